@@ -0,0 +1,177 @@
+#include "analyticspring.h"
+#include "physicsengine.h"
+#include <cmath>
+
+namespace {
+
+// Damping ratios this close to 1 use the critical solution; the other two
+// divide by numbers that vanish there
+const qreal CRITICAL_TOLERANCE = 1e-6;
+const int BISECTION_STEPS = 48;
+
+// Earliest time from which bound(t) stays under threshold, for a bound
+// that only decreases after peak
+template <typename Bound>
+qreal settleAfter(Bound bound, qreal peak, qreal threshold, qreal timescale)
+{
+    if (bound(peak) < threshold) {
+        // Below its maximum, so below everywhere
+        return 0.0;
+    }
+    qreal lo = peak;
+    qreal hi = peak + timescale;
+    while (bound(hi) >= threshold) {
+        lo = hi;
+        hi = peak + 2.0 * (hi - peak);
+        if (hi >= AnalyticSpring::MAX_SETTLE_TIME) {
+            return AnalyticSpring::MAX_SETTLE_TIME;
+        }
+    }
+    for (int i = 0; i < BISECTION_STEPS; ++i) {
+        const qreal mid = 0.5 * (lo + hi);
+        if (bound(mid) < threshold) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+// Where (p + q t) e^(-omega t) peaks
+qreal linearExponentialPeak(qreal p, qreal q, qreal omega)
+{
+    return q > 0 ? qMax<qreal>(0.0, 1.0 / omega - p / q) : 0.0;
+}
+
+} // namespace
+
+AnalyticSpring::AnalyticSpring(const PhysicsState &start, qreal positionThreshold, qreal velocityThreshold)
+    : m_target(start.targetPosition)
+{
+    if (!isSolvable(start)) {
+        return;
+    }
+
+    const qreal x0 = start.position - start.targetPosition;
+    const qreal v0 = start.velocity;
+    m_omega = std::sqrt(start.springConstant);
+    const qreal zeta = start.damping / (2.0 * m_omega);
+
+    if (qAbs(zeta - 1.0) < CRITICAL_TOLERANCE) {
+        m_damping = CriticallyDamped;
+        m_a = x0;
+        m_b = v0 + m_omega * x0;
+    } else if (zeta < 1.0) {
+        m_damping = Underdamped;
+        m_decay = zeta * m_omega;
+        m_frequency = m_omega * std::sqrt(1.0 - zeta * zeta);
+        m_a = x0;
+        m_b = (v0 + m_decay * x0) / m_frequency;
+    } else {
+        m_damping = Overdamped;
+        const qreal root = std::sqrt(zeta * zeta - 1.0);
+        m_r1 = -m_omega * (zeta - root); // The slow mode
+        m_r2 = -m_omega * (zeta + root);
+        m_a = (v0 - m_r2 * x0) / (m_r1 - m_r2);
+        m_b = x0 - m_a;
+    }
+    m_settleTime = computeSettleTime(positionThreshold, velocityThreshold);
+}
+
+bool AnalyticSpring::isSolvable(const PhysicsState &state)
+{
+    return state.springConstant > 0 && state.damping >= 0;
+}
+
+void AnalyticSpring::evaluate(qreal t, qreal *offset, qreal *rate) const
+{
+    switch (m_damping) {
+    case Underdamped: {
+        const qreal envelope = std::exp(-m_decay * t);
+        const qreal c = std::cos(m_frequency * t);
+        const qreal s = std::sin(m_frequency * t);
+        *offset = envelope * (m_a * c + m_b * s);
+        *rate = envelope * ((m_b * m_frequency - m_decay * m_a) * c
+                            - (m_a * m_frequency + m_decay * m_b) * s);
+        break;
+    }
+    case CriticallyDamped: {
+        const qreal envelope = std::exp(-m_omega * t);
+        *offset = (m_a + m_b * t) * envelope;
+        *rate = (m_b - m_omega * (m_a + m_b * t)) * envelope;
+        break;
+    }
+    case Overdamped: {
+        const qreal slow = m_a * std::exp(m_r1 * t);
+        const qreal fast = m_b * std::exp(m_r2 * t);
+        *offset = slow + fast;
+        *rate = m_r1 * slow + m_r2 * fast;
+        break;
+    }
+    }
+}
+
+qreal AnalyticSpring::position(qreal t) const
+{
+    qreal offset = 0;
+    qreal rate = 0;
+    evaluate(t, &offset, &rate);
+    return m_target + offset;
+}
+
+qreal AnalyticSpring::velocity(qreal t) const
+{
+    qreal offset = 0;
+    qreal rate = 0;
+    evaluate(t, &offset, &rate);
+    return rate;
+}
+
+qreal AnalyticSpring::computeSettleTime(qreal positionThreshold, qreal velocityThreshold) const
+{
+    if (m_omega <= 0) {
+        return 0.0;
+    }
+
+    switch (m_damping) {
+    case Underdamped: {
+        // Both oscillate inside envelopes: amplitude * e^(-decay t) for the
+        // position and omega times that for the velocity
+        const qreal amplitude = std::hypot(m_a, m_b);
+        if (m_decay <= 0) {
+            // Undamped: it never settles unless it is already at rest
+            return amplitude < positionThreshold && amplitude * m_omega < velocityThreshold
+                ? 0.0 : MAX_SETTLE_TIME;
+        }
+        const qreal forPosition = std::log(amplitude / positionThreshold) / m_decay;
+        const qreal forVelocity = std::log(amplitude * m_omega / velocityThreshold) / m_decay;
+        return qBound<qreal>(0.0, qMax(forPosition, forVelocity), MAX_SETTLE_TIME);
+    }
+    case CriticallyDamped: {
+        // |x| <= (|a| + |b| t) e^(-omega t), and alike for the velocity
+        const qreal pa = qAbs(m_a);
+        const qreal pb = qAbs(m_b);
+        const qreal va = qAbs(m_b - m_omega * m_a);
+        const qreal vb = m_omega * qAbs(m_b);
+        const qreal timescale = 1.0 / m_omega;
+        const qreal forPosition = settleAfter([&](qreal t) { return (pa + pb * t) * std::exp(-m_omega * t); },
+                                              linearExponentialPeak(pa, pb, m_omega), positionThreshold, timescale);
+        const qreal forVelocity = settleAfter([&](qreal t) { return (va + vb * t) * std::exp(-m_omega * t); },
+                                              linearExponentialPeak(va, vb, m_omega), velocityThreshold, timescale);
+        return qMax(forPosition, forVelocity);
+    }
+    case Overdamped: {
+        // Sums of decaying exponentials, so the bounds only decrease
+        const qreal timescale = -1.0 / m_r1;
+        const qreal forPosition = settleAfter([&](qreal t) {
+            return qAbs(m_a) * std::exp(m_r1 * t) + qAbs(m_b) * std::exp(m_r2 * t);
+        }, 0.0, positionThreshold, timescale);
+        const qreal forVelocity = settleAfter([&](qreal t) {
+            return qAbs(m_a * m_r1) * std::exp(m_r1 * t) + qAbs(m_b * m_r2) * std::exp(m_r2 * t);
+        }, 0.0, velocityThreshold, timescale);
+        return qMax(forPosition, forVelocity);
+    }
+    }
+    return 0.0;
+}
@@ -0,0 +1,59 @@
+#ifndef ANALYTICSPRING_H
+#define ANALYTICSPRING_H
+
+#include <QtGlobal>
+
+class PhysicsState;
+
+// Closed-form motion of a PhysicsState spring released at time zero.
+//
+// With unit mass the spring is x'' + c x' + k x = 0 around its target, so
+// position and velocity at any time come straight from the under-,
+// critically or over-damped solution instead of from substeps. The time
+// after which both stay inside the settle thresholds is worked out up
+// front from the solution's decay envelope. Limits are not part of the
+// solution; the caller clamps and starts a new one from there.
+class AnalyticSpring
+{
+public:
+    enum Damping {
+        Underdamped,
+        CriticallyDamped,
+        Overdamped
+    };
+
+    AnalyticSpring() = default;
+    AnalyticSpring(const PhysicsState &start, qreal positionThreshold, qreal velocityThreshold);
+
+    // The closed form needs a real spring: positive stiffness, no negative damping
+    static bool isSolvable(const PhysicsState &state);
+
+    Damping damping() const { return m_damping; }
+    qreal position(qreal t) const;
+    qreal velocity(qreal t) const;
+    // From release until position and velocity are settled for good
+    qreal settleTime() const { return m_settleTime; }
+    qreal target() const { return m_target; }
+
+    static constexpr qreal MAX_SETTLE_TIME = 60.0; // Seconds
+
+private:
+    // Offset from the target and its derivative
+    void evaluate(qreal t, qreal *offset, qreal *rate) const;
+    qreal computeSettleTime(qreal positionThreshold, qreal velocityThreshold) const;
+
+    Damping m_damping = CriticallyDamped;
+    qreal m_target = 0;
+    qreal m_omega = 0;       // Undamped angular frequency, sqrt(k)
+    // Underdamped: decay rate and damped frequency. Critical: x = (a + b t) e^(-omega t).
+    // Overdamped: x = a e^(r1 t) + b e^(r2 t).
+    qreal m_decay = 0;
+    qreal m_frequency = 0;
+    qreal m_a = 0;
+    qreal m_b = 0;
+    qreal m_r1 = 0;
+    qreal m_r2 = 0;
+    qreal m_settleTime = 0;
+};
+
+#endif // ANALYTICSPRING_H
@@ -0,0 +1,782 @@
+#include "backupengine.h"
+#include "checksum.h"
+#include "snapshotcatalog.h"
+#include "zipreader.h"
+#include "zipwriter.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+
+// Static member definitions
+const int BackupEngine::COMPRESSION_LEVEL;
+const int BackupEngine::MIN_AUTO_BACKUP_DELAY;
+const int BackupEngine::MAX_TIMER_INTERVAL;
+
+namespace {
+
+constexpr quint32 kSnapshotMagic = 0x514e4231; // "QNB1"
+constexpr quint16 kSnapshotVersion = 1;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_12;
+
+const char kSnapshotSuffix[] = ".qnsnap";
+const char kZipSuffix[] = ".zip";
+const char kSnapshotIdFormat[] = "yyyy-MM-dd_hh-mm-ss";
+
+bool sameEntry(const BackupEngine::Entry &a, const BackupEngine::Entry &b)
+{
+    return a.path == b.path && a.size == b.size
+        && a.modified == b.modified && a.hash == b.hash;
+}
+
+bool entryLessThan(const BackupEngine::Entry &a, const BackupEngine::Entry &b)
+{
+    return a.path < b.path;
+}
+
+} // namespace
+
+BackupEngine::BackupEngine()
+    : m_cancelFlag(std::make_shared<std::atomic_bool>(false))
+{
+    qRegisterMetaType<BackupEngine::Result>();
+
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &BackupEngine::onJobFinished);
+
+    m_autoTimer.setSingleShot(true);
+    connect(&m_autoTimer, &QTimer::timeout, this, &BackupEngine::onAutoBackupTimer);
+
+    // The singleton outlives the event loop; stop a running job while the
+    // application is still around to finish it cleanly
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        m_autoTimer.stop();
+        m_cancelFlag->store(true);
+        m_watcher.waitForFinished();
+    });
+
+    reloadSettings();
+}
+
+BackupEngine::~BackupEngine()
+{
+    m_cancelFlag->store(true);
+    m_watcher.waitForFinished();
+}
+
+void BackupEngine::setSourcePath(const QString &path)
+{
+    if (m_sourcePath == path) {
+        return;
+    }
+    m_sourcePath = path;
+    scheduleAutoBackup();
+}
+
+void BackupEngine::reloadSettings()
+{
+    QSettings settings;
+    const QString defaultPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)
+                              + "/QuteNote/Backups";
+    const QString repository = settings.value("backupLocation", defaultPath).toString();
+    m_autoBackupEnabled = settings.value("autoBackupEnabled", false).toBool();
+    m_autoBackupHours = qMax(1, settings.value("autoBackupInterval", 24).toInt());
+
+    if (repository != m_repositoryPath) {
+        m_repositoryPath = repository;
+        m_latest.reset();
+        m_catalog.reset();
+    }
+
+    m_lastBackup = QDateTime::fromString(settings.value("lastBackupTime").toString(), Qt::TextDate);
+    if (!m_lastBackup.isValid()) {
+        const QStringList ids = snapshotIds(m_repositoryPath);
+        if (!ids.isEmpty()) {
+            m_lastBackup = QDateTime::fromString(ids.last().left(int(qstrlen(kSnapshotIdFormat))),
+                                                 kSnapshotIdFormat);
+        }
+    }
+
+    scheduleAutoBackup();
+}
+
+std::shared_ptr<SnapshotCatalog> BackupEngine::catalog()
+{
+    if (!m_catalog || m_catalog->repositoryPath() != m_repositoryPath) {
+        m_catalog = std::make_shared<SnapshotCatalog>(m_repositoryPath);
+    }
+    return m_catalog;
+}
+
+bool BackupEngine::startBackup()
+{
+    if (m_job != Job::None || m_sourcePath.isEmpty() || m_repositoryPath.isEmpty()) {
+        return false;
+    }
+
+    const QString source = m_sourcePath;
+    const QString repository = m_repositoryPath;
+    Snapshot previous;
+    if (m_latest && m_latest->sourcePath == source) {
+        previous = *m_latest;
+    }
+    auto written = std::make_shared<Snapshot>();
+    m_written = written;
+    CancelFlag cancelled = m_cancelFlag;
+
+    const ProgressFn progress = progressReporter();
+
+    m_job = Job::Backup;
+    m_autoTimer.stop();
+    emit backupStarted();
+    m_watcher.setFuture(QtConcurrent::run([source, repository, previous, written, cancelled, progress]() {
+        return backupInWorker(source, repository, previous, written.get(), cancelled, progress);
+    }));
+    return true;
+}
+
+bool BackupEngine::startExport(const QString &zipFile)
+{
+    if (m_job != Job::None || m_sourcePath.isEmpty() || zipFile.isEmpty()) {
+        return false;
+    }
+
+    const QString source = m_sourcePath;
+    const QString repository = m_repositoryPath;
+    CancelFlag cancelled = m_cancelFlag;
+    const ProgressFn progress = progressReporter();
+
+    m_job = Job::Export;
+    m_autoTimer.stop();
+    m_watcher.setFuture(QtConcurrent::run([source, repository, zipFile, cancelled, progress]() {
+        return exportInWorker(source, repository, zipFile, cancelled, progress);
+    }));
+    return true;
+}
+
+bool BackupEngine::startRestore(const QString &backupFile)
+{
+    const bool zip = isZipFile(backupFile);
+    if (m_job != Job::None || m_sourcePath.isEmpty() || (!zip && !isSnapshotFile(backupFile))) {
+        return false;
+    }
+
+    const QString target = m_sourcePath;
+    CancelFlag cancelled = m_cancelFlag;
+    const ProgressFn progress = progressReporter();
+
+    m_job = Job::Restore;
+    m_autoTimer.stop();
+    m_watcher.setFuture(QtConcurrent::run([backupFile, zip, target, cancelled, progress]() {
+        return zip ? importInWorker(backupFile, target, cancelled, progress)
+                   : restoreInWorker(backupFile, target, cancelled, progress);
+    }));
+    return true;
+}
+
+BackupEngine::ProgressFn BackupEngine::progressReporter()
+{
+    // Only whole steps of a thousandth reach the UI thread
+    auto lastStep = std::make_shared<std::atomic_int>(-1);
+    return [this, lastStep](qint64 done, qint64 total) {
+        const int step = total > 0 ? int(qBound<qint64>(0, done * 1000 / total, 1000)) : 1000;
+        if (lastStep->exchange(step) == step) {
+            return;
+        }
+        QMetaObject::invokeMethod(this, [this, done, total]() {
+            emit progressChanged(done, total);
+        }, Qt::QueuedConnection);
+    };
+}
+
+void BackupEngine::onJobFinished()
+{
+    const Job job = m_job;
+    m_job = Job::None;
+    const Result result = m_watcher.result();
+
+    if (job == Job::Backup) {
+        if (result.ok) {
+            if (m_written && !m_written->isNull()) {
+                m_latest = m_written;
+                if (m_catalog && !result.unchanged) {
+                    m_catalog->addSnapshot(*m_latest);
+                }
+            }
+            m_lastBackup = QDateTime::currentDateTime();
+            QSettings settings;
+            settings.setValue("lastBackupTime", m_lastBackup.toString());
+            scheduleAutoBackup();
+        } else {
+            qWarning() << "BackupEngine: backup failed:" << result.error;
+            // Try again later rather than as soon as the minimum delay allows
+            if (m_autoBackupEnabled) {
+                m_autoTimer.start(MAX_TIMER_INTERVAL);
+            }
+        }
+        m_written.reset();
+        emit backupFinished(result);
+    } else if (job == Job::Export) {
+        if (!result.ok) {
+            qWarning() << "BackupEngine: export failed:" << result.error;
+        }
+        emit exportFinished(result);
+        scheduleAutoBackup();
+    } else if (job == Job::Restore) {
+        if (!result.ok) {
+            qWarning() << "BackupEngine: restore failed:" << result.error;
+        }
+        emit restoreFinished(result.ok, result.error);
+        scheduleAutoBackup();
+    }
+}
+
+void BackupEngine::scheduleAutoBackup()
+{
+    m_autoTimer.stop();
+    if (!m_autoBackupEnabled || m_job != Job::None) {
+        return;
+    }
+
+    qint64 remaining = 0;
+    if (m_lastBackup.isValid()) {
+        const QDateTime due = m_lastBackup.addSecs(qint64(m_autoBackupHours) * 60 * 60);
+        remaining = QDateTime::currentDateTime().msecsTo(due);
+    }
+    m_autoTimer.start(int(qBound<qint64>(MIN_AUTO_BACKUP_DELAY, remaining, MAX_TIMER_INTERVAL)));
+}
+
+void BackupEngine::onAutoBackupTimer()
+{
+    const bool due = !m_lastBackup.isValid()
+        || m_lastBackup.addSecs(qint64(m_autoBackupHours) * 60 * 60) <= QDateTime::currentDateTime();
+    if (!due || !startBackup()) {
+        scheduleAutoBackup();
+    }
+}
+
+BackupEngine::Result BackupEngine::backupInWorker(const QString &source, const QString &repository,
+                                                  Snapshot previous, Snapshot *written,
+                                                  const CancelFlag &cancelled, const ProgressFn &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+
+    if (!QFileInfo(source).isDir()) {
+        result.error = QString("Notes directory %1 does not exist").arg(source);
+        return result;
+    }
+    if (!QDir().mkpath(repository + "/objects") || !QDir().mkpath(repository + "/snapshots")) {
+        result.error = QString("Could not create backup location %1").arg(repository);
+        return result;
+    }
+
+    if (previous.isNull()) {
+        previous = latestSnapshot(repository);
+    }
+    QHash<QString, int> previousIndex;
+    previousIndex.reserve(previous.entries.size());
+    for (int i = 0; i < previous.entries.size(); ++i) {
+        previousIndex.insert(previous.entries.at(i).path, i);
+    }
+
+    QVector<Entry> entries = scanSource(source, repository, cancelled);
+    if (cancelled->load()) {
+        result.error = "Cancelled";
+        return result;
+    }
+
+    QSet<QByteArray> storedThisRun;
+    for (int i = 0; i < entries.size(); ++i) {
+        Entry &entry = entries[i];
+        if (cancelled->load()) {
+            result.error = "Cancelled";
+            return result;
+        }
+        progress(i, entries.size());
+        if (entry.size < 0) {
+            continue; // Directory
+        }
+        ++result.fileCount;
+
+        // Unchanged size and mtime: trust the hash (and blob) we already have
+        const auto it = previousIndex.constFind(entry.path);
+        if (it != previousIndex.constEnd()) {
+            const Entry &known = previous.entries.at(*it);
+            if (!known.isDirectory() && known.size == entry.size && known.modified == entry.modified) {
+                entry.hash = known.hash;
+                continue;
+            }
+        }
+
+        QByteArray content;
+        entry.hash = hashFile(source + "/" + entry.path, &content);
+        if (entry.hash.isEmpty()) {
+            result.error = QString("Could not read %1").arg(entry.path);
+            return result;
+        }
+        ++result.hashedCount;
+
+        if (storedThisRun.contains(entry.hash) || QFileInfo::exists(blobPath(repository, entry.hash))) {
+            continue;
+        }
+        if (!writeBlob(repository, entry.hash, content, &result.bytesWritten)) {
+            result.error = QString("Could not store %1 in %2").arg(entry.path, repository);
+            return result;
+        }
+        storedThisRun.insert(entry.hash);
+        ++result.storedCount;
+    }
+
+    // Nothing at all changed: the previous snapshot still describes the notes
+    if (!previous.isNull() && previous.sourcePath == source
+        && std::equal(entries.cbegin(), entries.cend(),
+                      previous.entries.cbegin(), previous.entries.cend(), sameEntry)) {
+        *written = previous;
+        result.ok = true;
+        result.unchanged = true;
+        result.snapshotId = previous.id;
+        result.elapsedMs = timer.elapsed();
+        return result;
+    }
+
+    Snapshot snapshot;
+    snapshot.created = QDateTime::currentDateTime();
+    snapshot.sourcePath = source;
+    snapshot.entries = std::move(entries);
+    snapshot.id = snapshot.created.toString(kSnapshotIdFormat);
+    // Two backups within the same second get a counter rather than clobbering
+    for (int n = 2; QFileInfo::exists(snapshotFilePath(repository, snapshot.id)); ++n) {
+        snapshot.id = snapshot.created.toString(kSnapshotIdFormat) + QString("_%1").arg(n);
+    }
+
+    if (!writeSnapshot(repository, snapshot, &result.bytesWritten, &result.error)) {
+        return result;
+    }
+
+    *written = snapshot;
+    result.ok = true;
+    result.snapshotId = snapshot.id;
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+BackupEngine::Result BackupEngine::restoreInWorker(const QString &snapshotFile, const QString &target,
+                                                   const CancelFlag &cancelled, const ProgressFn &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+
+    Snapshot snapshot;
+    if (!readSnapshot(snapshotFile, &snapshot, &result.error)) {
+        return result;
+    }
+    const QString repository = repositoryOf(snapshotFile);
+    result.snapshotId = snapshot.id;
+
+    // Files that are not part of the snapshot are left alone; everything the
+    // snapshot has is put back as it was.
+    for (int i = 0; i < snapshot.entries.size(); ++i) {
+        const Entry &entry = snapshot.entries.at(i);
+        if (cancelled->load()) {
+            result.error = "Cancelled";
+            return result;
+        }
+        progress(i, snapshot.entries.size());
+
+        const QString path = target + "/" + entry.path;
+        if (entry.isDirectory()) {
+            if (!QDir().mkpath(path)) {
+                result.error = QString("Could not create %1").arg(path);
+                return result;
+            }
+            continue;
+        }
+        ++result.fileCount;
+
+        const QFileInfo existing(path);
+        if (existing.isFile() && existing.size() == entry.size
+            && existing.lastModified().toMSecsSinceEpoch() == entry.modified) {
+            continue;
+        }
+
+        QByteArray content;
+        if (!readBlob(repository, entry.hash, &content)) {
+            result.error = QString("The backup copy of %1 is missing or damaged").arg(entry.path);
+            return result;
+        }
+
+        QDir().mkpath(existing.absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit()) {
+            result.error = QString("Could not write %1").arg(path);
+            return result;
+        }
+        QFile stamp(path);
+        if (stamp.open(QIODevice::Append)) {
+            stamp.setFileTime(QDateTime::fromMSecsSinceEpoch(entry.modified), QFileDevice::FileModificationTime);
+        }
+        ++result.storedCount;
+        result.bytesWritten += content.size();
+    }
+
+    result.ok = true;
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+BackupEngine::Result BackupEngine::exportInWorker(const QString &source, const QString &repository,
+                                                  const QString &zipFile, const CancelFlag &cancelled,
+                                                  const ProgressFn &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+
+    if (!QFileInfo(source).isDir()) {
+        result.error = QString("Notes directory %1 does not exist").arg(source);
+        return result;
+    }
+    const QVector<Entry> entries = scanSource(source, repository, cancelled);
+    if (cancelled->load()) {
+        result.error = "Cancelled";
+        return result;
+    }
+
+    ZipWriter writer(zipFile);
+    if (!writer.open()) {
+        result.error = writer.errorString();
+        return result;
+    }
+
+    QVector<ZipWriter::Source> files;
+    qint64 totalBytes = 0;
+    for (const Entry &entry : entries) {
+        const QString path = source + "/" + entry.path;
+        if (entry.size < 0) {
+            if (!writer.addDirectory(entry.path, QFileInfo(path).lastModified())) {
+                result.error = writer.errorString();
+                return result;
+            }
+            continue;
+        }
+        files.append({entry.path, path});
+        totalBytes += entry.size;
+    }
+    result.fileCount = files.size();
+
+    const bool ok = writer.addFiles(files, [&](qint64 bytesDone) {
+        progress(bytesDone, totalBytes);
+        return !cancelled->load();
+    });
+    if (!ok || !writer.close()) {
+        result.error = writer.errorString();
+        return result;
+    }
+
+    result.ok = true;
+    result.storedCount = files.size();
+    result.bytesWritten = QFileInfo(zipFile).size();
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+BackupEngine::Result BackupEngine::importInWorker(const QString &zipFile, const QString &target,
+                                                  const CancelFlag &cancelled, const ProgressFn &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+
+    ZipReader reader(zipFile);
+    if (!reader.open()) {
+        result.error = reader.errorString();
+        return result;
+    }
+    const qint64 totalBytes = qint64(reader.totalUncompressedSize());
+    qint64 bytesDone = 0;
+
+    const QVector<ZipReader::Entry> entries = reader.entries();
+    for (const ZipReader::Entry &entry : entries) {
+        if (cancelled->load()) {
+            result.error = "Cancelled";
+            return result;
+        }
+        // Never write outside the notes directory, whatever the archive says
+        if (!ZipReader::isSafeName(entry.name)) {
+            qWarning() << "BackupEngine: skipping unsafe archive entry" << entry.name;
+            continue;
+        }
+
+        const QString path = target + "/" + entry.name;
+        if (entry.isDirectory()) {
+            if (!QDir().mkpath(path)) {
+                result.error = QString("Could not create %1").arg(path);
+                return result;
+            }
+            continue;
+        }
+        ++result.fileCount;
+
+        // Each note is replaced in one step, or not at all
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            result.error = QString("Could not write %1: %2").arg(path, file.errorString());
+            return result;
+        }
+        const bool extracted = reader.extract(entry, &file, [&](qint64 entryBytes) {
+            progress(bytesDone + entryBytes, totalBytes);
+            return !cancelled->load();
+        });
+        if (!extracted) {
+            result.error = reader.errorString();
+            return result;
+        }
+        if (!file.commit()) {
+            result.error = QString("Could not write %1: %2").arg(path, file.errorString());
+            return result;
+        }
+        bytesDone += qint64(entry.uncompressedSize);
+
+        if (entry.modified.isValid()) {
+            QFile stamp(path);
+            if (stamp.open(QIODevice::Append)) {
+                stamp.setFileTime(entry.modified, QFileDevice::FileModificationTime);
+            }
+        }
+        ++result.storedCount;
+        result.bytesWritten += qint64(entry.uncompressedSize);
+    }
+
+    result.ok = true;
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QVector<BackupEngine::Entry> BackupEngine::scanSource(const QString &source, const QString &repository,
+                                                      const CancelFlag &cancelled)
+{
+    QVector<Entry> entries;
+    const QString sourceRoot = QDir(source).absolutePath();
+    const QString repositoryRoot = QDir(repository).absolutePath();
+
+    QStringList pending{sourceRoot};
+    while (!pending.isEmpty()) {
+        if (cancelled->load()) {
+            return {};
+        }
+        const QString directory = pending.takeLast();
+        // Hidden files (the ordering index) are part of the notes; hidden
+        // folders (.git, sync tool state) are not
+        const QFileInfoList children = QDir(directory).entryInfoList(
+            QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+        for (const QFileInfo &info : children) {
+            const QString path = info.absoluteFilePath();
+            Entry entry;
+            entry.path = path.mid(sourceRoot.size() + 1);
+            if (info.isDir()) {
+                if (info.fileName().startsWith('.') || path == repositoryRoot) {
+                    continue;
+                }
+                pending.append(path);
+            } else {
+                entry.size = info.size();
+                entry.modified = info.lastModified().toMSecsSinceEpoch();
+            }
+            entries.append(entry);
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), entryLessThan);
+    return entries;
+}
+
+QByteArray BackupEngine::hashFile(const QString &path, QByteArray *content)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    *content = file.readAll();
+    return QCryptographicHash::hash(*content, QCryptographicHash::Sha256);
+}
+
+bool BackupEngine::writeBlob(const QString &repository, const QByteArray &hash,
+                             const QByteArray &content, qint64 *bytesWritten)
+{
+    const QString path = blobPath(repository, hash);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+
+    const QByteArray compressed = qCompress(content, COMPRESSION_LEVEL);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(compressed) != compressed.size() || !file.commit()) {
+        qWarning() << "BackupEngine: could not write" << path << file.errorString();
+        return false;
+    }
+    *bytesWritten += compressed.size();
+    return true;
+}
+
+bool BackupEngine::writeSnapshot(const QString &repository, const Snapshot &snapshot,
+                                 qint64 *bytesWritten, QString *error)
+{
+    QByteArray body;
+    {
+        QDataStream out(&body, QIODevice::WriteOnly);
+        out.setVersion(kStreamVersion);
+        out << qint64(snapshot.created.toMSecsSinceEpoch()) << snapshot.sourcePath
+            << quint32(snapshot.entries.size());
+        for (const Entry &entry : snapshot.entries) {
+            out << entry.path << entry.size << entry.modified << entry.hash;
+        }
+    }
+    const QByteArray compressed = qCompress(body, COMPRESSION_LEVEL);
+
+    const QString path = snapshotFilePath(repository, snapshot.id);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = QString("Could not write %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    QDataStream out(&file);
+    out.setVersion(kStreamVersion);
+    out << kSnapshotMagic << kSnapshotVersion << QuteNote::recordChecksum(compressed) << compressed;
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        *error = QString("Could not write %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    *bytesWritten += QFileInfo(path).size();
+    return true;
+}
+
+bool BackupEngine::readSnapshot(const QString &snapshotFile, Snapshot *snapshot, QString *error)
+{
+    auto fail = [&](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile file(snapshotFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(QString("Could not open %1").arg(snapshotFile));
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 checksum = 0;
+    QByteArray compressed;
+    in >> magic >> version;
+    if (magic != kSnapshotMagic || version != kSnapshotVersion) {
+        return fail(QString("%1 is not a QuteNote snapshot").arg(snapshotFile));
+    }
+    in >> checksum >> compressed;
+    if (in.status() != QDataStream::Ok || QuteNote::recordChecksum(compressed) != checksum) {
+        return fail(QString("%1 is damaged").arg(snapshotFile));
+    }
+
+    const QByteArray body = qUncompress(compressed);
+    QDataStream data(body);
+    data.setVersion(kStreamVersion);
+    qint64 created = 0;
+    quint32 count = 0;
+    Snapshot result;
+    data >> created >> result.sourcePath >> count;
+    result.entries.reserve(int(qMin<quint32>(count, 1u << 20)));
+    for (quint32 i = 0; i < count && data.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        data >> entry.path >> entry.size >> entry.modified >> entry.hash;
+        result.entries.append(entry);
+    }
+    if (body.isEmpty() || data.status() != QDataStream::Ok) {
+        return fail(QString("%1 is damaged").arg(snapshotFile));
+    }
+
+    result.id = QFileInfo(snapshotFile).completeBaseName();
+    result.created = QDateTime::fromMSecsSinceEpoch(created);
+    *snapshot = std::move(result);
+    return true;
+}
+
+bool BackupEngine::readBlob(const QString &repository, const QByteArray &hash, QByteArray *content)
+{
+    QFile file(blobPath(repository, hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray compressed = file.readAll();
+    *content = qUncompress(compressed);
+    // qUncompress() returns nothing both for damage and for empty content
+    if (content->isEmpty() && compressed != qCompress(QByteArray(), COMPRESSION_LEVEL)) {
+        return false;
+    }
+    return QCryptographicHash::hash(*content, QCryptographicHash::Sha256) == hash;
+}
+
+BackupEngine::Snapshot BackupEngine::latestSnapshot(const QString &repository)
+{
+    const QStringList ids = snapshotIds(repository);
+    for (auto it = ids.crbegin(); it != ids.crend(); ++it) {
+        Snapshot snapshot;
+        if (readSnapshot(snapshotFilePath(repository, *it), &snapshot)) {
+            return snapshot;
+        }
+    }
+    return {};
+}
+
+QStringList BackupEngine::snapshotIds(const QString &repository)
+{
+    QStringList ids = QDir(repository + "/snapshots").entryList(
+        {QString("*") + kSnapshotSuffix}, QDir::Files, QDir::Name);
+    for (QString &id : ids) {
+        id.chop(int(qstrlen(kSnapshotSuffix)));
+    }
+    return ids;
+}
+
+QString BackupEngine::snapshotFilePath(const QString &repository, const QString &id)
+{
+    return repository + "/snapshots/" + id + kSnapshotSuffix;
+}
+
+QString BackupEngine::blobPath(const QString &repository, const QByteArray &hash)
+{
+    const QString hex = QString::fromLatin1(hash.toHex());
+    return repository + "/objects/" + hex.left(2) + "/" + hex.mid(2);
+}
+
+QString BackupEngine::repositoryOf(const QString &snapshotFile)
+{
+    QDir dir = QFileInfo(snapshotFile).absoluteDir();
+    dir.cdUp();
+    return dir.absolutePath();
+}
+
+bool BackupEngine::isSnapshotFile(const QString &path)
+{
+    return path.endsWith(kSnapshotSuffix) && QFileInfo(path).isFile();
+}
+
+bool BackupEngine::isZipFile(const QString &path)
+{
+    return path.endsWith(kZipSuffix, Qt::CaseInsensitive) && QFileInfo(path).isFile();
+}
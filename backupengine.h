@@ -0,0 +1,172 @@
+#ifndef BACKUPENGINE_H
+#define BACKUPENGINE_H
+
+#include "smartpointers.h"
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class SnapshotCatalog;
+
+// Incremental, deduplicating backups of the notes directory.
+//
+// A backup location is a small content-addressed repository:
+//
+//   objects/ab/cdef...          one zlib-compressed blob per distinct file
+//                               content, named by its SHA-256
+//   snapshots/<timestamp>.qnsnap  one manifest per backup: every path with
+//                               its size, mtime and blob hash, sorted by path
+//
+// A new backup only hashes files whose size or mtime differ from the
+// previous snapshot and only stores blobs the repository does not have yet.
+// If nothing changed at all no snapshot is written, so backing up an
+// untouched library costs one directory walk. All repository work happens
+// on a worker thread; automatic backups are scheduled from the
+// autoBackupEnabled/autoBackupInterval settings.
+//
+// The notes can also be exported to, and restored from, a plain ZIP archive
+// (see ZipWriter and ZipReader), which is streamed in both directions.
+class BackupEngine : public QObject, public QuteNote::Singleton<BackupEngine>
+{
+    Q_OBJECT
+    friend class QuteNote::Singleton<BackupEngine>;
+
+public:
+    struct Entry {
+        QString path;       // Relative to the notes directory, '/' separated
+        qint64 size = -1;   // -1 for directories
+        qint64 modified = 0; // ms since epoch
+        QByteArray hash;    // Raw SHA-256; empty for directories
+
+        bool isDirectory() const { return hash.isEmpty(); }
+    };
+
+    struct Snapshot {
+        QString id;          // File name without extension; sorts by time
+        QDateTime created;
+        QString sourcePath;
+        QVector<Entry> entries; // Sorted by path
+
+        bool isNull() const { return id.isEmpty(); }
+    };
+
+    struct Result {
+        bool ok = false;
+        bool unchanged = false; // Nothing to back up; no snapshot written
+        QString snapshotId;
+        int fileCount = 0;
+        int hashedCount = 0;    // Files that had to be read
+        int storedCount = 0;    // New blobs written
+        qint64 bytesWritten = 0;
+        qint64 elapsedMs = 0;
+        QString error;
+    };
+
+    // Where notes are backed up from and restored to
+    void setSourcePath(const QString &path);
+    QString sourcePath() const { return m_sourcePath; }
+    QString repositoryPath() const { return m_repositoryPath; }
+
+    // Re-reads the backup location and the automatic backup settings
+    void reloadSettings();
+
+    // Index of the snapshots in the current repository, kept up to date with
+    // the backups made from here; call refresh() on it (off the UI thread)
+    // to pick up anything else
+    std::shared_ptr<SnapshotCatalog> catalog();
+
+    bool isRunning() const { return m_watcher.isRunning(); }
+    // All return false if another job is still running
+    bool startBackup();
+    bool startExport(const QString &zipFile);
+    // Restores a snapshot (.qnsnap) or a ZIP export into the notes directory.
+    // Files that are not part of the backup are left alone.
+    bool startRestore(const QString &backupFile);
+
+    // Repository access; safe to call from any thread
+    static QStringList snapshotIds(const QString &repository);
+    static QString snapshotFilePath(const QString &repository, const QString &id);
+    static bool readSnapshot(const QString &snapshotFile, Snapshot *snapshot, QString *error = nullptr);
+    static QString blobPath(const QString &repository, const QByteArray &hash);
+    static bool readBlob(const QString &repository, const QByteArray &hash, QByteArray *content);
+    // The repository a snapshot file belongs to
+    static QString repositoryOf(const QString &snapshotFile);
+    static bool isSnapshotFile(const QString &path);
+    static bool isZipFile(const QString &path);
+
+Q_SIGNALS:
+    void backupStarted();
+    void backupFinished(const BackupEngine::Result &result);
+    void exportFinished(const BackupEngine::Result &result);
+    void restoreFinished(bool ok, const QString &error);
+    // Work done by the running job, in files or bytes of the total
+    void progressChanged(qint64 done, qint64 total);
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+    using ProgressFn = std::function<void(qint64 done, qint64 total)>;
+
+    BackupEngine();
+    ~BackupEngine() override;
+
+    void onJobFinished();
+    void scheduleAutoBackup();
+    void onAutoBackupTimer();
+    // Thread-safe; forwards worker progress as progressChanged()
+    ProgressFn progressReporter();
+
+    // Worker side
+    static Result backupInWorker(const QString &source, const QString &repository,
+                                 Snapshot previous, Snapshot *written,
+                                 const CancelFlag &cancelled, const ProgressFn &progress);
+    static Result restoreInWorker(const QString &snapshotFile, const QString &target,
+                                  const CancelFlag &cancelled, const ProgressFn &progress);
+    static Result exportInWorker(const QString &source, const QString &repository,
+                                 const QString &zipFile, const CancelFlag &cancelled,
+                                 const ProgressFn &progress);
+    static Result importInWorker(const QString &zipFile, const QString &target,
+                                 const CancelFlag &cancelled, const ProgressFn &progress);
+    static QVector<Entry> scanSource(const QString &source, const QString &repository,
+                                     const CancelFlag &cancelled);
+    static QByteArray hashFile(const QString &path, QByteArray *content);
+    static bool writeBlob(const QString &repository, const QByteArray &hash,
+                          const QByteArray &content, qint64 *bytesWritten);
+    static bool writeSnapshot(const QString &repository, const Snapshot &snapshot,
+                              qint64 *bytesWritten, QString *error);
+    static Snapshot latestSnapshot(const QString &repository);
+
+    enum class Job { None, Backup, Restore, Export };
+
+    QString m_sourcePath;
+    QString m_repositoryPath;
+    bool m_autoBackupEnabled = false;
+    int m_autoBackupHours = 24;
+    QDateTime m_lastBackup;
+
+    QFutureWatcher<Result> m_watcher;
+    Job m_job = Job::None;
+    CancelFlag m_cancelFlag;
+    // Manifest of the last snapshot, reused as the stat cache of the next
+    // backup so it does not have to be read back from the repository
+    std::shared_ptr<Snapshot> m_latest;
+    std::shared_ptr<Snapshot> m_written;
+    std::shared_ptr<SnapshotCatalog> m_catalog;
+    QTimer m_autoTimer;
+
+    static const int COMPRESSION_LEVEL = 6;
+    // Keeps an overdue backup from competing with startup, and paces retries
+    static const int MIN_AUTO_BACKUP_DELAY = 60 * 1000; // ms
+    // QTimer intervals are ints; longer waits are taken in steps
+    static const int MAX_TIMER_INTERVAL = 60 * 60 * 1000; // ms
+};
+
+Q_DECLARE_METATYPE(BackupEngine::Result)
+
+#endif // BACKUPENGINE_H
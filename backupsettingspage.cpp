@@ -7,6 +7,7 @@
 #include <QDateTime>
 #include <QSettings>
 #include <QFormLayout>
+#include <QDebug>
 
 BackupSettingsPage::BackupSettingsPage(QWidget *parent)
     : QWidget(parent)
@@ -80,10 +81,17 @@ void BackupSettingsPage::setupUI()
     QHBoxLayout *buttonLayout = new QHBoxLayout();
     m_backupNowBtn = new QPushButton("Backup Now", this);
     m_restoreBtn = new QPushButton("Restore from Backup", this);
+    m_exportBtn = new QPushButton("Export as ZIP...", this);
     buttonLayout->addWidget(m_backupNowBtn);
     buttonLayout->addWidget(m_restoreBtn);
+    buttonLayout->addWidget(m_exportBtn);
     buttonLayout->addStretch();
     manualBackupLayout->addLayout(buttonLayout);
+    m_progressBar = new QProgressBar(this);
+    m_progressBar->setRange(0, 1000);
+    m_progressBar->setTextVisible(false);
+    m_progressBar->hide();
+    manualBackupLayout->addWidget(m_progressBar);
     mainLayout->addWidget(manualBackupGroup);
     mainLayout->addStretch();
 
@@ -91,11 +99,19 @@ void BackupSettingsPage::setupUI()
     connect(m_browseBtn, &QPushButton::clicked, this, &BackupSettingsPage::onBrowseBackupLocation);
     connect(m_backupNowBtn, &QPushButton::clicked, this, &BackupSettingsPage::onBackupNow);
     connect(m_restoreBtn, &QPushButton::clicked, this, &BackupSettingsPage::onRestoreBackup);
+    connect(m_exportBtn, &QPushButton::clicked, this, &BackupSettingsPage::onExportZip);
     connect(m_autoBackupCheck, &QCheckBox::checkStateChanged, this, &BackupSettingsPage::onAutoBackupChanged);
     connect(m_backupLocationEdit, &QLineEdit::textChanged, this, &BackupSettingsPage::settingsChanged);
     connect(m_autoBackupInterval, QOverload<int>::of(&QSpinBox::valueChanged), this, &BackupSettingsPage::settingsChanged);
     connect(m_autoBackupCheck, &QCheckBox::toggled, this, &BackupSettingsPage::settingsChanged);
 
+    BackupEngine *engine = BackupEngine::instance();
+    connect(engine, &BackupEngine::backupStarted, this, &BackupSettingsPage::onBackupStarted);
+    connect(engine, &BackupEngine::backupFinished, this, &BackupSettingsPage::onBackupFinished);
+    connect(engine, &BackupEngine::exportFinished, this, &BackupSettingsPage::onExportFinished);
+    connect(engine, &BackupEngine::restoreFinished, this, &BackupSettingsPage::onRestoreFinished);
+    connect(engine, &BackupEngine::progressChanged, this, &BackupSettingsPage::onProgressChanged);
+
     // Apply theme styling to the spinbox
     ThemeManager::instance()->applyThemeToSpinBox(m_autoBackupInterval);
 }
@@ -110,6 +126,13 @@ void BackupSettingsPage::loadSettings()
     m_autoBackupCheck->setChecked(settings.value("autoBackupEnabled", false).toBool());
     m_autoBackupInterval->setValue(settings.value("autoBackupInterval", 24).toInt());
     
+    updateLastBackupLabel();
+    setBusy(BackupEngine::instance()->isRunning());
+}
+
+void BackupSettingsPage::updateLastBackupLabel()
+{
+    QSettings settings;
     QString lastBackup = settings.value("lastBackupTime").toString();
     if (!lastBackup.isEmpty()) {
         m_lastBackupLabel->setText("Last backup: " + lastBackup);
@@ -124,6 +147,10 @@ void BackupSettingsPage::saveSettings()
     settings.setValue("backupLocation", m_backupLocationEdit->text());
     settings.setValue("autoBackupEnabled", m_autoBackupCheck->isChecked());
     settings.setValue("autoBackupInterval", m_autoBackupInterval->value());
+    settings.sync();
+
+    // Picks up a new location and (re)schedules automatic backups
+    BackupEngine::instance()->reloadSettings();
 }
 
 void BackupSettingsPage::onBrowseBackupLocation()
@@ -155,25 +182,24 @@ void BackupSettingsPage::onBackupNow()
         return;
     }
 
-    // Create timestamped backup
-    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
-    QString backupPath = backupDir + "/backup_" + timestamp;
-    
-    createBackup(backupPath);
-    QSettings settings;
-    settings.setValue("lastBackupTime", QDateTime::currentDateTime().toString());
-    m_lastBackupLabel->setText("Last backup: " + QDateTime::currentDateTime().toString());
-    
-    QMessageBox::information(this, "Backup",
-        "Backup completed successfully.");
+    // Back up to the location shown, even if it has not been saved yet
+    saveSettings();
+    if (!createBackup()) {
+        QMessageBox::warning(this, "Backup",
+            "A backup or restore is already in progress.");
+    }
 }
 
 void BackupSettingsPage::onRestoreBackup()
 {
+    QString startDir = m_backupLocationEdit->text();
+    if (QDir(startDir + "/snapshots").exists()) {
+        startDir += "/snapshots";
+    }
     QString backupFile = QFileDialog::getOpenFileName(this,
         "Select Backup to Restore",
-        m_backupLocationEdit->text(),
-        "Backup Files (*.zip);;All Files (*)");
+        startDir,
+        "Snapshots (*.qnsnap);;Backup Files (*.zip);;All Files (*)");
     
     if (backupFile.isEmpty())
         return;
@@ -183,8 +209,8 @@ void BackupSettingsPage::onRestoreBackup()
         QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
         
         if (restoreFromBackup(backupFile)) {
-            QMessageBox::information(this, "Restore Backup",
-                "Backup restored successfully. Please restart the application.");
+            setBusy(true);
+            m_lastBackupLabel->setText("Restoring...");
         } else {
             QMessageBox::warning(this, "Restore Backup",
                 "Failed to restore from backup.");
@@ -198,16 +224,114 @@ void BackupSettingsPage::onAutoBackupChanged(int state)
     emit settingsChanged();
 }
 
-bool BackupSettingsPage::createBackup(const QString &path)
+bool BackupSettingsPage::createBackup()
 {
-    // Implementation for creating backup archive
-    // ... (implementation omitted for brevity)
+    if (!BackupEngine::instance()->startBackup()) {
+        return false;
+    }
+    m_backupRequested = true;
     return true;
 }
 
 bool BackupSettingsPage::restoreFromBackup(const QString &path)
 {
-    // Implementation for restoring from backup archive
-    // ... (implementation omitted for brevity)
-    return true;
+    if (!BackupEngine::isSnapshotFile(path) && !BackupEngine::isZipFile(path)) {
+        qWarning() << "BackupSettingsPage: not a snapshot or ZIP archive:" << path;
+        return false;
+    }
+    return BackupEngine::instance()->startRestore(path);
+}
+
+void BackupSettingsPage::onExportZip()
+{
+    const QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
+    QString zipFile = QFileDialog::getSaveFileName(this,
+        "Export Notes as ZIP",
+        m_backupLocationEdit->text() + "/QuteNote_" + timestamp + ".zip",
+        "ZIP Archives (*.zip)");
+    if (zipFile.isEmpty())
+        return;
+    if (!zipFile.endsWith(".zip", Qt::CaseInsensitive))
+        zipFile += ".zip";
+
+    if (BackupEngine::instance()->startExport(zipFile)) {
+        setBusy(true);
+        m_lastBackupLabel->setText("Exporting...");
+    } else {
+        QMessageBox::warning(this, "Export",
+            "A backup or restore is already in progress.");
+    }
+}
+
+void BackupSettingsPage::setBusy(bool busy)
+{
+    m_backupNowBtn->setEnabled(!busy);
+    m_restoreBtn->setEnabled(!busy);
+    m_exportBtn->setEnabled(!busy);
+    m_progressBar->setValue(0);
+    m_progressBar->setVisible(busy);
+}
+
+void BackupSettingsPage::onProgressChanged(qint64 done, qint64 total)
+{
+    m_progressBar->setValue(total > 0 ? int(done * 1000 / total) : 0);
+}
+
+void BackupSettingsPage::onBackupStarted()
+{
+    setBusy(true);
+    m_lastBackupLabel->setText("Backing up...");
+}
+
+void BackupSettingsPage::onBackupFinished(const BackupEngine::Result &result)
+{
+    setBusy(false);
+    updateLastBackupLabel();
+
+    // Automatic backups finish quietly
+    if (!m_backupRequested) {
+        return;
+    }
+    m_backupRequested = false;
+
+    if (!result.ok) {
+        QMessageBox::warning(this, "Backup",
+            "Backup failed: " + result.error);
+    } else if (result.unchanged) {
+        QMessageBox::information(this, "Backup",
+            "Nothing has changed since the last backup.");
+    } else {
+        QMessageBox::information(this, "Backup",
+            QString("Backup completed successfully.\n%1 notes, %2 new or changed (%3 KB written).")
+                .arg(result.fileCount).arg(result.storedCount).arg((result.bytesWritten + 1023) / 1024));
+    }
+}
+
+void BackupSettingsPage::onExportFinished(const BackupEngine::Result &result)
+{
+    setBusy(false);
+    updateLastBackupLabel();
+
+    if (result.ok) {
+        QMessageBox::information(this, "Export",
+            QString("Exported %1 notes (%2 KB).")
+                .arg(result.fileCount).arg((result.bytesWritten + 1023) / 1024));
+    } else {
+        QMessageBox::warning(this, "Export",
+            "Export failed: " + result.error);
+    }
+}
+
+void BackupSettingsPage::onRestoreFinished(bool ok, const QString &error)
+{
+    setBusy(false);
+    updateLastBackupLabel();
+
+    if (ok) {
+        QMessageBox::information(this, "Restore Backup",
+            "Backup restored successfully. Please restart the application.");
+    } else {
+        QMessageBox::warning(this, "Restore Backup",
+            "Failed to restore from backup: " + error);
+    }
 }
\ No newline at end of file
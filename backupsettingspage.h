@@ -9,6 +9,8 @@
 #include <QCheckBox>
 #include <QSpinBox>
 #include <QGroupBox>
+#include <QProgressBar>
+#include "backupengine.h"
 
 class BackupSettingsPage : public QWidget
 {
@@ -25,13 +27,21 @@ signals:
 private slots:
     void onBackupNow();
     void onRestoreBackup();
+    void onExportZip();
     void onBrowseBackupLocation();
     void onAutoBackupChanged(int state);
+    void onBackupStarted();
+    void onBackupFinished(const BackupEngine::Result &result);
+    void onExportFinished(const BackupEngine::Result &result);
+    void onRestoreFinished(bool ok, const QString &error);
+    void onProgressChanged(qint64 done, qint64 total);
 
 private:
     void setupUI();
-    bool createBackup(const QString &path);
+    bool createBackup();
     bool restoreFromBackup(const QString &path);
+    void updateLastBackupLabel();
+    void setBusy(bool busy);
 
     QLineEdit *m_backupLocationEdit;
     QCheckBox *m_autoBackupCheck;
@@ -39,7 +49,10 @@ private:
     QLabel *m_lastBackupLabel;
     QPushButton *m_backupNowBtn;
     QPushButton *m_restoreBtn;
+    QPushButton *m_exportBtn;
+    QProgressBar *m_progressBar;
     QPushButton *m_browseBtn;
+    bool m_backupRequested = false; // Report the result of a manual backup
 };
 
 #endif // BACKUPSETTINGSPAGE_H
\ No newline at end of file
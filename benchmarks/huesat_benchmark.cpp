@@ -0,0 +1,106 @@
+// Compares hue/saturation gradient generation before and after HueSatKernel.
+//
+//   huesat_benchmark [iterations]
+//
+// "qcolor" is the previous HueSatMapCache::generateGradient: QColor::setHsv()
+// and QImage::setPixel() per pixel, single-threaded (its OpenMP pragma was
+// never enabled). Each instruction set the CPU supports is then timed on
+// one thread, and the best one with row bands on the thread pool. Times are
+// the best of N iterations, in milliseconds; "diff" counts pixels that
+// differ from the QColor output.
+
+#include "huesatkernel.h"
+#include <QColor>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QTextStream>
+#include <QThreadPool>
+#include <limits>
+
+namespace {
+
+template <typename Fn>
+double bestOf(int iterations, Fn fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        best = qMin(best, timer.nsecsElapsed() / 1e6);
+    }
+    return best;
+}
+
+QImage qcolorGradient(const QSize &size)
+{
+    QImage gradient(size, QImage::Format_ARGB32_Premultiplied);
+    gradient.fill(Qt::transparent);
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            QColor color;
+            color.setHsv(HueSatKernel::hueForColumn(x, size.width()),
+                         HueSatKernel::saturationForRow(y, size.height()), 255);
+            gradient.setPixel(x, y, color.rgba());
+        }
+    }
+    return gradient;
+}
+
+qint64 differingPixels(const QImage &a, const QImage &b)
+{
+    qint64 count = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            count += lineA[x] != lineB[x];
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    const int iterations = args.size() > 1 ? qMax(1, args.at(1).toInt()) : 3;
+    const QVector<HueSatKernel::Isa> isas = HueSatKernel::availableIsas();
+    const HueSatKernel::Isa best = HueSatKernel::bestIsa();
+
+    out << "threads: " << QThreadPool::globalInstance()->maxThreadCount()
+        << ", best: " << HueSatKernel::isaName(best) << ", iterations: " << iterations << "\n\n";
+    out << qSetFieldWidth(10) << Qt::left << "size" << "qcolor";
+    for (HueSatKernel::Isa isa : isas) {
+        out << HueSatKernel::isaName(isa);
+    }
+    out << "parallel" << "speedup" << "diff" << qSetFieldWidth(0) << "\n";
+
+    for (int side : {48, 256, 512, 1024, 2048, 4096}) {
+        const QSize size(side, side);
+        QImage reference;
+        // The per-pixel path takes seconds at the top sizes; once is enough
+        const double legacyMs = bestOf(side >= 2048 ? 1 : iterations, [&]() { reference = qcolorGradient(size); });
+
+        out << qSetFieldWidth(10) << QString::number(side) << legacyMs;
+        qint64 diff = 0;
+        for (HueSatKernel::Isa isa : isas) {
+            QImage image;
+            out << bestOf(iterations, [&]() { image = HueSatKernel::generate(size, isa, false); });
+            diff = qMax(diff, differingPixels(reference, image));
+        }
+        QImage image;
+        const double parallelMs = bestOf(iterations, [&]() { image = HueSatKernel::generate(size, best, true); });
+        diff = qMax(diff, differingPixels(reference, image));
+        out << parallelMs << QString::number(legacyMs / qMax(parallelMs, 1e-6), 'f', 1) + "x" << diff
+            << qSetFieldWidth(0) << "\n";
+    }
+    return 0;
+}
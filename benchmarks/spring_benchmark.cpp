@@ -0,0 +1,146 @@
+// Steps 10k springs with the per-engine path and with SpringSystem.
+//
+//   spring_benchmark [springs] [frames]
+//
+// "per-object" is what PhysicsEngine did for each animated value: its own
+// PhysicsState, stepped through applySpringForce() in fixed 1/240s substeps
+// with an accumulator, and a stateUpdated() signal per frame. "batched" is
+// one SpringSystem::step() per frame over all springs, with the signal only
+// for springs that moved visibly. Both run the same frames at 60Hz from the
+// same starting states. "step" is the time spent integrating, "total" adds
+// the signals; both are per frame in microseconds. "notified" counts the
+// signals emitted.
+
+#include "springsystem.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <utility>
+
+// Stands in for a PhysicsEngine's signal and whoever listens to it
+class SpringObject : public QObject
+{
+    Q_OBJECT
+
+Q_SIGNALS:
+    void stateUpdated(qreal position);
+};
+
+namespace {
+
+const qreal FRAME = 1.0 / 60.0;
+
+QVector<PhysicsState> makeSprings(int count)
+{
+    QRandomGenerator random(42);
+    QVector<PhysicsState> springs(count);
+    for (PhysicsState &spring : springs) {
+        spring.position = random.bounded(400.0) - 200.0;
+        spring.velocity = random.bounded(2000.0) - 1000.0;
+        spring.targetPosition = 0.0;
+        spring.springConstant = 50.0 + random.bounded(300.0);
+        spring.damping = 5.0 + random.bounded(25.0);
+        // A quarter are overscroll springs with limits
+        if (random.bounded(4) == 0) {
+            spring.minLimit = -150.0;
+            spring.maxLimit = 150.0;
+        }
+    }
+    return springs;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    const int count = args.size() > 1 ? qMax(1, args.at(1).toInt()) : 10000;
+    const int frames = args.size() > 2 ? qMax(1, args.at(2).toInt()) : 600;
+    const QVector<PhysicsState> initial = makeSprings(count);
+
+    QVector<SpringObject *> emitters;
+    qreal checksum = 0;
+    for (int i = 0; i < count; ++i) {
+        emitters.append(new SpringObject);
+        QObject::connect(emitters.last(), &SpringObject::stateUpdated,
+                         [&checksum](qreal position) { checksum += position; });
+    }
+    QElapsedTimer timer;
+
+    // Per-object: what every PhysicsEngine's updatePhysics() did
+    QVector<PhysicsState> objects = initial;
+    QVector<qreal> accumulated(count, 0.0);
+    QVector<bool> settled(count, false);
+    qint64 objectNotified = 0;
+    qint64 objectStepNs = 0;
+    timer.start();
+    for (int frame = 0; frame < frames; ++frame) {
+        const qint64 frameStart = timer.nsecsElapsed();
+        for (int i = 0; i < count; ++i) {
+            if (settled.at(i)) {
+                continue; // The engine stopped its timer
+            }
+            PhysicsState &state = objects[i];
+            accumulated[i] += FRAME;
+            while (accumulated[i] >= SpringSystem::TIMESTEP) {
+                state.applySpringForce(SpringSystem::TIMESTEP);
+                accumulated[i] -= SpringSystem::TIMESTEP;
+            }
+            settled[i] = qAbs(state.velocity) < SpringSystem::VELOCITY_THRESHOLD
+                         && qAbs(state.position - state.targetPosition) < SpringSystem::POSITION_THRESHOLD;
+        }
+        objectStepNs += timer.nsecsElapsed() - frameStart;
+        // Emitted per engine after its step; gathered here to time them apart
+        for (int i = 0; i < count; ++i) {
+            if (!settled.at(i)) {
+                emit emitters.at(i)->stateUpdated(objects.at(i).position);
+                ++objectNotified;
+            }
+        }
+    }
+    const double objectUs = timer.nsecsElapsed() / 1e3 / frames;
+
+    // Batched: one SpringSystem for all of them
+    SpringSystem system;
+    for (const PhysicsState &state : initial) {
+        system.add(state);
+    }
+    QVector<SpringSystem::Handle> moved;
+    qint64 batchNotified = 0;
+    qint64 batchStepNs = 0;
+    timer.restart();
+    for (int frame = 0; frame < frames; ++frame) {
+        const qint64 frameStart = timer.nsecsElapsed();
+        system.step(FRAME, &moved, nullptr);
+        batchStepNs += timer.nsecsElapsed() - frameStart;
+        for (SpringSystem::Handle handle : std::as_const(moved)) {
+            emit emitters.at(handle)->stateUpdated(system.state(handle).position);
+        }
+        batchNotified += moved.size();
+    }
+    const double batchUs = timer.nsecsElapsed() / 1e3 / frames;
+    qDeleteAll(emitters);
+
+    // Both paths must end up in the same place (settled springs a hair apart,
+    // as the batch keeps stepping them)
+    qreal maxDifference = 0;
+    for (SpringSystem::Handle handle = 0; handle < count; ++handle) {
+        maxDifference = qMax(maxDifference, qAbs(system.state(handle).position - objects.at(handle).position));
+    }
+
+    out << "springs: " << count << ", frames: " << frames << " (checksum " << checksum << ")\n\n";
+    out << qSetFieldWidth(14) << Qt::left << "path" << "step" << "total" << "notified" << qSetFieldWidth(0) << "\n";
+    out << qSetFieldWidth(14) << "per-object" << objectStepNs / 1e3 / frames << objectUs << objectNotified
+        << qSetFieldWidth(0) << "\n";
+    out << qSetFieldWidth(14) << "batched" << batchStepNs / 1e3 / frames << batchUs << batchNotified
+        << qSetFieldWidth(0) << "\n";
+    out << "\nspeedup: " << QString::number(objectUs / qMax(batchUs, 1e-6), 'f', 1)
+        << "x, max position difference: " << maxDifference << "\n";
+    return 0;
+}
+
+#include "spring_benchmark.moc"
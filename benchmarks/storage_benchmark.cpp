@@ -0,0 +1,179 @@
+// Compares the HTML and Markdown note storage paths.
+//
+//   storage_benchmark [corpus-dir] [iterations]
+//
+// Every .txt/.html/.md file under corpus-dir is loaded once, then parsed and
+// serialized in both formats. Without a corpus a set of large synthetic notes
+// is generated instead. Times are the best of N iterations, in milliseconds.
+
+#include "markdownreader.h"
+#include "markdownwriter.h"
+#include "noteformat.h"
+#include <QGuiApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextList>
+#include <QTextStream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Note {
+    QString name;
+    std::unique_ptr<QTextDocument> document;
+};
+
+struct Totals {
+    double htmlParseMs = 0;
+    double htmlSerializeMs = 0;
+    qint64 htmlBytes = 0;
+    double markdownParseMs = 0;
+    double markdownSerializeMs = 0;
+    qint64 markdownBytes = 0;
+};
+
+template <typename Fn>
+double bestOf(int iterations, Fn fn)
+{
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        best = qMin(best, timer.nsecsElapsed() / 1e6);
+    }
+    return best;
+}
+
+std::unique_ptr<QTextDocument> syntheticNote(int paragraphs)
+{
+    auto document = std::make_unique<QTextDocument>();
+    QTextCursor cursor(document.get());
+
+    QTextCharFormat plain;
+    QTextCharFormat bold;
+    bold.setFontWeight(QFont::Bold);
+    QTextCharFormat italic;
+    italic.setFontItalic(true);
+
+    for (int i = 0; i < paragraphs; ++i) {
+        if (i % 25 == 0) {
+            QTextBlockFormat heading;
+            heading.setHeadingLevel(2);
+            cursor.insertBlock(heading);
+            cursor.insertText(QStringLiteral("Section %1").arg(i / 25 + 1), bold);
+            cursor.insertBlock(QTextBlockFormat());
+            continue;
+        }
+        if (i % 10 == 0) {
+            QTextListFormat listFormat;
+            listFormat.setStyle(QTextListFormat::ListDisc);
+            cursor.insertList(listFormat);
+            cursor.insertText(QStringLiteral("First item of list %1").arg(i), plain);
+            cursor.insertBlock();
+            cursor.insertText(QStringLiteral("Second item with "), plain);
+            cursor.insertText(QStringLiteral("emphasis"), italic);
+            cursor.insertBlock(QTextBlockFormat());
+            continue;
+        }
+        cursor.insertText(QStringLiteral("Paragraph %1 of a long note, with ").arg(i), plain);
+        cursor.insertText(QStringLiteral("bold words"), bold);
+        cursor.insertText(QStringLiteral(" and some "), plain);
+        cursor.insertText(QStringLiteral("italic text"), italic);
+        cursor.insertText(QStringLiteral(" to give the serializers something to do. "
+                                         "The quick brown fox jumps over the lazy dog."), plain);
+        cursor.insertBlock(QTextBlockFormat());
+    }
+    return document;
+}
+
+std::vector<Note> loadCorpus(const QString &directory)
+{
+    std::vector<Note> notes;
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (!QuteNote::hasNoteExtension(path)) {
+            continue;
+        }
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        Note note;
+        note.name = path;
+        note.document = std::make_unique<QTextDocument>();
+        if (QuteNote::noteFormatForPath(path) == QuteNote::NoteFormat::Markdown) {
+            MarkdownReader(note.document.get()).read(&file);
+        } else {
+            note.document->setHtml(QString::fromUtf8(file.readAll()));
+        }
+        notes.push_back(std::move(note));
+    }
+    return notes;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QTextDocument needs a QGuiApplication for fonts but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    const int iterations = args.size() > 2 ? qMax(1, args.at(2).toInt()) : 5;
+
+    std::vector<Note> notes;
+    if (args.size() > 1) {
+        notes = loadCorpus(args.at(1));
+    } else {
+        for (int i = 0; i < 8; ++i) {
+            notes.push_back({ QStringLiteral("synthetic-%1").arg(i), syntheticNote(2000 + i * 1000) });
+        }
+    }
+    if (notes.empty()) {
+        out << "No notes found\n";
+        return 1;
+    }
+
+    Totals totals;
+    for (const Note &note : notes) {
+        QByteArray html;
+        QByteArray markdown;
+        totals.htmlSerializeMs += bestOf(iterations, [&]() { html = note.document->toHtml().toUtf8(); });
+        totals.markdownSerializeMs += bestOf(iterations, [&]() { markdown = MarkdownWriter::write(note.document.get()); });
+        totals.htmlBytes += html.size();
+        totals.markdownBytes += markdown.size();
+
+        totals.htmlParseMs += bestOf(iterations, [&]() {
+            QTextDocument document;
+            document.setHtml(QString::fromUtf8(html));
+        });
+        totals.markdownParseMs += bestOf(iterations, [&]() {
+            QTextDocument document;
+            MarkdownReader(&document).read(QString::fromUtf8(markdown));
+        });
+    }
+
+    out << "notes: " << notes.size() << ", iterations: " << iterations << "\n\n";
+    out << qSetFieldWidth(12) << Qt::left << "format" << "parse ms" << "serialize ms" << "bytes"
+        << qSetFieldWidth(0) << "\n";
+    out << qSetFieldWidth(12) << "html" << totals.htmlParseMs << totals.htmlSerializeMs << totals.htmlBytes
+        << qSetFieldWidth(0) << "\n";
+    out << qSetFieldWidth(12) << "markdown" << totals.markdownParseMs << totals.markdownSerializeMs
+        << totals.markdownBytes << qSetFieldWidth(0) << "\n\n";
+
+    if (totals.markdownBytes > 0) {
+        out << "size ratio html/markdown: " << double(totals.htmlBytes) / totals.markdownBytes << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Measures theme-switch latency with and without StyleSheetCompiler.
+//
+//   theme_benchmark [switches] [combo-boxes]
+//
+// A window with a few hundred styled widgets is themed back and forth
+// between two themes at two zoom levels. "legacy" builds every sheet by
+// running QString::replace for each token over the raw template, the way
+// ThemeManager used to; "expand" uses the compiled templates without the
+// cache; "cached" is what ThemeManager now does. Each switch applies the
+// application sheet once and a sheet per combo box. Times are the mean per
+// switch, in milliseconds, split into building the sheets and applying them.
+
+#include "stylesheetcompiler.h"
+#include "thememanager.h"
+#include <QApplication>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSlider>
+#include <QTemporaryDir>
+#include <QTextEdit>
+#include <QTextStream>
+#include <QToolButton>
+#include <QVBoxLayout>
+#include <QWidget>
+#include <functional>
+#include <vector>
+
+namespace {
+
+struct Timing {
+    double buildMs = 0;
+    double applyMs = 0;
+};
+
+Theme makeTheme(const QString &name, const QString &background, const QString &accent, bool dark)
+{
+    Theme theme;
+    theme.name = name;
+    theme.displayName = name;
+    theme.isDark = dark;
+    const QColor base(background);
+    theme.colors.primary = QColor(accent).lighter(120);
+    theme.colors.secondary = QColor(accent).darker(110);
+    theme.colors.background = base;
+    theme.colors.surface = dark ? base.lighter(130) : base.lighter(108);
+    theme.colors.base = dark ? base.lighter(150) : base.lighter(104);
+    theme.colors.text = dark ? QColor("#ffffff") : QColor("#4a4a4a");
+    theme.colors.textSecondary = dark ? QColor("#b0b0b0") : QColor("#717171");
+    theme.colors.accent = QColor(accent);
+    theme.colors.menuBackground = QColor(accent).darker(130);
+    theme.colors.clicked = QColor(accent).lighter(140);
+    theme.colors.border = QColor(accent).darker(160);
+    theme.colors.error = QColor("#ff6b6b");
+    theme.colors.success = QColor("#98fb98");
+    theme.colors.toolbarTextIcon = QColor("#ffffff");
+    theme.colors.highlight = QColor(accent).darker(105);
+    theme.metrics.spacing = 8;
+    theme.metrics.borderRadius = 12;
+    theme.metrics.iconSize = 24;
+    theme.metrics.touchTarget = 48;
+    theme.defaultFont = QFont("Sans Serif");
+    theme.switchStyle = QString("QCheckBox::indicator { width: 40px; height: 24px; border-radius: 12px;"
+                                " border: 2px solid %1; }").arg(accent);
+    return theme;
+}
+
+Theme zoomed(Theme theme, double factor)
+{
+    theme.metrics.touchTarget = int(theme.metrics.touchTarget * factor);
+    theme.metrics.iconSize = int(theme.metrics.iconSize * factor);
+    return theme;
+}
+
+// The pre-compiler approach: one full pass over the template per token
+QString legacyExpand(StyleSheetCompiler::Sheet sheet, const StyleSheetCompiler::Tokens &tokens)
+{
+    QString result = StyleSheetCompiler::source(sheet);
+    for (int i = 0; i < StyleSheetCompiler::TokenCount; ++i) {
+        const auto token = StyleSheetCompiler::Token(i);
+        result.replace("{{" + StyleSheetCompiler::tokenName(token) + "}}", tokens[token]);
+    }
+    return result;
+}
+
+using Builder = std::function<QString(StyleSheetCompiler::Sheet, const StyleSheetCompiler::Tokens &)>;
+
+Timing run(const std::vector<Theme> &themes, int switches, const std::vector<QComboBox *> &combos,
+           const Builder &build)
+{
+    Timing timing;
+    QElapsedTimer timer;
+    for (int i = 0; i < switches; ++i) {
+        const StyleSheetCompiler::Tokens tokens = StyleSheetCompiler::themeTokens(themes.at(i % themes.size()));
+
+        timer.start();
+        const QString application = build(StyleSheetCompiler::Application, tokens);
+        std::vector<QString> comboSheets;
+        comboSheets.reserve(combos.size());
+        for (size_t c = 0; c < combos.size(); ++c) {
+            comboSheets.push_back(build(StyleSheetCompiler::ComboBox, tokens));
+        }
+        timing.buildMs += timer.nsecsElapsed() / 1e6;
+
+        timer.start();
+        qApp->setStyleSheet(application);
+        for (size_t c = 0; c < combos.size(); ++c) {
+            combos[c]->setStyleSheet(comboSheets[c]);
+        }
+        // Include the re-polish and layout that the sheet change triggers
+        QApplication::processEvents();
+        timing.applyMs += timer.nsecsElapsed() / 1e6;
+    }
+    timing.buildMs /= switches;
+    timing.applyMs /= switches;
+    return timing;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList args = app.arguments();
+    const int switches = args.size() > 1 ? qMax(2, args.at(1).toInt()) : 40;
+    const int comboCount = args.size() > 2 ? qMax(0, args.at(2).toInt()) : 24;
+
+    QWidget window;
+    auto layout = new QVBoxLayout(&window);
+    std::vector<QComboBox *> combos;
+    for (int i = 0; i < 60; ++i) {
+        layout->addWidget(new QPushButton(QString("Button %1").arg(i)));
+        layout->addWidget(new QLabel(QString("Label %1").arg(i)));
+        auto check = new QCheckBox(QString("Option %1").arg(i));
+        check->setChecked(i % 2);
+        layout->addWidget(check);
+        layout->addWidget(new QToolButton);
+    }
+    for (int i = 0; i < 10; ++i) {
+        layout->addWidget(new QLineEdit);
+        layout->addWidget(new QSlider(Qt::Horizontal));
+    }
+    layout->addWidget(new QTextEdit);
+    for (int i = 0; i < comboCount; ++i) {
+        auto combo = new QComboBox;
+        combo->addItems({"One", "Two", "Three"});
+        layout->addWidget(combo);
+        combos.push_back(combo);
+    }
+    window.show();
+    QApplication::processEvents();
+
+    const Theme light = makeTheme("Light", "#ffc0cb", "#ff69b4", false);
+    const Theme dark = makeTheme("Dark", "#1a1a1d", "#bd95e4", true);
+    const std::vector<Theme> themes = { light, dark, zoomed(light, 1.5), zoomed(dark, 1.5) };
+
+    QTemporaryDir cacheDir;
+    StyleSheetCompiler compiler(cacheDir.path());
+    // Warm the compiled templates and both caches, as after the first switch
+    for (const Theme &theme : themes) {
+        const StyleSheetCompiler::Tokens tokens = StyleSheetCompiler::themeTokens(theme);
+        compiler.styleSheet(StyleSheetCompiler::Application, tokens);
+        compiler.styleSheet(StyleSheetCompiler::ComboBox, tokens);
+    }
+
+    const Timing legacy = run(themes, switches, combos, legacyExpand);
+    const Timing expand = run(themes, switches, combos,
+        [](StyleSheetCompiler::Sheet sheet, const StyleSheetCompiler::Tokens &tokens) {
+            return StyleSheetCompiler::expand(sheet, tokens);
+        });
+    const Timing cached = run(themes, switches, combos,
+        [&compiler](StyleSheetCompiler::Sheet sheet, const StyleSheetCompiler::Tokens &tokens) {
+            return compiler.styleSheet(sheet, tokens);
+        });
+
+    // A fresh compiler over the same directory only has the disk cache
+    StyleSheetCompiler coldCompiler(cacheDir.path());
+    QElapsedTimer timer;
+    timer.start();
+    for (const Theme &theme : themes) {
+        coldCompiler.styleSheet(StyleSheetCompiler::Application, StyleSheetCompiler::themeTokens(theme));
+    }
+    const double diskMs = timer.nsecsElapsed() / 1e6 / themes.size();
+
+    out << "switches: " << switches << ", combo boxes: " << comboCount << "\n\n";
+    out << qSetFieldWidth(12) << Qt::left << "method" << "build ms" << "apply ms" << "total ms"
+        << qSetFieldWidth(0) << "\n";
+    auto row = [&out](const char *name, const Timing &timing) {
+        out << qSetFieldWidth(12) << name << timing.buildMs << timing.applyMs
+            << timing.buildMs + timing.applyMs << qSetFieldWidth(0) << "\n";
+    };
+    row("legacy", legacy);
+    row("expand", expand);
+    row("cached", cached);
+    out << "\napplication sheet from disk cache: " << diskMs << " ms\n";
+    out << "application sheet size: " << StyleSheetCompiler::source(StyleSheetCompiler::Application).size()
+        << " chars as written, "
+        << StyleSheetCompiler::expand(StyleSheetCompiler::Application,
+                                      StyleSheetCompiler::themeTokens(light)).size()
+        << " expanded\n";
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <QByteArray>
+
+namespace QuteNote {
+
+// Cheap FNV-1a checksum for framed on-disk records. It only has to catch
+// torn writes and damaged files, not tampering.
+inline quint32 recordChecksum(const QByteArray &data)
+{
+    quint32 hash = 2166136261u;
+    for (char c : data) {
+        hash ^= static_cast<quint8>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace QuteNote
+
+#endif // CHECKSUM_H
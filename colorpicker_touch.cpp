@@ -54,11 +54,38 @@ TouchColorPicker::TouchColorPicker(QWidget *parent)
         }
     }
     
+    // Only the first picker pays for this; later ones find the cache warm
+    static bool gradientsPrewarmed = false;
+    if (!gradientsPrewarmed) {
+        gradientsPrewarmed = true;
+        prewarmGradients();
+    }
+
     setupTouchInteraction();
     createLayout();
     updateColorControls();
 }
 
+void TouchColorPicker::prewarmGradients()
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal dpr = screen ? screen->devicePixelRatio() : 1.0;
+
+    // Sizes the map is likely to get in device pixels: its size hint and
+    // minimum at each pinch zoom step, and the compact fullscreen layout
+    // (the screen less the margins, preview and buttons)
+    QList<QSize> sizes;
+    for (qreal zoom : {1.0, 1.5, 2.0}) {
+        sizes << QSize(300, 300) * (dpr * zoom)
+              << QSize(MIN_TOUCH_TARGET * 4, MIN_TOUCH_TARGET * 4) * (dpr * zoom);
+    }
+    if (screen) {
+        const QSize available = screen->availableGeometry().size();
+        sizes << QSize(available.width() - 16, available.height() - 16 - 12 * 2 - 64 - MIN_TOUCH_TARGET * 2) * dpr;
+    }
+    HueSatMapCache::instance()->prewarm(sizes);
+}
+
 void TouchColorPicker::setCompactMode(bool enabled)
 {
     if (m_compactMode == enabled)
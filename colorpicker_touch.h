@@ -64,6 +64,7 @@ private:
     void updateRecentColors();
 
     void animateOutAndClose(std::function<void()> onFinished);
+    static void prewarmGradients();
 
     bool eventFilter(QObject *watched, QEvent *event) override;
 
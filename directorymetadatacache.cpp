@@ -0,0 +1,73 @@
+#include "directorymetadatacache.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+// Static member definitions
+const int DirectoryMetadataCache::MAX_RECORDS;
+
+DirectoryMetadataCache::Metadata DirectoryMetadataCache::metadata(const QString &path)
+{
+    const QString key = QDir::cleanPath(path);
+    const qint64 modified = modifiedTime(key);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_records.constFind(key);
+        if (it != m_records.constEnd() && it->modified == modified) {
+            return it->metadata;
+        }
+    }
+
+    // Listed without the lock; two threads racing on the same directory
+    // just both list it
+    Record record;
+    record.modified = modified;
+    record.metadata.childCount = modified < 0 ? 0 : countEntries(key);
+
+    QMutexLocker locker(&m_mutex);
+    if (modified < 0) {
+        // Gone; nothing worth remembering
+        m_records.remove(key);
+        return record.metadata;
+    }
+    if (m_records.size() >= MAX_RECORDS && !m_records.contains(key)) {
+        // Cheaper than tracking use; it fills up again with what is on screen
+        m_records.clear();
+    }
+    m_records.insert(key, record);
+    return record.metadata;
+}
+
+void DirectoryMetadataCache::invalidate(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_records.remove(QDir::cleanPath(path));
+}
+
+void DirectoryMetadataCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_records.clear();
+}
+
+qint64 DirectoryMetadataCache::modifiedTime(const QString &path)
+{
+    const QFileInfo info(path);
+    if (!info.isDir()) {
+        return -1;
+    }
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+int DirectoryMetadataCache::countEntries(const QString &path)
+{
+    int count = 0;
+    QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,52 @@
+#ifndef DIRECTORYMETADATACACHE_H
+#define DIRECTORYMETADATACACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+// Number of entries in a directory, remembered together with the
+// directory's mtime so a stale entry is noticed with a single stat instead
+// of a listing. Deciding between the empty and non-empty folder icon or
+// expander asks this instead of opening the folder every time.
+//
+// Used from the listing workers as well as the GUI thread. Entries are
+// dropped eagerly through invalidate(), normally for the changes reported by
+// the NotesWatcher, which also covers changes made within the same mtime
+// tick.
+class DirectoryMetadataCache
+{
+public:
+    struct Metadata {
+        int childCount = 0;
+        bool isEmpty() const { return childCount == 0; }
+    };
+
+    DirectoryMetadataCache() = default;
+
+    // Cached if the directory has not been modified since, listed otherwise
+    Metadata metadata(const QString &path);
+    int childCount(const QString &path) { return metadata(path).childCount; }
+    bool isEmpty(const QString &path) { return metadata(path).isEmpty(); }
+
+    void invalidate(const QString &path);
+    void clear();
+
+private:
+    struct Record {
+        qint64 modified = 0;
+        Metadata metadata;
+    };
+
+    static qint64 modifiedTime(const QString &path);
+    static int countEntries(const QString &path);
+
+    QMutex m_mutex;
+    QHash<QString, Record> m_records;
+
+    static const int MAX_RECORDS = 20000;
+
+    Q_DISABLE_COPY(DirectoryMetadataCache)
+};
+
+#endif // DIRECTORYMETADATACACHE_H
@@ -0,0 +1,141 @@
+#include "documentloader.h"
+#include "markdownreader.h"
+#include "noteformat.h"
+#include <QFile>
+#include <QTextDocument>
+#include <QThread>
+#include <QtConcurrent>
+
+DocumentLoader::DocumentLoader(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DocumentLoader::~DocumentLoader()
+{
+    if (m_cancelFlag) {
+        m_cancelFlag->store(true);
+    }
+
+    // Workers only touch their own captured state, but any document they
+    // produced still has to be freed once they return.
+    for (QFutureWatcher<LoadResult> *watcher : std::as_const(m_inFlight)) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+        if (watcher->future().resultCount() > 0) {
+            delete watcher->result().document;
+        }
+    }
+}
+
+void DocumentLoader::load(const QString &filePath)
+{
+    cancel();
+
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+    m_pendingFile = filePath;
+
+    auto *watcher = new QFutureWatcher<LoadResult>(this);
+    m_current = watcher;
+    m_inFlight.append(watcher);
+    connect(watcher, &QFutureWatcher<LoadResult>::finished, this, [this, watcher]() {
+        onWatcherFinished(watcher);
+    });
+
+    QThread *targetThread = thread();
+    CancelFlag cancelled = m_cancelFlag;
+    watcher->setFuture(QtConcurrent::run([filePath, targetThread, cancelled]() {
+        return loadInWorker(filePath, targetThread, cancelled);
+    }));
+
+    emit loadStarted(filePath);
+}
+
+void DocumentLoader::cancel()
+{
+    if (!m_current) {
+        return;
+    }
+
+    // The worker cannot be interrupted mid-parse; flag it so it bails out at
+    // the next checkpoint and drop whatever it eventually hands back.
+    m_cancelFlag->store(true);
+    m_current = nullptr;
+
+    const QString cancelledFile = m_pendingFile;
+    m_pendingFile.clear();
+    emit loadCancelled(cancelledFile);
+}
+
+DocumentLoader::LoadResult DocumentLoader::loadInWorker(const QString &filePath, QThread *targetThread,
+                                                        const CancelFlag &cancelled)
+{
+    LoadResult result;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = file.errorString();
+        return result;
+    }
+
+    auto *document = new QTextDocument();
+    if (QuteNote::noteFormatForPath(filePath) == QuteNote::NoteFormat::Markdown) {
+        // Parsed straight off the file, line by line
+        MarkdownReader reader(document);
+        if (!reader.read(&file)) {
+            result.error = file.errorString();
+            delete document;
+            return result;
+        }
+    } else {
+        const QByteArray data = file.readAll();
+        file.close();
+        if (cancelled->load()) {
+            delete document;
+            return result;
+        }
+        document->setHtml(QString::fromUtf8(data));
+    }
+    document->setModified(false);
+
+    if (cancelled->load()) {
+        delete document;
+        return result;
+    }
+
+    // Hand the finished document over to the GUI thread before returning so
+    // the receiver can reparent it and attach it to a QTextEdit.
+    document->moveToThread(targetThread);
+    result.document = document;
+    return result;
+}
+
+void DocumentLoader::onWatcherFinished(QFutureWatcher<LoadResult> *watcher)
+{
+    m_inFlight.removeOne(watcher);
+    watcher->deleteLater();
+
+    if (watcher != m_current) {
+        discard(watcher);
+        return;
+    }
+
+    m_current = nullptr;
+    const QString filePath = m_pendingFile;
+    m_pendingFile.clear();
+
+    const LoadResult result = watcher->result();
+    if (!result.document) {
+        emit loadFailed(filePath, result.error.isEmpty() ? tr("Unknown error") : result.error);
+        return;
+    }
+
+    emit loadFinished(filePath, result.document);
+}
+
+void DocumentLoader::discard(QFutureWatcher<LoadResult> *watcher)
+{
+    if (watcher->future().resultCount() > 0) {
+        delete watcher->result().document;
+    }
+}
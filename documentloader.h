@@ -0,0 +1,58 @@
+#ifndef DOCUMENTLOADER_H
+#define DOCUMENTLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QFutureWatcher>
+#include <QList>
+#include <atomic>
+#include <memory>
+
+class QTextDocument;
+class QThread;
+
+// Reads and parses a note into a QTextDocument on a worker thread so the GUI
+// thread never blocks on QFile::readAll() or QTextDocument::setHtml(). Only
+// one load is "current" at a time: starting a new load cancels the previous
+// one and its result is discarded when it arrives.
+class DocumentLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DocumentLoader(QObject *parent = nullptr);
+    ~DocumentLoader();
+
+    // Starts loading filePath, cancelling any load still in flight
+    void load(const QString &filePath);
+    void cancel();
+
+    bool isLoading() const { return m_current != nullptr; }
+    QString pendingFile() const { return m_pendingFile; }
+
+Q_SIGNALS:
+    void loadStarted(const QString &filePath);
+    // The receiver takes ownership of document (it lives in the loader's thread)
+    void loadFinished(const QString &filePath, QTextDocument *document);
+    void loadFailed(const QString &filePath, const QString &error);
+    void loadCancelled(const QString &filePath);
+
+private:
+    struct LoadResult {
+        QTextDocument *document = nullptr;
+        QString error;
+    };
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    static LoadResult loadInWorker(const QString &filePath, QThread *targetThread,
+                                   const CancelFlag &cancelled);
+    void onWatcherFinished(QFutureWatcher<LoadResult> *watcher);
+    void discard(QFutureWatcher<LoadResult> *watcher);
+
+    QFutureWatcher<LoadResult> *m_current = nullptr;
+    CancelFlag m_cancelFlag;
+    QString m_pendingFile;
+    QList<QFutureWatcher<LoadResult>*> m_inFlight;
+};
+
+#endif // DOCUMENTLOADER_H
@@ -22,17 +22,39 @@ DocumentItem::~DocumentItem()
 
 void DocumentItem::appendChild(DocumentItem *child)
 {
+    child->m_parent = this;
+    child->m_row = m_children.size();
     m_children.append(child);
 }
 
 void DocumentItem::insertChild(int row, DocumentItem *child)
 {
+    child->m_parent = this;
     m_children.insert(row, child);
+    renumberChildren(row);
 }
 
 void DocumentItem::removeChild(int row)
 {
     delete m_children.takeAt(row);
+    renumberChildren(row);
+}
+
+DocumentItem *DocumentItem::takeChild(int row)
+{
+    DocumentItem *child = m_children.takeAt(row);
+    child->m_parent = nullptr;
+    child->m_row = 0;
+    renumberChildren(row);
+    return child;
+}
+
+// Only the rows from the changed one on move; appending renumbers nothing
+void DocumentItem::renumberChildren(int from)
+{
+    for (int i = qMax(0, from); i < m_children.size(); ++i) {
+        m_children.at(i)->m_row = i;
+    }
 }
 
 DocumentItem *DocumentItem::child(int row) const
@@ -47,9 +69,7 @@ int DocumentItem::childCount() const
 
 int DocumentItem::row() const
 {
-    if (m_parent)
-        return m_parent->m_children.indexOf(const_cast<DocumentItem*>(this));
-    return 0;
+    return m_parent ? m_row : 0;
 }
 
 DocumentItem *DocumentItem::parent() const
@@ -11,16 +11,19 @@ public:
     enum Type { Document, Folder };
     
     explicit DocumentItem(Type type, const QString &title, DocumentItem *parent = nullptr);
-    ~DocumentItem();
+    virtual ~DocumentItem();
     
     void appendChild(DocumentItem *child);
     void insertChild(int row, DocumentItem *child);
     void removeChild(int row);
+    // Detaches without deleting, e.g. to move the item under another parent
+    DocumentItem *takeChild(int row);
     DocumentItem *child(int row) const;
     int childCount() const;
     int columnCount() const;
     QVariant data(int role) const;
     bool setData(const QVariant &value, int role);
+    // Kept up to date by the child functions above, so this is O(1)
     int row() const;
     DocumentItem *parent() const;
     
@@ -30,8 +33,11 @@ public:
     bool expanded;
     
 private:
+    void renumberChildren(int from);
+
     QList<DocumentItem*> m_children;
     DocumentItem *m_parent;
+    int m_row = 0; // Index in m_parent->m_children
 };
 
 class DocumentModel : public QAbstractItemModel {
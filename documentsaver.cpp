@@ -0,0 +1,139 @@
+#include "documentsaver.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextDocument>
+#include <QtConcurrent>
+#include <memory>
+
+DocumentSaver::DocumentSaver(QObject *parent)
+    : QObject(parent)
+{
+}
+
+DocumentSaver::~DocumentSaver()
+{
+    // Unlike loads, queued saves carry user data and must reach the disk.
+    // Receivers may already be half torn down, so finish silently.
+    disconnect();
+    waitForAll();
+}
+
+DocumentSaver::Serializer DocumentSaver::htmlSnapshot(const QTextDocument *document)
+{
+    if (!document) {
+        return Serializer();
+    }
+
+    // clone() copies the piece table, which is much cheaper than producing
+    // HTML; the expensive toHtml() then runs on the worker.
+    std::shared_ptr<QTextDocument> snapshot(document->clone());
+    return [snapshot]() {
+        return snapshot->toHtml().toUtf8();
+    };
+}
+
+void DocumentSaver::save(const QString &filePath, const Serializer &serializer, quint64 tag)
+{
+    if (filePath.isEmpty() || !serializer) {
+        return;
+    }
+
+    if (m_running.contains(filePath)) {
+        // A write for this file is already running; remember only the newest
+        // snapshot and write it once the current one lands.
+        if (m_pending.contains(filePath)) {
+            ++m_coalesced;
+        }
+        m_pending.insert(filePath, QueuedSave{serializer, tag});
+        return;
+    }
+
+    start(filePath, QueuedSave{serializer, tag});
+}
+
+bool DocumentSaver::isSaving(const QString &filePath) const
+{
+    return m_running.contains(filePath) || m_pending.contains(filePath);
+}
+
+void DocumentSaver::cancelPending(const QString &filePath)
+{
+    m_pending.remove(filePath);
+}
+
+void DocumentSaver::waitForAll()
+{
+    while (!m_running.isEmpty()) {
+        const QString filePath = m_running.constBegin().key();
+        m_running.value(filePath).watcher->waitForFinished();
+        onSaveFinished(filePath);
+    }
+}
+
+void DocumentSaver::start(const QString &filePath, const QueuedSave &save)
+{
+    auto *watcher = new QFutureWatcher<SaveResult>(this);
+    connect(watcher, &QFutureWatcher<SaveResult>::finished, this, [this, filePath]() {
+        onSaveFinished(filePath);
+    });
+
+    m_running.insert(filePath, RunningSave{watcher, save});
+    const Serializer serializer = save.serializer;
+    watcher->setFuture(QtConcurrent::run([filePath, serializer]() {
+        return writeInWorker(filePath, serializer);
+    }));
+}
+
+DocumentSaver::SaveResult DocumentSaver::writeInWorker(const QString &filePath, const Serializer &serializer)
+{
+    SaveResult result;
+
+    const QByteArray data = serializer();
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    // QSaveFile writes to a temporary file and renames it over the target on
+    // commit(), so the previous contents survive any failure before that.
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result.error = file.errorString();
+        return result;
+    }
+    if (file.write(data) != data.size()) {
+        result.error = file.errorString();
+        file.cancelWriting();
+        return result;
+    }
+    if (!file.commit()) {
+        result.error = file.errorString();
+        return result;
+    }
+
+    result.bytesWritten = data.size();
+    return result;
+}
+
+void DocumentSaver::onSaveFinished(const QString &filePath)
+{
+    // waitForAll() may already have handled this save synchronously
+    if (!m_running.contains(filePath)) {
+        return;
+    }
+
+    RunningSave running = m_running.take(filePath);
+    running.watcher->disconnect(this);
+    running.watcher->deleteLater();
+
+    const SaveResult result = running.watcher->result();
+
+    if (result.bytesWritten >= 0) {
+        emit saveFinished(filePath, result.bytesWritten, running.save.tag);
+    } else {
+        emit saveFailed(filePath, result.error);
+    }
+
+    if (m_pending.contains(filePath)) {
+        start(filePath, m_pending.take(filePath));
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef DOCUMENTSAVER_H
+#define DOCUMENTSAVER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <functional>
+
+class QTextDocument;
+
+// Serializes and writes notes on a worker thread. The caller takes a cheap
+// snapshot on the GUI thread (see htmlSnapshot()) and hands it over; the
+// heavy toHtml() and the disk write then happen off the GUI thread through
+// QSaveFile, so a crash mid-write never truncates the existing note.
+//
+// Saves of the same path are coalesced: while one write is running only the
+// newest queued snapshot is kept, older ones are dropped unwritten.
+class DocumentSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Produces the bytes to write; invoked on a worker thread
+    using Serializer = std::function<QByteArray()>;
+
+    explicit DocumentSaver(QObject *parent = nullptr);
+    ~DocumentSaver();
+
+    // tag is handed back unchanged in saveFinished so callers can tell which
+    // snapshot landed when saves were coalesced
+    void save(const QString &filePath, const Serializer &serializer, quint64 tag = 0);
+
+    bool isSaving(const QString &filePath) const;
+    // Drops the snapshot queued behind a running save of filePath, if any;
+    // the running one still completes
+    void cancelPending(const QString &filePath);
+    bool hasPendingSaves() const { return !m_running.isEmpty(); }
+    int coalescedCount() const { return m_coalesced; }
+
+    // Blocks until every queued save has been written (used on shutdown)
+    void waitForAll();
+
+    // Clones the document so later edits do not race with serialization
+    static Serializer htmlSnapshot(const QTextDocument *document);
+
+Q_SIGNALS:
+    void saveFinished(const QString &filePath, qint64 bytesWritten, quint64 tag);
+    void saveFailed(const QString &filePath, const QString &error);
+
+private:
+    struct SaveResult {
+        qint64 bytesWritten = -1;
+        QString error;
+    };
+    struct QueuedSave {
+        Serializer serializer; // Keeps the snapshot alive while the worker runs
+        quint64 tag = 0;
+    };
+    struct RunningSave {
+        QFutureWatcher<SaveResult> *watcher = nullptr;
+        QueuedSave save;
+    };
+
+    static SaveResult writeInWorker(const QString &filePath, const Serializer &serializer);
+    void start(const QString &filePath, const QueuedSave &save);
+    void onSaveFinished(const QString &filePath);
+
+    QHash<QString, RunningSave> m_running;
+    QHash<QString, QueuedSave> m_pending;
+    int m_coalesced = 0;
+};
+
+#endif // DOCUMENTSAVER_H
@@ -0,0 +1,323 @@
+#include "editjournal.h"
+#include "checksum.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Static member definitions
+const int EditJournal::SYNC_INTERVAL;
+const int EditJournal::SYNC_BATCH_SIZE;
+
+namespace {
+
+constexpr quint32 kJournalMagic = 0x514e4a31; // "QNJ1"
+constexpr quint16 kJournalVersion = 1;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_12;
+
+bool syncToDisk(QFile &file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+QString journalDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal";
+}
+
+} // namespace
+
+EditJournal::EditJournal(QObject *parent)
+    : QObject(parent)
+{
+    m_syncTimer.setSingleShot(true);
+    m_syncTimer.setInterval(SYNC_INTERVAL);
+    connect(&m_syncTimer, &QTimer::timeout, this, &EditJournal::sync);
+}
+
+EditJournal::~EditJournal()
+{
+    close();
+}
+
+QString EditJournal::journalPath(const QString &notePath)
+{
+    const QByteArray key = QFileInfo(notePath).absoluteFilePath().toUtf8();
+    const QString name = QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+    return journalDirectory() + "/" + name + ".qnj";
+}
+
+QStringList EditJournal::notesWithPendingEdits()
+{
+    QDir dir(journalDirectory());
+    const QFileInfoList journals = dir.entryInfoList(QStringList() << "*.qnj", QDir::Files, QDir::Time);
+
+    QStringList notes;
+    for (const QFileInfo &journal : journals) {
+        QString notePath;
+        BaseStamp base;
+        QList<Operation> operations;
+        if (readJournal(journal.absoluteFilePath(), &notePath, &base, &operations)
+                && !operations.isEmpty() && stampOf(notePath) == base) {
+            notes.append(notePath);
+        }
+    }
+    return notes;
+}
+
+bool EditJournal::open(const QString &notePath)
+{
+    close();
+    if (notePath.isEmpty()) {
+        return false;
+    }
+
+    m_notePath = QFileInfo(notePath).absoluteFilePath();
+    m_operations.clear();
+    m_sequence = 0;
+
+    const QString path = journalPath(m_notePath);
+    if (!QFileInfo::exists(path)) {
+        return true; // Created lazily on the first append
+    }
+
+    QString recordedPath;
+    BaseStamp base;
+    QList<Operation> operations;
+    const bool valid = readJournal(path, &recordedPath, &base, &operations);
+    if (!valid || recordedPath != m_notePath || !(stampOf(m_notePath) == base) || operations.isEmpty()) {
+        // Written against a different version of the note (saved elsewhere,
+        // synced in, edited externally); replaying it would corrupt the text.
+        QFile::remove(path);
+        return true;
+    }
+
+    m_operations = operations;
+    m_sequence = operations.last().sequence;
+    return true;
+}
+
+void EditJournal::close()
+{
+    if (m_file.isOpen()) {
+        sync();
+        m_file.close();
+    }
+    m_syncTimer.stop();
+    m_notePath.clear();
+    m_operations.clear();
+    m_sequence = 0;
+    m_unsynced = 0;
+}
+
+void EditJournal::discard()
+{
+    const QString notePath = m_notePath;
+    m_file.close();
+    m_syncTimer.stop();
+    m_unsynced = 0;
+    if (!notePath.isEmpty()) {
+        QFile::remove(journalPath(notePath));
+    }
+    m_operations.clear();
+    m_sequence = 0;
+}
+
+void EditJournal::append(Operation::Type type, int position, int removed, const QString &payload)
+{
+    if (!isOpen() || !ensureWritable()) {
+        return;
+    }
+
+    Operation operation;
+    operation.type = type;
+    operation.position = position;
+    operation.removed = removed;
+    operation.payload = payload;
+    operation.sequence = ++m_sequence;
+    m_operations.append(operation);
+
+    // write() + flush() puts the record in the kernel's page cache, which is
+    // enough to survive the process being killed; fsync is only needed for
+    // power loss and is batched below.
+    m_file.write(encodeOperation(operation));
+    m_file.flush();
+
+    ++m_unsynced;
+    scheduleSync();
+}
+
+void EditJournal::compact(quint64 upToSequence)
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    auto firstKept = std::find_if(m_operations.begin(), m_operations.end(),
+                                  [upToSequence](const Operation &op) { return op.sequence > upToSequence; });
+    m_operations.erase(m_operations.begin(), firstKept);
+
+    m_file.close();
+    m_syncTimer.stop();
+    m_unsynced = 0;
+
+    const QString path = journalPath(m_notePath);
+    if (m_operations.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+
+    // Edits made while the save was in flight are rebased onto the note as
+    // it is now on disk.
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to compact edit journal" << path << ":" << out.errorString();
+        return;
+    }
+    out.write(encodeHeader(m_notePath, stampOf(m_notePath)));
+    for (const Operation &operation : std::as_const(m_operations)) {
+        out.write(encodeOperation(operation));
+    }
+    if (!out.commit()) {
+        qWarning() << "Failed to compact edit journal" << path << ":" << out.errorString();
+    }
+}
+
+void EditJournal::sync()
+{
+    m_syncTimer.stop();
+    if (m_unsynced == 0 || !m_file.isOpen()) {
+        return;
+    }
+    if (!syncToDisk(m_file)) {
+        qWarning() << "Failed to sync edit journal" << m_file.fileName();
+    }
+    m_unsynced = 0;
+}
+
+bool EditJournal::ensureWritable()
+{
+    if (m_file.isOpen()) {
+        return true;
+    }
+
+    const QString path = journalPath(m_notePath);
+    QDir().mkpath(journalDirectory());
+
+    const bool exists = QFileInfo::exists(path);
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to open edit journal" << path << ":" << m_file.errorString();
+        return false;
+    }
+    if (!exists) {
+        m_file.write(encodeHeader(m_notePath, stampOf(m_notePath)));
+    }
+    return true;
+}
+
+void EditJournal::scheduleSync()
+{
+    if (m_unsynced >= SYNC_BATCH_SIZE) {
+        sync();
+    } else if (!m_syncTimer.isActive()) {
+        m_syncTimer.start();
+    }
+}
+
+EditJournal::BaseStamp EditJournal::stampOf(const QString &notePath)
+{
+    BaseStamp stamp;
+    QFileInfo info(notePath);
+    if (info.exists()) {
+        stamp.size = info.size();
+        stamp.modified = info.lastModified().toMSecsSinceEpoch();
+    }
+    return stamp;
+}
+
+QByteArray EditJournal::encodeHeader(const QString &notePath, const BaseStamp &base)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kJournalMagic << kJournalVersion << notePath << base.size << base.modified;
+    return data;
+}
+
+QByteArray EditJournal::encodeOperation(const Operation &operation)
+{
+    QByteArray record;
+    QDataStream recordOut(&record, QIODevice::WriteOnly);
+    recordOut.setVersion(kStreamVersion);
+    recordOut << static_cast<quint8>(operation.type) << operation.position << operation.removed
+              << operation.payload << operation.sequence;
+
+    QByteArray framed;
+    QDataStream out(&framed, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << QuteNote::recordChecksum(record) << record;
+    return framed;
+}
+
+bool EditJournal::readJournal(const QString &journalFile, QString *notePath,
+                              BaseStamp *base, QList<Operation> *operations)
+{
+    QFile file(journalFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version >> *notePath >> base->size >> base->modified;
+    if (in.status() != QDataStream::Ok || magic != kJournalMagic || version != kJournalVersion) {
+        return false;
+    }
+
+    // Read until the first torn or corrupt record; everything before it is
+    // intact because records are only ever appended.
+    while (!in.atEnd()) {
+        quint32 checksum = 0;
+        QByteArray record;
+        in >> checksum >> record;
+        if (in.status() != QDataStream::Ok || QuteNote::recordChecksum(record) != checksum) {
+            break;
+        }
+
+        QDataStream recordIn(record);
+        recordIn.setVersion(kStreamVersion);
+        quint8 type = 0;
+        Operation operation;
+        recordIn >> type >> operation.position >> operation.removed
+                 >> operation.payload >> operation.sequence;
+        if (recordIn.status() != QDataStream::Ok
+                || (type != Operation::ReplaceText && type != Operation::ReplaceHtml)) {
+            break;
+        }
+        operation.type = static_cast<Operation::Type>(type);
+        operations->append(operation);
+    }
+    return true;
+}
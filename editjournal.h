@@ -0,0 +1,96 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+// Append-only write-ahead journal for the note open in the editor.
+//
+// Every QTextDocument::contentsChange is appended as a small replace
+// operation to a sidecar file under AppDataLocation/journal. Appends are
+// handed to the OS immediately (so they survive the process being killed)
+// and fsync'ed in batches. The file header records the size and mtime of
+// the note it applies to; once a save lands, everything it covered is
+// compacted away, and a journal that exists with operations in it therefore
+// always means "edits that never reached the note".
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Operation {
+        enum Type : quint8 {
+            ReplaceText = 1, // payload is plain text (QChar::ParagraphSeparator splits blocks)
+            ReplaceHtml = 2  // payload is an HTML fragment, for anything formatted
+        };
+        Type type = ReplaceText;
+        qint32 position = 0;
+        qint32 removed = 0;
+        QString payload;
+        quint64 sequence = 0;
+    };
+
+    explicit EditJournal(QObject *parent = nullptr);
+    ~EditJournal();
+
+    // Attaches to the journal of notePath. Existing operations are kept only
+    // if they were recorded against the note as it currently is on disk.
+    bool open(const QString &notePath);
+    // Syncs and detaches, leaving any operations on disk for recovery
+    void close();
+    // Drops the journal entirely (edits discarded by the user)
+    void discard();
+
+    bool isOpen() const { return !m_notePath.isEmpty(); }
+    QString notePath() const { return m_notePath; }
+    quint64 sequence() const { return m_sequence; }
+
+    void append(Operation::Type type, int position, int removed, const QString &payload);
+    // Operations not yet covered by a save of the note
+    QList<Operation> pendingOperations() const { return m_operations; }
+
+    // The note has been written with every operation up to and including
+    // upToSequence; rewrite the journal against the new file on disk.
+    void compact(quint64 upToSequence);
+
+    // Forces buffered operations to stable storage
+    void sync();
+
+    static QString journalPath(const QString &notePath);
+    // Notes that have a journal with operations, most recently edited first
+    static QStringList notesWithPendingEdits();
+
+private:
+    struct BaseStamp {
+        qint64 size = -1;
+        qint64 modified = -1;
+        bool operator==(const BaseStamp &other) const {
+            return size == other.size && modified == other.modified;
+        }
+    };
+
+    static BaseStamp stampOf(const QString &notePath);
+    static bool readJournal(const QString &journalFile, QString *notePath,
+                            BaseStamp *base, QList<Operation> *operations);
+    static QByteArray encodeHeader(const QString &notePath, const BaseStamp &base);
+    static QByteArray encodeOperation(const Operation &operation);
+
+    bool ensureWritable();
+    void scheduleSync();
+
+    QString m_notePath;
+    QFile m_file;
+    QList<Operation> m_operations;
+    quint64 m_sequence = 0;
+    int m_unsynced = 0;
+    QTimer m_syncTimer;
+
+    static const int SYNC_INTERVAL = 500;   // ms between batched fsyncs
+    static const int SYNC_BATCH_SIZE = 64;  // operations that force an early fsync
+};
+
+#endif // EDITJOURNAL_H
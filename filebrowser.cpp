@@ -1,7 +1,7 @@
 #include "filebrowser.h"
 #include "filebrowserdividerdelegate.h"
-#include <QTreeWidget>
-#include <QTreeWidgetItemIterator>
+#include <QTreeView>
+#include <QItemSelectionModel>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
@@ -19,19 +19,16 @@
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QFile>
-#include <QSaveFile>
 #include <QFrame>
 #include <QEvent>
 #include <QTimer>
 #include <QRegularExpression>
 #include <QDebug>
-#include <QTextStream>
 #include <algorithm>
 #include "thememanager.h"
-
-namespace {
-constexpr const char *kOrderingFileName = ".qutenote_order.md";
-}
+#include "noteformat.h"
+#include "noteversionsdialog.h"
+#include <QtConcurrent>
 
 FileBrowser::FileBrowser(QWidget *parent)
     : QuteNote::ComponentBase(parent)
@@ -43,20 +40,29 @@ FileBrowser::FileBrowser(QWidget *parent)
 
 void FileBrowser::initializeComponent()
 {
-    // Create tree widget and main layout (Qt 6: install layout on this widget)
-    m_treeWidget = QuteNote::makeOwned<FileBrowserTreeWidget>(this);
+    // Directory model; folders are listed when first expanded and ordered
+    // by the per-directory ordering metadata
+    m_model = new LazyDocumentModel(this);
+    m_model->setLazyLoadingEnabled(m_lazyLoading);
+    m_model->setEntryOrderer([this](const QString &directoryPath, const QFileInfoList &entries) {
+        return orderEntries(directoryPath, entries);
+    });
+
+    // Create tree view and main layout (Qt 6: install layout on this widget)
+    m_treeView = QuteNote::makeOwned<FileBrowserTreeView>(this);
+    m_treeView->setModel(m_model);
     m_layout = QuteNote::makeOwned<QVBoxLayout>(this);
 
     // Set initial root directory for drag-drop handling
-    m_treeWidget->setRootDirectory(m_rootDirectory);
+    m_treeView->setRootDirectory(m_rootDirectory);
 
-    // Drag-drop is now configured in FileBrowserTreeWidget constructor
+    // Drag-drop is now configured in FileBrowserTreeView constructor
     // with proper drop event handling to perform actual file moves
     
     // Make tree widget touch-friendly
-    UIUtils::makeTouchFriendly(m_treeWidget.get());
+    UIUtils::makeTouchFriendly(m_treeView.get());
     // Enable kinetic scrolling on the tree viewport for touch devices
-    QScroller::grabGesture(m_treeWidget->viewport(), QScroller::TouchGesture);
+    QScroller::grabGesture(m_treeView->viewport(), QScroller::TouchGesture);
 
     // Set up touch handling
     m_touchHandler = QuteNote::makeOwned<FileBrowserTouchHandler>(this);
@@ -74,6 +80,20 @@ void FileBrowser::initializeComponent()
     m_moveBufferTimer->setInterval(250); // ms
     connect(m_moveBufferTimer.get(), &QTimer::timeout, this, &FileBrowser::processMoveBuffer);
 
+    // Picks up changes made by sync tools, editors and the like. The one
+    // watcher of the notes root; the search index is fed from it as well.
+    m_notesWatcher = new NotesWatcher(this);
+    connect(m_notesWatcher, &NotesWatcher::changesReady, this,
+            [this](const QList<NotesWatcher::DirectoryChange> &changes) {
+        // Cached counts go stale right away, even while rows wait for a move
+        for (const NotesWatcher::DirectoryChange &change : changes) {
+            m_model->directoryChangedOnDisk(change.directory);
+        }
+        applyExternalChanges(changes);
+    });
+    connect(m_notesWatcher, &NotesWatcher::changesReady,
+            this, &FileBrowser::notesChangedOnDisk);
+
     // Tree widget is now styled by the global application stylesheet
 }
 
@@ -89,23 +109,26 @@ void FileBrowser::navigateBack()
 void FileBrowser::navigateForward()
 {
     // TODO: Implement folder navigation history
-    if (m_treeWidget->selectedItems().count() == 1) {
-        QTreeWidgetItem* item = m_treeWidget->selectedItems().first();
-        QString path = item->data(0, Qt::UserRole).toString();
+    const QModelIndexList selected = m_treeView->selectionModel()->selectedRows();
+    if (selected.count() == 1) {
+        QString path = selected.first().data(LazyDocumentModel::PathRole).toString();
         if (QFileInfo(path).isDir()) {
             setRootDirectory(path);
         }
     }
     
-    // Set up the recent files section
-    QTreeWidgetItem* recentFilesRoot = createRecentFilesSection();
-    m_recentFilesRoot.reset(recentFilesRoot);
-    m_treeWidget->insertTopLevelItem(0, m_recentFilesRoot.get());
-    m_recentFilesRoot->setExpanded(true);
+    // Show the recent files section
+    m_model->setRecentFilesVisible(true);
+    m_treeView->expand(m_model->recentFilesIndex());
 }
 
 FileBrowser::~FileBrowser()
 {
+    // Let a running move batch finish (or roll back) rather than stop
+    // halfway; its ordering is placed again on the next listing
+    if (m_moveWatcher) {
+        m_moveWatcher->waitForFinished();
+    }
     cleanupResources();
 }
 
@@ -116,9 +139,9 @@ void FileBrowser::setupConnections()
         connect(m_touchHandler.get(), &FileBrowserTouchHandler::overscrollAmountChanged,
                 this, &FileBrowser::setOverscrollAmount);
         connect(m_touchHandler.get(), &FileBrowserTouchHandler::itemTapped,
-                this, [this](QTreeWidgetItem* item) {
-                    if (item) {
-                        onItemDoubleClicked(item, 0);
+                this, [this](const QModelIndex &index) {
+                    if (index.isValid()) {
+                        onItemDoubleClicked(index);
                     }
                 });
     }
@@ -130,51 +153,37 @@ void FileBrowser::setupConnections()
         updateStatusBar(tr("Folder: %1").arg(name));
     });
 
-    // Connect expansion/collapse once for lazy loading and icon updates
-    if (m_treeWidget) {
-        connect(m_treeWidget.get(), &QTreeWidget::itemExpanded, this,
-                [this](QTreeWidgetItem *item) {
-            QString path = item->data(0, Qt::UserRole).toString();
-            if (!path.isEmpty() && item->childCount() == 1 &&
-                item->child(0)->data(0, Qt::UserRole).toString().isEmpty()) {
-                // Remove placeholder and load real children
-                item->takeChild(0);
-                loadDirectory(item, path);
-            }
-            // Update icon to expanded (minus) or empty folder icon if no children
-            if (!path.isEmpty()) {
-                if (item->childCount() > 0) {
-                    item->setIcon(0, QIcon(":/resources/icons/custom/folder-minus.svg"));
-                } else {
-                    item->setIcon(0, QIcon(":/resources/icons/custom/folder.svg"));
-                }
-                // Track expanded directory
-                QFileInfo info(path);
-                if (info.isDir()) {
-                    m_expandedDirs.insert(info.absoluteFilePath());
-                }
+    // Folders are listed by the model (fetchMore) when they are expanded;
+    // only the folder icon and the remembered expansion state change here
+    if (m_treeView) {
+        connect(m_treeView.get(), &QTreeView::expanded, this,
+                [this](const QModelIndex &index) {
+            m_model->setData(index, true, LazyDocumentModel::ExpandedRole);
+            if (m_model->isFolder(index)) {
+                m_expandedDirs.insert(index.data(LazyDocumentModel::PathRole).toString());
             }
         });
 
-        connect(m_treeWidget.get(), &QTreeWidget::itemCollapsed, this,
-                [this](QTreeWidgetItem *item) {
-            const QString path = item->data(0, Qt::UserRole).toString();
-            if (path.isEmpty()) return;
-            // On collapse, show contracted icon unless it's empty
-            if (item->childCount() > 0) {
-                item->setIcon(0, QIcon(":/resources/icons/custom/folder-plus.svg"));
-            } else {
-                item->setIcon(0, QIcon(":/resources/icons/custom/folder.svg"));
-            }
-            QFileInfo info(path);
-            if (info.isDir()) {
-                m_expandedDirs.remove(info.absoluteFilePath());
+        connect(m_treeView.get(), &QTreeView::collapsed, this,
+                [this](const QModelIndex &index) {
+            m_model->setData(index, false, LazyDocumentModel::ExpandedRole);
+            if (m_model->isFolder(index)) {
+                m_expandedDirs.remove(index.data(LazyDocumentModel::PathRole).toString());
             }
         });
-        connect(m_treeWidget.get(), &FileBrowserTreeWidget::itemOrderChanged,
+        connect(m_treeView.get(), &FileBrowserTreeView::itemOrderChanged,
                 this, &FileBrowser::onItemOrderChanged);
     }
 
+    // Rows listed while search results are shown stay filtered
+    if (m_model) {
+        connect(m_model, &QAbstractItemModel::rowsInserted, this,
+                [this](const QModelIndex &parent, int first, int last) {
+            if (m_searchActive) {
+                hideNonMatchingRows(parent, first, last);
+            }
+        });
+    }
 }
 
 void FileBrowser::cleanupResources()
@@ -182,11 +191,6 @@ void FileBrowser::cleanupResources()
     // Save recent files before cleanup
     saveRecentFiles();
 
-    // Clear tree widget to free memory
-    if (m_treeWidget) {
-        m_treeWidget->clear();
-    }
-
     // Clear loaded paths cache
     m_loadedPaths.clear();
 
@@ -203,15 +207,13 @@ void FileBrowser::handleMemoryWarning()
     m_loadedPaths.clear();
 
     // Collapse all items except current path
-    if (m_treeWidget) {
-        QTreeWidgetItemIterator it(m_treeWidget.get());
-        while (*it) {
-            if (!*it) break; // Safety check
-            QString path = (*it)->data(0, Qt::UserRole).toString();
+    if (m_treeView) {
+        const QModelIndexList expanded = expandedIndexes();
+        for (const QModelIndex &index : expanded) {
+            const QString path = index.data(LazyDocumentModel::PathRole).toString();
             if (!m_currentDirectory.startsWith(path)) {
-                (*it)->setExpanded(false);
+                m_treeView->collapse(index);
             }
-            ++it;
         }
     }
 
@@ -221,34 +223,36 @@ void FileBrowser::handleMemoryWarning()
             if (m_recentFiles.empty()) break; // Safety check
             m_recentFiles.remove(*m_recentFiles.begin());
         }
+        rebuildRecentFilesSection();
         saveRecentFiles();
     }
 }
 
 void FileBrowser::setupUI()
 {
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
     // Configure tree widget for touch-friendly use
     // Hide the header (remove "Notes" header)
-    m_treeWidget->setHeaderHidden(true);
-    m_treeWidget->setRootIsDecorated(true);
-    m_treeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    m_treeView->setHeaderHidden(true);
+    m_treeView->setRootIsDecorated(true);
+    m_treeView->setContextMenuPolicy(Qt::CustomContextMenu);
     
     // Ensure tree widget expands to fill available space
-    m_treeWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    m_treeView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
     // Create actions
     m_createFolderAction = QuteNote::makeOwned<QAction>(tr("New Folder"), this);
     m_createFolderAction->setIcon(QIcon(":/resources/icons/custom/new-file.svg"));
         // Use custom delegate for divider items
-        m_treeWidget->setItemDelegate(new FileBrowserDividerDelegate(m_treeWidget.get()));
+        m_treeView->setItemDelegate(new FileBrowserDividerDelegate(m_treeView.get()));
     m_createNoteAction = QuteNote::makeOwned<QAction>(tr("New Note"), this);
     m_createNoteAction->setIcon(QIcon(":/resources/icons/custom/file-plus-2.svg"));
     m_createDividerAction = QuteNote::makeOwned<QAction>(tr("Add Divider"), this);
     m_removeAction = QuteNote::makeOwned<QAction>(tr("Remove"), this);
     m_removeAction->setIcon(QIcon(":/resources/icons/custom/close.svg"));
     m_renameAction = QuteNote::makeOwned<QAction>(tr("Rename"), this);
+    m_versionsAction = QuteNote::makeOwned<QAction>(tr("Previous Versions..."), this);
 
     // Create breadcrumb container
     m_breadcrumbContainer = QuteNote::makeOwned<QWidget>(this);
@@ -266,6 +270,10 @@ void FileBrowser::setupUI()
     m_contextMenu->addSeparator();
     m_contextMenu->addAction(m_removeAction.get());
     m_contextMenu->addAction(m_renameAction.get());
+    m_contextMenu->addSeparator();
+    m_contextMenu->addAction(m_versionsAction.get());
+    connect(m_versionsAction.get(), &QAction::triggered,
+            this, &FileBrowser::onShowVersions);
 
 
     // Create a fixed top button bar (toolbar) above the breadcrumbs and tree widget
@@ -330,6 +338,8 @@ void FileBrowser::setupUI()
         m_removeBtn->setIconSize(QSize(iconSz, iconSz));
         m_removeBtn->setMinimumSize(btnWidth, touchTarget);
         m_removeBtn->setMaximumSize(btnWidth, touchTarget);
+        // Item icons come from IconAtlas, rasterized at this size
+        m_treeView->setIconSize(QSize(iconSz, iconSz));
         
         // Update button bar height
         const int padding = 8;
@@ -354,6 +364,7 @@ void FileBrowser::setupUI()
     m_removeBtn->setIconSize(QSize(iconSz, iconSz));
     m_removeBtn->setMinimumSize(btnWidth, touchTarget);
     m_removeBtn->setMaximumSize(btnWidth, touchTarget);
+    m_treeView->setIconSize(QSize(iconSz, iconSz));
     
     // Set initial button bar height
     const int padding = 8;
@@ -381,9 +392,9 @@ void FileBrowser::setupUI()
     configureButton(m_removeBtn.get());
 
     // Style tree and bar for a single bezelled look
-    m_treeWidget->setFrameShape(QFrame::NoFrame);
-    // m_treeWidget->setStyleSheet(
-    //     "QTreeWidget {"
+    m_treeView->setFrameShape(QFrame::NoFrame);
+    // m_treeView->setStyleSheet(
+    //     "QTreeView {"
     //     "  background-color: palette(base);"
     //     "  border: 2px solid palette(highlight);"
     //     "  border-top-left-radius: 8px;"
@@ -403,7 +414,7 @@ void FileBrowser::setupUI()
     // Add top bar to main layout before breadcrumbs and tree
     m_layout->insertWidget(0, m_buttonBar.get());
     m_layout->insertWidget(1, m_breadcrumbContainer.get());
-    m_layout->insertWidget(2, m_treeWidget.get(), /*stretch=*/1);
+    m_layout->insertWidget(2, m_treeView.get(), /*stretch=*/1);
 
     // Explicitly set stretch by index for clarity in Qt 6
     // 0: button bar, 1: breadcrumbs, 2: tree
@@ -422,16 +433,16 @@ void FileBrowser::setupUI()
     }
 
     // Install event filter on viewport to address drag-leave artifacts
-    m_treeWidget->viewport()->installEventFilter(this);
+    m_treeView->viewport()->installEventFilter(this);
 
     // Basic signal connections only
-    connect(m_treeWidget.get(), &QTreeWidget::itemClicked,
+    connect(m_treeView.get(), &QTreeView::clicked,
             this, &FileBrowser::onItemClicked);
-    connect(m_treeWidget.get(), &QTreeWidget::itemDoubleClicked,
+    connect(m_treeView.get(), &QTreeView::doubleClicked,
             this, &FileBrowser::onItemDoubleClicked);
-    connect(m_treeWidget.get(), &QTreeWidget::itemSelectionChanged,
+    connect(m_treeView->selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &FileBrowser::onItemSelectionChanged);
-    connect(m_treeWidget.get(), &QTreeWidget::customContextMenuRequested,
+    connect(m_treeView.get(), &QTreeView::customContextMenuRequested,
             this, &FileBrowser::onContextMenuRequested);
     
     // Connect toolbar buttons
@@ -485,362 +496,258 @@ void FileBrowser::setupContextMenu()
 
 void FileBrowser::populateTree()
 {
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
 
     // Remember expanded directories before rebuilding
     captureExpandedPaths();
 
-    m_treeWidget->clear();
-
-    // Populate current root directory entries directly as top-level items (no explicit root item)
-    const QList<QFileInfo> entries = orderedEntriesForDirectory(m_rootDirectory);
-    for (const QFileInfo &entry : entries) {
-        QTreeWidgetItem *item = new QTreeWidgetItem(m_treeWidget.get());
-        item->setData(0, Qt::UserRole, entry.absoluteFilePath());
-        if (entry.isDir()) {
-            item->setText(0, displayNameForEntry(entry));
-            QDir d(entry.absoluteFilePath());
-            const bool empty = d.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot).isEmpty();
-            if (empty) {
-                item->setIcon(0, QIcon(":/resources/icons/custom/folder.svg"));
-            } else {
-                item->setIcon(0, QIcon(":/resources/icons/custom/folder-plus.svg"));
-            }
-            if (m_lazyLoading) {
-                item->addChild(new QTreeWidgetItem()); // placeholder for expansion
-            }
-        } else {
-            // Custom display for divider files
-            if (entry.suffix().compare("divider", Qt::CaseInsensitive) == 0) {
-                const QString base = entry.completeBaseName();
-                item->setText(0, base); // Just the title, delegate will handle drawing
-                // No icon for dividers, delegate draws the line
-            } else {
-                item->setText(0, displayNameForEntry(entry));
-                // Use custom file icon for all other files
-                QIcon fileIcon(":/resources/icons/custom/file.svg");
-                if (fileIcon.isNull()) {
-                    fileIcon = QApplication::style()->standardIcon(QStyle::SP_FileIcon);
-                }
-                item->setIcon(0, fileIcon);
-            }
-        }
+    // Only the first level is listed here; the model lists every other
+    // folder when it is expanded
+    m_hiddenRows.clear();
+    if (QDir::cleanPath(m_ordering.rootPath()) != QDir::cleanPath(QFileInfo(m_rootDirectory).absoluteFilePath())
+            && !m_ordering.open(m_rootDirectory)) {
+        qWarning() << "Cannot open ordering index for" << m_rootDirectory;
+    }
+    if (!m_model->setRootPath(m_rootDirectory)) {
+        qWarning() << "Cannot list notes directory" << m_rootDirectory;
+    }
+    if (m_notesWatcher) {
+        m_notesWatcher->setRootPath(m_rootDirectory);
     }
 
     // Restore previously expanded directories
     restoreExpandedPaths();
 
+    if (m_searchActive) {
+        applySearchFilter();
+        return;
+    }
+
     // Ensure something is selected by default (first item)
-    if (m_treeWidget->topLevelItemCount() > 0) {
-        m_treeWidget->setCurrentItem(m_treeWidget->topLevelItem(0));
+    if (m_model->rowCount() > 0) {
+        m_treeView->setCurrentIndex(m_model->index(0, 0));
     }
 }
 
-void FileBrowser::setRootDirectory(const QString &path)
+void FileBrowser::refreshDirectory(const QString &path)
 {
-    m_rootDirectory = path;
-    m_currentDirectory = path;
-    
-    // Update the tree widget's root directory for proper drop handling
-    if (m_treeWidget) {
-        m_treeWidget->setRootDirectory(path);
-    }
-    
-    populateTree();
-    emit directoryChanged(m_currentDirectory);
+    if (!m_model) return;
+
+    m_model->refreshDirectory(path.isEmpty() ? m_rootDirectory : path);
 }
 
-void FileBrowser::captureExpandedPaths()
+void FileBrowser::setLazyLoadingEnabled(bool enabled)
 {
-    m_expandedDirs.clear();
-    if (!m_treeWidget) return;
-
-    const int topCount = m_treeWidget->topLevelItemCount();
-    for (int i = 0; i < topCount; ++i) {
-        QTreeWidgetItem *top = m_treeWidget->topLevelItem(i);
-        if (!top) continue;
-        QString path = top->data(0, Qt::UserRole).toString();
-        if (top->isExpanded() && !path.isEmpty()) {
-            QFileInfo info(path);
-            if (info.isDir()) m_expandedDirs.insert(info.absoluteFilePath());
-        }
-        // Walk children (limited depth to avoid heavy traversal)
-        QList<QTreeWidgetItem*> stack;
-        stack.append(top);
-        while (!stack.isEmpty()) {
-            QTreeWidgetItem *it = stack.takeLast();
-            const int cc = it->childCount();
-            for (int c = 0; c < cc; ++c) {
-                QTreeWidgetItem *child = it->child(c);
-                if (!child) continue;
-                QString cpath = child->data(0, Qt::UserRole).toString();
-                if (child->isExpanded() && !cpath.isEmpty()) {
-                    QFileInfo cinfo(cpath);
-                    if (cinfo.isDir()) m_expandedDirs.insert(cinfo.absoluteFilePath());
-                }
-                stack.append(child);
-            }
-        }
+    m_lazyLoading = enabled;
+    if (m_model) {
+        m_model->setLazyLoadingEnabled(enabled);
     }
 }
 
-bool FileBrowser::expandPath(const QString &absPath, bool selectEnd)
+void FileBrowser::showSearchResults(const QStringList &paths)
 {
-    if (!m_treeWidget) return false;
-    if (absPath.isEmpty()) return false;
+    if (!m_treeView) return;
 
-    QFileInfo targetInfo(absPath);
-    const QString dirPath = targetInfo.isDir() ? targetInfo.absoluteFilePath()
-                                               : targetInfo.absolutePath();
-
-    // Special case: item lives directly under root directory
-    if (QDir::cleanPath(dirPath) == QDir::cleanPath(m_rootDirectory)) {
-        // For files, select the top-level file item; for directories, select the dir item
-        const int topCount = m_treeWidget->topLevelItemCount();
-        for (int i = 0; i < topCount; ++i) {
-            QTreeWidgetItem *it = m_treeWidget->topLevelItem(i);
-            if (!it) continue;
-            const QString ipath = it->data(0, Qt::UserRole).toString();
-            if (ipath == absPath || ipath == dirPath) {
-                if (targetInfo.isDir()) it->setExpanded(true);
-                if (selectEnd) {
-                    m_treeWidget->setCurrentItem(it);
-                    m_treeWidget->scrollToItem(it);
-                }
-                return true;
-            }
-        }
-        return false;
+    if (!m_searchActive) {
+        captureExpandedPaths();
+        m_expandedBeforeSearch = m_expandedDirs;
+        m_searchActive = true;
     }
+    m_searchPaths = paths;
+    applySearchFilter();
 
-    // Compute relative path from root to the directory containing the target
-    QString rel = QDir(m_rootDirectory).relativeFilePath(dirPath);
-    QString topComponent = rel.section('/', 0, 0);
-    QTreeWidgetItem *current = nullptr;
-
-    // Find top-level item
-    const int count = m_treeWidget->topLevelItemCount();
-    for (int i = 0; i < count; ++i) {
-        QTreeWidgetItem *it = m_treeWidget->topLevelItem(i);
-        if (!it) continue;
-        if (it->data(0, Qt::UserRole).toString() == QDir(m_rootDirectory).absoluteFilePath(topComponent)) {
-            current = it;
-            break;
+    if (!paths.isEmpty()) {
+        const QModelIndex first = m_model->indexForPath(paths.first());
+        if (first.isValid()) {
+            m_treeView->setCurrentIndex(first);
+            m_treeView->scrollTo(first);
         }
     }
-    if (!current) return false;
+}
 
-    // Expand through the remaining components
-    QStringList components = rel.split('/', Qt::SkipEmptyParts);
-    for (int idx = 0; idx < components.size(); ++idx) {
-        if (idx == 0) {
-            // already at topComponent
-        } else {
-            // Ensure children are loaded
-            if (current->childCount() == 1 && current->child(0)->data(0, Qt::UserRole).toString().isEmpty()) {
-                // Placeholder present, load children
-                QString cpath = current->data(0, Qt::UserRole).toString();
-                current->takeChild(0);
-                loadDirectory(current, cpath);
-            }
-            // Find next component under current
-            const QString nextName = components.at(idx);
-            QTreeWidgetItem *nextItem = nullptr;
-            const int cc = current->childCount();
-            for (int c = 0; c < cc; ++c) {
-                QTreeWidgetItem *child = current->child(c);
-                if (!child) continue;
-                QFileInfo chInfo(child->data(0, Qt::UserRole).toString());
-                if (chInfo.fileName() == nextName) { nextItem = child; break; }
-            }
-            if (!nextItem) break; // path component not found
-            current = nextItem;
-        }
-        current->setExpanded(true);
-    }
+void FileBrowser::clearSearchResults()
+{
+    if (!m_searchActive || !m_treeView) return;
 
-    // Optionally select the end target
-    if (selectEnd) {
-        QString selectPath = targetInfo.isDir() ? targetInfo.absoluteFilePath()
-                                               : targetInfo.absoluteFilePath();
-        // If selecting a file, find it under its parent dir
-        if (!targetInfo.isDir()) {
-            // Ensure children loaded
-            if (current->childCount() == 1 && current->child(0)->data(0, Qt::UserRole).toString().isEmpty()) {
-                QString cpath = current->data(0, Qt::UserRole).toString();
-                current->takeChild(0);
-                loadDirectory(current, cpath);
-            }
-            const int cc = current->childCount();
-            for (int c = 0; c < cc; ++c) {
-                QTreeWidgetItem *child = current->child(c);
-                if (!child) continue;
-                if (child->data(0, Qt::UserRole).toString() == selectPath) {
-                    m_treeWidget->setCurrentItem(child);
-                    m_treeWidget->scrollToItem(child);
-                    return true;
-                }
-            }
-        } else {
-            m_treeWidget->setCurrentItem(current);
-            m_treeWidget->scrollToItem(current);
-            return true;
+    m_searchActive = false;
+    m_searchPaths.clear();
+    m_searchHits.clear();
+    m_searchAncestors.clear();
+
+    for (const QPersistentModelIndex &index : std::as_const(m_hiddenRows)) {
+        if (index.isValid()) {
+            m_treeView->setRowHidden(index.row(), index.parent(), false);
         }
     }
-    return true;
-}
+    m_hiddenRows.clear();
+    m_model->setEmphasizedPaths(QSet<QString>());
 
-void FileBrowser::restoreExpandedPaths()
-{
-    if (m_expandedDirs.isEmpty() || !m_treeWidget) return;
-    // Expand each remembered directory path
-    for (const QString &path : std::as_const(m_expandedDirs)) {
-        expandPath(path, false);
+    // Folders opened to reveal hits go back to how the user left them.
+    // Collapse one by one (deepest first) so each folder gets its icon back.
+    const QModelIndexList expanded = expandedIndexes();
+    for (auto it = expanded.crbegin(); it != expanded.crend(); ++it) {
+        m_treeView->collapse(*it);
     }
+    m_expandedDirs = m_expandedBeforeSearch;
+    m_expandedBeforeSearch.clear();
+    restoreExpandedPaths();
 }
 
-
-void FileBrowser::addDirectoryToTree(QTreeWidgetItem *parentItem, const QDir &directory)
+void FileBrowser::applySearchFilter()
 {
-    const QList<QFileInfo> entries = orderedEntriesForDirectory(directory.absolutePath());
+    // Hits deep in collapsed folders are not in the model yet; expanding the
+    // path lists them
+    m_searchHits.clear();
+    m_searchAncestors.clear();
+    const QString root = QDir::cleanPath(m_rootDirectory);
+    for (const QString &path : std::as_const(m_searchPaths)) {
+        const QString clean = QDir::cleanPath(path);
+        m_searchHits.insert(clean);
+        expandPath(clean, false);
+        QString parent = QFileInfo(clean).absolutePath();
+        while (parent.size() > root.size() && !m_searchAncestors.contains(parent)) {
+            m_searchAncestors.insert(parent);
+            parent = QFileInfo(parent).absolutePath();
+        }
+    }
 
-    for (const QFileInfo &entry : entries) {
-        QTreeWidgetItem *item = addFileItem(parentItem, entry);
-        if (entry.isDir()) {
-            QDir subDir(entry.absoluteFilePath());
-            addDirectoryToTree(item, subDir);
+    for (const QPersistentModelIndex &index : std::as_const(m_hiddenRows)) {
+        if (index.isValid()) {
+            m_treeView->setRowHidden(index.row(), index.parent(), false);
         }
     }
-}
+    m_hiddenRows.clear();
 
-QString FileBrowser::stripOrderingPrefix(const QString &text) const
-{
-    static const QRegularExpression prefixRx("^\\d{3}_(.+)$");
-    const QRegularExpressionMatch match = prefixRx.match(text);
-    if (match.hasMatch()) {
-        return match.captured(1);
+    // Rows can only show up at the top level and inside the folders leading
+    // to hits; whatever sits in other folders is hidden along with them
+    hideNonMatchingRows(QModelIndex(), 0, m_model->rowCount() - 1);
+    for (const QString &ancestor : std::as_const(m_searchAncestors)) {
+        const QModelIndex parent = m_model->indexForPath(ancestor);
+        if (parent.isValid()) {
+            hideNonMatchingRows(parent, 0, m_model->rowCount(parent) - 1);
+        }
     }
-    return text;
+
+    m_model->setEmphasizedPaths(m_searchHits);
 }
 
-QString FileBrowser::displayNameForEntry(const QFileInfo &info) const
+void FileBrowser::hideNonMatchingRows(const QModelIndex &parent, int first, int last)
 {
-    return stripOrderingPrefix(info.fileName());
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        const QString path = index.data(LazyDocumentModel::PathRole).toString();
+        // Virtual items (Recent Files) are never search results
+        if (m_model->isVirtual(index)
+            || (!m_searchHits.contains(path) && !m_searchAncestors.contains(path))) {
+            m_treeView->setRowHidden(row, parent, true);
+            m_hiddenRows << QPersistentModelIndex(index);
+        }
+    }
 }
 
-QString FileBrowser::orderingMetadataPath(const QString &directoryPath) const
+void FileBrowser::setRootDirectory(const QString &path)
 {
-    const QString baseDir = directoryPath.isEmpty() ? m_rootDirectory : directoryPath;
-    return QDir(baseDir).filePath(QString::fromLatin1(kOrderingFileName));
+    m_rootDirectory = path;
+    m_currentDirectory = path;
+    
+    // Update the tree view's root directory for proper drop handling
+    if (m_treeView) {
+        m_treeView->setRootDirectory(path);
+    }
+    
+    populateTree();
+    emit directoryChanged(m_currentDirectory);
 }
 
-QStringList FileBrowser::loadOrderingMetadata(const QString &directoryPath) const
+QModelIndexList FileBrowser::expandedIndexes() const
 {
-    const QString normalizedDir = QDir::cleanPath(directoryPath.isEmpty() ? m_rootDirectory : directoryPath);
-    if (m_cachedOrdering.contains(normalizedDir)) {
-        return m_cachedOrdering.value(normalizedDir);
-    }
-
-    QStringList names;
-    QFile file(orderingMetadataPath(normalizedDir));
-    if (file.exists()) {
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream stream(&file);
-            while (!stream.atEnd()) {
-                const QString line = stream.readLine().trimmed();
-                if (line.startsWith(QStringLiteral("- "))) {
-                    const QString name = line.mid(2).trimmed();
-                    if (!name.isEmpty()) {
-                        names << name;
-                    }
-                } else if (line.startsWith(QStringLiteral("* "))) {
-                    const QString name = line.mid(2).trimmed();
-                    if (!name.isEmpty()) {
-                        names << name;
-                    }
-                }
+    // Walks the rows the model has listed so far; folders that were never
+    // expanded have no rows and are not descended into
+    QModelIndexList expanded;
+    if (!m_treeView) return expanded;
+
+    QModelIndexList stack;
+    stack.append(QModelIndex());
+    while (!stack.isEmpty()) {
+        const QModelIndex parent = stack.takeLast();
+        const int rows = m_model->rowCount(parent);
+        for (int row = 0; row < rows; ++row) {
+            const QModelIndex index = m_model->index(row, 0, parent);
+            if (m_treeView->isExpanded(index)) {
+                expanded.append(index);
+            }
+            if (m_model->isFolder(index)) {
+                stack.append(index);
             }
-        } else {
-            qWarning() << "Failed to read ordering metadata for" << normalizedDir << file.errorString();
         }
     }
-
-    m_cachedOrdering.insert(normalizedDir, names);
-    return names;
+    return expanded;
 }
 
-void FileBrowser::saveOrderingMetadata(const QString &directoryPath, const QStringList &orderedNames) const
+void FileBrowser::captureExpandedPaths()
 {
-    const QString normalizedDir = QDir::cleanPath(directoryPath.isEmpty() ? m_rootDirectory : directoryPath);
-    const QString metadataPath = orderingMetadataPath(normalizedDir);
-
-    QDir dir(normalizedDir);
-    if (!dir.exists()) {
-        dir.mkpath(".");
-    }
-
-    QSaveFile file(metadataPath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "Unable to save ordering metadata for" << normalizedDir << file.errorString();
-        return;
-    }
-
-    QTextStream stream(&file);
-    stream << "<!-- QuteNote ordering metadata -->\n";
-    for (const QString &name : orderedNames) {
-        stream << "- " << name << '\n';
-    }
+    m_expandedDirs.clear();
+    if (!m_treeView) return;
 
-    if (!file.commit()) {
-        qWarning() << "Failed to commit ordering metadata for" << normalizedDir;
+    const QModelIndexList expanded = expandedIndexes();
+    for (const QModelIndex &index : expanded) {
+        if (m_model->isFolder(index)) {
+            m_expandedDirs.insert(index.data(LazyDocumentModel::PathRole).toString());
+        }
     }
-
-    m_cachedOrdering.insert(normalizedDir, orderedNames);
 }
 
-QStringList FileBrowser::ensureOrderingMetadata(const QString &directoryPath, const QFileInfoList &entries)
+bool FileBrowser::expandPath(const QString &absPath, bool selectEnd)
 {
-    const QString normalizedDir = QDir::cleanPath(directoryPath.isEmpty() ? m_rootDirectory : directoryPath);
-    QStringList actualNames;
-    actualNames.reserve(entries.size());
-    for (const QFileInfo &info : entries) {
-        const QString fileName = info.fileName();
-        if (fileName == QString::fromLatin1(kOrderingFileName)) {
-            continue;
-        }
-        actualNames << fileName;
-    }
-
-    QStringList existingOrder = loadOrderingMetadata(normalizedDir);
-    QStringList finalOrder;
-    finalOrder.reserve(actualNames.size());
-    QSet<QString> seen;
+    if (!m_treeView) return false;
+    if (absPath.isEmpty()) return false;
 
-    for (const QString &name : existingOrder) {
-        if (actualNames.contains(name) && !seen.contains(name)) {
-            finalOrder << name;
-            seen.insert(name);
-        }
+    const QString target = QDir::cleanPath(QFileInfo(absPath).absoluteFilePath());
+    const QString root = QDir::cleanPath(m_rootDirectory);
+    const QString rootPrefix = root.endsWith('/') ? root : root + '/';
+    if (!target.startsWith(rootPrefix)) {
+        return false;
     }
 
-    QStringList leftovers;
-    for (const QString &name : actualNames) {
-        if (!seen.contains(name)) {
-            leftovers << name;
+    // Walk down from the root. Folders on the way are listed synchronously
+    // so the next component can be looked up right away.
+    QModelIndex current;
+    QString currentPath = root;
+    const QStringList components = target.mid(rootPrefix.size()).split('/', Qt::SkipEmptyParts);
+    for (const QString &component : components) {
+        m_model->ensureLoaded(current);
+        currentPath = QDir(currentPath).filePath(component);
+        const QModelIndex next = m_model->indexForPath(currentPath);
+        if (!next.isValid()) {
+            return false; // path component not found
+        }
+        current = next;
+        if (m_model->isFolder(current)) {
+            m_model->ensureLoaded(current);
+            m_treeView->expand(current);
         }
     }
 
-    std::sort(leftovers.begin(), leftovers.end(), [](const QString &a, const QString &b) {
-        return a.localeAwareCompare(b) < 0;
-    });
-
-    finalOrder.append(leftovers);
+    // Optionally select the end target
+    if (selectEnd && current.isValid()) {
+        m_treeView->setCurrentIndex(current);
+        m_treeView->scrollTo(current);
+    }
+    return true;
+}
 
-    if (finalOrder != existingOrder) {
-        saveOrderingMetadata(normalizedDir, finalOrder);
+void FileBrowser::restoreExpandedPaths()
+{
+    if (m_expandedDirs.isEmpty() || !m_treeView) return;
+    // Expand each remembered directory path
+    for (const QString &path : std::as_const(m_expandedDirs)) {
+        expandPath(path, false);
     }
+}
 
-    return finalOrder;
+QString FileBrowser::displayNameForEntry(const QFileInfo &info) const
+{
+    return LazyDocumentModel::displayNameFor(info);
 }
 
 QFileInfo FileBrowser::maybeMigratePrefixedEntry(const QFileInfo &info)
@@ -874,227 +781,38 @@ QFileInfo FileBrowser::maybeMigratePrefixedEntry(const QFileInfo &info)
     }
 
     const QFileInfo migratedInfo(targetPath);
-    renameEntryInOrdering(baseDir, info.fileName(), migratedInfo.fileName());
+    m_ordering.rename(baseDir, info.fileName(), migratedInfo.fileName());
     emit fileRenamed(info.absoluteFilePath(), targetPath);
     return migratedInfo;
 }
 
-QFileInfoList FileBrowser::listDirectoryEntries(const QString &directoryPath)
+QFileInfoList FileBrowser::orderEntries(const QString &directoryPath, const QFileInfoList &entries)
 {
-    QDir dir(directoryPath);
-    const QFileInfoList rawEntries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot,
-                                                       QDir::Name | QDir::DirsFirst);
-
     QFileInfoList cleaned;
-    cleaned.reserve(rawEntries.size());
-    for (const QFileInfo &entry : rawEntries) {
-        if (entry.fileName() == QString::fromLatin1(kOrderingFileName)) {
+    cleaned.reserve(entries.size());
+    for (const QFileInfo &entry : entries) {
+        if (OrderingIndex::isIndexFile(entry.fileName())) {
             continue;
         }
         cleaned << maybeMigratePrefixedEntry(entry);
     }
-    return cleaned;
+    return m_ordering.order(directoryPath, cleaned);
 }
 
-QList<QFileInfo> FileBrowser::orderedEntriesForDirectory(const QString &directoryPath)
+void FileBrowser::onItemClicked(const QModelIndex &index)
 {
-    const QFileInfoList entries = listDirectoryEntries(directoryPath);
-    const QStringList order = ensureOrderingMetadata(directoryPath, entries);
-
-    QHash<QString, QFileInfo> infoByName;
-    for (const QFileInfo &info : entries) {
-        infoByName.insert(info.fileName(), info);
-    }
-
-    QList<QFileInfo> ordered;
-    ordered.reserve(order.size());
-    for (const QString &name : order) {
-        if (infoByName.contains(name)) {
-            ordered << infoByName.value(name);
-        }
-    }
-    return ordered;
-}
-
-void FileBrowser::recordOrderingFromTree(const QString &directoryPath)
-{
-    if (!m_treeWidget) {
+    if (!m_treeView || !index.isValid()) {
         return;
     }
 
-    const QString normalizedDir = QDir::cleanPath(directoryPath.isEmpty() ? m_rootDirectory : directoryPath);
-    QStringList orderedNames;
-
-    auto gather = [&](QTreeWidgetItem *parent) {
-        const int count = parent ? parent->childCount() : m_treeWidget->topLevelItemCount();
-        for (int i = 0; i < count; ++i) {
-            QTreeWidgetItem *item = parent ? parent->child(i) : m_treeWidget->topLevelItem(i);
-            if (!item) continue;
-            if (!parent && item == m_recentFilesRoot.get()) {
-                continue;
-            }
-            const QString path = item->data(0, Qt::UserRole).toString();
-            if (path.isEmpty()) {
-                continue;
-            }
-            const QFileInfo info(path);
-            if (info.fileName() == QString::fromLatin1(kOrderingFileName)) {
-                continue;
-            }
-            if (QDir::cleanPath(info.absolutePath()) == normalizedDir) {
-                orderedNames << info.fileName();
-            }
-        }
-    };
-
-    if (QDir::cleanPath(normalizedDir) == QDir::cleanPath(m_rootDirectory)) {
-        gather(nullptr);
-    } else {
-        QTreeWidgetItem *parentItem = findTreeItemForPath(normalizedDir);
-        if (!parentItem) {
-            return;
-        }
-        gather(parentItem);
-    }
-
-    if (orderedNames.isEmpty()) {
-        return;
-    }
-
-    saveOrderingMetadata(normalizedDir, orderedNames);
-    m_cachedOrdering.insert(normalizedDir, orderedNames);
-}
-
-void FileBrowser::upsertNameInOrdering(const QString &directoryPath, const QString &name, int index)
-{
-    if (name.isEmpty()) {
-        return;
-    }
-
-    QStringList order = loadOrderingMetadata(directoryPath);
-    if (order.isEmpty()) {
-        const QFileInfoList entries = listDirectoryEntries(directoryPath);
-        order = ensureOrderingMetadata(directoryPath, entries);
-    }
-
-    order.removeAll(name);
-    if (index < 0 || index > order.size()) {
-        order << name;
-    } else {
-        order.insert(index, name);
-    }
-
-    saveOrderingMetadata(directoryPath, order);
-}
-
-void FileBrowser::removeNameFromOrdering(const QString &directoryPath, const QString &name)
-{
-    if (name.isEmpty()) {
-        return;
-    }
-    QStringList order = loadOrderingMetadata(directoryPath);
-    if (order.isEmpty()) {
-        return;
-    }
-    const int removed = order.removeAll(name);
-    if (removed > 0) {
-        saveOrderingMetadata(directoryPath, order);
-    }
-}
-
-void FileBrowser::renameEntryInOrdering(const QString &directoryPath, const QString &oldName, const QString &newName)
-{
-    if (oldName == newName || newName.isEmpty()) {
-        return;
-    }
-
-    QStringList order = loadOrderingMetadata(directoryPath);
-    if (order.isEmpty()) {
-        return;
-    }
-
-    bool changed = false;
-    for (QString &name : order) {
-        if (name == oldName) {
-            name = newName;
-            changed = true;
-        }
-    }
-
-    if (changed) {
-        saveOrderingMetadata(directoryPath, order);
-    }
-}
-
-QTreeWidgetItem* FileBrowser::findTreeItemForPath(const QString &path) const
-{
-    if (!m_treeWidget) {
-        return nullptr;
-    }
-    const QString normalized = QDir::cleanPath(path);
-    QTreeWidgetItemIterator it(m_treeWidget.get());
-    while (*it) {
-        QTreeWidgetItem *item = *it;
-        const QString itemPath = QDir::cleanPath(item->data(0, Qt::UserRole).toString());
-        if (!itemPath.isEmpty() && itemPath == normalized) {
-            return item;
-        }
-        ++it;
-    }
-    return nullptr;
-}
-
-QTreeWidgetItem* FileBrowser::addFileItem(QTreeWidgetItem *parentItem, const QFileInfo &fileInfo)
-{
-    QTreeWidgetItem *item = new QTreeWidgetItem(parentItem);
-    item->setData(0, Qt::UserRole, fileInfo.absoluteFilePath());
-
-    if (fileInfo.isDir()) {
-        item->setText(0, displayNameForEntry(fileInfo));
-        // Set initial icon based on whether the directory is empty
-        QDir d(fileInfo.absoluteFilePath());
-        const bool empty = d.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot).isEmpty();
-        if (empty) {
-            item->setIcon(0, QIcon(":/resources/icons/custom/folder.svg"));
-        } else {
-            item->setIcon(0, QIcon(":/resources/icons/custom/folder-plus.svg"));
-        }
-    } else {
-        // Custom display for divider files
-        if (fileInfo.suffix().compare("divider", Qt::CaseInsensitive) == 0) {
-            const QString base = stripOrderingPrefix(fileInfo.completeBaseName());
-            item->setText(0, base); // Just the title, delegate will handle drawing
-            // No icon for dividers, delegate draws the line
-        } else {
-            item->setText(0, displayNameForEntry(fileInfo));
-            QIcon fileIcon(":/resources/icons/custom/file.svg");
-            if (fileIcon.isNull()) {
-                fileIcon = QApplication::style()->standardIcon(QStyle::SP_FileIcon);
-            }
-            item->setIcon(0, fileIcon);
-            }
-        }
-    return item;
-}
-
-void FileBrowser::onItemClicked(QTreeWidgetItem *item, int /*column*/)
-{
-    if (!m_treeWidget || !item) {
-        return;
-    }
-
-    if (m_treeWidget->currentItem() != item) {
-        m_treeWidget->setCurrentItem(item);
+    if (m_treeView->currentIndex() != index) {
+        m_treeView->setCurrentIndex(index);
     }
 
     // Handle recent files section
-    if (item->parent() == m_recentFilesRoot.get()) {
-        QString filePath = item->data(0, Qt::UserRole).toString();
-        if (filePath.isEmpty()) {
-            filePath = item->toolTip(0);
-        }
-
-        QFileInfo fileInfo(filePath);
+    const QModelIndex recentFilesIndex = m_model->recentFilesIndex();
+    if (recentFilesIndex.isValid() && index.parent() == recentFilesIndex) {
+        QFileInfo fileInfo(index.data(LazyDocumentModel::PathRole).toString());
         const QString resolvedPath = fileInfo.absoluteFilePath();
 
         if (resolvedPath.isEmpty()) {
@@ -1106,11 +824,7 @@ void FileBrowser::onItemClicked(QTreeWidgetItem *item, int /*column*/)
             // Drop the stale entry and persist the change
             m_recentFiles.remove(RecentFile{resolvedPath, QDateTime()});
             saveRecentFiles();
-
-            if (auto *parent = item->parent()) {
-                parent->removeChild(item);
-            }
-            delete item;
+            rebuildRecentFilesSection();
 
             const QFileInfo staleInfo(resolvedPath);
             updateStatusBar(tr("File no longer exists: %1").arg(displayNameForEntry(staleInfo)), 4000);
@@ -1123,22 +837,20 @@ void FileBrowser::onItemClicked(QTreeWidgetItem *item, int /*column*/)
         return;
     }
 
-    const QString path = item->data(0, Qt::UserRole).toString();
+    const QString path = index.data(LazyDocumentModel::PathRole).toString();
     if (path.isEmpty()) {
         updateButtonStates();
         return; // Virtual items like "Recent Files" header - ignore
     }
 
-    QFileInfo info(path);
-
-    if (info.isDir()) {
+    if (m_model->isFolder(index)) {
         // Folder - toggle expansion and treat as current directory
-        if (item->isExpanded()) {
-            m_treeWidget->collapseItem(item);
+        if (m_treeView->isExpanded(index)) {
+            m_treeView->collapse(index);
         } else {
-            m_treeWidget->expandItem(item);
+            m_treeView->expand(index);
         }
-        m_currentDirectory = info.absoluteFilePath();
+        m_currentDirectory = path;
         emit directoryChanged(m_currentDirectory);
     } else {
         emit fileSelected(path);
@@ -1148,17 +860,17 @@ void FileBrowser::onItemClicked(QTreeWidgetItem *item, int /*column*/)
     updateButtonStates();
 }
 
-void FileBrowser::onItemDoubleClicked(QTreeWidgetItem *item, int column)
+void FileBrowser::onItemDoubleClicked(const QModelIndex &index)
 {
-    onItemClicked(item, column);
+    onItemClicked(index);
 }
 
 void FileBrowser::onItemSelectionChanged()
 {
     // Update button states based on selection
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
-    bool hasSelection = !m_treeWidget->selectedItems().isEmpty();
+    bool hasSelection = m_treeView->selectionModel()->hasSelection();
     
     // Enable/disable remove button based on selection
     if (m_removeBtn) {
@@ -1173,14 +885,38 @@ void FileBrowser::onItemSelectionChanged()
 
 void FileBrowser::onContextMenuRequested(const QPoint &pos)
 {
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
-    // Simplified - no context menu for Android compatibility
-    QTreeWidgetItem *item = m_treeWidget->itemAt(pos);
-    if (item) {
-        // Just select the item without showing context menu
-        m_treeWidget->setCurrentItem(item);
-    }
+    const QModelIndex index = m_treeView->indexAt(pos);
+    if (index.isValid()) {
+        m_treeView->setCurrentIndex(index);
+    }
+
+#ifndef Q_OS_ANDROID
+    // Simplified on Android - long presses only select. The menu is the one
+    // built in setupUI(), Previous Versions... included.
+    const QString path = index.data(LazyDocumentModel::PathRole).toString();
+    const QFileInfo info(path);
+    m_renameAction->setEnabled(!path.isEmpty());
+    m_removeAction->setEnabled(!path.isEmpty());
+    m_versionsAction->setEnabled(info.isFile()
+                                 && info.suffix().compare("divider", Qt::CaseInsensitive) != 0);
+    m_contextMenu->popup(m_treeView->viewport()->mapToGlobal(pos));
+#endif
+}
+
+void FileBrowser::onShowVersions()
+{
+    if (!m_treeView) return;
+
+    const QString path = m_treeView->currentIndex().data(LazyDocumentModel::PathRole).toString();
+    if (path.isEmpty() || !QFileInfo(path).isFile()) return;
+
+    NoteVersionsDialog dialog(path, this);
+    connect(&dialog, &NoteVersionsDialog::aboutToRestore, this, &FileBrowser::fileAboutToBeRestored);
+    connect(&dialog, &NoteVersionsDialog::noteRestored, this, &FileBrowser::fileRestored);
+    dialog.exec();
+    QTimer::singleShot(0, this, &FileBrowser::forceUiRefreshAfterDialog);
 }
 
 void FileBrowser::onCreateFolder()
@@ -1223,8 +959,8 @@ void FileBrowser::onCreateFolder()
 
     // Determine target directory: selected folder, selected file's parent, or root/current
     QString baseDir = !m_currentDirectory.isEmpty() ? m_currentDirectory : m_rootDirectory;
-    if (m_treeWidget && m_treeWidget->currentItem()) {
-        const QString selPath = m_treeWidget->currentItem()->data(0, Qt::UserRole).toString();
+    if (m_treeView && m_treeView->currentIndex().isValid()) {
+        const QString selPath = m_treeView->currentIndex().data(LazyDocumentModel::PathRole).toString();
         if (!selPath.isEmpty()) {
             QFileInfo selInfo(selPath);
             baseDir = selInfo.isDir() ? selInfo.absoluteFilePath() : selInfo.absolutePath();
@@ -1248,34 +984,13 @@ void FileBrowser::onCreateFolder()
         return;
     }
 
-    upsertNameInOrdering(baseDir, QFileInfo(folderPath).fileName());
+    m_ordering.insert(baseDir, QFileInfo(folderPath).fileName());
 
     updateStatusBar(tr("Folder created: %1").arg(folderName));
 
-    // Try to reflect the new folder in the visible tree without a full reload
-    if (m_treeWidget) {
-        // Find the parent item representing baseDir
-        QTreeWidgetItem* parentItem = nullptr;
-        for (QTreeWidgetItemIterator it(m_treeWidget.get()); *it; ++it) {
-            QTreeWidgetItem* candidate = *it;
-            const QString candidatePath = candidate->data(0, Qt::UserRole).toString();
-            if (!candidatePath.isEmpty() && QFileInfo(candidatePath).absoluteFilePath() == QFileInfo(baseDir).absoluteFilePath()) {
-                parentItem = candidate;
-                break;
-            }
-        }
-        if (parentItem) {
-            QFileInfo newInfo(folderPath);
-            QTreeWidgetItem* newItem = addFileItem(parentItem, newInfo);
-            if (m_lazyLoading) {
-                newItem->addChild(new QTreeWidgetItem()); // placeholder for expansion
-            }
-            parentItem->setExpanded(true);
-        }
-    }
-
-    // Refresh the tree to reflect the new folder
-    populateTree();
+    // Add just the new row and reveal it, without reloading the tree
+    m_model->addPath(folderPath);
+    expandPath(folderPath, true);
     emit directoryChanged(baseDir);
     updateButtonStates();
 }
@@ -1318,15 +1033,15 @@ void FileBrowser::onCreateNote()
         return;
     }
 
-    // Ensure .txt extension (keep simple behavior consistent with previous code)
-    if (!noteName.endsWith(".txt", Qt::CaseInsensitive)) {
+    // Default to .txt unless the name already picks a note format (e.g. ".md")
+    if (!QuteNote::hasNoteExtension(noteName)) {
         noteName += ".txt";
     }
 
     // Determine target directory: selected folder, selected file's parent, or root/current
     QString baseDir = !m_currentDirectory.isEmpty() ? m_currentDirectory : m_rootDirectory;
-    if (m_treeWidget && m_treeWidget->currentItem()) {
-        const QString selPath = m_treeWidget->currentItem()->data(0, Qt::UserRole).toString();
+    if (m_treeView && m_treeView->currentIndex().isValid()) {
+        const QString selPath = m_treeView->currentIndex().data(LazyDocumentModel::PathRole).toString();
         if (!selPath.isEmpty()) {
             QFileInfo selInfo(selPath);
             baseDir = selInfo.isDir() ? selInfo.absoluteFilePath() : selInfo.absolutePath();
@@ -1351,12 +1066,13 @@ void FileBrowser::onCreateNote()
     }
     file.close();
 
-    upsertNameInOrdering(baseDir, QFileInfo(notePath).fileName());
+    m_ordering.insert(baseDir, QFileInfo(notePath).fileName());
 
     updateStatusBar(tr("Note created: %1").arg(QFileInfo(notePath).fileName()));
 
-    // Repopulate to ensure the new file is shown
-    populateTree();
+    // Add just the new row and reveal it
+    m_model->addPath(notePath);
+    expandPath(notePath, true);
     emit fileCreated(notePath);
     emit directoryChanged(baseDir);
     updateButtonStates();
@@ -1388,9 +1104,10 @@ void FileBrowser::onCreateDivider()
         QFile file(dividerPath);
         if (file.open(QIODevice::WriteOnly)) {
             file.close();
-            upsertNameInOrdering(baseDir, QFileInfo(dividerPath).fileName());
-            // Repopulate to show divider
-            populateTree();
+            m_ordering.insert(baseDir, QFileInfo(dividerPath).fileName());
+            // Add just the new row and reveal it
+            m_model->addPath(dividerPath);
+            expandPath(dividerPath, true);
             updateStatusBar(tr("Divider created: %1").arg(dividerName));
         } else {
             QMessageBox::warning(this, "Error", "Could not create divider.");
@@ -1404,12 +1121,13 @@ void FileBrowser::onCreateDivider()
 
 void FileBrowser::onRename()
 {
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
-    QTreeWidgetItem *currentItem = m_treeWidget->currentItem();
-    if (!currentItem) return;
+    const QModelIndex currentIndex = m_treeView->currentIndex();
+    if (!currentIndex.isValid()) return;
 
-    QString oldPath = currentItem->data(0, Qt::UserRole).toString();
+    QString oldPath = currentIndex.data(LazyDocumentModel::PathRole).toString();
+    const QString itemName = currentIndex.data(Qt::DisplayRole).toString();
     if (oldPath.isEmpty()) return; // Cannot rename virtual items like "Recent"
 
     QFileInfo info(oldPath);
@@ -1435,16 +1153,15 @@ void FileBrowser::onRename()
     }
 
     if (success) {
-        currentItem->setText(0, newName);
-        currentItem->setData(0, Qt::UserRole, newPath);
-        renameEntryInOrdering(info.absolutePath(), info.fileName(), QFileInfo(newPath).fileName());
-        // Repopulate to ensure consistency and resorting
-        populateTree();
+        m_ordering.rename(info.absolutePath(), info.fileName(), QFileInfo(newPath).fileName());
+        // The row keeps its place; the ordering entry was renamed in place
+        m_model->renamePath(oldPath, newPath);
+        emit fileRenamed(info.absoluteFilePath(), QFileInfo(newPath).absoluteFilePath());
         updateStatusBar(tr("Renamed to: %1").arg(newName));
     } else {
         QMessageBox::warning(this, "Rename Failed", 
             QString("Could not rename %1").arg(info.isDir() ? "folder" : "file"));
-        updateStatusBar(tr("Rename failed: %1").arg(currentItem->text(0)));
+        updateStatusBar(tr("Rename failed: %1").arg(itemName));
     }
 }
 
@@ -1458,9 +1175,9 @@ void FileBrowser::onItemOrderChanged(const QString &sourcePath, const QString &o
         return;
     }
 
-    // Enqueue the move and start/reset the buffer timer. The timer will
-    // call processMoveBuffer() which does the actual filesystem operations
-    // and refreshes the view once all queued moves are applied.
+    // Only enqueue the file move; the timer calls processMoveBuffer() which
+    // does the actual filesystem operations, and the rows follow in
+    // finishMoves() once they succeeded.
     FileMove fm;
     fm.sourcePath = sourcePath;
     fm.oldParentPath = oldParentPath.isEmpty() ? m_rootDirectory : oldParentPath;
@@ -1468,11 +1185,6 @@ void FileBrowser::onItemOrderChanged(const QString &sourcePath, const QString &o
     fm.newIndex = newIndex;
     m_moveBuffer.append(fm);
 
-    recordOrderingFromTree(fm.newParentPath);
-    if (QDir::cleanPath(fm.oldParentPath) != QDir::cleanPath(fm.newParentPath)) {
-        recordOrderingFromTree(fm.oldParentPath);
-    }
-
     if (m_moveBufferTimer) {
         m_moveBufferTimer->start(); // restart coalescing timer
     }
@@ -1483,69 +1195,220 @@ void FileBrowser::onItemOrderChanged(const QString &sourcePath, const QString &o
 
 void FileBrowser::processMoveBuffer()
 {
-    if (m_moveBuffer.isEmpty()) return;
+    // One transaction at a time; the buffer is picked up again when the
+    // running one finishes
+    if (m_moveBuffer.isEmpty() || m_moveWatcher) return;
 
     // Copy and clear buffer so new moves can be queued while processing
-    const QList<FileMove> toProcess = m_moveBuffer;
+    QList<FileMove> toProcess = m_moveBuffer;
     m_moveBuffer.clear();
 
-    for (const FileMove &fm : toProcess) {
-        const QString src = fm.sourcePath;
-        if (src.isEmpty()) continue;
-
-        QFileInfo sfi(src);
-        const QString fileName = sfi.fileName();
-        const QString dstParent = fm.newParentPath.isEmpty() ? m_rootDirectory : fm.newParentPath;
-        QDir dstDir(dstParent);
-        const QString dstPath = dstDir.filePath(fileName);
-
-        const QString normalizedSrc = QDir::cleanPath(src);
-        const QString normalizedDst = QDir::cleanPath(dstPath);
-
-        // Pure reordering within the same directory: skip the physical move but
-        // ensure metadata stays up to date.
-        if (normalizedSrc == normalizedDst) {
+    // Plan the whole batch up front. Items that can never be moved are
+    // dropped here, their rows untouched; the rest move together.
+    MoveTransaction transaction;
+    QList<FileMove> planned;
+    QList<int> stepMoves; // Pure reorderings have no step
+    QSet<QString> staleDirectories;
+    for (FileMove &fm : toProcess) {
+        if (fm.sourcePath.isEmpty()) continue;
+
+        // Follows folders moved by earlier items of the batch
+        const QString src = transaction.currentPath(fm.sourcePath);
+        const QString fileName = QFileInfo(src).fileName();
+        fm.oldParentPath = QFileInfo(src).absolutePath();
+        fm.destinationPath = QDir::cleanPath(QDir(fm.newParentPath).filePath(fileName));
+
+        // Pure reordering within the same directory: only the ordering changes
+        if (src == fm.destinationPath) {
+            fm.sourcePath = src;
+            planned << fm;
             continue;
         }
 
-        if (QFileInfo::exists(dstPath)) {
-            updateStatusBar(tr("Move failed, target exists: %1").arg(fileName), 5000);
-            qWarning() << "Move failed, target exists:" << dstPath;
+        QString error;
+        if (!transaction.addStep(fm.sourcePath, fm.destinationPath, &error)) {
+            updateStatusBar(tr("Cannot move %1: %2").arg(fileName, error), 5000);
+            qWarning() << "Cannot move" << src << "->" << fm.destinationPath << ":" << error;
             continue;
         }
+        fm.sourcePath = src;
+        stepMoves << int(planned.size());
+        planned << fm;
+    }
 
-        bool ok = false;
-        if (sfi.isDir()) {
-            QDir dir;
-            ok = dir.rename(src, dstPath);
-        } else {
-            ok = QFile::rename(src, dstPath);
+    if (planned.isEmpty()) {
+        finishMoves(planned, stepMoves, staleDirectories, MoveTransaction::Result());
+        return;
+    }
+
+    const QList<MoveTransaction::Step> steps = transaction.steps();
+    if (!steps.isEmpty()) {
+        updateStatusBar(tr("Moving %n item(s)...", nullptr, int(steps.size())), 0);
+    }
+
+    m_moveWatcher = new QFutureWatcher<MoveTransaction::Result>(this);
+    connect(m_moveWatcher, &QFutureWatcher<MoveTransaction::Result>::finished, this,
+            [this, planned, stepMoves, staleDirectories]() {
+        QFutureWatcher<MoveTransaction::Result> *watcher = m_moveWatcher;
+        m_moveWatcher = nullptr;
+        watcher->deleteLater();
+        finishMoves(planned, stepMoves, staleDirectories, watcher->result());
+    });
+    m_moveWatcher->setFuture(QtConcurrent::run([steps]() {
+        return MoveTransaction::run(steps);
+    }));
+}
+
+void FileBrowser::finishMoves(const QList<FileMove> &moves, const QList<int> &stepMoves,
+                              QSet<QString> staleDirectories, const MoveTransaction::Result &result)
+{
+    if (!moves.isEmpty() && result.committed) {
+        // The files are in place, so the rows follow: the whole batch in one
+        // repaint, and written to the ordering index in one go
+        if (m_treeView) {
+            m_treeView->setUpdatesEnabled(false);
         }
+        m_ordering.beginBatch();
+        for (const FileMove &fm : moves) {
+            const QModelIndex moved = m_model->movePath(fm.sourcePath, fm.newParentPath, fm.newIndex);
+            const bool rowMoved = moved.isValid()
+                && QDir::cleanPath(QFileInfo(moved.data(LazyDocumentModel::PathRole).toString()).absolutePath())
+                       == QDir::cleanPath(fm.newParentPath);
+
+            // The ordering index places the item in front of the row that
+            // now follows it
+            QString beforeName;
+            const QModelIndex next = rowMoved ? moved.sibling(moved.row() + 1, 0) : QModelIndex();
+            if (next.isValid()) {
+                beforeName = QFileInfo(next.data(LazyDocumentModel::PathRole).toString()).fileName();
+            }
+            const QString fileName = QFileInfo(fm.destinationPath).fileName();
+            m_ordering.move(fm.oldParentPath, fileName, fm.newParentPath, beforeName);
 
-        if (ok) {
-            qWarning() << "Moved" << src << "->" << dstPath;
-            emit fileRenamed(src, dstPath);
-        } else {
-            updateStatusBar(tr("Failed to move %1").arg(fileName), 5000);
-            qWarning() << "Failed to move" << src << "->" << dstPath;
+            if (QDir::cleanPath(fm.sourcePath) != fm.destinationPath) {
+                emit fileRenamed(fm.sourcePath, fm.destinationPath);
+            }
+            // Rows the model could not move (a name clash, or a folder that
+            // is not listed yet) are re-read
+            if (!rowMoved) {
+                staleDirectories << fm.oldParentPath << fm.newParentPath;
+            }
+        }
+        m_ordering.commitBatch();
+        if (m_treeView) {
+            m_treeView->setUpdatesEnabled(true);
+        }
+        updateStatusBar(tr("Finished moving items."), 3000);
+    } else if (!moves.isEmpty()) {
+        // Everything was moved back and the rows never moved
+        const FileMove failed = moves.value(stepMoves.value(result.failedStep, 0));
+        updateStatusBar(tr("Move failed, nothing was moved: %1").arg(result.error), 5000);
+        qWarning() << "Move transaction failed:" << result.error << "at" << failed.sourcePath;
+        for (const QString &path : result.notRolledBack) {
+            qWarning() << "Could not move back" << path;
+        }
+        // Unless some could not be moved back
+        if (!result.notRolledBack.isEmpty()) {
+            for (const FileMove &fm : moves) {
+                staleDirectories << fm.oldParentPath << fm.newParentPath;
+            }
         }
     }
 
-    // Refresh tree once after applying all changes
-    populateTree();
-    updateStatusBar(tr("Finished moving items."), 3000);
+    // Only folders that do not match the disk any more are re-read, each once
+    for (const QString &directory : std::as_const(staleDirectories)) {
+        m_model->refreshDirectory(directory);
+    }
+
+    if (!m_deferredChanges.isEmpty()) {
+        const QList<NotesWatcher::DirectoryChange> changes = m_deferredChanges;
+        m_deferredChanges.clear();
+        applyExternalChanges(changes);
+    }
+
+    if (!m_moveBuffer.isEmpty() && m_moveBufferTimer) {
+        m_moveBufferTimer->start();
+    }
+}
+
+void FileBrowser::applyExternalChanges(const QList<NotesWatcher::DirectoryChange> &changes)
+{
+    // The renames of a running batch show up here too; they are looked at
+    // once the ordering index has recorded the batch
+    if (m_moveWatcher) {
+        m_deferredChanges += changes;
+        return;
+    }
+
+    // Changes the application made itself come back as well. Each step
+    // below is a no-op when the rows and the ordering already match.
+    const QString root = QDir::cleanPath(m_rootDirectory);
+    for (const NotesWatcher::DirectoryChange &change : changes) {
+        const QString directory = QDir::cleanPath(change.directory);
+
+        // Rewritten in place, or replaced by a rename as atomic saves do. An
+        // open note may be in a folder that is not listed, so this comes
+        // before the rows are looked at.
+        const QDir changedDir(directory);
+        for (const QString &name : change.modified) {
+            emit fileModified(changedDir.filePath(name));
+        }
+        for (const auto &renamed : change.renamed) {
+            emit fileModified(changedDir.filePath(renamed.second));
+        }
+
+        const QModelIndex parent = m_model->indexForPath(directory);
+        if (directory != root && !parent.isValid()) {
+            // Not in the tree yet; its listing will be current when it is
+            continue;
+        }
+        if (change.rescan || !m_model->isLoaded(parent)) {
+            m_model->refreshDirectory(directory);
+            continue;
+        }
+
+        const QDir dir(directory);
+        for (const auto &renamed : change.renamed) {
+            const QString oldPath = dir.filePath(renamed.first);
+            const QString newPath = dir.filePath(renamed.second);
+            if (m_model->indexForPath(newPath).isValid()) {
+                // Replaced an existing entry, as atomic saves do
+                m_ordering.remove(directory, renamed.first);
+                m_model->removePath(oldPath);
+                continue;
+            }
+            m_ordering.rename(directory, renamed.first, renamed.second);
+            if (m_model->renamePath(oldPath, newPath).isValid()) {
+                emit fileRenamed(oldPath, newPath);
+            } else {
+                m_model->addPath(newPath);
+            }
+        }
+        for (const QString &name : change.removed) {
+            m_ordering.remove(directory, name);
+            if (m_model->removePath(dir.filePath(name))) {
+                emit fileDeleted(dir.filePath(name));
+            }
+        }
+        for (const QString &name : change.added) {
+            if (!m_ordering.contains(directory, name)) {
+                m_ordering.insert(directory, name);
+            }
+            m_model->addPath(dir.filePath(name));
+        }
+    }
 }
 
 void FileBrowser::forceUiRefreshAfterDialog()
 {
     // Aggressively refresh the file browser viewport and the window to clear stale paints
-    if (m_treeWidget) {
-        if (auto *vp = m_treeWidget->viewport()) {
+    if (m_treeView) {
+        if (auto *vp = m_treeView->viewport()) {
             vp->update();
             vp->repaint();
         }
-        m_treeWidget->update();
-        m_treeWidget->repaint();
+        m_treeView->update();
+        m_treeView->repaint();
     }
     if (QWidget *w = window()) {
         w->update();
@@ -1577,15 +1440,18 @@ void FileBrowser::onRemoveItem()
         }
     };
     
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
-    QTreeWidgetItem *currentItem = m_treeWidget->currentItem();
-    if (!currentItem) {
+    const QModelIndex currentIndex = m_treeView->currentIndex();
+    if (!currentIndex.isValid()) {
         return;
     }
 
-    QString path = currentItem->data(0, Qt::UserRole).toString();
-    QString itemName = currentItem->text(0); // Store item name before potential deletion
+    QString path = currentIndex.data(LazyDocumentModel::PathRole).toString();
+    if (path.isEmpty()) {
+        return; // Virtual items like "Recent Files" cannot be removed
+    }
+    QString itemName = currentIndex.data(Qt::DisplayRole).toString(); // Store item name before potential deletion
     QFileInfo info(path);
 
     QString itemType;
@@ -1619,21 +1485,14 @@ void FileBrowser::onRemoveItem()
     }
 
     if (success) {
-        removeNameFromOrdering(info.absolutePath(), info.fileName());
-        // Explicitly remove the item from the tree widget
-        if (currentItem->parent()) {
-            currentItem->parent()->removeChild(currentItem);
-        } else {
-            m_treeWidget->takeTopLevelItem(m_treeWidget->indexOfTopLevelItem(currentItem));
-        }
-        delete currentItem; // Delete the item after removing it from the tree
-
-        // Repopulate to reflect removal
-        populateTree();
+        m_ordering.remove(info.absolutePath(), info.fileName());
+        emit fileDeleted(info.absoluteFilePath());
+        // Remove just the row (and the rows under it)
+        m_model->removePath(path);
         updateStatusBar(tr("Removed %1: %2").arg(itemType, itemName));
     } else {
         QMessageBox::warning(this, "Error", "Could not remove item.");
-        updateStatusBar(tr("Remove failed: %1").arg(currentItem->text(0)));
+        updateStatusBar(tr("Remove failed: %1").arg(itemName));
     }
     
     // Update button states after removing item
@@ -1643,9 +1502,9 @@ void FileBrowser::onRemoveItem()
 void FileBrowser::updateButtonStates()
 {
     // Update button states
-    if (!m_treeWidget) return;
+    if (!m_treeView) return;
     
-    bool hasSelection = !m_treeWidget->selectedItems().isEmpty();
+    bool hasSelection = m_treeView->selectionModel()->hasSelection();
     
     // Enable/disable remove button based on selection
     if (m_removeBtn) {
@@ -1669,28 +1528,13 @@ void FileBrowser::updateButtonStates()
     }
 }
 
-void FileBrowser::loadDirectory(QTreeWidgetItem *parentItem, const QString &path)
-{
-    if (!parentItem) return;
-    
-    const QList<QFileInfo> entries = orderedEntriesForDirectory(path);
-    for (const QFileInfo &entry : entries) {
-        QTreeWidgetItem *item = addFileItem(parentItem, entry);
-        if (entry.isDir() && m_lazyLoading) {
-            item->addChild(new QTreeWidgetItem());
-        }
-    }
-    m_currentDirectory = path;
-    emit directoryChanged(path);
-}
-
 QString FileBrowser::selectedFile() const
 {
-    if (!m_treeWidget) return QString();
+    if (!m_treeView) return QString();
     
-    QTreeWidgetItem *currentItem = m_treeWidget->currentItem();
-    if (currentItem) {
-        QString path = currentItem->data(0, Qt::UserRole).toString();
+    const QModelIndex currentIndex = m_treeView->currentIndex();
+    if (currentIndex.isValid()) {
+        QString path = currentIndex.data(LazyDocumentModel::PathRole).toString();
         QFileInfo info(path);
         if (!info.isDir()) {
             return path;
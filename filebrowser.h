@@ -11,8 +11,13 @@
 #include <QScroller>
 #include <QPushButton>
 #include <QTimer>
+#include <QFutureWatcher>
 #include <QShowEvent>
-#include "filebrowsertreewidget.h"
+#include "filebrowsertreeview.h"
+#include "lazydocumentmodel.h"
+#include "orderingindex.h"
+#include "movetransaction.h"
+#include "noteswatcher.h"
 #include "filebrowsertouchhandler.h"
 #include "uiutils.h"
 #include "componentbase.h"
@@ -54,9 +59,11 @@ public:
     QString currentDirectory() const { return m_currentDirectory; }
     QString selectedFile() const;
     void populateTree();
+    // Re-reads one folder and updates only its rows, e.g. after a save
+    void refreshDirectory(const QString &path);
     
     // Touch-related methods
-    FileBrowserTreeWidget* treeWidget() const { return m_treeWidget.get(); }
+    FileBrowserTreeView* treeView() const { return m_treeView.get(); }
     void navigateBack();
     void navigateForward();
     void setJellyStrength(qreal strength) { if (m_touchHandler) m_touchHandler->touchInteraction()->setJellyStrength(strength); }
@@ -75,6 +82,11 @@ public:
     
     // Performance
     void setLazyLoadingEnabled(bool enabled);
+
+    // Search: show only the given notes and the folders leading to them
+    void showSearchResults(const QStringList &paths);
+    void clearSearchResults();
+    bool isShowingSearchResults() const { return m_searchActive; }
     
     // Signals
     Q_SIGNALS:
@@ -83,6 +95,13 @@ public:
     void fileCreated(const QString &path);
     void fileDeleted(const QString &path);
     void fileRenamed(const QString &oldPath, const QString &newPath);
+    // Contents changed on disk, possibly by the application's own saves
+    void fileModified(const QString &path);
+    // Everything the notes watcher saw change under the root
+    void notesChangedOnDisk(const QList<NotesWatcher::DirectoryChange> &changes);
+    // Before and after a note is replaced by one of its backed-up versions
+    void fileAboutToBeRestored(const QString &path);
+    void fileRestored(const QString &path);
     void overscrollAmountChanged(qreal amount);
     void scrollLimitReached(qreal position);
 
@@ -94,8 +113,8 @@ public:
     void removeSelectedItem();
 
 private slots:
-    void onItemClicked(QTreeWidgetItem *item, int column);
-    void onItemDoubleClicked(QTreeWidgetItem *item, int column);
+    void onItemClicked(const QModelIndex &index);
+    void onItemDoubleClicked(const QModelIndex &index);
     void onItemSelectionChanged();
     void onContextMenuRequested(const QPoint &pos);
     void onCreateFolder();
@@ -103,6 +122,7 @@ private slots:
     void onCreateDivider();
     void onRemoveItem();
     void onRename();
+    void onShowVersions();
     void onItemOrderChanged(const QString &sourcePath, const QString &oldParentPath, const QString &newParentPath, int newIndex);
     void processMoveBuffer();
 
@@ -111,21 +131,18 @@ private:
     void updateRecentFiles(const QString &filePath);
     void loadRecentFiles();
     void saveRecentFiles();
-    QTreeWidgetItem* createRecentFilesSection();
-    void rebuildRecentFilesSection(QTreeWidgetItem *rootItem);
+    void rebuildRecentFilesSection();
     
     // Animations
-    void animateItemExpansion(QTreeWidgetItem *item);
-    void animateItemCollapse(QTreeWidgetItem *item);
+    void animateItemExpansion(const QModelIndex &index);
+    void animateItemCollapse(const QModelIndex &index);
     QPropertyAnimation* createFadeAnimation(QWidget *target, qreal startValue, qreal endValue);
-    void setupItemAnimation(QTreeWidgetItem *item);
     void setupOverscrollAnimation();
     
     // Touch feedback
     void setupTouchFeedback();
     bool eventFilter(QObject *watched, QEvent *event) override;
     void showEvent(QShowEvent *event) override;
-    void highlightItem(QTreeWidgetItem *item, bool highlight);
     
     // UI Setup
     void setupUI();
@@ -138,32 +155,17 @@ private:
     void updateStatusBar(const QString &message, int timeoutMs = 10000);
     
     // File operations
-    void addDirectoryToTree(QTreeWidgetItem *parentItem, const QDir &directory);
-    void loadDirectory(QTreeWidgetItem *parentItem, const QString &path);
-    QTreeWidgetItem* addFileItem(QTreeWidgetItem *parentItem, const QFileInfo &fileInfo);
-    QTreeWidgetItem* findOrCreateParentItem(const QString &path);
+    QModelIndexList expandedIndexes() const;
     void captureExpandedPaths();
     void restoreExpandedPaths();
     bool expandPath(const QString &absPath, bool selectEnd = false);
     void updateButtonStates();
     QString displayNameForEntry(const QFileInfo &info) const;
-    QString stripOrderingPrefix(const QString &text) const;
-    QFileInfoList listDirectoryEntries(const QString &directoryPath);
-    QList<QFileInfo> orderedEntriesForDirectory(const QString &directoryPath);
+    QFileInfoList orderEntries(const QString &directoryPath, const QFileInfoList &entries);
     QFileInfo maybeMigratePrefixedEntry(const QFileInfo &info);
-    QString orderingMetadataPath(const QString &directoryPath) const;
-    QStringList loadOrderingMetadata(const QString &directoryPath) const;
-    void saveOrderingMetadata(const QString &directoryPath, const QStringList &orderedNames) const;
-    QStringList ensureOrderingMetadata(const QString &directoryPath, const QFileInfoList &entries);
-    void recordOrderingFromTree(const QString &directoryPath);
-    void upsertNameInOrdering(const QString &directoryPath, const QString &name, int index = -1);
-    void removeNameFromOrdering(const QString &directoryPath, const QString &name);
-    void renameEntryInOrdering(const QString &directoryPath, const QString &oldName, const QString &newName);
-    QTreeWidgetItem* findTreeItemForPath(const QString &path) const;
     
     // Sorting
     void sortItems();
-    static bool compareItems(QTreeWidgetItem *a, QTreeWidgetItem *b);
     
     // Component functionality
     void initializeComponent() override;
@@ -176,15 +178,26 @@ private:
     QSet<QString> m_loadedPaths;
     QuteNote::OwnedPtr<QTimer> m_refreshTimer;
     
-    // Buffered file move operations to avoid partial/missing references while
-    // the view is updated. Moves are accumulated and flushed by a timer.
+    // Buffered file move operations. Moves are accumulated and flushed by a
+    // timer; the rows only move once the files have.
     struct FileMove {
         QString sourcePath;
         QString oldParentPath;
         QString newParentPath;
         int newIndex = -1;
+        QString destinationPath;
     };
     QList<FileMove> m_moveBuffer;
+    // Renames of a planned batch run on a worker, all or nothing
+    QFutureWatcher<MoveTransaction::Result> *m_moveWatcher = nullptr;
+    // stepMoves holds, for every transaction step, the index of its move
+    void finishMoves(const QList<FileMove> &moves, const QList<int> &stepMoves,
+                     QSet<QString> staleDirectories, const MoveTransaction::Result &result);
+
+    // Changes made to the notes outside the application
+    void applyExternalChanges(const QList<NotesWatcher::DirectoryChange> &changes);
+    NotesWatcher *m_notesWatcher = nullptr; // Owned by this widget
+    QList<NotesWatcher::DirectoryChange> m_deferredChanges; // Held while moves run
     QuteNote::OwnedPtr<QTimer> m_moveBufferTimer;
     
     // Touch interaction
@@ -200,10 +213,11 @@ private:
     QString m_currentDirectory;
     QuteNote::OwnedPtr<QAction> m_removeAction;
     QuteNote::OwnedPtr<QAction> m_renameAction;
+    QuteNote::OwnedPtr<QAction> m_versionsAction;
     QSet<RecentFile> m_recentFiles;
-    QuteNote::OwnedPtr<QTreeWidgetItem> m_recentFilesRoot;
     static const int MAX_RECENT_FILES = 10;
-    QuteNote::OwnedPtr<FileBrowserTreeWidget> m_treeWidget;
+    QuteNote::OwnedPtr<FileBrowserTreeView> m_treeView;
+    LazyDocumentModel *m_model = nullptr; // Owned by this widget
     QuteNote::OwnedPtr<QVBoxLayout> m_layout;
     
     // Bottom button bar (fixed at the bottom under the tree)
@@ -221,7 +235,17 @@ private:
 
     // Remember which directories are expanded by absolute path
     QSet<QString> m_expandedDirs;
-    mutable QHash<QString, QStringList> m_cachedOrdering;
+
+    // Search results currently shown, and the expansion state to go back to
+    void applySearchFilter();
+    void hideNonMatchingRows(const QModelIndex &parent, int first, int last);
+    bool m_searchActive = false;
+    QStringList m_searchPaths;
+    QSet<QString> m_searchHits;
+    QSet<QString> m_searchAncestors;
+    QList<QPersistentModelIndex> m_hiddenRows;
+    QSet<QString> m_expandedBeforeSearch;
+    OrderingIndex m_ordering;
 };
 
 #endif // FILEBROWSER_H
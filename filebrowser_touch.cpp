@@ -1,5 +1,4 @@
 #include "filebrowser.h"
-#include "thememanager.h"
 #include <QSettings>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -34,12 +33,12 @@ void FileBrowser::setupOverscrollAnimation()
 
 void FileBrowser::setOverscrollAmount(qreal amount)
 {
-    QScrollBar *vScrollBar = m_treeWidget->verticalScrollBar();
+    QScrollBar *vScrollBar = m_treeView->verticalScrollBar();
     if (!vScrollBar)
         return;
     
     // Apply overscroll with visual feedback
-    const int maxOverscroll = m_treeWidget->height() / 3;
+    const int maxOverscroll = m_treeView->height() / 3;
     const qreal clampedAmount = qBound(-maxOverscroll, static_cast<int>(amount), maxOverscroll);
     
     // Apply a scale transform for the "squish" effect
@@ -49,7 +48,7 @@ void FileBrowser::setOverscrollAmount(qreal amount)
         scale = 1.0 - (factor * 0.1); // Squish by up to 10%
     }
     
-    // Apply transforms - need option for qtreewidget, doesnt support settransform
+    // Apply transforms - need option for qtreeview, doesnt support settransform
     
     // Adjust content position
     vScrollBar->setValue(vScrollBar->value() + clampedAmount);
@@ -60,7 +59,7 @@ void FileBrowser::setOverscrollAmount(qreal amount)
 bool FileBrowser::eventFilter(QObject *watched, QEvent *event)
 {
     // Repaint viewport to clear drag artifacts when leaving/ending outside
-    if (m_treeWidget && watched == m_treeWidget->viewport()) {
+    if (m_treeView && watched == m_treeView->viewport()) {
         switch (event->type()) {
         case QEvent::DragLeave:
         case QEvent::Drop:
@@ -69,21 +68,21 @@ bool FileBrowser::eventFilter(QObject *watched, QEvent *event)
         case QEvent::TouchEnd:
         case QEvent::TouchCancel:
             // Force immediate viewport update to clear any drag artifacts
-            m_treeWidget->viewport()->update();
+            m_treeView->viewport()->update();
             // Also schedule a delayed update to catch any lingering artifacts
             QTimer::singleShot(0, this, [this]() {
-                if (m_treeWidget && m_treeWidget->viewport()) {
-                    m_treeWidget->viewport()->update();
+                if (m_treeView && m_treeView->viewport()) {
+                    m_treeView->viewport()->update();
                 }
             });
             // Additional cleanup for drop events
             if (event->type() == QEvent::Drop) {
                 QTimer::singleShot(50, this, [this]() {
-                    if (m_treeWidget) {
-                        m_treeWidget->viewport()->update();
+                    if (m_treeView) {
+                        m_treeView->viewport()->update();
                         // Clear any lingering selection artifacts
-                        m_treeWidget->clearFocus();
-                        m_treeWidget->setFocus();
+                        m_treeView->clearFocus();
+                        m_treeView->setFocus();
                     }
                 });
             }
@@ -92,16 +91,17 @@ bool FileBrowser::eventFilter(QObject *watched, QEvent *event)
             // If the user taps/clicks outside any item, select the parent directory
             // of the current selection. For top-level, clear selection to target root.
             if (auto *me = static_cast<QMouseEvent*>(event)) {
-                QTreeWidgetItem *hit = m_treeWidget->itemAt(me->pos());
-                if (!hit) {
-                    QTreeWidgetItem *current = m_treeWidget->currentItem();
-                    if (current) {
-                        if (QTreeWidgetItem *parent = current->parent()) {
-                            m_treeWidget->setCurrentItem(parent);
+                const QModelIndex hit = m_treeView->indexAt(me->pos());
+                if (!hit.isValid()) {
+                    const QModelIndex current = m_treeView->currentIndex();
+                    if (current.isValid()) {
+                        const QModelIndex parent = current.parent();
+                        if (parent.isValid()) {
+                            m_treeView->setCurrentIndex(parent);
                         } else {
                             // No parent (top-level) -> clear selection and target root/current dir
-                            m_treeWidget->clearSelection();
-                            m_treeWidget->setCurrentItem(nullptr);
+                            m_treeView->clearSelection();
+                            m_treeView->setCurrentIndex(QModelIndex());
                             if (!m_rootDirectory.isEmpty()) {
                                 m_currentDirectory = m_rootDirectory;
                                 emit directoryChanged(m_currentDirectory);
@@ -124,13 +124,6 @@ bool FileBrowser::eventFilter(QObject *watched, QEvent *event)
     return QWidget::eventFilter(watched, event);
 }
 
-void FileBrowser::highlightItem(QTreeWidgetItem *item, bool highlight)
-{
-    QColor highlightColor = ThemeManager::instance()->currentTheme().colors.accent;
-    highlightColor.setAlpha(highlight ? 128 : 0);
-    item->setBackground(0, highlightColor);
-}
-
 QPropertyAnimation* FileBrowser::createFadeAnimation(QWidget *target, qreal startValue, qreal endValue)
 {
     QGraphicsOpacityEffect *effect = new QGraphicsOpacityEffect(target);
@@ -145,13 +138,13 @@ QPropertyAnimation* FileBrowser::createFadeAnimation(QWidget *target, qreal star
     return animation;
 }
 
-void FileBrowser::animateItemExpansion(QTreeWidgetItem *item)
+void FileBrowser::animateItemExpansion(const QModelIndex &index)
 {
     // Create a widget to animate
-    QWidget *itemWidget = m_treeWidget->itemWidget(item, 0);
+    QWidget *itemWidget = m_treeView->indexWidget(index);
     if (!itemWidget) {
-        itemWidget = new QWidget(m_treeWidget.get());
-        m_treeWidget->setItemWidget(item, 0, itemWidget);
+        itemWidget = new QWidget(m_treeView.get());
+        m_treeView->setIndexWidget(index, itemWidget);
     }
     
     // Create fade in animation
@@ -159,22 +152,18 @@ void FileBrowser::animateItemExpansion(QTreeWidgetItem *item)
     fadeIn->start(QAbstractAnimation::DeleteWhenStopped);
 }
 
-void FileBrowser::animateItemCollapse(QTreeWidgetItem *item)
+void FileBrowser::animateItemCollapse(const QModelIndex &index)
 {
-    QWidget *itemWidget = m_treeWidget->itemWidget(item, 0);
+    QWidget *itemWidget = m_treeView->indexWidget(index);
     if (itemWidget) {
         QPropertyAnimation *fadeOut = createFadeAnimation(itemWidget, 1.0, 0.0);
         fadeOut->start(QAbstractAnimation::DeleteWhenStopped);
     }
 }
 
-void FileBrowser::rebuildRecentFilesSection(QTreeWidgetItem *rootItem)
+void FileBrowser::rebuildRecentFilesSection()
 {
-    if (!rootItem) {
-        return;
-    }
-
-    rootItem->takeChildren();
+    QList<RecentFile> files;
     QList<RecentFile> staleEntries;
 
     for (const RecentFile &file : m_recentFiles) {
@@ -184,26 +173,24 @@ void FileBrowser::rebuildRecentFilesSection(QTreeWidgetItem *rootItem)
             staleEntries.append(file);
             continue;
         }
-
-        QTreeWidgetItem *item = new QTreeWidgetItem();
-        item->setText(0, displayNameForEntry(info));
-        item->setData(0, Qt::UserRole, absolutePath);
-        item->setToolTip(0, absolutePath);
-        item->setIcon(0, QIcon::fromTheme("text-x-generic"));
-        rootItem->addChild(item);
+        files.append(RecentFile{absolutePath, file.lastAccessed});
     }
 
     for (const RecentFile &stale : staleEntries) {
         m_recentFiles.remove(stale);
     }
-}
 
-QTreeWidgetItem* FileBrowser::createRecentFilesSection()
-{
-    QTreeWidgetItem *recentFiles = new QTreeWidgetItem(QStringList() << "Recent Files");
-    recentFiles->setIcon(0, QIcon::fromTheme("document-open-recent"));
-    rebuildRecentFilesSection(recentFiles);
-    return recentFiles;
+    // Most recently opened first
+    std::sort(files.begin(), files.end());
+    QStringList paths;
+    paths.reserve(files.size());
+    for (const RecentFile &file : std::as_const(files)) {
+        paths << file.path;
+    }
+
+    if (m_model) {
+        m_model->setRecentFiles(paths);
+    }
 }
 
 void FileBrowser::updateRecentFiles(const QString &filePath)
@@ -218,7 +205,7 @@ void FileBrowser::updateRecentFiles(const QString &filePath)
 
     if (!info.exists()) {
         m_recentFiles.remove(RecentFile{absolutePath, QDateTime()});
-        rebuildRecentFilesSection(m_recentFilesRoot.get());
+        rebuildRecentFilesSection();
         saveRecentFiles();
         return;
     }
@@ -235,7 +222,7 @@ void FileBrowser::updateRecentFiles(const QString &filePath)
         m_recentFiles.remove(*it);
     }
 
-    rebuildRecentFilesSection(m_recentFilesRoot.get());
+    rebuildRecentFilesSection();
     saveRecentFiles();
 }
 
@@ -266,7 +253,7 @@ void FileBrowser::loadRecentFiles()
         m_recentFiles.insert(RecentFile{absolutePath, lastAccessed});
     }
 
-    rebuildRecentFilesSection(m_recentFilesRoot.get());
+    rebuildRecentFilesSection();
     saveRecentFiles();
 }
 
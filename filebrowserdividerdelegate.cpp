@@ -44,15 +44,12 @@ void FileBrowserDividerDelegate::paint(QPainter *painter, const QStyleOptionView
 }
 
 QSize FileBrowserDividerDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
-    QString path = index.data(Qt::UserRole).toString();
-    if (path.endsWith(".divider", Qt::CaseInsensitive)) {
-        QFont font = option.font;
-        font.setBold(true);
-        QFontMetrics fm(font);
-        int h = fm.height() + 18;
-        return QSize(option.rect.width(), h);
-    } else {
-        // For non-divider items (files and folders), return a fixed height
-        return QSize(option.rect.width(), 38); // Match button height
-    }
+    Q_UNUSED(index);
+    // Every row gets the same height (at least the button height, enough for
+    // a divider's title box) so the view can use uniform row heights
+    QFont font = option.font;
+    font.setBold(true);
+    QFontMetrics fm(font);
+    const int h = qMax(38, fm.height() + 18);
+    return QSize(option.rect.width(), h);
 }
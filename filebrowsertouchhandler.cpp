@@ -2,7 +2,7 @@
 #include "filebrowser.h"
 #include "touchinteraction.h"
 #include <QApplication>
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QScrollBar>
 #include <QtMath>
 #include <QElapsedTimer>
@@ -16,11 +16,10 @@ FileBrowserTouchHandler::FileBrowserTouchHandler(FileBrowser* fileBrowser)
     , m_fileBrowser(fileBrowser)
     , m_scroller(nullptr)
     , m_touchInteraction(new TouchInteraction(this))
-    , m_lastTouchedItem(nullptr)
 {
     if (!m_fileBrowser) return;
     
-    enableGestureHandling(m_fileBrowser->treeWidget());
+    enableGestureHandling(m_fileBrowser->treeView());
     setupScrolling();
     
     // Configure touch interaction physics
@@ -34,9 +33,9 @@ FileBrowserTouchHandler::FileBrowserTouchHandler(FileBrowser* fileBrowser)
     m_longPressTimer = new QTimer(this);
     m_longPressTimer->setSingleShot(true);
     connect(m_longPressTimer, &QTimer::timeout, this, [this]() {
-        if (!m_fileBrowser || !m_fileBrowser->treeWidget()) return;
-        QTreeWidget* tw = m_fileBrowser->treeWidget();
-        if (!m_lastTouchedItem) return;
+        if (!m_fileBrowser || !m_fileBrowser->treeView()) return;
+        FileBrowserTreeView* tw = m_fileBrowser->treeView();
+        if (!m_lastTouchedIndex.isValid()) return;
 
         // Ensure touch hasn't moved too far and is still within the tree widget bounds
         QPoint globalPos = tw->mapToGlobal(m_lastTouchPos);
@@ -52,26 +51,26 @@ FileBrowserTouchHandler::FileBrowserTouchHandler(FileBrowser* fileBrowser)
         m_longPressTriggered = true;
         m_isItemDrag = true;
 
-        // Initiate the QTreeWidget's internal drag operation
-        tw->setCurrentItem(m_lastTouchedItem); // Ensure the item is selected for drag
-        m_fileBrowser->treeWidget()->initiateDrag(Qt::MoveAction, m_touchStartPos);
+        // Initiate the tree view's internal drag operation
+        tw->setCurrentIndex(m_lastTouchedIndex); // Ensure the item is selected for drag
+        tw->initiateDrag(Qt::MoveAction, m_touchStartPos);
     });
 }
 
 FileBrowserTouchHandler::~FileBrowserTouchHandler()
 {
-    if (m_fileBrowser && m_fileBrowser->treeWidget()) {
-        disableGestureHandling(m_fileBrowser->treeWidget());
-        QScroller::ungrabGesture(m_fileBrowser->treeWidget()->viewport());
+    if (m_fileBrowser && m_fileBrowser->treeView()) {
+        disableGestureHandling(m_fileBrowser->treeView());
+        QScroller::ungrabGesture(m_fileBrowser->treeView()->viewport());
     }
 }
 
 void FileBrowserTouchHandler::setupScrolling()
 {
-    auto treeWidget = m_fileBrowser->treeWidget();
-    if (!treeWidget || !treeWidget->viewport()) return;
+    auto treeView = m_fileBrowser->treeView();
+    if (!treeView || !treeView->viewport()) return;
 
-    m_scroller = QScroller::scroller(treeWidget->viewport());
+    m_scroller = QScroller::scroller(treeView->viewport());
     QScrollerProperties props = m_scroller->scrollerProperties();
     
     props.setScrollMetric(QScrollerProperties::VerticalOvershootPolicy, 
@@ -80,18 +79,18 @@ void FileBrowserTouchHandler::setupScrolling()
     props.setScrollMetric(QScrollerProperties::OvershootDragDistanceFactor, 0.3);
     
     m_scroller->setScrollerProperties(props);
-    QScroller::grabGesture(treeWidget->viewport(), QScroller::TouchGesture);
+    QScroller::grabGesture(treeView->viewport(), QScroller::TouchGesture);
     
     updateScrollLimits();
 }
 
 void FileBrowserTouchHandler::updateScrollLimits()
 {
-    auto treeWidget = m_fileBrowser->treeWidget();
-    if (!treeWidget || !treeWidget->viewport()) return;
+    auto treeView = m_fileBrowser->treeView();
+    if (!treeView || !treeView->viewport()) return;
 
-    const int viewportHeight = treeWidget->viewport()->height();
-    const int contentHeight = treeWidget->sizeHint().height();
+    const int viewportHeight = treeView->viewport()->height();
+    const int contentHeight = treeView->sizeHint().height();
     
     const int min = 0;
     const int max = qMax(0, contentHeight - viewportHeight);
@@ -99,21 +98,21 @@ void FileBrowserTouchHandler::updateScrollLimits()
     m_touchInteraction->setScrollLimits(min, max);
 }
 
-QTreeWidgetItem* FileBrowserTouchHandler::itemAtPoint(const QPoint& point) const
+QModelIndex FileBrowserTouchHandler::indexAtPoint(const QPoint& point) const
 {
-    auto treeWidget = m_fileBrowser->treeWidget();
-    if (!treeWidget) return nullptr;
+    auto treeView = m_fileBrowser->treeView();
+    if (!treeView) return QModelIndex();
     
-    return treeWidget->itemAt(point);
+    return treeView->indexAt(point);
 }
 
-void FileBrowserTouchHandler::handleItemTap(QTreeWidgetItem* item)
+void FileBrowserTouchHandler::handleItemTap(const QModelIndex& index)
 {
-    if (!item) return;
+    if (!index.isValid()) return;
     
-    emit itemTapped(item);
-    if (item->childCount() > 0) {
-        emit itemExpansionRequested(item);
+    emit itemTapped(index);
+    if (index.model()->hasChildren(index)) {
+        emit itemExpansionRequested(index);
     }
 }
 
@@ -163,10 +162,10 @@ bool FileBrowserTouchHandler::handleTouchBegin(QTouchEvent* event)
     if (handled && !event->points().isEmpty()) {
         m_touchStartPos = event->points().first().position().toPoint();
         m_lastTouchPos = m_touchStartPos;
-        m_lastTouchedItem = itemAtPoint(m_touchStartPos);
+        m_lastTouchedIndex = indexAtPoint(m_touchStartPos);
         m_isItemDrag = false;
         m_longPressTriggered = false;
-        if (m_lastTouchedItem) {
+        if (m_lastTouchedIndex.isValid()) {
             m_longPressTimer->start(LONG_PRESS_TIMEOUT);
         }
     }
@@ -176,7 +175,7 @@ bool FileBrowserTouchHandler::handleTouchBegin(QTouchEvent* event)
 bool FileBrowserTouchHandler::handleTouchUpdate(QTouchEvent* event)
 {
     bool handled = TouchInteractionHandler::handleTouchUpdate(event);
-    if (handled && !event->points().isEmpty() && m_lastTouchedItem) {
+    if (handled && !event->points().isEmpty() && m_lastTouchedIndex.isValid()) {
         QPoint currentPos = event->points().first().position().toPoint();
         m_lastTouchPos = currentPos;
         int distance = (currentPos - m_touchStartPos).manhattanLength();
@@ -188,20 +187,20 @@ bool FileBrowserTouchHandler::handleTouchUpdate(QTouchEvent* event)
 
         // If finger goes outside the tree widget while waiting, cancel long-press
         if (!m_longPressTriggered) {
-            if (auto *tw = m_fileBrowser->treeWidget()) {
+            if (auto *tw = m_fileBrowser->treeView()) {
                 QPoint posInTree = tw->mapFromGlobal(event->points().first().globalPosition().toPoint());
                 if (!tw->rect().contains(posInTree)) {
                     if (m_longPressTimer->isActive()) m_longPressTimer->stop();
                     // Also clear the target item to avoid accidental start
-                    m_lastTouchedItem = nullptr;
+                    m_lastTouchedIndex = QPersistentModelIndex();
                 }
             }
         }
         
         // Get the current scroll position to calculate overscroll
-        auto treeWidget = m_fileBrowser->treeWidget();
-        if (treeWidget) {
-            QScrollBar *vScrollBar = treeWidget->verticalScrollBar();
+        auto treeView = m_fileBrowser->treeView();
+        if (treeView) {
+            QScrollBar *vScrollBar = treeView->verticalScrollBar();
             if (vScrollBar) {
                 int currentValue = vScrollBar->value();
                 int minValue = vScrollBar->minimum();
@@ -228,15 +227,15 @@ bool FileBrowserTouchHandler::handleTouchEnd(QTouchEvent* event)
         m_longPressTimer->stop();
     }
     
-    if (handled && m_lastTouchedItem && !m_longPressTriggered) {
+    if (handled && m_lastTouchedIndex.isValid() && !m_longPressTriggered) {
         static QElapsedTimer tapTimer;
         if (tapTimer.elapsed() < TAP_TIMEOUT) {
-            handleItemTap(m_lastTouchedItem);
+            handleItemTap(m_lastTouchedIndex);
         }
         tapTimer.start();
     }
     
-    m_lastTouchedItem = nullptr;
+    m_lastTouchedIndex = QPersistentModelIndex();
     m_isItemDrag = false;
     m_longPressTriggered = false;
     
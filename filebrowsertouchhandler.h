@@ -3,7 +3,7 @@
 
 #include "touchinteractionhandler.h"
 #include <QScroller>
-#include <QTreeWidgetItem>
+#include <QPersistentModelIndex>
 #include <QPinchGesture>
 #include <QSwipeGesture>
 #include <QPanGesture>
@@ -24,9 +24,9 @@ public:
     TouchInteraction* touchInteraction() const { return m_touchInteraction; }
 
 Q_SIGNALS:
-    void itemExpansionRequested(QTreeWidgetItem* item);
+    void itemExpansionRequested(const QModelIndex& index);
     void overscrollAmountChanged(qreal amount);
-    void itemTapped(QTreeWidgetItem* item);
+    void itemTapped(const QModelIndex& index);
     void enableGestureHandling(QWidget* widget);
     void disableGestureHandling(QWidget* widget);
 
@@ -41,14 +41,14 @@ protected:
 private:
     void setupScrolling();
     void updateScrollLimits();
-    QTreeWidgetItem* itemAtPoint(const QPoint& point) const;
-    void handleItemTap(QTreeWidgetItem* item);
+    QModelIndex indexAtPoint(const QPoint& point) const;
+    void handleItemTap(const QModelIndex& index);
 
     FileBrowser* m_fileBrowser;
     QScroller* m_scroller;
     TouchInteraction* m_touchInteraction;
     QPoint m_touchStartPos;
-    QTreeWidgetItem* m_lastTouchedItem;
+    QPersistentModelIndex m_lastTouchedIndex;
     bool m_isItemDrag{false};
     QTimer* m_longPressTimer{nullptr};
     QPoint m_lastTouchPos;
@@ -0,0 +1,204 @@
+#include "filebrowsertreeview.h"
+#include "lazydocumentmodel.h"
+#include <QFileInfo>
+#include <QMimeData>
+#include <QUrl>
+#include <QPixmap>
+#include <QPainter>
+#include <QDrag>
+#include <memory>
+
+FileBrowserTreeView::FileBrowserTreeView(QWidget *parent)
+    : QTreeView(parent)
+{
+    setDragDropMode(QAbstractItemView::InternalMove);
+    setDragEnabled(true);
+    setDefaultDropAction(Qt::MoveAction);
+    setDropIndicatorShown(true);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // Every row (dividers included) has the delegate's fixed height, which
+    // lets the view lay out and scroll very large folders without asking
+    // for each row's size
+    setUniformRowHeights(true);
+}
+
+void FileBrowserTreeView::dropEvent(QDropEvent *event)
+{
+    if (!event || !model()) {
+        return;
+    }
+
+    QStringList sourcePaths = extractPathsFromMime(event->mimeData());
+    if (sourcePaths.isEmpty()) {
+        sourcePaths = currentSelectionPaths();
+    }
+
+    if (sourcePaths.isEmpty()) {
+        event->ignore();
+        return;
+    }
+
+    QStringList oldParentPaths;
+    oldParentPaths.reserve(sourcePaths.size());
+    for (const QString &path : sourcePaths) {
+        oldParentPaths << QFileInfo(path).absolutePath();
+    }
+
+    // Virtual rows (Recent Files) have no path and cannot take children
+    auto isFolder = [this](const QModelIndex &index) {
+        return index.isValid() && index.data(LazyDocumentModel::FolderRole).toBool()
+            && !pathForIndex(index).isEmpty();
+    };
+
+    const QPoint dropPos = event->position().toPoint();
+    const QModelIndex targetIndex = indexAt(dropPos);
+    QModelIndex resolvedParent;
+    int insertIndex = -1;
+
+    auto indicator = dropIndicatorPosition();
+    if (targetIndex.isValid() && indicator != QAbstractItemView::OnItem && isFolder(targetIndex)) {
+        const QRect targetRect = visualRect(targetIndex);
+        if (targetRect.contains(dropPos) && targetRect.height() > 0) {
+            const int relativeY = dropPos.y() - targetRect.top();
+            const double ratio = static_cast<double>(relativeY) / targetRect.height();
+            if (ratio >= 0.25 && ratio <= 0.75) {
+                indicator = QAbstractItemView::OnItem;
+            }
+        }
+    }
+
+    switch (indicator) {
+    case QAbstractItemView::OnItem:
+        resolvedParent = targetIndex;
+        insertIndex = model()->rowCount(resolvedParent);
+        break;
+    case QAbstractItemView::AboveItem:
+    case QAbstractItemView::BelowItem:
+        if (targetIndex.isValid()) {
+            resolvedParent = targetIndex.parent();
+            insertIndex = targetIndex.row();
+            if (indicator == QAbstractItemView::BelowItem) {
+                ++insertIndex;
+            }
+        } else {
+            insertIndex = model()->rowCount();
+        }
+        break;
+    case QAbstractItemView::OnViewport:
+    default:
+        insertIndex = model()->rowCount();
+        break;
+    }
+
+    if (indicator == QAbstractItemView::OnItem && resolvedParent.isValid() && !isFolder(resolvedParent)) {
+        insertIndex = resolvedParent.row() + 1;
+        resolvedParent = resolvedParent.parent();
+    }
+
+    QString parentPath = resolvedParent.isValid() ? pathForIndex(resolvedParent) : m_rootDirectory;
+    if (parentPath.isEmpty()) {
+        // Dropped among virtual rows: append to the root folder
+        parentPath = m_rootDirectory;
+        insertIndex = -1;
+    }
+
+    // The rows are moved by FileBrowser through the model, not by the view
+    event->setDropAction(Qt::MoveAction);
+    event->accept();
+    stopAutoScroll();
+    setState(QAbstractItemView::NoState);
+    viewport()->update();
+
+    for (int i = 0; i < sourcePaths.size(); ++i) {
+        emit itemOrderChanged(sourcePaths.at(i),
+                              oldParentPaths.value(i),
+                              parentPath,
+                              insertIndex < 0 ? -1 : insertIndex + i);
+    }
+}
+
+QString FileBrowserTreeView::pathForIndex(const QModelIndex &index) const
+{
+    return index.data(LazyDocumentModel::PathRole).toString();
+}
+
+void FileBrowserTreeView::startDrag(Qt::DropActions supportedActions)
+{
+    if (!model() || !selectionModel()) return;
+
+    const QModelIndexList indexes = selectionModel()->selectedRows();
+    if (indexes.isEmpty()) return;
+
+    std::unique_ptr<QMimeData> md(model()->mimeData(indexes));
+    if (!md) return;
+
+    QDrag *drag = new QDrag(this);
+    drag->setMimeData(md.release());
+
+    // Create a simple drag pixmap using the first selected item's text
+    QPixmap pix(200, 24);
+    pix.fill(Qt::transparent);
+    QPainter p(&pix);
+    p.setPen(palette().color(QPalette::Text));
+    p.drawText(4, 16, indexes.first().data(Qt::DisplayRole).toString());
+    p.end();
+    drag->setPixmap(pix);
+
+    // Execute the drag; allow moving by default. The model is not asked to
+    // remove the source rows afterwards, FileBrowser moves them.
+    drag->exec(supportedActions ? supportedActions : Qt::MoveAction);
+}
+
+QStringList FileBrowserTreeView::extractPathsFromMime(const QMimeData *data) const
+{
+    QStringList sourcePaths;
+    if (!data) {
+        return sourcePaths;
+    }
+
+    if (data->hasFormat("application/x-qutenote-paths")) {
+        const QByteArray ba = data->data("application/x-qutenote-paths");
+        sourcePaths = QString::fromUtf8(ba).split('\n', Qt::SkipEmptyParts);
+    } else if (!data->urls().isEmpty()) {
+        for (const QUrl &u : data->urls()) {
+            if (u.isLocalFile()) {
+                sourcePaths << u.toLocalFile();
+            }
+        }
+    }
+
+    return sourcePaths;
+}
+
+QStringList FileBrowserTreeView::currentSelectionPaths() const
+{
+    QStringList paths;
+    if (!selectionModel()) {
+        return paths;
+    }
+    const QModelIndexList indexes = selectionModel()->selectedRows();
+    for (const QModelIndex &index : indexes) {
+        if (!(index.flags() & Qt::ItemIsDragEnabled)) {
+            continue;
+        }
+        const QString path = pathForIndex(index);
+        if (!path.isEmpty()) {
+            paths << path;
+        }
+    }
+    return paths;
+}
+
+void FileBrowserTreeView::initiateDrag(Qt::DropActions supportedActions, const QPoint &startPos)
+{
+    // Store the start position (unused by current implementation but useful
+    // for future enhancements where the visual drag start may differ)
+    m_dragStartPos = startPos;
+
+    // Ensure the widget has focus so selection is respected
+    setFocus(Qt::MouseFocusReason);
+
+    // Start the drag immediately
+    startDrag(supportedActions);
+}
@@ -1,20 +1,21 @@
-#ifndef FILEBROWSERTREEWIDGET_H
-#define FILEBROWSERTREEWIDGET_H
+#ifndef FILEBROWSERTREEVIEW_H
+#define FILEBROWSERTREEVIEW_H
 
-#include <QTreeWidget>
+#include <QTreeView>
 #include <QDropEvent>
-#include <QDragEnterEvent>
-#include <QDragMoveEvent>
 #include <QMimeData>
 #include <QDrag>
 
-class FileBrowserTreeWidget : public QTreeWidget
+// Tree view of the FileBrowser's LazyDocumentModel. Drops do not go through
+// the model: the view resolves where the items should land and reports each
+// one through itemOrderChanged(), and FileBrowser moves the file and the row.
+class FileBrowserTreeView : public QTreeView
 {
     Q_OBJECT
 
 public:
-    explicit FileBrowserTreeWidget(QWidget *parent = nullptr);
-    ~FileBrowserTreeWidget() override = default;
+    explicit FileBrowserTreeView(QWidget *parent = nullptr);
+    ~FileBrowserTreeView() override = default;
 
     // Set the root directory for proper drop handling on empty space
     void setRootDirectory(const QString &rootDir) { m_rootDirectory = rootDir; }
@@ -27,25 +28,20 @@ public:
     void initiateDrag(Qt::DropActions supportedActions, const QPoint &startPos);
 
 signals:
-    // Emitted after an internal move. We pass string paths instead of pointers so
-    // callers can safely act on the filesystem without relying on item pointer validity.
+    // Emitted for every dropped item. We pass string paths instead of indexes so
+    // callers can safely act on the filesystem while rows are being moved.
     void itemOrderChanged(const QString &sourcePath, const QString &oldParentPath, const QString &newParentPath, int newIndex);
 
 protected:
     void dropEvent(QDropEvent *event) override;
-    void dragEnterEvent(QDragEnterEvent *event) override;
-    void dragMoveEvent(QDragMoveEvent *event) override;
-    
-    // Override to prevent Qt's default drag-drop behavior
-    QMimeData* mimeData(const QList<QTreeWidgetItem*> &items) const override;
 
 private:
-    QString getItemPath(QTreeWidgetItem *item) const;
+    QString pathForIndex(const QModelIndex &index) const;
     QStringList extractPathsFromMime(const QMimeData *data) const;
     QStringList currentSelectionPaths() const;
-    
+
     QString m_rootDirectory;
     QPoint m_dragStartPos; // Store the initial drag position
 };
 
-#endif // FILEBROWSERTREEWIDGET_H
+#endif // FILEBROWSERTREEVIEW_H
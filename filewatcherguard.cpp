@@ -14,7 +14,7 @@ FileWatcherGuard::~FileWatcherGuard()
 {
     // QScopedPointer will handle m_watcher cleanup
     if (!m_watchedPaths.isEmpty()) {
-        m_watcher->removePaths(m_watchedPaths);
+        m_watcher->removePaths(m_watchedPaths.values());
     }
 }
 
@@ -46,7 +46,7 @@ bool FileWatcherGuard::addPath(const QString &path)
     }
 
     if (m_watcher->addPath(path)) {
-        m_watchedPaths.append(path);
+        m_watchedPaths.insert(path);
         return true;
     }
 
@@ -67,11 +67,11 @@ bool FileWatcherGuard::addPaths(const QStringList &paths)
 
 bool FileWatcherGuard::removePath(const QString &path)
 {
-    if (m_watcher->removePath(path)) {
-        m_watchedPaths.removeOne(path);
-        return true;
-    }
-    return false;
+    // QFileSystemWatcher drops paths that were deleted on its own; forget
+    // them here too so they can be watched again once they are back
+    const bool removed = m_watcher->removePath(path);
+    m_watchedPaths.remove(path);
+    return removed;
 }
 
 bool FileWatcherGuard::removePaths(const QStringList &paths)
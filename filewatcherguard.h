@@ -4,6 +4,7 @@
 #include <QFileSystemWatcher>
 #include <QScopedPointer>
 #include <QObject>
+#include <QSet>
 #include <QStringList>
 
 class FileWatcherGuard : public QObject
@@ -60,7 +61,7 @@ private:
     void handleFileError(const QString &path);
 
     QScopedPointer<QFileSystemWatcher> m_watcher;
-    QStringList m_watchedPaths;
+    QSet<QString> m_watchedPaths;
 };
 
 #endif // FILEWATCHERGUARD_H
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "framescheduler.h"
+#include <QEvent>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+
+// Static member definitions
+const int FrameScheduler::FALLBACK_INTERVAL;
+const int FrameScheduler::WATCHDOG_INTERVAL;
+
+FrameScheduler::FrameScheduler()
+    : m_lastFrameNs(-1)
+    , m_nextSerial(0)
+    , m_frameRequested(false)
+{
+    m_fallbackTimer.setSingleShot(true);
+    connect(&m_fallbackTimer, &QTimer::timeout, this, &FrameScheduler::runFrame);
+    m_clock.start();
+}
+
+void FrameScheduler::schedule(QObject *client, StepFunction step)
+{
+    if (!client || !step) {
+        return;
+    }
+
+    const int index = indexOf(client);
+    if (index >= 0) {
+        m_clients[index].step = std::move(step);
+        m_clients[index].serial = ++m_nextSerial;
+    } else {
+        m_clients.append({client, std::move(step), ++m_nextSerial});
+        connect(client, &QObject::destroyed, this, [this, client]() { unschedule(client); });
+        if (m_clients.size() == 1) {
+            // Waking up: the first frame gets one nominal interval, not
+            // however long the scheduler slept
+            m_lastFrameNs = -1;
+        }
+    }
+    requestFrame();
+}
+
+void FrameScheduler::unschedule(QObject *client)
+{
+    const int index = indexOf(client);
+    if (index < 0) {
+        return;
+    }
+    disconnect(client, &QObject::destroyed, this, nullptr);
+    m_clients.remove(index);
+
+    if (m_clients.isEmpty()) {
+        // Asleep: no frame requests, no timer. A request already made to
+        // the window arrives once more and does nothing.
+        m_fallbackTimer.stop();
+    }
+}
+
+bool FrameScheduler::isScheduled(const QObject *client) const
+{
+    return indexOf(client) >= 0;
+}
+
+int FrameScheduler::indexOf(const QObject *client) const
+{
+    for (int i = 0; i < m_clients.size(); ++i) {
+        if (m_clients.at(i).object == client) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QWindow *FrameScheduler::findFrameWindow() const
+{
+    if (m_window && m_window->isExposed()) {
+        return m_window;
+    }
+    QWindow *focus = QGuiApplication::focusWindow();
+    if (focus && focus->isExposed()) {
+        return focus;
+    }
+    const QList<QWindow *> windows = QGuiApplication::topLevelWindows();
+    for (QWindow *window : windows) {
+        if (window->isExposed()) {
+            return window;
+        }
+    }
+    return nullptr;
+}
+
+qreal FrameScheduler::nominalFrameInterval() const
+{
+    const QScreen *screen = m_window ? m_window->screen() : QGuiApplication::primaryScreen();
+    const qreal rate = screen ? screen->refreshRate() : 0.0;
+    return rate > 1.0 ? 1.0 / rate : FALLBACK_INTERVAL / 1000.0;
+}
+
+void FrameScheduler::requestFrame()
+{
+    if (m_frameRequested || m_clients.isEmpty()) {
+        return;
+    }
+    m_frameRequested = true;
+
+    QWindow *window = findFrameWindow();
+    if (window != m_window) {
+        if (m_window) {
+            m_window->removeEventFilter(this);
+        }
+        m_window = window;
+        if (m_window) {
+            m_window->installEventFilter(this);
+        }
+    }
+
+    if (m_window) {
+        m_window->requestUpdate();
+        // Hiding the window can swallow the request; don't stall on it
+        m_fallbackTimer.start(WATCHDOG_INTERVAL);
+    } else {
+        m_fallbackTimer.start(FALLBACK_INTERVAL);
+    }
+}
+
+bool FrameScheduler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::UpdateRequest && watched == m_window && m_frameRequested) {
+        // Step first, so whatever the clients invalidate is painted by
+        // this same update request
+        runFrame();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void FrameScheduler::runFrame()
+{
+    m_frameRequested = false;
+    m_fallbackTimer.stop();
+    if (m_clients.isEmpty()) {
+        return;
+    }
+
+    const qint64 now = m_clock.nsecsElapsed();
+    const qreal seconds = m_lastFrameNs < 0
+        ? nominalFrameInterval()
+        : qBound(0.0, (now - m_lastFrameNs) / 1e9, MAX_FRAME_SECONDS);
+    m_lastFrameNs = now;
+
+    // Clients may schedule or unschedule others (or themselves) while
+    // stepping, so walk a snapshot and look each one up again
+    const QVector<Client> clients = m_clients;
+    for (const Client &client : clients) {
+        int index = indexOf(client.object);
+        if (index < 0 || m_clients.at(index).serial != client.serial) {
+            continue;
+        }
+        if (!client.step(seconds)) {
+            index = indexOf(client.object);
+            if (index >= 0 && m_clients.at(index).serial == client.serial) {
+                unschedule(client.object);
+            }
+        }
+    }
+
+    emit frameFinished(seconds);
+    requestFrame();
+}
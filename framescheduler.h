@@ -0,0 +1,78 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include "smartpointers.h"
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class QWindow;
+
+// One animation clock for the whole application.
+//
+// Physics animations register a step function instead of running their own
+// QTimer. While any are registered the scheduler asks a visible window for
+// a frame with QWindow::requestUpdate(), which the platform paces to the
+// display refresh, and steps every client in one pass when the window's
+// UpdateRequest arrives, before the window paints. Once the last client
+// settles nothing is requested and the scheduler stays asleep. Without a
+// window on screen a single shared timer stands in for the display.
+class FrameScheduler : public QObject, public QuteNote::Singleton<FrameScheduler>
+{
+    Q_OBJECT
+    friend class QuteNote::Singleton<FrameScheduler>;
+
+public:
+    // Advances an animation by the seconds since the previous frame;
+    // returning false means it has settled and unregisters it
+    using StepFunction = std::function<bool(qreal seconds)>;
+
+    // Registers or replaces client's step function. Clients are dropped
+    // automatically when they are destroyed.
+    void schedule(QObject *client, StepFunction step);
+    void unschedule(QObject *client);
+    bool isScheduled(const QObject *client) const;
+
+    bool isRunning() const { return !m_clients.isEmpty(); }
+    int clientCount() const { return m_clients.size(); }
+
+Q_SIGNALS:
+    // After every client has been stepped for a frame
+    void frameFinished(qreal seconds);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    FrameScheduler();
+    ~FrameScheduler() override = default;
+
+    struct Client {
+        QObject *object;
+        StepFunction step;
+        quint64 serial; // Tells a re-scheduled client from the one stepped
+    };
+
+    void requestFrame();
+    void runFrame();
+    QWindow *findFrameWindow() const;
+    qreal nominalFrameInterval() const;
+    int indexOf(const QObject *client) const;
+
+    QVector<Client> m_clients;
+    QPointer<QWindow> m_window;
+    QTimer m_fallbackTimer;
+    QElapsedTimer m_clock;
+    qint64 m_lastFrameNs;
+    quint64 m_nextSerial;
+    bool m_frameRequested;
+
+    static const int FALLBACK_INTERVAL = 16;   // ms, with no window on screen
+    static const int WATCHDOG_INTERVAL = 100;  // ms before a lost frame request is replaced
+    static constexpr qreal MAX_FRAME_SECONDS = 1.0 / 10.0;
+};
+
+#endif // FRAMESCHEDULER_H
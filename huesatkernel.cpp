@@ -0,0 +1,314 @@
+#include "huesatkernel.h"
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QDebug>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HUESAT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HUESAT_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it;
+// MSVC accepts the intrinsics anywhere
+#if defined(HUESAT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HUESAT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HUESAT_TARGET_AVX2
+#endif
+
+namespace {
+
+// QColor keeps 16-bit channels: round to 0-65535, then divide by 257
+// the way qt_div_257() does to get the 8-bit value
+inline quint32 channel8(float value)
+{
+    const int wide = int(value * 65535.0f + 0.5f);
+    return quint32((wide - (wide >> 8) + 0x80) >> 8);
+}
+
+void fillScalar(quint32 *row, const float *red, const float *green, const float *blue,
+                int begin, int end, float s)
+{
+    for (int x = begin; x < end; ++x) {
+        const quint32 r = channel8(1.0f - s * red[x]);
+        const quint32 g = channel8(1.0f - s * green[x]);
+        const quint32 b = channel8(1.0f - s * blue[x]);
+        row[x] = 0xff000000u | (r << 16) | (g << 8) | b;
+    }
+}
+
+#ifdef HUESAT_X86
+inline __m128i channelSse2(__m128 s, const float *weights)
+{
+    const __m128 value = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(s, _mm_loadu_ps(weights)));
+    const __m128i wide = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(65535.0f)),
+                                                     _mm_set1_ps(0.5f)));
+    return _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(wide, _mm_srli_epi32(wide, 8)),
+                                        _mm_set1_epi32(0x80)), 8);
+}
+
+int fillSse2(quint32 *row, const float *red, const float *green, const float *blue, int width, float saturation)
+{
+    const __m128 s = _mm_set1_ps(saturation);
+    const __m128i alpha = _mm_set1_epi32(int(0xff000000u));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i r = channelSse2(s, red + x);
+        const __m128i g = channelSse2(s, green + x);
+        const __m128i b = channelSse2(s, blue + x);
+        const __m128i pixels = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(r, 16)),
+                                            _mm_or_si128(_mm_slli_epi32(g, 8), b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), pixels);
+    }
+    return x;
+}
+
+HUESAT_TARGET_AVX2 inline __m256i channelAvx2(__m256 s, const float *weights)
+{
+    const __m256 value = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(s, _mm256_loadu_ps(weights)));
+    const __m256i wide = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(65535.0f)),
+                                                           _mm256_set1_ps(0.5f)));
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_sub_epi32(wide, _mm256_srli_epi32(wide, 8)),
+                                              _mm256_set1_epi32(0x80)), 8);
+}
+
+HUESAT_TARGET_AVX2 int fillAvx2(quint32 *row, const float *red, const float *green, const float *blue,
+                                int width, float saturation)
+{
+    const __m256 s = _mm256_set1_ps(saturation);
+    const __m256i alpha = _mm256_set1_epi32(int(0xff000000u));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i r = channelAvx2(s, red + x);
+        const __m256i g = channelAvx2(s, green + x);
+        const __m256i b = channelAvx2(s, blue + x);
+        const __m256i pixels = _mm256_or_si256(_mm256_or_si256(alpha, _mm256_slli_epi32(r, 16)),
+                                               _mm256_or_si256(_mm256_slli_epi32(g, 8), b));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + x), pixels);
+    }
+    return x;
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    // The OS must save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // HUESAT_X86
+
+#ifdef HUESAT_NEON
+inline uint32x4_t channelNeon(float32x4_t s, const float *weights)
+{
+    const float32x4_t value = vsubq_f32(vdupq_n_f32(1.0f), vmulq_f32(s, vld1q_f32(weights)));
+    const uint32x4_t wide = vcvtq_u32_f32(vaddq_f32(vmulq_f32(value, vdupq_n_f32(65535.0f)),
+                                                    vdupq_n_f32(0.5f)));
+    return vshrq_n_u32(vaddq_u32(vsubq_u32(wide, vshrq_n_u32(wide, 8)), vdupq_n_u32(0x80)), 8);
+}
+
+int fillNeon(quint32 *row, const float *red, const float *green, const float *blue, int width, float saturation)
+{
+    const float32x4_t s = vdupq_n_f32(saturation);
+    const uint32x4_t alpha = vdupq_n_u32(0xff000000u);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const uint32x4_t r = channelNeon(s, red + x);
+        const uint32x4_t g = channelNeon(s, green + x);
+        const uint32x4_t b = channelNeon(s, blue + x);
+        const uint32x4_t pixels = vorrq_u32(vorrq_u32(alpha, vshlq_n_u32(r, 16)),
+                                            vorrq_u32(vshlq_n_u32(g, 8), b));
+        vst1q_u32(row + x, pixels);
+    }
+    return x;
+}
+#endif // HUESAT_NEON
+
+struct Band {
+    int first;
+    int last; // exclusive
+};
+
+} // namespace
+
+namespace HueSatKernel {
+
+Isa bestIsa()
+{
+#ifdef HUESAT_X86
+    static const Isa best = cpuHasAvx2() ? Isa::Avx2 : Isa::Sse2;
+    return best;
+#elif defined(HUESAT_NEON)
+    return Isa::Neon;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+QVector<Isa> availableIsas()
+{
+    QVector<Isa> result{Isa::Scalar};
+#ifdef HUESAT_X86
+    result.append(Isa::Sse2);
+    if (bestIsa() == Isa::Avx2) {
+        result.append(Isa::Avx2);
+    }
+#endif
+#ifdef HUESAT_NEON
+    result.append(Isa::Neon);
+#endif
+    return result;
+}
+
+const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Sse2:
+        return "sse2";
+    case Isa::Avx2:
+        return "avx2";
+    case Isa::Neon:
+        return "neon";
+    case Isa::Scalar:
+        break;
+    }
+    return "scalar";
+}
+
+int hueForColumn(int x, int width)
+{
+    const qreal hue = qBound(0.0, static_cast<qreal>(x) / qMax(1, width - 1), 1.0);
+    return qBound(0, static_cast<int>(hue * 359.0 + 0.5), 359);
+}
+
+int saturationForRow(int y, int height)
+{
+    const qreal sat = qBound(0.0, 1.0 - static_cast<qreal>(y) / qMax(1, height - 1), 1.0);
+    return qBound(0, static_cast<int>(sat * 255.0 + 0.5), 255);
+}
+
+Columns columns(int width)
+{
+    Columns result;
+    result.red.resize(width);
+    result.green.resize(width);
+    result.blue.resize(width);
+
+    for (int x = 0; x < width; ++x) {
+        // As QColor: hue in hundredths of a degree, split into sextant and fraction
+        const float h = float(hueForColumn(x, width) * 100) / 6000.0f;
+        const int sextant = int(h);
+        const float f = h - float(sextant);
+        const float rising = 1.0f - f;
+        // Weights of s in each channel: 0 is the value itself, 1 is v(1-s)
+        float r = 0, g = 0, b = 0;
+        switch (sextant) {
+        case 0: r = 0; g = rising; b = 1; break;
+        case 1: r = f; g = 0; b = 1; break;
+        case 2: r = 1; g = 0; b = rising; break;
+        case 3: r = 1; g = f; b = 0; break;
+        case 4: r = rising; g = 1; b = 0; break;
+        default: r = 0; g = 1; b = f; break;
+        }
+        result.red[x] = r;
+        result.green[x] = g;
+        result.blue[x] = b;
+    }
+    return result;
+}
+
+void fillRow(quint32 *row, const Columns &columns, int width, int saturation, Isa isa)
+{
+    // QColor stores saturation as s * 257 over 65535
+    const float s = float(saturation * 257) / 65535.0f;
+    const float *red = columns.red.constData();
+    const float *green = columns.green.constData();
+    const float *blue = columns.blue.constData();
+
+    int done = 0;
+    switch (isa) {
+#ifdef HUESAT_X86
+    case Isa::Avx2:
+        done = fillAvx2(row, red, green, blue, width, s);
+        break;
+    case Isa::Sse2:
+        done = fillSse2(row, red, green, blue, width, s);
+        break;
+#endif
+#ifdef HUESAT_NEON
+    case Isa::Neon:
+        done = fillNeon(row, red, green, blue, width, s);
+        break;
+#endif
+    default:
+        break;
+    }
+    fillScalar(row, red, green, blue, done, width, s);
+}
+
+QImage generate(const QSize &size, Isa isa, bool parallel)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) {
+        qWarning() << "HueSatKernel: could not allocate a gradient of" << size;
+        return image;
+    }
+
+    const int width = size.width();
+    const int height = size.height();
+    const Columns weights = columns(width);
+    // Taken once up front: scanLine() detaches, which is not for worker threads
+    uchar *const bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+
+    auto fillBand = [&](const Band &band) {
+        for (int y = band.first; y < band.last; ++y) {
+            quint32 *row = reinterpret_cast<quint32 *>(bits + y * bytesPerLine);
+            fillRow(row, weights, width, saturationForRow(y, height), isa);
+        }
+    };
+
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    if (!parallel || threads < 2 || qint64(width) * height < MIN_PARALLEL_PIXELS) {
+        fillBand({0, height});
+        return image;
+    }
+
+    // A few bands per thread evens out uneven scheduling
+    const int bandCount = qMin(height, threads * 4);
+    const int rowsPerBand = (height + bandCount - 1) / bandCount;
+    QVector<Band> bands;
+    for (int first = 0; first < height; first += rowsPerBand) {
+        bands.append({first, qMin(height, first + rowsPerBand)});
+    }
+    QtConcurrent::blockingMap(bands, fillBand);
+    return image;
+}
+
+QImage generate(const QSize &size)
+{
+    return generate(size, bestIsa(), true);
+}
+
+} // namespace HueSatKernel
@@ -0,0 +1,56 @@
+#ifndef HUESATKERNEL_H
+#define HUESATKERNEL_H
+
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+// Fills hue/saturation gradients (hue 0-359 left to right, saturation 255
+// at the top to 0 at the bottom, full value) as HueSatMap shows them.
+//
+// Within an image the hue only changes per column and the saturation per
+// row, and for full value each RGB channel is 1 - s * w with w a per-column
+// weight. So the weights are worked out once per width and every row is a
+// multiply, a subtract and a rounding per channel, done 4 or 8 pixels at a
+// time with SSE2, AVX2 or NEON (picked at runtime) or one at a time
+// otherwise. The conversion is the one QColor::setHsv() uses, in the same
+// order of float operations. Rows are written straight into the image's
+// scan lines, in bands spread over the global thread pool.
+namespace HueSatKernel {
+
+enum class Isa {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon
+};
+
+// The widest instruction set this CPU can run
+Isa bestIsa();
+QVector<Isa> availableIsas();
+const char *isaName(Isa isa);
+
+// Channel weights per column for one image width
+struct Columns {
+    QVector<float> red;
+    QVector<float> green;
+    QVector<float> blue;
+};
+
+Columns columns(int width);
+int hueForColumn(int x, int width);
+int saturationForRow(int y, int height);
+
+// Writes width opaque ARGB32 pixels at the given saturation (0-255)
+void fillRow(quint32 *row, const Columns &columns, int width, int saturation, Isa isa);
+
+// Rows are filled in parallel unless parallel is false or the image is small
+QImage generate(const QSize &size, Isa isa, bool parallel = true);
+QImage generate(const QSize &size);
+
+// Images with fewer pixels than this are filled on the calling thread
+const int MIN_PARALLEL_PIXELS = 128 * 1024;
+
+} // namespace HueSatKernel
+
+#endif // HUESATKERNEL_H
@@ -8,6 +8,7 @@
 #include <QMouseEvent>
 #include <QPainterPath>
 #include <QRadialGradient>
+#include <QLinearGradient>
 #include <Qt>
 #include <QDebug>
 #include "resourcemanager.h"
@@ -36,9 +37,9 @@ void HueSatMap::initializeComponent()
     
     // Setup connections
     setupConnections();
-    
-    // Initialize with a valid image
-    resetGradient(256, 256);
+
+    // The gradient is requested at the first resize; generating one here
+    // would block construction on a size the map is never shown at
 }
 
 void HueSatMap::setupConnections()
@@ -70,6 +71,11 @@ void HueSatMap::setupConnections()
                 m_isDragging = false;
             });
 
+    // Emitted from a worker thread, so this is queued
+    connect(m_gradientCache, &HueSatMapCache::gradientReady,
+            this, &HueSatMap::onGradientReady);
+    connect(m_gradientCache, &HueSatMapCache::renderModeChanged,
+            this, [this]() { updateGradient(); });
 }
 
 void HueSatMap::cleanupResources()
@@ -100,85 +106,45 @@ void HueSatMap::handleMemoryWarning()
 
 void HueSatMap::resetGradient(int width, int height)
 {
-    const int minDimension = MIN_TOUCH_TARGET * 2;
-    const int maxDimension = 4096;
-    
-    width = qBound(minDimension, width, maxDimension);
-    height = qBound(minDimension, height, maxDimension);
-    
-    // Get cached gradient
-    if (m_gradientCache) {
-        m_hueSatMap = m_gradientCache->getOrGenerateGradient(QSize(width, height));
+    if (!m_gradientCache) {
+        return;
     }
-    
+
+    // Never blocks: until the bucket is generated the cache hands back the
+    // closest image it has, which paintEvent() stretches over the widget.
+    // In procedural mode there is no image at all.
+    m_gradientBucket = m_gradientCache->imageBucket(QSize(width, height));
+    m_hueSatMap = m_gradientCache->gradient(m_gradientBucket);
     update();
 }
 
-void HueSatMap::updateGradient()
+void HueSatMap::onGradientReady(const QSize &bucket)
 {
-    // Ensure we have a valid image
-    if (m_hueSatMap.isNull()) {
-        resetGradient(256, 256);
-        if (m_hueSatMap.isNull()) {
-            return;
-        }
-    }
-    
-    const int width = m_hueSatMap.width();
-    const int height = m_hueSatMap.height();
-    
-    if (width <= 0 || height <= 0) {
-        qWarning("Invalid image dimensions: %dx%d", width, height);
-        return;
-    }
-    
-    try {
-        // Fill with a solid color first
-        m_hueSatMap.fill(Qt::transparent);
-        
-        // Pre-calculate values outside the loop for better performance
-        const qreal invWidth = 1.0 / qMax(1, width - 1);
-        const qreal invHeight = 1.0 / qMax(1, height - 1);
-        
-        // Generate the gradient
-        for (int y = 0; y < height; ++y) {
-            QRgb *scanLine = reinterpret_cast<QRgb*>(m_hueSatMap.scanLine(y));
-            if (!scanLine) {
-                qWarning("Failed to get scanline %d", y);
-                continue;
-            }
-            
-            for (int x = 0; x < width; ++x) {
-                // Calculate hue and saturation with proper bounds checking
-                const qreal hue = qBound(0.0, static_cast<qreal>(x) * invWidth, 1.0);
-                const qreal sat = qBound(0.0, 1.0 - (static_cast<qreal>(y) * invHeight), 1.0);
-                
-                // Convert to HSV color with proper range checking
-                const int h = qBound(0, static_cast<int>(hue * 359.0 + 0.5), 359);
-                const int s = qBound(0, static_cast<int>(sat * 255.0 + 0.5), 255);
-                
-                QColor color;
-                color.setHsv(h, s, 255);
-                scanLine[x] = color.rgba();
-            }
-        }
-        
+    if (m_gradientCache && bucket == m_gradientBucket && m_hueSatMap.size() != bucket) {
+        m_hueSatMap = m_gradientCache->gradient(bucket);
         update();
-    } catch (const std::exception &e) {
-        qWarning("Error in updateGradient: %s", e.what());
-    } catch (...) {
-        qWarning("Unknown error in updateGradient");
     }
 }
 
+void HueSatMap::updateGradient()
+{
+    const QSize size = gradientSize();
+    resetGradient(size.width(), size.height());
+}
+
+QSize HueSatMap::gradientSize() const
+{
+    // In device pixels, so high-DPI screens get a sharp map
+    return size() * devicePixelRatioF();
+}
+
 void HueSatMap::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
-    // Regenerate gradient when size changes
-    if (m_hueSatMap.isNull() || 
-        m_hueSatMap.width() != width() || 
-        m_hueSatMap.height() != height()) {
-        resetGradient(width(), height());
+    // Only a new bucket needs another image; within one it is just scaled
+    if (m_hueSatMap.isNull() || !m_gradientCache ||
+        m_gradientCache->imageBucket(gradientSize()) != m_gradientBucket) {
+        updateGradient();
     }
 }
 
@@ -222,31 +188,23 @@ void HueSatMap::paintEvent(QPaintEvent *event)
             return;
         }
 
-        // Ensure we have a valid image with non-zero size
-        if (m_hueSatMap.isNull() || m_hueSatMap.size().isEmpty()) {
-            resetGradient(paintRect.width(), paintRect.height());
-            if (m_hueSatMap.isNull()) {
-                return;
+        const QRectF drawnRect(paintRect);
+        painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+        if (m_gradientCache && m_gradientCache->renderMode() == HueSatMapCache::ProceduralMode) {
+            paintProceduralGradient(&painter, drawnRect);
+        } else if (m_hueSatMap.isNull() || m_hueSatMap.size().isEmpty()) {
+            // Nothing cached yet: a plain background until gradientReady()
+            painter.fillRect(paintRect, palette().window());
+            if (m_gradientBucket.isEmpty()) {
+                updateGradient();
             }
+            return;
+        } else {
+            // Stretch the bucket-sized image over the widget; the painter
+            // filters it, so no scaled copy is made per paint
+            painter.drawImage(drawnRect, m_hueSatMap);
         }
 
-        // Draw the image directly at the widget's size
-        painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
-        
-        // Scale the image to fit the widget while maintaining aspect ratio
-        QImage scaled = m_hueSatMap.scaled(paintRect.size(), 
-                                         Qt::KeepAspectRatio, 
-                                         Qt::SmoothTransformation);
-        
-        // Center the image in the widget
-        QPoint offset((paintRect.width() - scaled.width()) / 2, 
-                     (paintRect.height() - scaled.height()) / 2);
-        
-        painter.drawImage(offset, scaled);
-        
-        // Calculate the actual drawn area
-        QRectF drawnRect(offset, scaled.size());
-        
         // Draw the indicator if position is valid
         if (m_indicatorPos.x() >= 0 && m_indicatorPos.y() >= 0 &&
             m_indicatorPos.x() <= 1.0 && m_indicatorPos.y() <= 1.0) {
@@ -274,6 +232,32 @@ void HueSatMap::paintEvent(QPaintEvent *event)
     }
 }
 
+void HueSatMap::paintProceduralGradient(QPainter *painter, const QRectF &rect) const
+{
+    // At full value every hue edge of the HSV hexcone is a straight line in
+    // RGB, so stops at the six primaries and secondaries give the exact
+    // spectrum. Hue runs 0-359 over the width, as the generated images do.
+    QLinearGradient hue(rect.topLeft(), rect.topRight());
+    for (int degrees = 0; degrees < 360; degrees += 60) {
+        hue.setColorAt(degrees / 359.0, QColor::fromHsv(degrees, 255, 255));
+    }
+    hue.setColorAt(1.0, QColor::fromHsv(359, 255, 255));
+
+    // Lowering saturation blends linearly towards white, which is exactly
+    // a white layer whose alpha grows from the top to the bottom
+    QLinearGradient saturation(rect.topLeft(), rect.bottomLeft());
+    saturation.setColorAt(0.0, QColor(255, 255, 255, 0));
+    saturation.setColorAt(1.0, QColor(255, 255, 255, 255));
+
+    painter->save();
+    painter->setPen(Qt::NoPen);
+    painter->setCompositionMode(QPainter::CompositionMode_Source);
+    painter->fillRect(rect, hue);
+    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter->fillRect(rect, saturation);
+    painter->restore();
+}
+
 void HueSatMap::setScale(qreal scale)
 {
     if (qFuzzyCompare(m_scale, scale))
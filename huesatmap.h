@@ -50,14 +50,17 @@ private:
     // Private methods
     void updateGradient();
     void resetGradient(int width, int height);
+    void onGradientReady(const QSize &bucket);
+    QSize gradientSize() const;
     void setupTouchInteraction();
     void drawTargetIndicator(QPainter *painter);
-    QImage getCachedGradient(const QSize &size);
+    void paintProceduralGradient(QPainter *painter, const QRectF &rect) const;
     
     // Member variables
     QuteNote::OwnedPtr<TouchInteraction> m_touchInteraction;
     HueSatMapCache *m_gradientCache;
     QImage m_hueSatMap;
+    QSize m_gradientBucket; // Bucket m_hueSatMap was asked for; it may show another until ready
     QPointF m_indicatorPos;
     QColor m_indicatorColor;
     qreal m_scale;
@@ -1,16 +1,17 @@
 #include "huesatmapcache.h"
-#include <QColor>
+#include "huesatkernel.h"
+#include <QMutexLocker>
+#include <QtConcurrent>
 #include <QDebug>
-#include <QPainter>
-#include <QThread>
-#include <algorithm>
-#include <omp.h> // Added missing include for OpenMP
-#include <stdexcept> // Added missing include for std::exception
 
 // Static member definitions
 const qint64 HueSatMapCache::DEFAULT_MAX_MEMORY;
 const int HueSatMapCache::MIN_DIMENSION;
 const int HueSatMapCache::MAX_DIMENSION;
+const int HueSatMapCache::BUCKETS_PER_OCTAVE;
+const int HueSatMapCache::MIN_BUCKET_STEP;
+const int HueSatMapCache::BYTES_PER_PIXEL;
+const qint64 HueSatMapCache::MIN_IMAGE_MEMORY;
 
 HueSatMapCache* HueSatMapCache::s_instance = nullptr;
 
@@ -28,99 +29,210 @@ HueSatMapCache::HueSatMapCache()
     m_cache.setMaxCost(m_maxMemory);
 }
 
-QString HueSatMapCache::cacheKey(const QSize &size) const
+quint64 HueSatMapCache::cacheKey(const QSize &bucket)
 {
-    return QString("%1x%2").arg(size.width()).arg(size.height());
+    return (quint64(quint32(bucket.width())) << 32) | quint32(bucket.height());
 }
 
-void HueSatMapCache::setMaxMemoryUsage(qint64 bytes)
+int HueSatMapCache::bucketDimension(int dimension)
 {
-    m_maxMemory = bytes;
-    m_cache.setMaxCost(m_maxMemory);
-    optimizeCache();
+    dimension = qBound(MIN_DIMENSION, dimension, MAX_DIMENSION);
+    int octave = MIN_DIMENSION;
+    while (octave < dimension) {
+        octave *= 2;
+    }
+    const int step = qMax(MIN_BUCKET_STEP, octave / BUCKETS_PER_OCTAVE);
+    return qMin(MAX_DIMENSION, (dimension + step - 1) / step * step);
 }
 
-void HueSatMapCache::optimizeCache()
+QSize HueSatMapCache::bucketSize(const QSize &size)
 {
-    // Remove least recently used items if we're over the memory limit
-    while (m_cache.totalCost() > m_maxMemory) {
-        if (!m_cache.remove(m_cache.keys().first())) {
-            break; // Failed to remove any more items
+    return QSize(bucketDimension(size.width()), bucketDimension(size.height()));
+}
+
+QSize HueSatMapCache::imageBucket(const QSize &size) const
+{
+    QMutexLocker locker(&m_mutex);
+    return fittingBucket(bucketSize(size));
+}
+
+QSize HueSatMapCache::fittingBucket(const QSize &bucket) const
+{
+    // Called with m_mutex held. Halving always ends: MIN_DIMENSION square
+    // is far below MIN_IMAGE_MEMORY.
+    QSize fitted = bucket;
+    while (qint64(fitted.width()) * fitted.height() * BYTES_PER_PIXEL > m_maxMemory &&
+           (fitted.width() > MIN_DIMENSION || fitted.height() > MIN_DIMENSION)) {
+        fitted = bucketSize(fitted / 2);
+    }
+    return fitted;
+}
+
+HueSatMapCache::RenderMode HueSatMapCache::renderMode() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxMemory < MIN_IMAGE_MEMORY ? ProceduralMode : ImageMode;
+}
+
+void HueSatMapCache::setMaxMemoryUsage(qint64 bytes)
+{
+    const RenderMode previous = renderMode();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxMemory = qMax<qint64>(0, bytes);
+        m_unfit.clear(); // Judged against the old limit
+        if (m_maxMemory < MIN_IMAGE_MEMORY) {
+            m_cache.clear();
         }
+        m_cache.setMaxCost(m_maxMemory);
     }
+
+    const RenderMode mode = renderMode();
+    if (mode != previous) {
+        emit renderModeChanged(mode);
+    }
+}
+
+void HueSatMapCache::optimizeCache()
+{
+    // Setting the limit again trims least recently used images down to it
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(m_maxMemory);
 }
 
 void HueSatMapCache::clear()
 {
+    QMutexLocker locker(&m_mutex);
     m_cache.clear();
 }
 
+bool HueSatMapCache::contains(const QSize &size) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(cacheKey(fittingBucket(bucketSize(size))));
+}
+
+QImage HueSatMapCache::gradient(const QSize &size)
+{
+    if (renderMode() == ProceduralMode) {
+        return QImage();
+    }
+
+    const QSize bucket = imageBucket(size);
+    const quint64 key = cacheKey(bucket);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (QImage *cached = m_cache.object(key)) {
+            return *cached;
+        }
+    }
+    generateInBackground(bucket);
+
+    // Meanwhile the nearest size there is, scaled by the painter, beats a
+    // blank map; prefer larger images, which scale down cleanly
+    QMutexLocker locker(&m_mutex);
+    const qint64 wanted = qint64(bucket.width()) * bucket.height();
+    quint64 closest = 0;
+    qint64 closestDistance = -1;
+    const QList<quint64> keys = m_cache.keys();
+    for (quint64 candidate : keys) {
+        const qint64 area = qint64(candidate >> 32) * qint64(candidate & 0xffffffffu);
+        const qint64 distance = area >= wanted ? area - wanted : 2 * (wanted - area);
+        if (closestDistance < 0 || distance < closestDistance) {
+            closest = candidate;
+            closestDistance = distance;
+        }
+    }
+    if (closestDistance >= 0) {
+        if (QImage *cached = m_cache.object(closest)) {
+            return *cached;
+        }
+    }
+    return QImage();
+}
+
 QImage HueSatMapCache::getOrGenerateGradient(const QSize &size)
 {
-    // Clamp dimensions to reasonable values
-    QSize clampedSize(
-        qBound(MIN_DIMENSION, size.width(), MAX_DIMENSION),
-        qBound(MIN_DIMENSION, size.height(), MAX_DIMENSION)
-    );
-    
-    // Check cache first
-    QString key = cacheKey(clampedSize);
-    QImage *cached = m_cache.object(key);
-    if (cached) {
-        return *cached;
+    const QSize bucket = imageBucket(size);
+    const quint64 key = cacheKey(bucket);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (QImage *cached = m_cache.object(key)) {
+            return *cached;
+        }
     }
-    
-    // Generate new gradient
-    QImage gradient = generateGradient(clampedSize);
+
+    QImage gradient = generateGradient(bucket, true);
     cacheGradient(key, gradient);
     return gradient;
 }
 
-void HueSatMapCache::cacheGradient(const QString &key, const QImage &gradient)
+void HueSatMapCache::prewarm(const QList<QSize> &sizes)
 {
-    // Calculate memory cost (width * height * bytes per pixel)
-    int cost = gradient.width() * gradient.height() * 4; // RGBA = 4 bytes
-    
-    // Create a new cached image and insert into cache
-    QImage *cached = new QImage(gradient);
-    if (!m_cache.insert(key, cached, cost)) {
-        delete cached; // Failed to insert, clean up
-        qWarning() << "Failed to cache gradient with key:" << key;
+    QSet<quint64> seen;
+    for (const QSize &size : sizes) {
+        const QSize bucket = imageBucket(size);
+        if (!seen.contains(cacheKey(bucket))) {
+            seen.insert(cacheKey(bucket));
+            generateInBackground(bucket);
+        }
     }
 }
 
-QImage HueSatMapCache::generateGradient(const QSize &size)
-{
-    QImage gradient(size, QImage::Format_ARGB32_Premultiplied);
-    gradient.fill(Qt::transparent);
-    
-    const int width = size.width();
-    const int height = size.height();
-    const qreal invWidth = 1.0 / qMax(1, width - 1);
-    const qreal invHeight = 1.0 / qMax(1, height - 1);
-    
-    try {
-        // Generate gradient with optimized calculations
-        #pragma omp parallel for collapse(2) if(width * height > 100000)
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                // Calculate hue and saturation with proper bounds checking
-                const qreal hue = qBound(0.0, static_cast<qreal>(x) * invWidth, 1.0);
-                const qreal sat = qBound(0.0, 1.0 - (static_cast<qreal>(y) * invHeight), 1.0);
-                
-                // Convert to HSV color with proper range checking
-                const int h = qBound(0, static_cast<int>(hue * 359.0 + 0.5), 359);
-                const int s = qBound(0, static_cast<int>(sat * 255.0 + 0.5), 255);
-                
-                QColor color;
-                color.setHsv(h, s, 255); // Use setHsv with integer values
-                gradient.setPixel(x, y, color.rgba());
-            }
+void HueSatMapCache::generateInBackground(const QSize &bucket)
+{
+    const quint64 key = cacheKey(bucket);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_maxMemory < MIN_IMAGE_MEMORY || m_pending.contains(key) ||
+            m_unfit.contains(key) || m_cache.contains(key)) {
+            return;
         }
-    } catch (const std::exception &e) {
-        qWarning() << "Error generating gradient:" << e.what();
-        gradient.fill(Qt::red); // Visual indicator of error
+        m_pending.insert(key);
+    }
+
+    // The cache lives as long as the process, so the worker may use it
+    QtConcurrent::run([this, bucket, key]() {
+        // Already on the pool: one band per gradient, several gradients at once
+        const QImage gradient = generateGradient(bucket, false);
+        const bool cached = cacheGradient(key, gradient);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_pending.remove(key);
+        }
+        // Maps re-request a ready bucket; one that is not in the cache would
+        // only be generated again
+        if (cached) {
+            emit gradientReady(bucket);
+        }
+    });
+}
+
+bool HueSatMapCache::cacheGradient(quint64 key, const QImage &gradient)
+{
+    const int cost = int(gradient.sizeInBytes());
+
+    QMutexLocker locker(&m_mutex);
+    if (m_maxMemory < MIN_IMAGE_MEMORY) {
+        return false; // Switched to procedural mode while this was generated
+    }
+    // QCache takes ownership, and deletes the copy at once if it does not fit
+    if (!m_cache.insert(key, new QImage(gradient), cost)) {
+        qWarning() << "HueSatMapCache: gradient of" << gradient.size() << "exceeds the cache limit";
+        m_unfit.insert(key);
+        return false;
+    }
+    return true;
+}
+
+QImage HueSatMapCache::generateGradient(const QSize &size, bool parallel)
+{
+    // Vectorized rows, split across the thread pool for large sizes
+    QImage gradient = HueSatKernel::generate(size, HueSatKernel::bestIsa(), parallel);
+    if (gradient.isNull()) {
+        // Visual indicator of error, as small as it gets
+        gradient = QImage(QSize(MIN_DIMENSION, MIN_DIMENSION), QImage::Format_ARGB32_Premultiplied);
+        gradient.fill(Qt::red);
     }
-    
     return gradient;
-}
\ No newline at end of file
+}
@@ -3,41 +3,97 @@
 
 #include <QCache>
 #include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
 #include <QSize>
-#include <QString>
-#include <memory>
 
-class HueSatMapCache {
+// Hue/saturation gradients by size, shared by every HueSatMap.
+//
+// Sizes are rounded up into buckets (eight per doubling), so a map that is
+// resized a little keeps drawing the same image, scaled at paint time. The
+// images live in a QCache keyed by the packed bucket size with their byte
+// size as cost, which evicts the least recently used first. gradient()
+// never generates on the calling thread: a missing bucket is generated on
+// the thread pool and gradientReady() is emitted when it is in the cache.
+// A bucket bigger than the memory limit is halved until it fits, so the
+// cache can always hold what it generates.
+//
+// With a memory limit too small for a useful image the cache switches to
+// procedural mode: it stores nothing and maps paint the field from two
+// linear gradients instead.
+class HueSatMapCache : public QObject
+{
+    Q_OBJECT
+
 public:
+    enum RenderMode {
+        ImageMode,      // Cached images, scaled at paint time
+        ProceduralMode  // Painted from gradients, nothing stored
+    };
+
     static HueSatMapCache *instance();
-    
-    // Get or generate gradient for the given size
+
+    RenderMode renderMode() const;
+
+    // The size gradients for this size are generated at
+    static QSize bucketSize(const QSize &size);
+    // bucketSize(), shrunk to fit the current memory limit; what gradient()
+    // and gradientReady() use
+    QSize imageBucket(const QSize &size) const;
+
+    // The gradient for size's bucket if it is cached, otherwise the closest
+    // cached one (or a null image) while the bucket is generated
+    QImage gradient(const QSize &size);
+    bool contains(const QSize &size) const;
+
+    // Get or generate gradient for the given size, on the calling thread
     QImage getOrGenerateGradient(const QSize &size);
-    
-    // Configure cache settings
+
+    // Generates the buckets for these sizes in the background
+    void prewarm(const QList<QSize> &sizes);
+
+    // Configure cache settings; limits under MIN_IMAGE_MEMORY select
+    // ProceduralMode and drop every cached image
     void setMaxMemoryUsage(qint64 bytes);
+    static const qint64 MIN_IMAGE_MEMORY = 256 * 256 * 4; // One 256x256 gradient
     void optimizeCache();
-    
+
     // Clear the cache
     void clear();
-    
+
+Q_SIGNALS:
+    // Emitted from a worker thread
+    void gradientReady(const QSize &bucket);
+    void renderModeChanged(HueSatMapCache::RenderMode mode);
+
 private:
     HueSatMapCache();
     ~HueSatMapCache() = default;
-    
+
     // Helper methods
-    QString cacheKey(const QSize &size) const;
-    QImage generateGradient(const QSize &size);
-    void cacheGradient(const QString &key, const QImage &gradient);
-    
+    static quint64 cacheKey(const QSize &bucket);
+    static int bucketDimension(int dimension);
+    QSize fittingBucket(const QSize &bucket) const;
+    QImage generateGradient(const QSize &size, bool parallel);
+    bool cacheGradient(quint64 key, const QImage &gradient);
+    void generateInBackground(const QSize &bucket);
+
     static HueSatMapCache *s_instance;
-    QCache<QString, QImage> m_cache;
+    mutable QMutex m_mutex;
+    QCache<quint64, QImage> m_cache;
+    QSet<quint64> m_pending;
+    QSet<quint64> m_unfit; // Rejected by the cache; not generated again until the limit changes
     qint64 m_maxMemory;
-    
+
     // Cache configuration
     static const qint64 DEFAULT_MAX_MEMORY = 50 * 1024 * 1024; // 50MB
     static const int MIN_DIMENSION = 48;  // Minimum touch target size
     static const int MAX_DIMENSION = 4096; // Maximum reasonable size
+    static const int BUCKETS_PER_OCTAVE = 8;
+    static const int MIN_BUCKET_STEP = 32;
+    static const int BYTES_PER_PIXEL = 4; // Format_ARGB32_Premultiplied
 };
 
-#endif // HUESATMAPCACHE_H
\ No newline at end of file
+#endif // HUESATMAPCACHE_H
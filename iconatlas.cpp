@@ -0,0 +1,141 @@
+#include "iconatlas.h"
+#include "thememanager.h"
+#include <QApplication>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QStyle>
+
+// Static member definitions
+const int IconAtlas::DEFAULT_ICON_SIZE;
+
+IconAtlas::IconAtlas()
+    : m_iconSize(DEFAULT_ICON_SIZE)
+{
+    for (int i = 0; i < IconCount; ++i) {
+        m_sources[i] = QIcon(sourcePath(static_cast<Icon>(i)));
+    }
+    // Fall back on the style's icons if the resources are missing
+    if (m_sources[File].isNull()) {
+        m_sources[File] = QApplication::style()->standardIcon(QStyle::SP_FileIcon);
+    }
+    for (Icon folder : {Folder, FolderCollapsed, FolderExpanded}) {
+        if (m_sources[folder].isNull()) {
+            m_sources[folder] = QApplication::style()->standardIcon(QStyle::SP_DirIcon);
+        }
+    }
+
+    const int themeSize = ThemeManager::instance()->currentTheme().metrics.iconSize;
+    if (themeSize > 0) {
+        m_iconSize = themeSize;
+    }
+
+    connect(ThemeManager::instance(), &ThemeManager::themeChanged,
+            this, &IconAtlas::onThemeChanged);
+    // A screen with another pixel ratio needs its own rasterization
+    connect(qApp, &QGuiApplication::screenAdded, this, [this](QScreen *screen) {
+        if (m_built && !m_pixmaps.value(Folder).contains(screen->devicePixelRatio())) {
+            invalidate();
+        }
+    });
+}
+
+QIcon IconAtlas::icon(Icon which)
+{
+    if (!m_built) {
+        build();
+    }
+    return m_icons[which];
+}
+
+QPixmap IconAtlas::pixmap(Icon which, qreal devicePixelRatio)
+{
+    if (!m_built) {
+        build();
+    }
+    QHash<qreal, QPixmap> &pixmaps = m_pixmaps[which];
+    auto it = pixmaps.constFind(devicePixelRatio);
+    if (it != pixmaps.constEnd()) {
+        return it.value();
+    }
+    const QPixmap pixmap = rasterize(which, devicePixelRatio);
+    pixmaps.insert(devicePixelRatio, pixmap);
+    return pixmap;
+}
+
+void IconAtlas::onThemeChanged(const Theme &theme)
+{
+    // Colour-only changes leave the icons as they are
+    const int size = theme.metrics.iconSize > 0 ? theme.metrics.iconSize : DEFAULT_ICON_SIZE;
+    if (size == m_iconSize) {
+        return;
+    }
+    m_iconSize = size;
+    invalidate();
+}
+
+void IconAtlas::invalidate()
+{
+    m_built = false;
+    m_pixmaps.clear();
+    for (QIcon &icon : m_icons) {
+        icon = QIcon();
+    }
+    emit iconsChanged();
+}
+
+void IconAtlas::build()
+{
+    const QList<qreal> ratios = devicePixelRatios();
+    for (int i = 0; i < IconCount; ++i) {
+        const Icon which = static_cast<Icon>(i);
+        QIcon icon;
+        QHash<qreal, QPixmap> &pixmaps = m_pixmaps[which];
+        for (qreal ratio : ratios) {
+            const QPixmap pixmap = rasterize(which, ratio);
+            pixmaps.insert(ratio, pixmap);
+            icon.addPixmap(pixmap);
+        }
+        m_icons[i] = icon;
+    }
+    m_built = true;
+}
+
+QPixmap IconAtlas::rasterize(Icon which, qreal devicePixelRatio) const
+{
+    const int side = qRound(m_iconSize * devicePixelRatio);
+    QPixmap pixmap = m_sources[which].pixmap(QSize(side, side));
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    return pixmap;
+}
+
+QList<qreal> IconAtlas::devicePixelRatios()
+{
+    QList<qreal> ratios;
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    for (QScreen *screen : screens) {
+        const qreal ratio = screen->devicePixelRatio();
+        if (!ratios.contains(ratio)) {
+            ratios << ratio;
+        }
+    }
+    if (ratios.isEmpty()) {
+        ratios << qApp->devicePixelRatio();
+    }
+    return ratios;
+}
+
+QString IconAtlas::sourcePath(Icon which)
+{
+    switch (which) {
+    case Folder:
+        return QStringLiteral(":/resources/icons/custom/folder.svg");
+    case FolderCollapsed:
+        return QStringLiteral(":/resources/icons/custom/folder-plus.svg");
+    case FolderExpanded:
+        return QStringLiteral(":/resources/icons/custom/folder-minus.svg");
+    case File:
+    case IconCount:
+        break;
+    }
+    return QStringLiteral(":/resources/icons/custom/file.svg");
+}
@@ -0,0 +1,62 @@
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include "smartpointers.h"
+#include <QHash>
+#include <QIcon>
+#include <QObject>
+#include <QPixmap>
+
+struct Theme;
+
+// Process-wide cache of the FileBrowser's item icons.
+//
+// The custom SVGs are rasterized once for the theme's icon size at every
+// device pixel ratio in use, and the resulting QIcons are handed out as
+// implicitly shared copies, so no item or paint ever parses or renders an
+// SVG again. Everything is rebuilt (and iconsChanged() emitted) when the
+// theme's icon size changes or a screen with a new pixel ratio shows up.
+class IconAtlas : public QObject, public QuteNote::Singleton<IconAtlas>
+{
+    Q_OBJECT
+    friend class QuteNote::Singleton<IconAtlas>;
+
+public:
+    enum Icon {
+        Folder,          // Empty folder
+        FolderCollapsed,
+        FolderExpanded,
+        File,
+        IconCount
+    };
+
+    QIcon icon(Icon which);
+    // Rasterized at iconSize(), for the given pixel ratio
+    QPixmap pixmap(Icon which, qreal devicePixelRatio);
+    int iconSize() const { return m_iconSize; }
+
+Q_SIGNALS:
+    void iconsChanged();
+
+private:
+    IconAtlas();
+    ~IconAtlas() override = default;
+
+    void onThemeChanged(const Theme &theme);
+    void invalidate();
+    void build();
+    QPixmap rasterize(Icon which, qreal devicePixelRatio) const;
+    static QList<qreal> devicePixelRatios();
+    static QString sourcePath(Icon which);
+
+    int m_iconSize;
+    bool m_built = false;
+    QIcon m_sources[IconCount];
+    QIcon m_icons[IconCount];
+    // By icon, then pixel ratio
+    QHash<int, QHash<qreal, QPixmap>> m_pixmaps;
+
+    static const int DEFAULT_ICON_SIZE = 16;
+};
+
+#endif // ICONATLAS_H
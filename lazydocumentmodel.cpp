@@ -1,13 +1,32 @@
 #include "lazydocumentmodel.h"
+#include "iconatlas.h"
 #include <QDir>
-#include <QDirIterator>
+#include <QDateTime>
 #include <QtConcurrent>
-#include <QApplication>
+#include <QFont>
+#include <QMimeData>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QThread>
+#include <limits>
+#include <utility>
+
+namespace {
+const char *const kPathsMimeType = "application/x-qutenote-paths";
+}
+
+// Static member definitions
+const int LazyDocumentModel::DEFAULT_BATCH_SIZE;
+const int LazyDocumentModel::DEFAULT_LOAD_DELAY;
+const int LazyDocumentModel::DEFAULT_MAX_CONCURRENT_LOADS;
+const int LazyDocumentModel::PREFETCH_IDLE_DELAY;
+const int LazyDocumentModel::MAX_PREFETCHED_LISTINGS;
 
 LazyDocumentItem::LazyDocumentItem(Type type, const QString &title, DocumentItem *parent)
     : DocumentItem(type, title, parent)
     , m_loaded(false)
 {
+    expanded = false;
 }
 
 LazyDocumentModel::LazyDocumentModel(QObject *parent)
@@ -15,45 +34,84 @@ LazyDocumentModel::LazyDocumentModel(QObject *parent)
     , m_lazyLoadingEnabled(true)
     , m_batchSize(DEFAULT_BATCH_SIZE)
     , m_loadDelay(DEFAULT_LOAD_DELAY)
-    , m_watcher(new QFutureWatcher<QList<QPair<QString, bool>>>(this))
+    , m_maxConcurrentLoads(qBound(1, QThread::idealThreadCount(), DEFAULT_MAX_CONCURRENT_LOADS))
 {
+    // The atlas has just been rebuilt for a new icon size
+    connect(IconAtlas::instance(), &IconAtlas::iconsChanged, this, [this]() {
+        subtreeIconsChanged(m_rootItem);
+    });
+
+    // Every item of this model is a LazyDocumentItem, the root included
+    delete m_rootItem;
+    auto *rootItem = new LazyDocumentItem(LazyDocumentItem::Folder, QString());
+    rootItem->setLoaded(true);
+    setRootItem(rootItem);
+
     connect(&m_loadTimer, &QTimer::timeout,
             this, &LazyDocumentModel::processLoadQueue);
-    
-    connect(m_watcher, &QFutureWatcher<QList<QPair<QString, bool>>>::finished,
-            this, &LazyDocumentModel::onLoadingFinished);
-    
+    connect(&m_batchTimer, &QTimer::timeout,
+            this, &LazyDocumentModel::insertNextBatch);
+    connect(&m_idleTimer, &QTimer::timeout,
+            this, &LazyDocumentModel::startPrefetch);
+
     m_loadTimer.setSingleShot(true);
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(0);
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(PREFETCH_IDLE_DELAY);
 }
 
 LazyDocumentModel::~LazyDocumentModel()
 {
     m_loadTimer.stop();
-    m_watcher->waitForFinished();
-    delete m_watcher;
+    m_batchTimer.stop();
+    m_idleTimer.stop();
+    cancelAllLoads();
+    for (const Scan &scan : std::as_const(m_scans)) {
+        scan.watcher->waitForFinished();
+    }
 }
 
 bool LazyDocumentModel::loadFromFile(const QString &filePath)
 {
-    // Only load root level items initially
-    QDir dir(filePath);
+    return setRootPath(filePath);
+}
+
+bool LazyDocumentModel::setRootPath(const QString &path)
+{
+    QDir dir(path);
     if (!dir.exists())
         return false;
-        
+
     beginResetModel();
-    
-    // Create root item
-    auto rootItem = new LazyDocumentItem(LazyDocumentItem::Folder, dir.dirName());
-    rootItem->path = dir.absolutePath();
+
+    // Scans still running finish in the background and are dropped
+    cancelAllLoads();
+    m_metadataCache.clear();
+    m_itemsByPath.clear();
+    m_recentFilesItem = nullptr;
+    delete m_rootItem;
+
+    auto *rootItem = new LazyDocumentItem(LazyDocumentItem::Folder, dir.dirName());
+    rootItem->path = QDir::cleanPath(dir.absolutePath());
     setRootItem(rootItem);
-    
-    // Queue loading of first level
-    queueLoad(QModelIndex(), dir.absolutePath());
-    
+    m_itemsByPath.insert(rootItem->path, rootItem);
+
+    if (m_recentFilesVisible) {
+        m_recentFilesItem = createRecentFilesSection();
+        rootItem->appendChild(m_recentFilesItem);
+    }
+    populate(rootItem, listDirectory(rootItem->path, &m_metadataCache), false);
+
     endResetModel();
     return true;
 }
 
+QString LazyDocumentModel::rootPath() const
+{
+    return m_rootItem->path;
+}
+
 void LazyDocumentModel::setLazyLoadingEnabled(bool enabled)
 {
     m_lazyLoadingEnabled = enabled;
@@ -69,28 +127,486 @@ void LazyDocumentModel::setLoadDelay(int msecs)
     m_loadDelay = qBound(0, msecs, 1000);
 }
 
-bool LazyDocumentModel::hasChildren(const QModelIndex &parent) const
+void LazyDocumentModel::setMaxConcurrentLoads(int count)
+{
+    m_maxConcurrentLoads = qBound(1, count, 16);
+    processLoadQueue();
+}
+
+void LazyDocumentModel::setPrefetchEnabled(bool enabled)
+{
+    m_prefetchEnabled = enabled;
+    if (!enabled) {
+        m_idleTimer.stop();
+        m_prefetchQueue.clear();
+        m_prefetched.clear();
+    }
+}
+
+void LazyDocumentModel::ensureLoaded(const QModelIndex &parent)
 {
-    if (!parent.isValid())
-        return true;
-        
     LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(parent));
-    if (!item->isLoaded()) {
-        QDir dir(item->path);
-        return dir.exists() && !dir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty();
+    if (!item || item->type != LazyDocumentItem::Folder)
+        return;
+
+    if (item->isLoaded()) {
+        flushPendingRows(item);
+        return;
     }
-    
-    return item->childCount() > 0;
+
+    // A running scan of this folder is dropped when it finds it loaded
+    m_loadQueue.removeAll(item->path);
+    Listing listing;
+    if (!takePrefetched(item, &listing)) {
+        listing = listDirectory(item->path, &m_metadataCache);
+    }
+    populate(item, listing, true);
 }
 
-bool LazyDocumentModel::canFetchMore(const QModelIndex &parent) const
+bool LazyDocumentModel::isLoaded(const QModelIndex &parent) const
+{
+    return static_cast<LazyDocumentItem*>(itemFromIndex(parent))->isLoaded();
+}
+
+QModelIndex LazyDocumentModel::indexForPath(const QString &path) const
+{
+    return indexForItem(itemForPath(path));
+}
+
+bool LazyDocumentModel::isFolder(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return false;
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(index));
+    return item->type == LazyDocumentItem::Folder && !item->isVirtual();
+}
+
+bool LazyDocumentModel::isVirtual(const QModelIndex &index) const
+{
+    return index.isValid() && static_cast<LazyDocumentItem*>(itemFromIndex(index))->isVirtual();
+}
+
+QStringList LazyDocumentModel::childNames(const QModelIndex &parent) const
+{
+    DocumentItem *item = itemFromIndex(parent);
+    QStringList names;
+    for (int row = firstEntryRow(item); row < item->childCount(); ++row) {
+        names << QFileInfo(item->child(row)->path).fileName();
+    }
+    // Rows not inserted yet come after the ones that are
+    auto pending = m_pendingRows.constFind(static_cast<LazyDocumentItem*>(item));
+    if (pending != m_pendingRows.constEnd()) {
+        for (int i = pending->next; i < pending->entries.size(); ++i) {
+            names << pending->entries.at(i).fileName();
+        }
+    }
+    return names;
+}
+
+QModelIndex LazyDocumentModel::addPath(const QString &path, int row)
+{
+    const QFileInfo info(path);
+    const QString cleanPath = QDir::cleanPath(info.absoluteFilePath());
+    flushPendingRowsFor(cleanPath);
+    if (LazyDocumentItem *existing = itemForPath(cleanPath)) {
+        return indexForItem(existing);
+    }
+
+    LazyDocumentItem *parent = itemForPath(info.absolutePath());
+    if (!parent || parent->type != LazyDocumentItem::Folder) {
+        return QModelIndex();
+    }
+    if (!parent->isLoaded()) {
+        m_prefetched.remove(parent->path);
+        if (!parent->hasChildrenHint()) {
+            parent->setChildrenHint(true);
+            iconChanged(parent);
+        }
+        return QModelIndex();
+    }
+
+    const int first = firstEntryRow(parent);
+    const int count = parent->childCount();
+    const int insertRow = row < 0 ? count : qBound(first, row, count);
+
+    beginInsertRows(indexForItem(parent), insertRow, insertRow);
+    LazyDocumentItem *item = createItem(info, info.isDir() && !m_metadataCache.isEmpty(cleanPath));
+    parent->insertChild(insertRow, item);
+    m_itemsByPath.insert(item->path, item);
+    endInsertRows();
+
+    if (count == first) {
+        iconChanged(parent);
+    }
+    return createIndex(insertRow, 0, item);
+}
+
+bool LazyDocumentModel::removePath(const QString &path)
+{
+    flushPendingRowsFor(path);
+    LazyDocumentItem *item = itemForPath(path);
+    if (!item || item == m_rootItem)
+        return false;
+
+    DocumentItem *parent = item->parent();
+    const int row = item->row();
+
+    beginRemoveRows(indexForItem(parent), row, row);
+    forgetSubtree(item);
+    parent->removeChild(row);
+    endRemoveRows();
+
+    if (parent->childCount() == firstEntryRow(parent)) {
+        iconChanged(parent);
+    }
+    return true;
+}
+
+QModelIndex LazyDocumentModel::renamePath(const QString &oldPath, const QString &newPath)
+{
+    flushPendingRowsFor(oldPath);
+    LazyDocumentItem *item = itemForPath(oldPath);
+    if (!item || item == m_rootItem)
+        return QModelIndex();
+
+    const QFileInfo newInfo(newPath);
+    const QString cleanPath = QDir::cleanPath(newInfo.absoluteFilePath());
+    if (QDir::cleanPath(newInfo.absolutePath()) != QFileInfo(item->path).absolutePath()) {
+        // Renamed into another folder
+        removePath(oldPath);
+        return addPath(cleanPath);
+    }
+
+    const QString previousPath = item->path;
+    rebaseSubtree(item, previousPath, cleanPath);
+    item->title = displayNameFor(newInfo);
+
+    const QModelIndex index = indexForItem(item);
+    emit dataChanged(index, index);
+    return index;
+}
+
+QModelIndex LazyDocumentModel::movePath(const QString &path, const QString &newParentPath, int row)
+{
+    flushPendingRowsFor(path);
+    flushPendingRows(itemForPath(newParentPath));
+    LazyDocumentItem *item = itemForPath(path);
+    if (!item || item == m_rootItem)
+        return QModelIndex();
+
+    LazyDocumentItem *newParent = itemForPath(newParentPath);
+    if (!newParent || newParent->type != LazyDocumentItem::Folder) {
+        removePath(path);
+        return QModelIndex();
+    }
+    // A folder cannot be moved into itself
+    for (DocumentItem *ancestor = newParent; ancestor; ancestor = ancestor->parent()) {
+        if (ancestor == item) {
+            return indexForItem(item);
+        }
+    }
+    if (!newParent->isLoaded()) {
+        // It will be listed along with the rest of the folder
+        m_prefetched.remove(newParent->path);
+        removePath(path);
+        if (!newParent->hasChildrenHint()) {
+            newParent->setChildrenHint(true);
+            iconChanged(newParent);
+        }
+        return QModelIndex();
+    }
+
+    DocumentItem *oldParent = item->parent();
+    const QString previousPath = item->path;
+    const QString movedPath = QDir(newParent->path).filePath(QFileInfo(previousPath).fileName());
+    if (oldParent != newParent && m_itemsByPath.contains(movedPath)) {
+        // The name is taken in the new folder
+        return indexForItem(item);
+    }
+
+    const int sourceRow = item->row();
+    const int first = firstEntryRow(newParent);
+    const int count = newParent->childCount();
+    const int destination = row < 0 ? count : qBound(first, row, count);
+    if (oldParent == newParent && (destination == sourceRow || destination == sourceRow + 1)) {
+        return indexForItem(item);
+    }
+
+    if (!beginMoveRows(indexForItem(oldParent), sourceRow, sourceRow, indexForItem(newParent), destination)) {
+        return indexForItem(item);
+    }
+    oldParent->takeChild(sourceRow);
+    const int insertRow = (oldParent == newParent && destination > sourceRow) ? destination - 1 : destination;
+    newParent->insertChild(insertRow, item);
+    if (movedPath != previousPath) {
+        rebaseSubtree(item, previousPath, movedPath);
+    }
+    endMoveRows();
+
+    const QModelIndex index = createIndex(insertRow, 0, item);
+    if (oldParent != newParent) {
+        emit dataChanged(index, index);
+        if (oldParent->childCount() == firstEntryRow(oldParent)) {
+            iconChanged(oldParent);
+        }
+        if (count == first) {
+            iconChanged(newParent);
+        }
+    }
+    return index;
+}
+
+void LazyDocumentModel::refreshDirectory(const QString &path)
 {
-    if (!m_lazyLoadingEnabled)
+    LazyDocumentItem *parent = itemForPath(path);
+    if (!parent || parent->type != LazyDocumentItem::Folder)
+        return;
+
+    if (!parent->isLoaded()) {
+        // Only the expander can be out of date
+        m_prefetched.remove(parent->path);
+        const bool hasEntries = !m_metadataCache.isEmpty(parent->path);
+        if (hasEntries != parent->hasChildrenHint()) {
+            parent->setChildrenHint(hasEntries);
+            iconChanged(parent);
+        }
+        return;
+    }
+
+    flushPendingRows(parent);
+    const Listing listing = listDirectory(parent->path, &m_metadataCache);
+    const QFileInfoList entries = orderedEntries(listing);
+    const QModelIndex parentIndex = indexForItem(parent);
+    const int first = firstEntryRow(parent);
+
+    QSet<QString> wanted;
+    wanted.reserve(entries.size());
+    for (const QFileInfo &info : entries) {
+        wanted.insert(QDir::cleanPath(info.absoluteFilePath()));
+    }
+
+    // Entries that are gone
+    for (int row = parent->childCount() - 1; row >= first; --row) {
+        DocumentItem *child = parent->child(row);
+        if (!wanted.contains(child->path)) {
+            beginRemoveRows(parentIndex, row, row);
+            forgetSubtree(child);
+            parent->removeChild(row);
+            endRemoveRows();
+        }
+    }
+
+    // New entries, and existing ones moved to where the listing has them.
+    // Rows above targetRow are final by then, so a move is always upwards.
+    for (int i = 0; i < entries.size(); ++i) {
+        const QFileInfo &info = entries.at(i);
+        const int targetRow = first + i;
+        LazyDocumentItem *child = m_itemsByPath.value(QDir::cleanPath(info.absoluteFilePath()));
+        if (child && child->parent() == parent) {
+            const int row = child->row();
+            if (row != targetRow) {
+                beginMoveRows(parentIndex, row, row, parentIndex, targetRow);
+                parent->takeChild(row);
+                parent->insertChild(targetRow, child);
+                endMoveRows();
+            }
+            if (child->type == LazyDocumentItem::Folder && !child->isLoaded()) {
+                const bool hasEntries = !listing.emptyDirectories.contains(info.fileName());
+                if (hasEntries != child->hasChildrenHint()) {
+                    child->setChildrenHint(hasEntries);
+                    iconChanged(child);
+                }
+            }
+            continue;
+        }
+
+        beginInsertRows(parentIndex, targetRow, targetRow);
+        LazyDocumentItem *item = createItem(info, !listing.emptyDirectories.contains(info.fileName()));
+        parent->insertChild(targetRow, item);
+        m_itemsByPath.insert(item->path, item);
+        endInsertRows();
+    }
+
+    iconChanged(parent);
+}
+
+void LazyDocumentModel::setEmphasizedPaths(const QSet<QString> &paths)
+{
+    const QSet<QString> previous = m_emphasized;
+    m_emphasized = paths;
+
+    auto notify = [this](const QString &path) {
+        if (LazyDocumentItem *item = itemForPath(path)) {
+            const QModelIndex index = indexForItem(item);
+            if (index.isValid()) {
+                emit dataChanged(index, index, {Qt::FontRole});
+            }
+        }
+    };
+    for (const QString &path : previous) {
+        if (!paths.contains(path)) notify(path);
+    }
+    for (const QString &path : paths) {
+        if (!previous.contains(path)) notify(path);
+    }
+}
+
+void LazyDocumentModel::setRecentFiles(const QStringList &paths)
+{
+    m_recentFiles = paths;
+    if (!m_recentFilesItem)
+        return;
+
+    const QModelIndex sectionIndex = indexForItem(m_recentFilesItem);
+    if (m_recentFilesItem->childCount() > 0) {
+        beginRemoveRows(sectionIndex, 0, m_recentFilesItem->childCount() - 1);
+        while (m_recentFilesItem->childCount() > 0) {
+            m_recentFilesItem->removeChild(m_recentFilesItem->childCount() - 1);
+        }
+        endRemoveRows();
+    }
+    if (!paths.isEmpty()) {
+        beginInsertRows(sectionIndex, 0, paths.size() - 1);
+        LazyDocumentItem *section = createRecentFilesSection();
+        while (section->childCount() > 0) {
+            m_recentFilesItem->appendChild(section->takeChild(0));
+        }
+        delete section;
+        endInsertRows();
+    }
+}
+
+void LazyDocumentModel::setRecentFilesVisible(bool visible)
+{
+    m_recentFilesVisible = visible;
+    if (visible == (m_recentFilesItem != nullptr))
+        return;
+
+    if (visible) {
+        beginInsertRows(QModelIndex(), 0, 0);
+        m_recentFilesItem = createRecentFilesSection();
+        m_rootItem->insertChild(0, m_recentFilesItem);
+        endInsertRows();
+    } else {
+        beginRemoveRows(QModelIndex(), 0, 0);
+        m_rootItem->removeChild(0);
+        m_recentFilesItem = nullptr;
+        endRemoveRows();
+    }
+}
+
+QModelIndex LazyDocumentModel::recentFilesIndex() const
+{
+    return m_recentFilesItem ? createIndex(0, 0, m_recentFilesItem) : QModelIndex();
+}
+
+QString LazyDocumentModel::displayNameFor(const QFileInfo &info)
+{
+    // Entries left over from the old "001_name" ordering scheme are shown
+    // without their prefix; dividers only show their title
+    static const QRegularExpression prefixRx(QStringLiteral("^\\d{3}_(.+)$"));
+    const QString name = isDividerPath(info.fileName()) ? info.completeBaseName() : info.fileName();
+    const QRegularExpressionMatch match = prefixRx.match(name);
+    return match.hasMatch() ? match.captured(1) : name;
+}
+
+bool LazyDocumentModel::isDividerPath(const QString &path)
+{
+    return path.endsWith(QLatin1String(".divider"), Qt::CaseInsensitive);
+}
+
+QVariant LazyDocumentModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(index));
+    switch (role) {
+    case Qt::DecorationRole:
+        if (item == m_recentFilesItem) {
+            return QIcon::fromTheme(QStringLiteral("document-open-recent"));
+        }
+        if (item->isVirtual()) {
+            return QIcon::fromTheme(QStringLiteral("text-x-generic"));
+        }
+        if (item->type == LazyDocumentItem::Folder) {
+            if (isEmptyFolder(item)) {
+                return IconAtlas::instance()->icon(IconAtlas::Folder);
+            }
+            return IconAtlas::instance()->icon(item->expanded ? IconAtlas::FolderExpanded
+                                                              : IconAtlas::FolderCollapsed);
+        }
+        // No icon for dividers, the delegate draws the line
+        return isDividerPath(item->path) ? QVariant() : QVariant(IconAtlas::instance()->icon(IconAtlas::File));
+    case Qt::ToolTipRole:
+        return item->isVirtual() && !item->path.isEmpty() ? QVariant(item->path) : QVariant();
+    case Qt::FontRole:
+        if (!item->isVirtual() && m_emphasized.contains(item->path)) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    default:
+        return item->data(role);
+    }
+}
+
+bool LazyDocumentModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    // Items are renamed on disk and then through renamePath(); only the
+    // expansion state, which picks the folder icon, is set through here
+    if (!index.isValid() || role != ExpandedRole)
         return false;
-        
+
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(index));
+    if (item->expanded != value.toBool()) {
+        item->expanded = value.toBool();
+        emit dataChanged(index, index, {Qt::DecorationRole, ExpandedRole});
+    }
+
+    if (item->type == LazyDocumentItem::Folder && !item->isVirtual()) {
+        if (!item->expanded) {
+            // Nobody is waiting for it any more
+            if (!item->isLoaded())
+                cancelLoad(item->path);
+        } else {
+            queueSiblingPrefetch(item);
+        }
+    }
+    return true;
+}
+
+Qt::ItemFlags LazyDocumentModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::ItemIsDropEnabled;
+
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(index));
+    Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    if (item->isVirtual())
+        return flags;
+
+    flags |= Qt::ItemIsDragEnabled;
+    if (item->type == LazyDocumentItem::Folder)
+        flags |= Qt::ItemIsDropEnabled;
+    return flags;
+}
+
+bool LazyDocumentModel::hasChildren(const QModelIndex &parent) const
+{
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(parent));
+    if (item->type != LazyDocumentItem::Folder)
+        return false;
+
+    return !isEmptyFolder(item);
+}
+
+bool LazyDocumentModel::canFetchMore(const QModelIndex &parent) const
+{
     if (!parent.isValid())
         return false;
-        
+
     LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(parent));
     return item && item->type == LazyDocumentItem::Folder && !item->isLoaded();
 }
@@ -99,77 +615,500 @@ void LazyDocumentModel::fetchMore(const QModelIndex &parent)
 {
     if (!canFetchMore(parent))
         return;
-        
+
+    if (!m_lazyLoadingEnabled) {
+        ensureLoaded(parent);
+        return;
+    }
+
     LazyDocumentItem *item = static_cast<LazyDocumentItem*>(itemFromIndex(parent));
-    queueLoad(parent, item->path);
+    Listing listing;
+    if (takePrefetched(item, &listing)) {
+        populateInBatches(item, listing);
+        return;
+    }
+    queueLoad(item->path);
+}
+
+QStringList LazyDocumentModel::mimeTypes() const
+{
+    return {QString::fromLatin1(kPathsMimeType)};
+}
+
+QMimeData *LazyDocumentModel::mimeData(const QModelIndexList &indexes) const
+{
+    QStringList paths;
+    for (const QModelIndex &index : indexes) {
+        if (!index.isValid() || isVirtual(index))
+            continue;
+        const QString path = itemFromIndex(index)->path;
+        if (!path.isEmpty() && !paths.contains(path))
+            paths << path;
+    }
+    if (paths.isEmpty())
+        return nullptr;
+
+    QMimeData *mimeData = new QMimeData();
+    mimeData->setData(QString::fromLatin1(kPathsMimeType), paths.join('\n').toUtf8());
+    QList<QUrl> urls;
+    for (const QString &path : std::as_const(paths)) {
+        urls << QUrl::fromLocalFile(path);
+    }
+    mimeData->setUrls(urls);
+    return mimeData;
+}
+
+bool LazyDocumentModel::canDropMimeData(const QMimeData *data, Qt::DropAction action,
+                                        int row, int column, const QModelIndex &parent) const
+{
+    Q_UNUSED(action);
+    Q_UNUSED(row);
+
+    if (!data || !data->hasFormat(QString::fromLatin1(kPathsMimeType)))
+        return false;
+
+    if (column > 0)
+        return false;
+
+    return flags(parent).testFlag(Qt::ItemIsDropEnabled);
 }
 
-void LazyDocumentModel::queueLoad(const QModelIndex &parent, const QString &path)
+LazyDocumentModel::Listing LazyDocumentModel::listDirectory(const QString &path, DirectoryMetadataCache *cache,
+                                                            const CancelFlag &cancelled)
 {
-    LoadRequest request{parent, path};
-    if (!m_loadQueue.contains(request)) {
-        m_loadQueue.enqueue(request);
+    Listing listing;
+    listing.path = path;
+    // Taken before listing, so a change made meanwhile makes it look stale
+    listing.modified = modifiedTime(path);
+    listing.entries = QDir(path).entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot,
+                                               QDir::Name | QDir::DirsFirst);
+    for (const QFileInfo &info : std::as_const(listing.entries)) {
+        // Peeking into every subfolder is the slow part, unless it is cached
+        if (cancelled && cancelled->load()) {
+            break;
+        }
+        if (info.isDir() && cache->isEmpty(info.absoluteFilePath())) {
+            listing.emptyDirectories.insert(info.fileName());
+        }
+    }
+    return listing;
+}
+
+qint64 LazyDocumentModel::modifiedTime(const QString &path)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+LazyDocumentItem *LazyDocumentModel::itemForPath(const QString &path) const
+{
+    return path.isEmpty() ? nullptr : m_itemsByPath.value(QDir::cleanPath(path));
+}
+
+QModelIndex LazyDocumentModel::indexForItem(DocumentItem *item) const
+{
+    if (!item || item == m_rootItem)
+        return QModelIndex();
+    return createIndex(item->row(), 0, item);
+}
+
+int LazyDocumentModel::firstEntryRow(DocumentItem *parent) const
+{
+    return (parent == m_rootItem && m_recentFilesItem) ? 1 : 0;
+}
+
+LazyDocumentItem *LazyDocumentModel::createItem(const QFileInfo &info, bool hasChildren) const
+{
+    LazyDocumentItem *item = new LazyDocumentItem(
+        info.isDir() ? LazyDocumentItem::Folder : LazyDocumentItem::Document,
+        displayNameFor(info)
+    );
+    item->path = QDir::cleanPath(info.absoluteFilePath());
+    if (info.isDir()) {
+        item->setChildrenHint(hasChildren);
+    } else {
+        item->setLoaded(true);
+    }
+    return item;
+}
+
+QFileInfoList LazyDocumentModel::orderedEntries(const Listing &listing) const
+{
+    return m_orderer ? m_orderer(listing.path, listing.entries) : listing.entries;
+}
+
+void LazyDocumentModel::populate(LazyDocumentItem *parent, const Listing &listing, bool notify)
+{
+    const QFileInfoList entries = orderedEntries(listing);
+    parent->setLoaded(true);
+
+    if (!entries.isEmpty()) {
+        const int first = parent->childCount();
+        if (notify)
+            beginInsertRows(indexForItem(parent), first, first + entries.size() - 1);
+
+        for (const QFileInfo &info : entries) {
+            // Entries renamed by the orderer are not in the listing; assume
+            // they have children until they are expanded
+            LazyDocumentItem *item = createItem(info, !listing.emptyDirectories.contains(info.fileName()));
+            parent->appendChild(item);
+            m_itemsByPath.insert(item->path, item);
+        }
+
+        if (notify)
+            endInsertRows();
+    }
+
+    if (notify)
+        iconChanged(parent);
+}
+
+void LazyDocumentModel::iconChanged(DocumentItem *item)
+{
+    const QModelIndex index = indexForItem(item);
+    if (index.isValid())
+        emit dataChanged(index, index, {Qt::DecorationRole});
+}
+
+void LazyDocumentModel::subtreeIconsChanged(DocumentItem *parent)
+{
+    // One range per loaded folder; folders never listed have no rows to repaint
+    const int rows = parent->childCount();
+    if (rows == 0)
+        return;
+    const QModelIndex parentIndex = indexForItem(parent);
+    emit dataChanged(index(0, 0, parentIndex), index(rows - 1, 0, parentIndex), {Qt::DecorationRole});
+    for (int row = 0; row < rows; ++row)
+        subtreeIconsChanged(parent->child(row));
+}
+
+void LazyDocumentModel::forgetSubtree(DocumentItem *item)
+{
+    auto it = m_itemsByPath.find(item->path);
+    if (it != m_itemsByPath.end() && it.value() == item)
+        m_itemsByPath.erase(it);
+
+    LazyDocumentItem *lazyItem = static_cast<LazyDocumentItem*>(item);
+    if (m_pendingRows.remove(lazyItem))
+        m_pendingOrder.removeOne(lazyItem);
+    m_prefetched.remove(item->path);
+    forgetFolderMetadata(lazyItem);
+
+    for (int row = 0; row < item->childCount(); ++row)
+        forgetSubtree(item->child(row));
+}
+
+void LazyDocumentModel::rebaseSubtree(DocumentItem *item, const QString &oldPrefix, const QString &newPrefix)
+{
+    LazyDocumentItem *lazyItem = static_cast<LazyDocumentItem*>(item);
+    auto it = m_itemsByPath.find(item->path);
+    if (it != m_itemsByPath.end() && it.value() == lazyItem)
+        m_itemsByPath.erase(it);
+    m_prefetched.remove(item->path);
+    forgetFolderMetadata(lazyItem);
+
+    item->path = newPrefix + item->path.mid(oldPrefix.size());
+    m_itemsByPath.insert(item->path, lazyItem);
+
+    for (int row = 0; row < item->childCount(); ++row)
+        rebaseSubtree(item->child(row), oldPrefix, newPrefix);
+}
+
+void LazyDocumentModel::directoryChangedOnDisk(const QString &path)
+{
+    m_metadataCache.invalidate(QDir::cleanPath(path));
+}
+
+void LazyDocumentModel::forgetFolderMetadata(LazyDocumentItem *item)
+{
+    if (item->type == LazyDocumentItem::Folder && item->isLoaded() && !item->isVirtual())
+        m_metadataCache.invalidate(item->path);
+}
+
+LazyDocumentItem *LazyDocumentModel::createRecentFilesSection() const
+{
+    LazyDocumentItem *section = new LazyDocumentItem(LazyDocumentItem::Folder, tr("Recent Files"));
+    section->setVirtual(true);
+    section->setLoaded(true);
+
+    for (const QString &path : m_recentFiles) {
+        LazyDocumentItem *item = new LazyDocumentItem(LazyDocumentItem::Document, displayNameFor(QFileInfo(path)));
+        item->path = path;
+        item->setVirtual(true);
+        item->setLoaded(true);
+        section->appendChild(item);
+    }
+    return section;
+}
+
+void LazyDocumentModel::queueLoad(const QString &path)
+{
+    m_idleTimer.stop();
+    m_prefetchQueue.removeAll(path);
+
+    auto scan = m_scans.find(path);
+    if (scan != m_scans.end() && !scan->cancelled->load()) {
+        // Already being listed; someone is waiting for it now
+        scan->prefetch = false;
+        return;
+    }
+
+    if (!m_loadQueue.contains(path)) {
+        m_loadQueue.enqueue(path);
         if (!m_loadTimer.isActive()) {
             m_loadTimer.start(m_loadDelay);
         }
     }
 }
 
+void LazyDocumentModel::cancelLoad(const QString &path)
+{
+    m_loadQueue.removeAll(path);
+    m_prefetchQueue.removeAll(path);
+
+    auto scan = m_scans.find(path);
+    if (scan != m_scans.end() && !scan->prefetch) {
+        // A prefetch is not on anybody's behalf and may as well finish
+        scan->cancelled->store(true);
+    }
+}
+
+void LazyDocumentModel::cancelAllLoads()
+{
+    m_loadQueue.clear();
+    m_prefetchQueue.clear();
+    m_prefetched.clear();
+    m_pendingRows.clear();
+    m_pendingOrder.clear();
+    for (const Scan &scan : std::as_const(m_scans)) {
+        scan.cancelled->store(true);
+    }
+}
+
 void LazyDocumentModel::processLoadQueue()
 {
-    if (m_loadQueue.isEmpty() || m_watcher->isRunning())
-        return;
-        
-    LoadRequest request = m_loadQueue.dequeue();
-    LazyDocumentItem *parentItem = static_cast<LazyDocumentItem*>(itemFromIndex(request.parent));
-    
-    // Start async loading
-    QFuture<QList<QPair<QString, bool>>> future = QtConcurrent::run([path = request.path]() {
-        QList<QPair<QString, bool>> entries;
-        QDir dir(path);
-        QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot);
-        
-        while (it.hasNext()) {
-            it.next();
-            entries.append({it.fileName(), it.fileInfo().isDir()});
-            
-            // Process events to keep UI responsive
-            QApplication::processEvents();
-        }
-        return entries;
+    // Folders whose cancelled scan is still winding down wait for it to end
+    QQueue<QString> waiting;
+    while (!m_loadQueue.isEmpty() && m_scans.size() < m_maxConcurrentLoads) {
+        const QString path = m_loadQueue.dequeue();
+        if (m_scans.contains(path)) {
+            waiting.enqueue(path);
+            continue;
+        }
+        LazyDocumentItem *item = itemForPath(path);
+        if (item && item->type == LazyDocumentItem::Folder && !item->isLoaded()) {
+            startScan(path, false);
+        }
+    }
+    while (!m_loadQueue.isEmpty()) {
+        waiting.enqueue(m_loadQueue.dequeue());
+    }
+    m_loadQueue = waiting;
+}
+
+void LazyDocumentModel::startScan(const QString &path, bool prefetch)
+{
+    Scan scan;
+    scan.watcher = new QFutureWatcher<Listing>(this);
+    scan.cancelled = std::make_shared<std::atomic_bool>(false);
+    scan.prefetch = prefetch;
+    m_scans.insert(path, scan);
+
+    connect(scan.watcher, &QFutureWatcher<Listing>::finished, this, [this, path]() {
+        onScanFinished(path);
     });
-    
-    m_watcher->setFuture(future);
-}
-
-void LazyDocumentModel::onLoadingFinished()
-{
-    QList<QPair<QString, bool>> entries = m_watcher->result();
-    LazyDocumentItem *parentItem = static_cast<LazyDocumentItem*>(itemFromIndex(m_loadQueue.head().parent));
-    
-    if (!parentItem)
-        return;
-        
-    beginInsertRows(m_loadQueue.head().parent, 0, entries.size() - 1);
-    
-    for (const auto &entry : entries) {
-        const QString &name = entry.first;
-        bool isDir = entry.second;
-        
-        LazyDocumentItem *item = new LazyDocumentItem(
-            isDir ? LazyDocumentItem::Folder : LazyDocumentItem::Document,
-            name,
-            parentItem
-        );
-        item->path = QDir(parentItem->path).filePath(name);
-        parentItem->appendChild(item);
-    }
-    
-    parentItem->setLoaded(true);
-    endInsertRows();
-    
-    // Process next batch if there are more items in queue
-    if (!m_loadQueue.isEmpty()) {
-        m_loadTimer.start(m_loadDelay);
+
+    CancelFlag cancelled = scan.cancelled;
+    DirectoryMetadataCache *cache = &m_metadataCache;
+    scan.watcher->setFuture(QtConcurrent::run([path, cache, cancelled]() {
+        return listDirectory(path, cache, cancelled);
+    }));
+}
+
+void LazyDocumentModel::onScanFinished(const QString &path)
+{
+    const Scan scan = m_scans.take(path);
+    scan.watcher->deleteLater();
+
+    if (!scan.cancelled->load()) {
+        const Listing listing = scan.watcher->result();
+
+        // The folder may have been listed synchronously, removed, renamed or
+        // reset away while the scan was running
+        LazyDocumentItem *item = itemForPath(listing.path);
+        if (item && item->type == LazyDocumentItem::Folder && !item->isLoaded()) {
+            if (scan.prefetch) {
+                m_prefetched.insert(listing.path, listing);
+            } else {
+                populateInBatches(item, listing);
+            }
+        }
     }
-}
\ No newline at end of file
+
+    processLoadQueue();
+    scheduleIdleWork();
+}
+
+void LazyDocumentModel::populateInBatches(LazyDocumentItem *parent, const Listing &listing)
+{
+    PendingRows pending;
+    pending.entries = orderedEntries(listing);
+    pending.emptyDirectories = listing.emptyDirectories;
+    parent->setLoaded(true);
+
+    if (pending.entries.isEmpty()) {
+        iconChanged(parent);
+        return;
+    }
+
+    m_pendingRows.insert(parent, pending);
+    m_pendingOrder.append(parent);
+
+    // The first batch goes in right away so the folder opens with rows
+    insertBatch(parent, m_batchSize);
+    if (!m_pendingOrder.isEmpty() && !m_batchTimer.isActive()) {
+        m_batchTimer.start();
+    }
+}
+
+void LazyDocumentModel::insertBatch(LazyDocumentItem *parent, int count)
+{
+    auto it = m_pendingRows.find(parent);
+    if (it == m_pendingRows.end())
+        return;
+
+    PendingRows &pending = it.value();
+    const int end = int(qMin<qint64>(qint64(pending.next) + count, pending.entries.size()));
+    QList<LazyDocumentItem*> items;
+    items.reserve(end - pending.next);
+    for (; pending.next < end; ++pending.next) {
+        const QFileInfo &info = pending.entries.at(pending.next);
+        // Added through addPath() or a move while waiting
+        if (m_itemsByPath.contains(QDir::cleanPath(info.absoluteFilePath())))
+            continue;
+        items << createItem(info, !pending.emptyDirectories.contains(info.fileName()));
+    }
+
+    // Done with the pending entry before any signal is emitted
+    if (pending.next >= pending.entries.size()) {
+        m_pendingRows.erase(it);
+        m_pendingOrder.removeOne(parent);
+    }
+
+    const int first = parent->childCount();
+    if (!items.isEmpty()) {
+        beginInsertRows(indexForItem(parent), first, first + items.size() - 1);
+        for (LazyDocumentItem *item : std::as_const(items)) {
+            parent->appendChild(item);
+            m_itemsByPath.insert(item->path, item);
+        }
+        endInsertRows();
+    }
+
+    // The icon tells empty folders apart, which is only known at the end
+    if (first == firstEntryRow(parent) || !m_pendingRows.contains(parent))
+        iconChanged(parent);
+}
+
+void LazyDocumentModel::insertNextBatch()
+{
+    if (m_pendingOrder.isEmpty()) {
+        scheduleIdleWork();
+        return;
+    }
+
+    // Round robin, so one huge folder does not hold up the others
+    LazyDocumentItem *parent = m_pendingOrder.takeFirst();
+    m_pendingOrder.append(parent);
+    insertBatch(parent, m_batchSize);
+
+    if (!m_pendingOrder.isEmpty()) {
+        m_batchTimer.start();
+    } else {
+        scheduleIdleWork();
+    }
+}
+
+void LazyDocumentModel::flushPendingRows(DocumentItem *parent)
+{
+    LazyDocumentItem *item = static_cast<LazyDocumentItem*>(parent);
+    if (item && m_pendingRows.contains(item))
+        insertBatch(item, std::numeric_limits<int>::max());
+}
+
+void LazyDocumentModel::flushPendingRowsFor(const QString &path)
+{
+    flushPendingRows(itemForPath(QFileInfo(path).absolutePath()));
+}
+
+bool LazyDocumentModel::isEmptyFolder(LazyDocumentItem *item) const
+{
+    if (!item->isLoaded())
+        return !item->hasChildrenHint();
+    return item->childCount() == 0 && !m_pendingRows.contains(item);
+}
+
+void LazyDocumentModel::queueSiblingPrefetch(DocumentItem *item)
+{
+    if (!m_prefetchEnabled || !m_lazyLoadingEnabled)
+        return;
+
+    DocumentItem *parent = item->parent();
+    if (!parent)
+        return;
+
+    for (int row = firstEntryRow(parent); row < parent->childCount(); ++row) {
+        LazyDocumentItem *sibling = static_cast<LazyDocumentItem*>(parent->child(row));
+        if (sibling == item || sibling->type != LazyDocumentItem::Folder
+            || sibling->isLoaded() || !sibling->hasChildrenHint()) {
+            continue;
+        }
+        if (!m_prefetchQueue.contains(sibling->path) && !m_prefetched.contains(sibling->path)) {
+            m_prefetchQueue.enqueue(sibling->path);
+        }
+    }
+    scheduleIdleWork();
+}
+
+void LazyDocumentModel::scheduleIdleWork()
+{
+    if (!m_prefetchEnabled || m_prefetchQueue.isEmpty())
+        return;
+    if (!m_loadQueue.isEmpty() || !m_scans.isEmpty() || !m_pendingOrder.isEmpty())
+        return;
+
+    m_idleTimer.start();
+}
+
+void LazyDocumentModel::startPrefetch()
+{
+    // Anything the view asks for goes first
+    if (!m_loadQueue.isEmpty() || !m_scans.isEmpty() || !m_pendingOrder.isEmpty())
+        return;
+
+    while (!m_prefetchQueue.isEmpty() && m_prefetched.size() < MAX_PREFETCHED_LISTINGS) {
+        const QString path = m_prefetchQueue.dequeue();
+        LazyDocumentItem *item = itemForPath(path);
+        if (item && item->type == LazyDocumentItem::Folder && !item->isLoaded()) {
+            // One at a time; the next one starts when this one is done
+            startScan(path, true);
+            return;
+        }
+    }
+}
+
+bool LazyDocumentModel::takePrefetched(LazyDocumentItem *item, Listing *listing)
+{
+    auto it = m_prefetched.find(item->path);
+    if (it == m_prefetched.end())
+        return false;
+
+    const Listing prefetched = it.value();
+    m_prefetched.erase(it);
+
+    // Changed since it was listed
+    if (prefetched.modified != modifiedTime(item->path))
+        return false;
+
+    *listing = prefetched;
+    return true;
+}
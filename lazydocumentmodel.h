@@ -2,47 +2,145 @@
 #define LAZYDOCUMENTMODEL_H
 
 #include "documentmodel.h"
+#include "directorymetadatacache.h"
+#include <QFileInfo>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QQueue>
+#include <QSet>
 #include <QTimer>
-#include <QThread>
+#include <atomic>
+#include <functional>
+#include <memory>
+
 
 class LazyDocumentItem : public DocumentItem {
 public:
     explicit LazyDocumentItem(Type type, const QString &title, DocumentItem *parent = nullptr);
-    
+
     bool isLoaded() const { return m_loaded; }
     void setLoaded(bool loaded) { m_loaded = loaded; }
-    
+
+    // Whether an unloaded folder has entries, as seen when its parent was listed
+    bool hasChildrenHint() const { return m_hasChildrenHint; }
+    void setChildrenHint(bool hasChildren) { m_hasChildrenHint = hasChildren; }
+
+    // Virtual items (the Recent Files section) are not part of the directory tree
+    bool isVirtual() const { return m_virtual; }
+    void setVirtual(bool isVirtual) { m_virtual = isVirtual; }
+
 private:
     bool m_loaded = false;
+    bool m_hasChildrenHint = true;
+    bool m_virtual = false;
 };
 
+// Tree model over a notes directory.
+//
+// Folders are listed when they are first expanded (canFetchMore/fetchMore);
+// everything after that is kept up to date through fine-grained row
+// insertions, removals and moves, so a create, rename, delete or drag only
+// touches the rows involved instead of rebuilding the tree. Items are found
+// by absolute path through a hash, not by walking the tree.
+//
+// Listing runs on worker threads, a few folders at a time. The rows of a
+// big folder are inserted in batches from the event loop, a scan is
+// cancelled when its folder is collapsed before it finishes, and while
+// nothing else is loading the siblings of expanded folders are listed
+// ahead of time so they open without waiting.
 class LazyDocumentModel : public DocumentModel {
     Q_OBJECT
-    
+
 public:
+    enum Roles {
+        PathRole = Qt::UserRole,
+        FolderRole,
+        ExpandedRole
+    };
+
+    // Orders (and may rename) the raw listing of a directory. Called on the
+    // model's thread after the listing has been read.
+    using EntryOrderer = std::function<QFileInfoList(const QString &directory, const QFileInfoList &entries)>;
+
     explicit LazyDocumentModel(QObject *parent = nullptr);
     ~LazyDocumentModel();
-    
+
     // Override data loading
     bool loadFromFile(const QString &filePath);
-    
+
+    // Resets the model to the given directory; its first level is listed
+    // right away, everything below on demand
+    bool setRootPath(const QString &path);
+    QString rootPath() const;
+    void setEntryOrderer(EntryOrderer orderer) { m_orderer = std::move(orderer); }
+
     // Lazy loading control
     void setLazyLoadingEnabled(bool enabled);
     void setLoadBatchSize(int size);
     void setLoadDelay(int msecs);
-    
+    void setMaxConcurrentLoads(int count);
+    void setPrefetchEnabled(bool enabled);
+
+    // Lists a folder synchronously if it has not been loaded yet, and
+    // inserts any of its rows still waiting for their batch
+    void ensureLoaded(const QModelIndex &parent);
+    bool isLoaded(const QModelIndex &parent) const;
+    // Drops a queued or running scan of the folder; it is listed again the
+    // next time it is fetched
+    void cancelLoad(const QString &path);
+
+    // Lookups
+    QModelIndex indexForPath(const QString &path) const;
+    bool isFolder(const QModelIndex &index) const;
+    bool isVirtual(const QModelIndex &index) const;
+    // File names of the directory entries under parent, in display order
+    QStringList childNames(const QModelIndex &parent) const;
+
+    // Incremental updates. Paths below a folder that has not been loaded yet
+    // only update that folder's expander; they show up once it is listed.
+    QModelIndex addPath(const QString &path, int row = -1);
+    bool removePath(const QString &path);
+    QModelIndex renamePath(const QString &oldPath, const QString &newPath);
+    QModelIndex movePath(const QString &path, const QString &newParentPath, int row = -1);
+    // Re-lists one loaded directory and applies the difference as row changes
+    void refreshDirectory(const QString &path);
+    // The entries of path changed on disk (see NotesWatcher); drops its
+    // cached entry count. The counts of the folders inside it are checked
+    // against their mtime when next asked for.
+    void directoryChangedOnDisk(const QString &path);
+
+    // Items shown in bold, e.g. search hits
+    void setEmphasizedPaths(const QSet<QString> &paths);
+
+    // Recent Files section, shown as the first top-level row when visible
+    void setRecentFiles(const QStringList &paths);
+    void setRecentFilesVisible(bool visible);
+    QModelIndex recentFilesIndex() const;
+
+    static QString displayNameFor(const QFileInfo &info);
+    static bool isDividerPath(const QString &path);
+
     // Overridden model methods
+    QVariant data(const QModelIndex &index, int role) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
     bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
     bool canFetchMore(const QModelIndex &parent) const override;
     void fetchMore(const QModelIndex &parent) override;
-    
+
+    QStringList mimeTypes() const override;
+    QMimeData *mimeData(const QModelIndexList &indexes) const override;
+    bool canDropMimeData(const QMimeData *data, Qt::DropAction action,
+                         int row, int column, const QModelIndex &parent) const override;
+    Qt::DropActions supportedDragActions() const override { return Qt::MoveAction; }
+    Qt::DropActions supportedDropActions() const override { return Qt::MoveAction; }
+
 private slots:
-    void onLoadingFinished();
     void processLoadQueue();
-    
+    void insertNextBatch();
+    void startPrefetch();
+
 protected:
     // Helper to set the root item
     void setRootItem(DocumentItem* item) { m_rootItem = item; }
@@ -52,29 +150,92 @@ protected:
     }
 
 private:
-    struct LoadRequest {
-        QModelIndex parent;
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    struct Listing {
         QString path;
-        bool operator==(const LoadRequest &other) const {
-            return parent == other.parent && path == other.path;
-        }
+        QFileInfoList entries;
+        QSet<QString> emptyDirectories; // File names
+        qint64 modified = 0; // Of the directory, when it was listed
+    };
+
+    struct Scan {
+        QFutureWatcher<Listing> *watcher = nullptr;
+        CancelFlag cancelled;
+        bool prefetch = false;
+    };
+
+    // Rows of a listed folder still waiting to be inserted
+    struct PendingRows {
+        QFileInfoList entries; // Ordered
+        QSet<QString> emptyDirectories;
+        int next = 0;
     };
-    
-    void queueLoad(const QModelIndex &parent, const QString &path);
-    void loadChildren(const QString &path, LazyDocumentItem *parent);
-    void startNextBatch();
-    
+
+    static Listing listDirectory(const QString &path, DirectoryMetadataCache *cache,
+                                 const CancelFlag &cancelled = CancelFlag());
+    static qint64 modifiedTime(const QString &path);
+
+    LazyDocumentItem *itemForPath(const QString &path) const;
+    QModelIndex indexForItem(DocumentItem *item) const;
+    int firstEntryRow(DocumentItem *parent) const;
+    LazyDocumentItem *createItem(const QFileInfo &info, bool hasChildren) const;
+    QFileInfoList orderedEntries(const Listing &listing) const;
+    void populate(LazyDocumentItem *parent, const Listing &listing, bool notify);
+    void populateInBatches(LazyDocumentItem *parent, const Listing &listing);
+    void insertBatch(LazyDocumentItem *parent, int count);
+    void flushPendingRows(DocumentItem *parent);
+    void flushPendingRowsFor(const QString &path);
+    bool isEmptyFolder(LazyDocumentItem *item) const;
+    void iconChanged(DocumentItem *item);
+    void subtreeIconsChanged(DocumentItem *parent);
+    void forgetSubtree(DocumentItem *item);
+    void rebaseSubtree(DocumentItem *item, const QString &oldPrefix, const QString &newPrefix);
+    void forgetFolderMetadata(LazyDocumentItem *item);
+    LazyDocumentItem *createRecentFilesSection() const;
+    void queueLoad(const QString &path);
+    void startScan(const QString &path, bool prefetch);
+    void onScanFinished(const QString &path);
+    void queueSiblingPrefetch(DocumentItem *item);
+    void scheduleIdleWork();
+    bool takePrefetched(LazyDocumentItem *item, Listing *listing);
+    void cancelAllLoads();
+
     bool m_lazyLoadingEnabled;
     int m_batchSize;
     int m_loadDelay;
-    
-    QQueue<LoadRequest> m_loadQueue;
+    EntryOrderer m_orderer;
+
+    QHash<QString, LazyDocumentItem*> m_itemsByPath;
+    QSet<QString> m_emphasized;
+    LazyDocumentItem *m_recentFilesItem = nullptr;
+    QStringList m_recentFiles;
+    bool m_recentFilesVisible = false;
+
+    // Shared with the listing workers, which the destructor waits for
+    DirectoryMetadataCache m_metadataCache;
+
+    // Scans asked for by the view, in order
+    QQueue<QString> m_loadQueue;
     QTimer m_loadTimer;
-    QFutureWatcher<QList<QPair<QString, bool>>> *m_watcher;
-    QThread m_loaderThread;
-    
+    int m_maxConcurrentLoads;
+    QHash<QString, Scan> m_scans; // Running, by folder path
+
+    QHash<LazyDocumentItem*, PendingRows> m_pendingRows;
+    QList<LazyDocumentItem*> m_pendingOrder; // Folders take turns per batch
+    QTimer m_batchTimer;
+
+    // Speculative scans, only started while nothing else is loading
+    bool m_prefetchEnabled = true;
+    QQueue<QString> m_prefetchQueue;
+    QHash<QString, Listing> m_prefetched;
+    QTimer m_idleTimer;
+
     static const int DEFAULT_BATCH_SIZE = 50;
     static const int DEFAULT_LOAD_DELAY = 100; // ms
+    static const int DEFAULT_MAX_CONCURRENT_LOADS = 4;
+    static const int PREFETCH_IDLE_DELAY = 400; // ms
+    static const int MAX_PREFETCHED_LISTINGS = 64;
 };
 
-#endif // LAZYDOCUMENTMODEL_H
\ No newline at end of file
+#endif // LAZYDOCUMENTMODEL_H
@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "startuptracer.h"
 
 #include <QApplication>
 #include <QLocale>
@@ -6,17 +7,32 @@
 #include <QFontDatabase>
 #include <QDebug>
 
+static void loadItalicFont()
+{
+    StartupTracer::Scope trace("italic font");
+    int fontIdItalic = QFontDatabase::addApplicationFont(":/resources/fonts/NunitoSans-Italic-Variable.ttf");
+    if (fontIdItalic == -1) {
+        qWarning() << "Failed to load italic font variant.";
+    } else {
+        QStringList italicFamilies = QFontDatabase::applicationFontFamilies(fontIdItalic);
+        if (!italicFamilies.isEmpty()) {
+            qDebug() << "Loaded italic font family:" << italicFamilies.at(0);
+        }
+    }
+}
 
 int main(int argc, char *argv[])
 {
+    StartupTracer::mark("main");
     QApplication a(argc, argv);
+    StartupTracer::mark("QApplication");
 
     // Attempt to load a bundled custom font. Place your TTF in the resource path
     // (e.g. ":/fonts/NunitoSans-Regular.ttf") or adjust the path accordingly.
     // Resource paths use the full path as listed in resources.qrc (files are
     // under resources/fonts/). Use those resource paths here.
+    const qint64 fontsStart = StartupTracer::now();
     int fontId = QFontDatabase::addApplicationFont(":/resources/fonts/NunitoSans-Variable.ttf");
-    int fontIdItalic = QFontDatabase::addApplicationFont(":/resources/fonts/NunitoSans-Italic-Variable.ttf");
     QString nunitoSansFamily;
     if (fontId != -1) {
         QStringList familyNames = QFontDatabase::applicationFontFamilies(fontId);
@@ -29,14 +45,13 @@ int main(int argc, char *argv[])
         qWarning() << "Failed to load custom font. If you want a bundled font, add it to resources.qrc under :/fonts/";
     }
 
-    if (fontIdItalic == -1) {
-        qWarning() << "Failed to load italic font variant.";
-    } else {
-        QStringList italicFamilies = QFontDatabase::applicationFontFamilies(fontIdItalic);
-        if (!italicFamilies.isEmpty()) {
-            qDebug() << "Loaded italic font family:" << italicFamilies.at(0);
-        }
+    // Nothing shown at startup is italic; in deferred mode that variable font
+    // is only registered once the window is up
+    const bool deferred = MainWindow::deferredInitializationEnabled();
+    if (!deferred) {
+        loadItalicFont();
     }
+    StartupTracer::complete("fonts", fontsStart, StartupTracer::now());
 
     QTranslator translator;
     const QStringList uiLanguages = QLocale::system().uiLanguages();
@@ -50,6 +65,12 @@ int main(int argc, char *argv[])
     // (startup diagnostics removed)
 
     MainWindow w;
-    w.show();
+    if (deferred) {
+        QObject::connect(&w, &MainWindow::firstFrameShown, &loadItalicFont);
+    }
+    {
+        StartupTracer::Scope trace("show");
+        w.show();
+    }
     return a.exec();
 }
@@ -4,8 +4,14 @@
 #include "filebrowser.h"
 #include "thememanager.h"
 #include "titlebarwidget.h"
+#include "documentloader.h"
+#include "editjournal.h"
+#include "noteformat.h"
+#include "searchindex.h"
+#include "backupengine.h"
 
 #include <QMenu>
+#include <QLineEdit>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDir>
@@ -100,10 +106,62 @@ MainView::MainView(QWidget *parent)
                 this, &MainView::onFileSaved);
         connect(m_textEditor, &TextEditor::modificationChanged,
                 this, &MainView::onEditorModified);
+        connect(m_textEditor, &TextEditor::saveFailed,
+                this, [this](const QString &filePath, const QString &error) {
+            QFileInfo fi(filePath);
+            updateStatusBar(tr("Failed to save %1: %2").arg(fi.fileName(), error), 4000);
+        });
+    }
+
+    m_documentLoader = new DocumentLoader(this);
+    connect(m_documentLoader, &DocumentLoader::loadFinished,
+            this, &MainView::onDocumentLoaded);
+    connect(m_documentLoader, &DocumentLoader::loadFailed,
+            this, &MainView::onDocumentLoadFailed);
+
+    m_searchIndex = new SearchIndex(this);
+    connect(m_searchIndex, &SearchIndex::indexChanged, this, [this]() {
+        // Keep visible results in step with the index while it fills up
+        if (!m_searchEdit->text().trimmed().isEmpty()) {
+            m_searchTimer->start();
+        }
+    });
+    connect(m_searchIndex, &SearchIndex::indexingFinished, this, [this](int documentCount) {
+        updateStatusBar(tr("Search index ready: %n note(s)", nullptr, documentCount), 2000);
+    });
+    if (m_fileBrowser) {
+        connect(m_fileBrowser, &FileBrowser::fileCreated, m_searchIndex, &SearchIndex::updateFile);
+        connect(m_fileBrowser, &FileBrowser::fileDeleted, m_searchIndex, &SearchIndex::removePath);
+        connect(m_fileBrowser, &FileBrowser::fileRenamed, m_searchIndex, &SearchIndex::renamePath);
+        connect(m_fileBrowser, &FileBrowser::fileRestored, m_searchIndex, &SearchIndex::updateFile);
+        connect(m_fileBrowser, &FileBrowser::notesChangedOnDisk,
+                m_searchIndex, &SearchIndex::applyExternalChanges);
+        connect(m_fileBrowser, &FileBrowser::fileModified, this, &MainView::onFileModifiedOnDisk);
+        connect(m_fileBrowser, &FileBrowser::fileAboutToBeRestored, this, [this](const QString &path) {
+            // An autosave of the open note landing after the restore would
+            // overwrite it
+            if (m_textEditor && QFileInfo(path).absoluteFilePath() == QFileInfo(m_currentFile).absoluteFilePath()) {
+                m_textEditor->abandonPendingSaves();
+            }
+        });
+        connect(m_fileBrowser, &FileBrowser::fileRestored, this, [this](const QString &path) {
+            // Show the restored version if that note is open
+            if (m_textEditor && QFileInfo(path).absoluteFilePath() == QFileInfo(m_currentFile).absoluteFilePath()) {
+                // Journaled edits belong to the replaced version
+                m_textEditor->discardJournal();
+                m_textEditor->setModified(false);
+                loadFile(path);
+            }
+        });
     }
 
     // Set initial directory
     setRootDirectory(m_rootDirectory);
+    applyEditorSettings();
+
+    // Reopen a note whose edits were journaled but never saved (e.g. the app
+    // was killed); the replay itself happens once the note has loaded.
+    QTimer::singleShot(0, this, &MainView::recoverUnsavedNotes);
     
     // Show the window after everything is set up
     show();
@@ -250,6 +308,10 @@ void MainView::closeEvent(QCloseEvent *event)
 {
     // Check for unsaved changes before closing
     if (promptSaveIfModified()) {
+        // Saves run in the background; make sure they land before exiting
+        if (m_textEditor) {
+            m_textEditor->waitForPendingSaves();
+        }
         event->accept();  // Allow the window to close
     } else {
         event->ignore();  // User cancelled, don't close
@@ -273,8 +335,32 @@ void MainView::setupUI()
     m_sidebarLayout = new QVBoxLayout(m_sidebar);
     m_sidebarLayout->setContentsMargins(0, 0, 0, 0);
     m_sidebarLayout->setSpacing(0);
+
+    // Search bar above the tree; hits are shown by filtering the tree
+    m_searchEdit = new QLineEdit(m_sidebar);
+    m_searchEdit->setPlaceholderText(tr("Search notes"));
+    m_searchEdit->setClearButtonEnabled(true);
+    m_sidebarLayout->addWidget(m_searchEdit);
     m_sidebarLayout->addWidget(m_fileBrowser);
 
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(150);
+    connect(m_searchTimer, &QTimer::timeout, this, &MainView::runSearch);
+    connect(m_searchEdit, &QLineEdit::textChanged, m_searchTimer, qOverload<>(&QTimer::start));
+    connect(m_searchEdit, &QLineEdit::returnPressed, this, &MainView::openFirstSearchHit);
+
+    QAction *findAction = new QAction(tr("Search Notes"), this);
+    findAction->setShortcut(QKeySequence::Find);
+    addAction(findAction);
+    connect(findAction, &QAction::triggered, this, [this]() {
+        if (!m_sidebarVisible) {
+            toggleSidebar(true);
+        }
+        m_searchEdit->setFocus();
+        m_searchEdit->selectAll();
+    });
+
     // Create text editor with proper flexbox-like behavior
 
     m_textEditor = new TextEditor(this);
@@ -408,7 +494,7 @@ void MainView::setupMenus()
         updateStatusBar("Opening file dialog...", 1000);
         QString fileName = QFileDialog::getOpenFileName(this,
             "Open Document", m_fileBrowser->currentDirectory(),
-            "HTML files (*.html);;Text files (*.txt);;All files (*.*)");
+            "HTML files (*.html);;Text files (*.txt);;Markdown files (*.md *.markdown);;All files (*.*)");
         if (!fileName.isEmpty()) {
             QFileInfo fi(fileName);
             updateStatusBar("Opening file: " + fi.fileName(), 2000);
@@ -873,6 +959,10 @@ void MainView::setRootDirectory(const QString &path)
 {
     m_rootDirectory = path;
     m_fileBrowser->setRootDirectory(path);
+    if (m_searchIndex) {
+        m_searchIndex->setRootDirectory(path);
+    }
+    BackupEngine::instance()->setSourcePath(path);
     
     // Also update the text editor's default save directory
     if (m_textEditor) {
@@ -880,6 +970,15 @@ void MainView::setRootDirectory(const QString &path)
     }
 }
 
+void MainView::applyEditorSettings()
+{
+    if (!m_textEditor) return;
+
+    QSettings settings("QuteNote", "QuteNote");
+    m_textEditor->setAutosaveDelay(settings.value("autoSaveDelay", 2000).toInt());
+    m_textEditor->setAutosaveEnabled(settings.value("autoSave", false).toBool());
+}
+
 void MainView::toggleSidebar(bool visible)
 {
     if (m_sidebarVisible == visible) {
@@ -1169,6 +1268,12 @@ void MainView::saveFile()
         updateStatusBar("Error: Text editor not available", 2000);
         return;
     }
+
+    // The editor only holds a placeholder until the pending load completes
+    if (m_documentLoader->isLoading()) {
+        updateStatusBar(tr("Please wait, the note is still loading"), 2000);
+        return;
+    }
     
     if (m_currentFile.isEmpty()) {
         // For new files, create filename from title bar and save to notes directory
@@ -1183,8 +1288,7 @@ void MainView::saveFile()
         }
         
         // Ensure we have a proper extension
-        if (!filename.endsWith(".txt", Qt::CaseInsensitive) && 
-            !filename.endsWith(".html", Qt::CaseInsensitive)) {
+        if (!QuteNote::hasNoteExtension(filename)) {
             filename += ".txt";
         }
         
@@ -1208,34 +1312,20 @@ void MainView::saveFile()
             }
         }
         
-        QFile file(fullPath);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(m_textEditor->getContent().toUtf8());
-            file.close();
-            m_currentFile = fullPath;
-            m_textEditor->setFilePath(fullPath);
-            m_textEditor->setModified(false);
-            // Reflect saved name in the title bar widget
-            if (m_titleBarWidget) {
-                QFileInfo fi(fullPath);
-                m_titleBarWidget->setFilename(fi.fileName());
-            }
-            updateWindowTitle();
-            emit fileSaved(m_currentFile);
-            
-            // Update status bar
-            updateStatusBar("File saved: " + filename, 2000);
-        } else {
-            // Update status bar with error
-            updateStatusBar("Failed to save file: " + filename, 2000);
+        // The editor snapshots the document and writes it in the background;
+        // completion is reported through TextEditor::fileSaved.
+        m_currentFile = fullPath;
+        m_refreshTreeOnSave = true;
+        m_textEditor->setFilePath(fullPath);
+        m_textEditor->saveDocument();
+        // Reflect saved name in the title bar widget
+        if (m_titleBarWidget) {
+            QFileInfo fi(fullPath);
+            m_titleBarWidget->setFilename(fi.fileName());
         }
+        updateWindowTitle();
     } else {
         m_textEditor->saveDocument();
-        emit fileSaved(m_currentFile);
-        
-        // Update status bar
-        QFileInfo fi(m_currentFile);
-        updateStatusBar("File saved: " + fi.fileName(), 2000);
     }
 }
 
@@ -1245,6 +1335,14 @@ bool MainView::promptSaveIfModified()
     if (!m_textEditor || !m_textEditor->isModified()) {
         return true;
     }
+
+    // With autosave on, an existing note is flushed silently instead of asking.
+    // Saves only count once written, so wait for this one before moving on.
+    if (m_textEditor->isAutosaveEnabled() && !m_currentFile.isEmpty()) {
+        m_textEditor->flushAutosave();
+        m_textEditor->waitForPendingSaves();
+        return !m_textEditor->isModified();
+    }
     
     // Determine the filename for the prompt
     QString filename;
@@ -1265,12 +1363,14 @@ bool MainView::promptSaveIfModified()
     );
     
     if (reply == QMessageBox::Save) {
-        // Save the file
+        // Save the file and wait for the write, which clears the modified
+        // flag only if it succeeded
         saveFile();
-        // Check if save was successful (file might still be modified if save failed)
+        m_textEditor->waitForPendingSaves();
         return !m_textEditor->isModified();
     } else if (reply == QMessageBox::Discard) {
-        // User wants to discard changes
+        // User wants to discard changes, including the crash-recovery copy
+        m_textEditor->discardJournal();
         return true;
     } else {
         // User cancelled
@@ -1287,24 +1387,78 @@ void MainView::loadFile(const QString &filePath)
         return; // User cancelled the operation
     }
     
-    QFile file(filePath);
-    if (file.open(QIODevice::ReadOnly)) {
-        QByteArray data = file.readAll();
-        m_textEditor->setContent(QString::fromUtf8(data));
-        file.close();
-        
-        m_currentFile = filePath;
-        m_textEditor->setFilePath(filePath);
+    // Reading and parsing happen on a worker thread; a newer request simply
+    // supersedes whatever is still in flight.
+    QFileInfo info(filePath);
+    m_textEditor->showLoadingPlaceholder(info.fileName());
+    m_documentLoader->load(filePath);
+    updateStatusBar(tr("Loading %1...").arg(info.fileName()), 0);
+}
+
+void MainView::onDocumentLoaded(const QString &filePath, QTextDocument *document)
+{
+    if (!m_textEditor) {
+        delete document;
+        return;
+    }
+
+    m_textEditor->adoptDocument(document);
+
+    m_currentFile = filePath;
+    rememberCurrentFileOnDisk();
+    m_textEditor->setFilePath(filePath);
+    m_textEditor->setModified(false);
+    const int recovered = m_textEditor->recoverFromJournal();
+    // Update the title bar with the selected file's name
+    QFileInfo info(filePath);
+    if (m_titleBarWidget) {
+        m_titleBarWidget->setFilename(info.fileName());
+    }
+    updateWindowTitle();
+    if (recovered > 0) {
+        updateStatusBar(tr("Recovered unsaved changes in %1").arg(info.fileName()), 4000);
+    } else {
+        updateStatusBar(tr("Opened %1").arg(info.fileName()), 1500);
+    }
+
+    // Opened from a search: jump to the first match
+    const auto hit = m_searchHitPositions.constFind(filePath);
+    if (hit != m_searchHitPositions.constEnd() && !m_searchEdit->text().trimmed().isEmpty()) {
+        const auto terms = SearchIndex::tokenize(m_searchEdit->text(), 1);
+        m_textEditor->revealPosition(hit->first, hit->second, terms.isEmpty() ? 0 : terms.first().first.size());
+    }
+
+    emit fileOpened(filePath);
+}
+
+void MainView::recoverUnsavedNotes()
+{
+    // Only the most recently edited note is reopened; any other note with a
+    // journal is recovered whenever it is next opened.
+    const QStringList pending = EditJournal::notesWithPendingEdits();
+    if (pending.isEmpty() || !m_currentFile.isEmpty() || m_documentLoader->isLoading()) {
+        return;
+    }
+    loadFile(pending.first());
+}
+
+void MainView::onDocumentLoadFailed(const QString &filePath, const QString &error)
+{
+    if (m_textEditor) {
+        m_textEditor->clearLoadingPlaceholder();
+    }
+
+    // The editor no longer shows the previous note, so don't let a later
+    // save write the empty buffer over it.
+    m_currentFile.clear();
+    if (m_textEditor) {
+        m_textEditor->setFilePath("");
         m_textEditor->setModified(false);
-        // Update the title bar with the selected file's name
-        if (m_titleBarWidget) {
-            QFileInfo info(filePath);
-            m_titleBarWidget->setFilename(info.fileName());
-        }
-        updateWindowTitle();
-        
-        emit fileOpened(filePath);
     }
+    updateWindowTitle();
+
+    QFileInfo info(filePath);
+    updateStatusBar(tr("Unable to open %1: %2").arg(info.fileName(), error), 4000);
 }
 
 void MainView::newFile()
@@ -1314,6 +1468,12 @@ void MainView::newFile()
         return; // User cancelled the operation
     }
     
+    // Drop any note that is still loading in the background
+    m_documentLoader->cancel();
+    if (m_textEditor) {
+        m_textEditor->clearLoadingPlaceholder();
+    }
+
     // Clear the current file path and content
     m_currentFile.clear();
     
@@ -1359,11 +1519,60 @@ void MainView::onFileSelected(const QString &filePath)
 void MainView::onFileSaved(const QString &filePath)
 {
     m_currentFile = filePath;
+    rememberCurrentFileOnDisk();
     updateWindowTitle();
     emit fileSaved(filePath);
 
-    // Refresh file browser to show any changes
-    m_fileBrowser->populateTree();
+    QFileInfo fi(filePath);
+    updateStatusBar("File saved: " + fi.fileName(), 2000);
+    m_searchIndex->updateFile(filePath);
+
+    // Only a newly created file changes the tree; autosaves and re-saves of
+    // an existing note must not touch it. Its folder is re-read on its own.
+    if (m_refreshTreeOnSave) {
+        m_refreshTreeOnSave = false;
+        m_fileBrowser->refreshDirectory(fi.absolutePath());
+    }
+}
+
+void MainView::rememberCurrentFileOnDisk()
+{
+    const QFileInfo info(m_currentFile);
+    m_currentFileModified = info.exists() ? info.lastModified() : QDateTime();
+    m_currentFileSize = info.exists() ? info.size() : -1;
+}
+
+void MainView::onFileModifiedOnDisk(const QString &filePath)
+{
+    if (!m_textEditor || m_currentFile.isEmpty()
+            || QFileInfo(filePath).absoluteFilePath() != QFileInfo(m_currentFile).absoluteFilePath()) {
+        return;
+    }
+    // Our own saves come back through the watcher too
+    const QFileInfo info(m_currentFile);
+    if (m_textEditor->isSaving() || !info.exists()
+            || (info.lastModified() == m_currentFileModified && info.size() == m_currentFileSize)) {
+        return;
+    }
+    rememberCurrentFileOnDisk();
+
+    const QString fileName = info.fileName();
+    if (m_textEditor->isModified()) {
+        const QMessageBox::StandardButton reply = QMessageBox::question(
+            this,
+            tr("Note Changed on Disk"),
+            tr("'%1' was changed outside QuteNote. Reload it and discard your changes?").arg(fileName),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::No);
+        if (reply != QMessageBox::Yes) {
+            // The next save writes the edited version over it
+            return;
+        }
+        m_textEditor->abandonPendingSaves();
+        m_textEditor->discardJournal();
+        m_textEditor->setModified(false);
+    }
+    loadFile(m_currentFile);
 }
 
 void MainView::onEditorModified(bool modified)
@@ -1392,3 +1601,42 @@ void MainView::updateWindowTitle()
     #endif
     }
 }
+
+void MainView::runSearch()
+{
+    const QString query = m_searchEdit->text().trimmed();
+    if (query.isEmpty()) {
+        m_searchHitPositions.clear();
+        m_fileBrowser->clearSearchResults();
+        return;
+    }
+
+    const QList<SearchIndex::Hit> hits = m_searchIndex->search(m_searchEdit->text());
+    QStringList paths;
+    paths.reserve(hits.size());
+    m_searchHitPositions.clear();
+    for (const SearchIndex::Hit &hit : hits) {
+        paths.append(hit.path);
+        m_searchHitPositions.insert(hit.path, qMakePair(hit.block, hit.offset));
+    }
+    m_fileBrowser->showSearchResults(paths);
+
+    if (m_searchIndex->isIndexing()) {
+        updateStatusBar(tr("%n matching note(s), still indexing...", nullptr, hits.size()), 2000);
+    } else {
+        updateStatusBar(tr("%n matching note(s)", nullptr, hits.size()), 2000);
+    }
+}
+
+void MainView::openFirstSearchHit()
+{
+    // Results may be a keystroke behind the text
+    if (m_searchTimer->isActive()) {
+        m_searchTimer->stop();
+        runSearch();
+    }
+    const QString path = m_fileBrowser->selectedFile();
+    if (!path.isEmpty() && m_searchHitPositions.contains(path)) {
+        onFileSelected(path);
+    }
+}
@@ -5,6 +5,9 @@
 #include <QString>
 #include <QFileSystemModel>
 #include <QResizeEvent>
+#include <QHash>
+#include <QPair>
+#include <QDateTime>
 
 // Forward declarations
 class QHBoxLayout;
@@ -24,6 +27,10 @@ class QTimer;
 class QApplication;
 class QScreen;
 class FileBrowser;
+class DocumentLoader;
+class SearchIndex;
+class QLineEdit;
+class QTextDocument;
 class QHBoxLayout;
 
 class QScrollArea;
@@ -54,6 +61,8 @@ public:
     // Allow a title widget (e.g. TitleBarWidget) to be inserted into the toolbar
     void setTitleWidget(QWidget *widget);
     void updateStatusBar(const QString &message, int timeout = 2000);
+    // Re-reads editor preferences (autosave) from the settings store
+    void applyEditorSettings();
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
@@ -75,9 +84,15 @@ Q_SIGNALS:
 private slots:
     void onEditorModified(bool modified);
     void onFileSaved(const QString &filePath);
+    void onFileModifiedOnDisk(const QString &filePath);
     void onThemeChanged(const Theme &newTheme);
     void onThemeApplyStarted();
     void onThemeApplyFinished();
+    void onDocumentLoaded(const QString &filePath, QTextDocument *document);
+    void onDocumentLoadFailed(const QString &filePath, const QString &error);
+    void recoverUnsavedNotes();
+    void runSearch();
+    void openFirstSearchHit();
 
 public:
 
@@ -128,6 +143,19 @@ private:
     QMenuBar *m_menuBar;
     QToolBar *m_toolbar;
     QTimer *m_resizeTimer;  // Timer for throttling resize updates
+    DocumentLoader *m_documentLoader = nullptr; // Parses notes off the GUI thread
+    bool m_refreshTreeOnSave = false; // Set when a save creates a new file
+    // The open note as last loaded or saved here, to tell outside edits from
+    // the watcher echoing our own saves
+    QDateTime m_currentFileModified;
+    qint64 m_currentFileSize = -1;
+    void rememberCurrentFileOnDisk();
+
+    // Full-text search over the notes directory
+    SearchIndex *m_searchIndex = nullptr;
+    QLineEdit *m_searchEdit = nullptr;
+    QTimer *m_searchTimer = nullptr;
+    QHash<QString, QPair<int, int>> m_searchHitPositions; // path -> (block, offset)
 
     // Actions
     QAction *m_newAction;
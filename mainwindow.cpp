@@ -5,6 +5,7 @@
 #include "titlebarwidget.h"
 #include "thememanager.h"
 #include "texteditor.h"
+#include "startuptracer.h"
 
 #include <QKeyEvent>
 #include <QMessageBox>
@@ -28,6 +29,12 @@
 #include <QTextStream>
 #include <QDir>
 #include <QDir>
+#include <QSettings>
+#include <QWindow>
+
+// Static member definitions
+const int MainWindow::DEFERRED_INIT_DELAY;
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
@@ -39,8 +46,13 @@ MainWindow::MainWindow(QWidget *parent)
     , m_statusBar(nullptr)
     , m_backPressCount(0)
 {
+    StartupTracer::Scope trace("MainWindow");
+
     // First set up the basic UI from the .ui file
-    m_themeManager = QuteNote::Singleton<ThemeManager>::instance();
+    {
+        StartupTracer::Scope traceTheme("ThemeManager");
+        m_themeManager = QuteNote::Singleton<ThemeManager>::instance();
+    }
     m_titleBarWidget = new TitleBarWidget(this);
     m_titleBarWidget->setThemeManager(m_themeManager);
     if (ui) {
@@ -78,8 +90,54 @@ void MainWindow::setupTouchInteraction()
     // For now, we'll just ensure the window is touch-friendly
 }
 
+bool MainWindow::deferredInitializationEnabled()
+{
+    return QSettings("QuteNote", "QuteNote").value("deferredInitialization", true).toBool();
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+
+    // The first expose of the window is painted synchronously; watch for it
+    if (!m_firstFrameSeen && windowHandle()) {
+        windowHandle()->installEventFilter(this);
+    }
+}
+
+void MainWindow::onFirstFrame()
+{
+    StartupTracer::mark("first frame");
+    emit firstFrameShown();
+
+    // Whatever is queued behind the first frame has run once this fires
+    QTimer::singleShot(0, this, [this]() {
+        StartupTracer::mark("interactive");
+        if (m_settingsView) {
+            StartupTracer::finish();
+        } else {
+            QTimer::singleShot(DEFERRED_INIT_DELAY, this, &MainWindow::runDeferredInitialization);
+        }
+    });
+}
+
+void MainWindow::runDeferredInitialization()
+{
+    ensureSettingsView();
+    StartupTracer::finish();
+}
+
 bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
+    if (!m_firstFrameSeen && watched == windowHandle() && event->type() == QEvent::Expose
+            && windowHandle()->isExposed()) {
+        m_firstFrameSeen = true;
+        windowHandle()->removeEventFilter(this);
+        StartupTracer::mark("first expose");
+        // Posted now, delivered after the expose has been painted
+        QTimer::singleShot(0, this, &MainWindow::onFirstFrame);
+    }
+
     // Handle resize events on debug-overlay parents so overlays track size.
     if (event && event->type() == QEvent::Resize) {
         QWidget *w = qobject_cast<QWidget*>(watched);
@@ -236,14 +294,11 @@ void MainWindow::setupUI()
     // Set up touch interaction first
     setupTouchInteraction();
 
-    // Create main view and settings view
-    m_mainView = new MainView(this);
-    m_settingsView = new SettingsView(this);
-
-    // Initialize the settings view component
-    if (m_settingsView) {
-        m_settingsView->initializeComponent();
-        // setupComponent() is called automatically during initialization
+    // Create main view; the settings view follows once the first frame is up
+    // unless deferred initialization is off
+    {
+        StartupTracer::Scope trace("MainView");
+        m_mainView = new MainView(this);
     }
     // MainView inherits from QWidget, not ComponentBase, so no initializeComponent needed
     
@@ -253,10 +308,9 @@ void MainWindow::setupUI()
     }
 
     // Check for null pointers before adding to stacked widget
-    if (m_mainView && m_settingsView && m_stackedWidget) {
+    if (m_mainView && m_stackedWidget) {
         // Add views to stacked widget
         m_stackedWidget->addWidget(m_mainView);
-        m_stackedWidget->addWidget(m_settingsView);
 
         // Set central widget
         setCentralWidget(m_stackedWidget);
@@ -264,19 +318,14 @@ void MainWindow::setupUI()
     }
 
     // Connect signals only if views were created successfully
-    if (m_mainView && m_settingsView) {
+    if (m_mainView) {
         connect(m_mainView, &MainView::settingsRequested,
                 this, &MainWindow::showSettings);
-        connect(m_settingsView, &SettingsView::settingsChanged,
-                this, &MainWindow::applySettings);
-        connect(m_settingsView, &SettingsView::backToMain,
-                this, &MainWindow::showMainView);
-        connect(m_mainView, &MainView::fileSaved, this, [this](const QString &filePath) {
-            Q_UNUSED(filePath);
-            if (m_mainView && m_mainView->fileBrowser()) {
-                m_mainView->fileBrowser()->populateTree();
-            }
-        });
+        // MainView refreshes the file browser itself when a save creates a
+        // new file; repopulating here on every (auto)save rebuilt the tree.
+    }
+    if (!deferredInitializationEnabled()) {
+        ensureSettingsView();
     }
 
     // Set window properties
@@ -296,7 +345,10 @@ void MainWindow::setupUI()
     // Connect to theme changes to apply different colors to UI elements
     connect(m_themeManager, &ThemeManager::themeChanged, this, &MainWindow::onThemeChanged);
     // Apply initial theme
-    onThemeChanged(m_themeManager->currentTheme());
+    {
+        StartupTracer::Scope traceTheme("initial theme");
+        onThemeChanged(m_themeManager->currentTheme());
+    }
 
 #ifdef Q_OS_ANDROID
     // Apply Android system UI styling after a short delay to ensure window is created
@@ -329,7 +381,7 @@ void MainWindow::onTitleBarFilenameChanged(const QString &newName)
     if (QFile::rename(oldPath, newPath)) {
         m_mainView->onFileSelected(newPath);
         if (m_mainView->fileBrowser())
-            m_mainView->fileBrowser()->populateTree();
+            m_mainView->fileBrowser()->refreshDirectory(dir);
     } else {
         QMessageBox::warning(this, tr("Rename Failed"), tr("Could not rename file."));
     }
@@ -351,6 +403,8 @@ void MainWindow::applySettings()
     // Apply sidebar visibility setting
     bool showSidebar = settings->value("showSidebarByDefault", true).toBool();
     m_mainView->toggleSidebar(showSidebar);
+
+    m_mainView->applyEditorSettings();
     
     delete settings;
     
@@ -380,6 +434,8 @@ void MainWindow::showMainView()
 {
     if (!m_stackedWidget || !m_mainView) return;
     m_stackedWidget->setCurrentWidget(m_mainView);
+    // Auto-save toggles are stored immediately without settingsChanged
+    m_mainView->applyEditorSettings();
     #ifndef Q_OS_ANDROID
     setWindowTitle("QuteNote");
     #endif
@@ -388,8 +444,28 @@ void MainWindow::showMainView()
     // (temporary diagnostics removed)
 }
 
+void MainWindow::ensureSettingsView()
+{
+    if (m_settingsView || !m_stackedWidget) return;
+
+    StartupTracer::Scope trace("SettingsView");
+    m_settingsView = new SettingsView(this);
+
+    // Initialize the settings view component
+    m_settingsView->initializeComponent();
+    // setupComponent() is called automatically during initialization
+
+    m_stackedWidget->addWidget(m_settingsView);
+    connect(m_settingsView, &SettingsView::settingsChanged,
+            this, &MainWindow::applySettings);
+    connect(m_settingsView, &SettingsView::backToMain,
+            this, &MainWindow::showMainView);
+}
+
 void MainWindow::showSettings()
 {
+    // Asked for before deferred initialization got to it
+    ensureSettingsView();
     if (!m_stackedWidget || !m_settingsView) return;
     m_stackedWidget->setCurrentWidget(m_settingsView);
 #ifndef Q_OS_ANDROID
@@ -28,6 +28,15 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Builds what the first frame does not need (SettingsView and what it
+    // pulls in) only once the window is up; on unless the
+    // "deferredInitialization" setting turns it off
+    static bool deferredInitializationEnabled();
+
+signals:
+    // The window has been exposed and painted for the first time
+    void firstFrameShown();
+
 private slots:
     void showSettings();
     void showMainView();
@@ -39,16 +48,23 @@ private:
     void setupUI();
     void setupTouchInteraction();
     void handleViewTransition(QWidget *from, QWidget *to);
+    void ensureSettingsView();
+    void onFirstFrame();
+    void runDeferredInitialization();
 #ifdef Q_OS_ANDROID
     void setupAndroidSystemUI();
 #endif
     
     int m_backPressCount;
+    bool m_firstFrameSeen = false;
+
+    static const int DEFERRED_INIT_DELAY = 50; // ms after the window is interactive
     
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
     void keyReleaseEvent(QKeyEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
 
     Ui::MainWindow *ui;
     QStackedWidget *m_stackedWidget;
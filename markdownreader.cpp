@@ -0,0 +1,391 @@
+#include "markdownreader.h"
+#include <QIODevice>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QTextList>
+#include <QTextImageFormat>
+#include <QTextLength>
+#include <QTextStream>
+
+namespace {
+
+const QRegularExpression &headingPattern()
+{
+    static const QRegularExpression re(QStringLiteral("^ {0,3}(#{1,6})(?:\\s+(.*?))?(?:\\s+#+)?\\s*$"));
+    return re;
+}
+
+const QRegularExpression &rulePattern()
+{
+    static const QRegularExpression re(QStringLiteral("^ {0,3}([-*_])(?:\\s*\\1){2,}\\s*$"));
+    return re;
+}
+
+const QRegularExpression &listItemPattern()
+{
+    static const QRegularExpression re(QStringLiteral("^( *)([-*+]|\\d{1,9}[.)])(?:\\s+(.*))?$"));
+    return re;
+}
+
+bool isFenceLine(const QString &line)
+{
+    return line.trimmed().startsWith(QLatin1String("```"));
+}
+
+bool isAsciiPunctuation(QChar c)
+{
+    return c.unicode() < 128 && (c.isPunct() || c.isSymbol());
+}
+
+// Font size adjustment used by Qt's own HTML importer for <h1>..<h6>
+int headingSizeAdjustment(int level)
+{
+    static const int adjustments[] = { 3, 2, 1, 0, -1, -1 };
+    return adjustments[qBound(1, level, 6) - 1];
+}
+
+} // namespace
+
+MarkdownReader::MarkdownReader(QTextDocument *document)
+    : m_document(document)
+{
+}
+
+bool MarkdownReader::read(QIODevice *device)
+{
+    if (!device || !m_document) {
+        return false;
+    }
+
+    beginDocument();
+    QTextStream in(device);
+    QString line;
+    while (in.readLineInto(&line)) {
+        processLine(line);
+    }
+    endDocument();
+    return in.status() == QTextStream::Ok;
+}
+
+void MarkdownReader::read(const QString &markdown)
+{
+    if (!m_document) {
+        return;
+    }
+
+    beginDocument();
+    const QStringList lines = markdown.split(QLatin1Char('\n'));
+    for (const QString &line : lines) {
+        processLine(line.endsWith(QLatin1Char('\r')) ? line.chopped(1) : line);
+    }
+    endDocument();
+}
+
+void MarkdownReader::beginDocument()
+{
+    // Building the document must not be undoable, same as setHtml()
+    m_document->setUndoRedoEnabled(false);
+    m_document->clear();
+    m_cursor = QTextCursor(m_document);
+    m_firstBlock = true;
+    m_inCodeFence = false;
+    m_pendingKind = PendingKind::None;
+    m_pendingText.clear();
+    m_lists.clear();
+    m_listIndents.clear();
+}
+
+void MarkdownReader::endDocument()
+{
+    flushPending();
+    m_document->setUndoRedoEnabled(true);
+}
+
+void MarkdownReader::processLine(const QString &line)
+{
+    if (isFenceLine(line)) {
+        flushPending();
+        m_inCodeFence = !m_inCodeFence;
+        return;
+    }
+    if (m_inCodeFence) {
+        insertCodeLine(line);
+        return;
+    }
+
+    const QString trimmed = line.trimmed();
+    if (trimmed.isEmpty()) {
+        flushPending();
+        return;
+    }
+
+    // MarkdownWriter's marker for an intentionally empty paragraph
+    if (trimmed == QLatin1String("&nbsp;")) {
+        flushPending();
+        m_lists.clear();
+        m_listIndents.clear();
+        insertBlock(QTextBlockFormat());
+        return;
+    }
+
+    QRegularExpressionMatch match = headingPattern().match(line);
+    if (match.hasMatch()) {
+        insertHeading(match.captured(1).length(), match.captured(2));
+        return;
+    }
+
+    if (rulePattern().match(line).hasMatch()) {
+        insertRule();
+        return;
+    }
+
+    match = listItemPattern().match(line);
+    if (match.hasMatch()) {
+        const QString marker = match.captured(2);
+        startListItem(match.captured(1).length(), marker.at(0).isDigit(), match.captured(3));
+        return;
+    }
+
+    // Continuation of the paragraph or list item being collected. A trailing
+    // backslash is a hard line break, anything else a soft one.
+    if (m_pendingKind != PendingKind::None) {
+        int backslashes = 0;
+        for (int i = m_pendingText.size() - 1; i >= 0 && m_pendingText.at(i) == QLatin1Char('\\'); --i) {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 1) {
+            m_pendingText.chop(1);
+            m_pendingText += QChar(QChar::LineSeparator);
+        } else {
+            m_pendingText += QLatin1Char(' ');
+        }
+        m_pendingText += trimmed;
+        return;
+    }
+
+    m_lists.clear();
+    m_listIndents.clear();
+    insertBlock(QTextBlockFormat());
+    m_pendingKind = PendingKind::Paragraph;
+    m_pendingText = trimmed;
+}
+
+void MarkdownReader::flushPending()
+{
+    if (m_pendingKind == PendingKind::None) {
+        return;
+    }
+    appendInline(m_pendingText, QTextCharFormat());
+    m_pendingKind = PendingKind::None;
+    m_pendingText.clear();
+}
+
+void MarkdownReader::insertBlock(const QTextBlockFormat &blockFormat)
+{
+    if (m_firstBlock) {
+        // A fresh document already has one empty block; reuse it
+        m_cursor.setBlockFormat(blockFormat);
+        m_cursor.setBlockCharFormat(QTextCharFormat());
+        m_firstBlock = false;
+    } else {
+        m_cursor.insertBlock(blockFormat, QTextCharFormat());
+    }
+}
+
+void MarkdownReader::insertCodeLine(const QString &line)
+{
+    m_lists.clear();
+    m_listIndents.clear();
+
+    QTextBlockFormat blockFormat;
+    blockFormat.setNonBreakableLines(true);
+    blockFormat.setProperty(QTextFormat::BlockCodeFence, QChar(QLatin1Char('`')));
+    insertBlock(blockFormat);
+
+    QTextCharFormat code;
+    code.setFontFixedPitch(true);
+    code.setFontFamilies(QStringList() << QStringLiteral("monospace"));
+    m_cursor.insertText(line, code);
+}
+
+void MarkdownReader::insertHeading(int level, const QString &text)
+{
+    flushPending();
+    m_lists.clear();
+    m_listIndents.clear();
+
+    QTextBlockFormat blockFormat;
+    blockFormat.setHeadingLevel(level);
+    insertBlock(blockFormat);
+
+    QTextCharFormat heading;
+    heading.setFontWeight(QFont::Bold);
+    heading.setProperty(QTextFormat::FontSizeAdjustment, headingSizeAdjustment(level));
+    appendInline(text, heading);
+}
+
+void MarkdownReader::insertRule()
+{
+    flushPending();
+    m_lists.clear();
+    m_listIndents.clear();
+
+    QTextBlockFormat blockFormat;
+    blockFormat.setProperty(QTextFormat::BlockTrailingHorizontalRulerWidth,
+                            QTextLength(QTextLength::PercentageLength, 100));
+    insertBlock(blockFormat);
+}
+
+void MarkdownReader::startListItem(int indent, bool ordered, const QString &text)
+{
+    flushPending();
+
+    // Nesting is decided by comparing indentation with the open lists rather
+    // than by a fixed tab width, so both 2- and 4-space styles work.
+    while (!m_listIndents.isEmpty() && indent < m_listIndents.last()) {
+        m_listIndents.removeLast();
+        m_lists.removeLast();
+    }
+    if (m_listIndents.isEmpty() || indent > m_listIndents.last()) {
+        m_listIndents.append(indent);
+        m_lists.append(nullptr);
+    }
+
+    const int depth = m_lists.size() - 1;
+    static const QTextListFormat::Style bulletStyles[] = {
+        QTextListFormat::ListDisc, QTextListFormat::ListCircle, QTextListFormat::ListSquare
+    };
+    const QTextListFormat::Style style = ordered ? QTextListFormat::ListDecimal : bulletStyles[depth % 3];
+
+    insertBlock(QTextBlockFormat());
+    QTextList *list = m_lists.at(depth);
+    if (list && list->format().style() == style) {
+        list->add(m_cursor.block());
+    } else {
+        QTextListFormat listFormat;
+        listFormat.setStyle(style);
+        listFormat.setIndent(depth + 1);
+        m_lists[depth] = m_cursor.createList(listFormat);
+    }
+
+    m_pendingKind = PendingKind::ListItem;
+    m_pendingText = text.trimmed();
+}
+
+void MarkdownReader::appendInline(const QString &text, const QTextCharFormat &base)
+{
+    bool bold = false;
+    bool italic = false;
+    bool strike = false;
+    bool underline = false;
+    bool code = false;
+    QString run;
+
+    auto currentFormat = [&]() {
+        QTextCharFormat format = base;
+        if (bold) format.setFontWeight(QFont::Bold);
+        if (italic) format.setFontItalic(true);
+        if (strike) format.setFontStrikeOut(true);
+        if (underline) format.setFontUnderline(true);
+        if (code) {
+            format.setFontFixedPitch(true);
+            format.setFontFamilies(QStringList() << QStringLiteral("monospace"));
+        }
+        return format;
+    };
+    auto flushRun = [&]() {
+        if (!run.isEmpty()) {
+            m_cursor.insertText(run, currentFormat());
+            run.clear();
+        }
+    };
+    auto isWordChar = [&text](int index) {
+        return index >= 0 && index < text.size() && text.at(index).isLetterOrNumber();
+    };
+
+    const int length = text.size();
+    for (int i = 0; i < length; ++i) {
+        const QChar c = text.at(i);
+
+        if (code) {
+            if (c == QLatin1Char('`')) {
+                flushRun();
+                code = false;
+            } else {
+                run += c;
+            }
+            continue;
+        }
+
+        if (c == QLatin1Char('\\') && i + 1 < length && isAsciiPunctuation(text.at(i + 1))) {
+            run += text.at(++i);
+            continue;
+        }
+        if (c == QLatin1Char('`')) {
+            flushRun();
+            code = true;
+            continue;
+        }
+        if (QStringView(text).mid(i, 2) == QLatin1String("**") || QStringView(text).mid(i, 2) == QLatin1String("__")) {
+            flushRun();
+            bold = !bold;
+            ++i;
+            continue;
+        }
+        if (QStringView(text).mid(i, 2) == QLatin1String("~~")) {
+            flushRun();
+            strike = !strike;
+            ++i;
+            continue;
+        }
+        // '_' inside a word (snake_case) is literal; '*' always toggles
+        if (c == QLatin1Char('*') || (c == QLatin1Char('_') && !(isWordChar(i - 1) && isWordChar(i + 1)))) {
+            flushRun();
+            italic = !italic;
+            continue;
+        }
+        if (QStringView(text).mid(i, 3) == QLatin1String("<u>")) {
+            flushRun();
+            underline = true;
+            i += 2;
+            continue;
+        }
+        if (QStringView(text).mid(i, 4) == QLatin1String("</u>")) {
+            flushRun();
+            underline = false;
+            i += 3;
+            continue;
+        }
+
+        const bool image = c == QLatin1Char('!') && i + 1 < length && text.at(i + 1) == QLatin1Char('[');
+        if (image || c == QLatin1Char('[')) {
+            const int labelStart = i + (image ? 2 : 1);
+            const int labelEnd = text.indexOf(QLatin1String("]("), labelStart);
+            const int targetEnd = labelEnd >= 0 ? text.indexOf(QLatin1Char(')'), labelEnd + 2) : -1;
+            if (targetEnd >= 0) {
+                flushRun();
+                const QString label = text.mid(labelStart, labelEnd - labelStart);
+                const QString target = text.mid(labelEnd + 2, targetEnd - labelEnd - 2).trimmed();
+                if (image) {
+                    QTextImageFormat imageFormat;
+                    imageFormat.setName(target);
+                    if (!label.isEmpty()) {
+                        imageFormat.setProperty(QTextFormat::ImageAltText, label);
+                    }
+                    m_cursor.insertImage(imageFormat);
+                } else {
+                    QTextCharFormat link = currentFormat();
+                    link.setAnchor(true);
+                    link.setAnchorHref(target);
+                    link.setFontUnderline(true);
+                    appendInline(label, link);
+                }
+                i = targetEnd;
+                continue;
+            }
+        }
+
+        run += c;
+    }
+    flushRun();
+}
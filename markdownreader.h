@@ -0,0 +1,64 @@
+#ifndef MARKDOWNREADER_H
+#define MARKDOWNREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTextBlockFormat>
+#include <QTextCharFormat>
+#include <QTextListFormat>
+#include <QVector>
+
+class QIODevice;
+class QTextDocument;
+class QTextList;
+
+// Streaming Markdown parser that builds a QTextDocument directly, one line at
+// a time, so a note never has to be held in memory as one big string.
+//
+// It covers the subset MarkdownWriter produces (and what people typically
+// write by hand): ATX headings, bullet and numbered lists with nesting,
+// fenced code, horizontal rules, **bold**, *italic*, ~~strike~~, <u>underline</u>,
+// `code`, [links](url) and ![images](src). Emphasis is matched by simple
+// toggling rather than the full CommonMark delimiter rules.
+//
+// Safe to use on a worker thread as long as the document is not shared.
+class MarkdownReader
+{
+public:
+    explicit MarkdownReader(QTextDocument *document);
+
+    // Replaces the document's contents with the Markdown read from device
+    bool read(QIODevice *device);
+    // Convenience for in-memory text
+    void read(const QString &markdown);
+
+private:
+    enum class PendingKind { None, Paragraph, ListItem };
+
+    void beginDocument();
+    void endDocument();
+    void processLine(const QString &line);
+    void flushPending();
+    void insertBlock(const QTextBlockFormat &blockFormat);
+    void insertCodeLine(const QString &line);
+    void insertHeading(int level, const QString &text);
+    void insertRule();
+    void startListItem(int indent, bool ordered, const QString &text);
+    void appendInline(const QString &text, const QTextCharFormat &base);
+
+    QTextDocument *m_document;
+    QTextCursor m_cursor;
+    bool m_firstBlock = true;
+    bool m_inCodeFence = false;
+
+    PendingKind m_pendingKind = PendingKind::None;
+    QString m_pendingText;
+
+    // Open lists by nesting depth, with the indentation that opened each;
+    // cleared by any non-list block
+    QVector<QTextList*> m_lists;
+    QVector<int> m_listIndents;
+};
+
+#endif // MARKDOWNREADER_H
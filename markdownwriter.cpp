@@ -0,0 +1,370 @@
+#include "markdownwriter.h"
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextFragment>
+#include <QTextImageFormat>
+#include <QTextList>
+#include <QFont>
+#include <utility>
+
+namespace {
+
+// Inline Markdown of a block, remembered together with the block revision and
+// fragment formats it was rendered from. Owned by the block
+// (QTextBlock::setUserData).
+class MarkdownBlockCache : public QTextBlockUserData
+{
+public:
+    int revision = -1;
+    QVector<int> formats; // See fragmentFormats()
+    bool heading = false; // Headings drop bold markers, see inlineMarkdown()
+    QString text;
+};
+
+// QTextBlock::revision() only moves when text changes, not when a format is
+// applied to existing text (bold, links), so the fragment layout is part of
+// the key: offset, length and format index of every fragment. Identical
+// formats share an index in the document, so this is a few integers per
+// fragment rather than a comparison of formats.
+QVector<int> fragmentFormats(const QTextBlock &block)
+{
+    QVector<int> formats;
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        const QTextFragment fragment = it.fragment();
+        formats << fragment.position() - block.position() << fragment.length()
+                << fragment.charFormatIndex();
+    }
+    return formats;
+}
+
+bool isCodeBlock(const QTextBlock &block)
+{
+    return block.blockFormat().hasProperty(QTextFormat::BlockCodeFence);
+}
+
+bool isRuleBlock(const QTextBlock &block)
+{
+    return block.blockFormat().hasProperty(QTextFormat::BlockTrailingHorizontalRulerWidth);
+}
+
+bool isOrderedList(const QTextList *list)
+{
+    switch (list->format().style()) {
+    case QTextListFormat::ListDisc:
+    case QTextListFormat::ListCircle:
+    case QTextListFormat::ListSquare:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Markers have to hug the text, so whitespace at either end of an emphasised
+// fragment is moved outside of them
+void wrap(QString &out, const QString &text, const QString &open, const QString &close)
+{
+    int start = 0;
+    while (start < text.size() && text.at(start).isSpace()) {
+        ++start;
+    }
+    int end = text.size();
+    while (end > start && text.at(end - 1).isSpace()) {
+        --end;
+    }
+    if (start == end) {
+        out += text;
+        return;
+    }
+    out += QStringView(text).left(start);
+    out += open;
+    out += QStringView(text).mid(start, end - start);
+    out += close;
+    out += QStringView(text).mid(end);
+}
+
+QString encodeTarget(QString target)
+{
+    target.replace(QLatin1Char(' '), QLatin1String("%20"));
+    target.replace(QLatin1Char(')'), QLatin1String("%29"));
+    return target;
+}
+
+} // namespace
+
+QByteArray MarkdownWriter::write(const QTextDocument *document)
+{
+    QVector<Line> lines;
+    lines.reserve(document->blockCount());
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        lines.append(describe(block, false, nullptr));
+    }
+    return join(lines);
+}
+
+DocumentSaver::Serializer MarkdownWriter::snapshot(const QTextDocument *document, int *serializedBlocks)
+{
+    if (serializedBlocks) {
+        *serializedBlocks = 0;
+    }
+
+    // Only the (cheap) per-block lines are captured here on the GUI thread;
+    // the joined string and its UTF-8 encoding are built on the save worker.
+    QVector<Line> lines;
+    lines.reserve(document->blockCount());
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        lines.append(describe(block, true, serializedBlocks));
+    }
+    return [lines]() { return join(lines); };
+}
+
+MarkdownWriter::Line MarkdownWriter::describe(const QTextBlock &block, bool useCache, int *serializedBlocks)
+{
+    Line line;
+
+    if (isCodeBlock(block)) {
+        line.kind = Line::Code;
+        line.text = block.text();
+        line.text.replace(QChar(QChar::LineSeparator), QLatin1Char('\n'));
+        return line;
+    }
+    if (isRuleBlock(block)) {
+        line.kind = Line::Rule;
+        line.text = QStringLiteral("---");
+        return line;
+    }
+
+    const QString content = cachedInlineMarkdown(block, useCache, serializedBlocks);
+
+    // The prefix depends on neighbouring blocks (list numbering) and is
+    // therefore never cached
+    QString prefix;
+    const int headingLevel = block.blockFormat().headingLevel();
+    if (headingLevel > 0) {
+        line.kind = Line::Heading;
+        prefix = QString(qMin(headingLevel, 6), QLatin1Char('#')) + QLatin1Char(' ');
+    } else if (QTextList *list = block.textList()) {
+        line.kind = Line::ListItem;
+        prefix = QString(4 * qMax(0, list->format().indent() - 1), QLatin1Char(' '));
+        prefix += isOrderedList(list)
+                ? QString::number(list->itemNumber(block) + 1) + QLatin1String(". ")
+                : QStringLiteral("- ");
+    } else if (content.isEmpty()) {
+        line.kind = Line::Empty;
+        line.text = QStringLiteral("&nbsp;");
+        return line;
+    }
+
+    // Hard line breaks become "\" + newline; every continuation line is
+    // escaped again so it cannot start a block of its own
+    const QStringList segments = content.split(QChar(QChar::LineSeparator));
+    const QString continuationIndent(line.kind == Line::ListItem ? prefix.size() : 0, QLatin1Char(' '));
+    line.text = prefix + (line.kind == Line::Paragraph ? escapeLineStart(segments.first()) : segments.first());
+    for (int i = 1; i < segments.size(); ++i) {
+        line.text += QLatin1String("\\\n") + continuationIndent + escapeLineStart(segments.at(i));
+    }
+    return line;
+}
+
+QString MarkdownWriter::cachedInlineMarkdown(const QTextBlock &block, bool useCache, int *serializedBlocks)
+{
+    if (!useCache) {
+        return inlineMarkdown(block);
+    }
+
+    QTextBlock mutableBlock = block;
+    auto *cache = static_cast<MarkdownBlockCache*>(mutableBlock.userData());
+    const bool heading = block.blockFormat().headingLevel() > 0;
+    const QVector<int> formats = fragmentFormats(block);
+    if (cache && cache->revision == block.revision() && cache->formats == formats
+            && cache->heading == heading) {
+        return cache->text;
+    }
+
+    if (!cache) {
+        cache = new MarkdownBlockCache;
+        mutableBlock.setUserData(cache);
+    }
+    cache->revision = block.revision();
+    cache->formats = formats;
+    cache->heading = heading;
+    cache->text = inlineMarkdown(block);
+    if (serializedBlocks) {
+        ++*serializedBlocks;
+    }
+    return cache->text;
+}
+
+QString MarkdownWriter::inlineMarkdown(const QTextBlock &block)
+{
+    const bool heading = block.blockFormat().headingLevel() > 0;
+
+    // Adjacent fragments often differ only in properties Markdown does not
+    // carry (colour, size); merge those first so "*a*" + "*b*" does not turn
+    // into "*a**b*".
+    struct Run {
+        QTextCharFormat format;
+        QString text;
+    };
+    auto sameMarkup = [heading](const QTextCharFormat &a, const QTextCharFormat &b) {
+        return a.fontFixedPitch() == b.fontFixedPitch()
+            && a.fontItalic() == b.fontItalic()
+            && a.fontStrikeOut() == b.fontStrikeOut()
+            && a.fontUnderline() == b.fontUnderline()
+            && (heading || (a.fontWeight() > QFont::Normal) == (b.fontWeight() > QFont::Normal))
+            && a.isAnchor() == b.isAnchor()
+            && a.anchorHref() == b.anchorHref();
+    };
+
+    QVector<Run> runs;
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        const QTextFragment fragment = it.fragment();
+        if (!fragment.isValid()) {
+            continue;
+        }
+        const QTextCharFormat format = fragment.charFormat();
+        if (!runs.isEmpty() && !format.isImageFormat() && !runs.last().format.isImageFormat()
+                && sameMarkup(runs.last().format, format)) {
+            runs.last().text += fragment.text();
+        } else {
+            runs.append({ format, fragment.text() });
+        }
+    }
+
+    QString out;
+    for (const Run &run : std::as_const(runs)) {
+        const QTextCharFormat &format = run.format;
+
+        if (format.isImageFormat()) {
+            const QTextImageFormat image = format.toImageFormat();
+            const QString alt = escapeText(image.property(QTextFormat::ImageAltText).toString());
+            // One object replacement character per image
+            for (int i = 0; i < run.text.size(); ++i) {
+                out += QLatin1String("![") + alt + QLatin1String("](") + encodeTarget(image.name()) + QLatin1Char(')');
+            }
+            continue;
+        }
+
+        QString rendered;
+        if (format.fontFixedPitch() && !run.text.contains(QLatin1Char('`'))) {
+            wrap(rendered, run.text, QStringLiteral("`"), QStringLiteral("`"));
+        } else {
+            rendered = escapeText(run.text);
+            auto mark = [&rendered](const QString &open, const QString &close) {
+                QString marked;
+                wrap(marked, rendered, open, close);
+                rendered = marked;
+            };
+            if (format.fontUnderline() && !format.isAnchor()) {
+                mark(QStringLiteral("<u>"), QStringLiteral("</u>"));
+            }
+            if (format.fontStrikeOut()) {
+                mark(QStringLiteral("~~"), QStringLiteral("~~"));
+            }
+            if (format.fontItalic()) {
+                mark(QStringLiteral("*"), QStringLiteral("*"));
+            }
+            // Headings are bold by virtue of being headings
+            if (!heading && format.fontWeight() > QFont::Normal) {
+                mark(QStringLiteral("**"), QStringLiteral("**"));
+            }
+        }
+
+        if (format.isAnchor() && !format.anchorHref().isEmpty()) {
+            out += QLatin1Char('[') + rendered + QLatin1String("](") + encodeTarget(format.anchorHref()) + QLatin1Char(')');
+        } else {
+            out += rendered;
+        }
+    }
+    return out;
+}
+
+QString MarkdownWriter::escapeText(const QString &text)
+{
+    QString out;
+    out.reserve(text.size());
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+        case '\\':
+        case '`':
+        case '*':
+        case '_':
+        case '~':
+        case '[':
+        case ']':
+        case '<':
+            out += QLatin1Char('\\');
+            out += c;
+            break;
+        case QChar::Nbsp:
+            out += QLatin1Char(' ');
+            break;
+        default:
+            out += c;
+            break;
+        }
+    }
+    return out;
+}
+
+QString MarkdownWriter::escapeLineStart(const QString &line)
+{
+    int start = 0;
+    while (start < line.size() && line.at(start) == QLatin1Char(' ')) {
+        ++start;
+    }
+    const QString text = line.mid(start);
+    if (text.isEmpty()) {
+        return text;
+    }
+
+    // Characters that would open a heading, quote, list or rule, and the
+    // writer's own empty-paragraph marker
+    const QChar first = text.at(0);
+    if (first == QLatin1Char('#') || first == QLatin1Char('>') || first == QLatin1Char('-')
+            || first == QLatin1Char('+') || first == QLatin1Char('=')
+            || text.startsWith(QLatin1String("&nbsp;"))) {
+        return QLatin1Char('\\') + text;
+    }
+
+    // "1. " / "1) " would start an ordered list
+    int digits = 0;
+    while (digits < text.size() && text.at(digits).isDigit()) {
+        ++digits;
+    }
+    if (digits > 0 && digits < text.size()
+            && (text.at(digits) == QLatin1Char('.') || text.at(digits) == QLatin1Char(')'))) {
+        return text.left(digits) + QLatin1Char('\\') + text.mid(digits);
+    }
+    return text;
+}
+
+QByteArray MarkdownWriter::join(const QVector<Line> &lines)
+{
+    // A fresh, empty note is stored as an empty file
+    if (lines.isEmpty() || (lines.size() == 1 && lines.first().kind == Line::Empty)) {
+        return QByteArray();
+    }
+
+    QString out;
+    for (int i = 0; i < lines.size(); ++i) {
+        const Line &line = lines.at(i);
+        if (i > 0) {
+            const Line::Kind previous = lines.at(i - 1).kind;
+            if (previous == Line::Code && line.kind != Line::Code) {
+                out += QLatin1String("\n```");
+            }
+            const bool tight = (previous == Line::ListItem && line.kind == Line::ListItem)
+                    || (previous == Line::Code && line.kind == Line::Code);
+            out += tight ? QLatin1String("\n") : QLatin1String("\n\n");
+        }
+        if (line.kind == Line::Code && (i == 0 || lines.at(i - 1).kind != Line::Code)) {
+            out += QLatin1String("```\n");
+        }
+        out += line.text;
+    }
+    if (lines.last().kind == Line::Code) {
+        out += QLatin1String("\n```");
+    }
+    out += QLatin1Char('\n');
+    return out.toUtf8();
+}
@@ -0,0 +1,49 @@
+#ifndef MARKDOWNWRITER_H
+#define MARKDOWNWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "documentsaver.h"
+
+class QTextBlock;
+class QTextDocument;
+
+// Serializes a QTextDocument to the Markdown subset MarkdownReader parses.
+//
+// Markdown is block-addressable: each QTextBlock becomes one line (plus a
+// prefix derived from its block format), so the expensive part, the inline
+// text of a block, can be cached on the block itself and reused for every
+// block whose QTextBlock::revision() and fragment formats have not changed
+// since it was last serialized. snapshot() relies on that to only serialize dirty blocks on
+// the GUI thread and leaves the joining and encoding to the save worker.
+//
+// Colours and paragraph alignment have no Markdown equivalent and are not
+// preserved; use an HTML note (.txt/.html) for those.
+class MarkdownWriter
+{
+public:
+    // Whole document, on the calling thread
+    static QByteArray write(const QTextDocument *document);
+
+    // Per-block snapshot for DocumentSaver, reusing cached block text.
+    // serializedBlocks receives how many blocks actually had to be rendered.
+    static DocumentSaver::Serializer snapshot(const QTextDocument *document,
+                                              int *serializedBlocks = nullptr);
+
+private:
+    struct Line {
+        enum Kind { Paragraph, Empty, Heading, ListItem, Code, Rule };
+        Kind kind = Paragraph;
+        QString text; // Complete line including its prefix
+    };
+
+    static Line describe(const QTextBlock &block, bool useCache, int *serializedBlocks);
+    static QString cachedInlineMarkdown(const QTextBlock &block, bool useCache, int *serializedBlocks);
+    static QString inlineMarkdown(const QTextBlock &block);
+    static QString escapeText(const QString &text);
+    static QString escapeLineStart(const QString &line);
+    static QByteArray join(const QVector<Line> &lines);
+};
+
+#endif // MARKDOWNWRITER_H
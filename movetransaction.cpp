@@ -0,0 +1,110 @@
+#include "movetransaction.h"
+#include "paths.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QCoreApplication>
+
+QString MoveTransaction::currentPath(const QString &path) const
+{
+    QString current = QDir::cleanPath(path);
+    for (const Step &step : m_steps) {
+        if (QuteNote::isPathUnder(current, step.source)) {
+            current = step.destination + current.mid(step.source.size());
+        }
+    }
+    return current;
+}
+
+QString MoveTransaction::originalPath(const QString &path) const
+{
+    QString original = QDir::cleanPath(path);
+    for (int i = m_steps.size() - 1; i >= 0; --i) {
+        const Step &step = m_steps.at(i);
+        if (QuteNote::isPathUnder(original, step.destination)) {
+            original = step.source + original.mid(step.destination.size());
+        }
+    }
+    return original;
+}
+
+bool MoveTransaction::addStep(const QString &source, const QString &destination, QString *error)
+{
+    const QString from = currentPath(source);
+    const QString to = QDir::cleanPath(destination);
+    auto fail = [error](const QString &reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    if (from == to) {
+        return fail(tr("Source and destination are the same"));
+    }
+    if (QuteNote::isPathUnder(to, from)) {
+        return fail(tr("A folder cannot be moved into itself"));
+    }
+
+    // Taken by an earlier step, or on disk and not vacated by one
+    bool vacated = false;
+    for (const Step &step : std::as_const(m_steps)) {
+        if (QuteNote::isPathUnder(to, step.destination)) {
+            return fail(tr("Another item is being moved there"));
+        }
+        if (QuteNote::isPathUnder(to, step.source)) {
+            vacated = true;
+        }
+    }
+    if (!vacated && QFileInfo::exists(to)) {
+        return fail(tr("The destination already exists"));
+    }
+    // from only exists once earlier steps have run (it may be inside a
+    // folder moved before it), so the item is looked for where it is now.
+    // Tracing back from from rather than using source directly also catches
+    // an item an earlier step moved out from under it.
+    if (originalPath(from) != QDir::cleanPath(source) || !QFileInfo::exists(source)) {
+        return fail(tr("The item no longer exists"));
+    }
+
+    m_steps.append(Step{from, to});
+    return true;
+}
+
+MoveTransaction::Result MoveTransaction::run(const QList<Step> &steps)
+{
+    Result result;
+    for (int i = 0; i < steps.size(); ++i) {
+        const Step &step = steps.at(i);
+        if (renamePath(step.source, step.destination)) {
+            continue;
+        }
+
+        result.failedStep = i;
+        result.error = QFileInfo::exists(step.destination)
+            ? tr("%1 already exists").arg(step.destination)
+            : tr("Could not move %1").arg(step.source);
+
+        // Undo in reverse so paths inside moved folders are valid again
+        for (int j = i - 1; j >= 0; --j) {
+            if (!renamePath(steps.at(j).destination, steps.at(j).source)) {
+                result.notRolledBack << steps.at(j).destination;
+            }
+        }
+        return result;
+    }
+    result.committed = true;
+    return result;
+}
+
+bool MoveTransaction::renamePath(const QString &from, const QString &to)
+{
+    // Never replaces anything that appeared since the step was planned
+    if (QFileInfo::exists(to)) {
+        return false;
+    }
+    if (QFileInfo(from).isDir()) {
+        return QDir().rename(from, to);
+    }
+    return QFile::rename(from, to);
+}
@@ -0,0 +1,55 @@
+#ifndef MOVETRANSACTION_H
+#define MOVETRANSACTION_H
+
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// A batch of file and folder renames that either all happen or are all
+// undone.
+//
+// Steps are planned on the GUI thread: each one is checked against the
+// disk and against the steps before it (a later step that starts inside a
+// folder moved earlier is given the folder's new path). run() carries
+// them out in order and, when one fails, renames everything it already
+// moved back in reverse order. It only touches the filesystem, so it is
+// safe to call from a worker thread.
+class MoveTransaction
+{
+    Q_DECLARE_TR_FUNCTIONS(MoveTransaction)
+
+public:
+    struct Step {
+        QString source;
+        QString destination;
+    };
+
+    struct Result {
+        bool committed = false;
+        int failedStep = -1;        // Index into steps(), if not committed
+        QString error;
+        QStringList notRolledBack;  // Destinations that could not be moved back
+    };
+
+    // Where path is once the steps planned so far have run
+    QString currentPath(const QString &path) const;
+    // False (with a reason) if the step can never succeed. source is the
+    // item's path on disk now, before any step; it is followed through the
+    // steps planned so far.
+    bool addStep(const QString &source, const QString &destination, QString *error = nullptr);
+
+    QList<Step> steps() const { return m_steps; }
+    bool isEmpty() const { return m_steps.isEmpty(); }
+
+    static Result run(const QList<Step> &steps);
+
+private:
+    // Where whatever is at path after the planned steps is on disk now
+    QString originalPath(const QString &path) const;
+    static bool renamePath(const QString &from, const QString &to);
+
+    QList<Step> m_steps;
+};
+
+#endif // MOVETRANSACTION_H
@@ -0,0 +1,38 @@
+#ifndef NOTEFORMAT_H
+#define NOTEFORMAT_H
+
+#include <QString>
+#include <QFileInfo>
+
+namespace QuteNote {
+
+// On-disk representation of a note, chosen per file by its extension.
+// ".md"/".markdown" notes are stored as Markdown; everything else keeps the
+// original HTML round-trip through QTextDocument::setHtml()/toHtml().
+enum class NoteFormat {
+    Html,
+    Markdown
+};
+
+inline NoteFormat noteFormatForPath(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix();
+    if (suffix.compare("md", Qt::CaseInsensitive) == 0
+            || suffix.compare("markdown", Qt::CaseInsensitive) == 0) {
+        return NoteFormat::Markdown;
+    }
+    return NoteFormat::Html;
+}
+
+// True if fileName already carries an extension QuteNote can open as a note
+inline bool hasNoteExtension(const QString &fileName)
+{
+    return fileName.endsWith(".txt", Qt::CaseInsensitive)
+        || fileName.endsWith(".html", Qt::CaseInsensitive)
+        || fileName.endsWith(".md", Qt::CaseInsensitive)
+        || fileName.endsWith(".markdown", Qt::CaseInsensitive);
+}
+
+} // namespace QuteNote
+
+#endif // NOTEFORMAT_H
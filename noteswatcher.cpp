@@ -0,0 +1,484 @@
+#include "noteswatcher.h"
+#include "filewatcherguard.h"
+#include "paths.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// Static member definitions
+const int NotesWatcher::COALESCE_INTERVAL;
+
+NotesWatcher::NotesWatcher(QObject *parent)
+    : QObject(parent)
+{
+    // Not restarted by later events, so a steady trickle of changes is
+    // still delivered every COALESCE_INTERVAL
+    m_coalesceTimer.setSingleShot(true);
+    m_coalesceTimer.setInterval(COALESCE_INTERVAL);
+    connect(&m_coalesceTimer, &QTimer::timeout, this, &NotesWatcher::flush);
+}
+
+NotesWatcher::~NotesWatcher()
+{
+    if (m_walk) {
+        m_walk->waitForFinished();
+    }
+    stopWatching();
+}
+
+void NotesWatcher::setRootPath(const QString &path)
+{
+    const QString root = path.isEmpty() ? QString() : QDir::cleanPath(QFileInfo(path).absoluteFilePath());
+    if (root == m_rootPath) {
+        return;
+    }
+
+    stopWatching();
+    m_pending.clear();
+    m_coalesceTimer.stop();
+    if (m_walk) {
+        // Finishes on its own; its result is for the old root
+        m_walk->disconnect(this);
+        m_walk->deleteLater();
+        m_walk = nullptr;
+    }
+    for (QFutureWatcher<QStringList> *walk : std::as_const(m_subtreeWalks)) {
+        walk->disconnect(this);
+        walk->deleteLater();
+    }
+    m_subtreeWalks.clear();
+
+    m_rootPath = root;
+    if (root.isEmpty()) {
+        return;
+    }
+
+    // Walking a large tree takes a while, so it is done on a worker and
+    // the watches are added when it is done
+    m_walk = new QFutureWatcher<QStringList>(this);
+    connect(m_walk, &QFutureWatcher<QStringList>::finished, this, [this]() {
+        QFutureWatcher<QStringList> *walk = m_walk;
+        m_walk = nullptr;
+        walk->deleteLater();
+        startWatching(walk->result());
+    });
+    m_walk->setFuture(QtConcurrent::run([root]() {
+        return listDirectories(root);
+    }));
+}
+
+int NotesWatcher::watchedDirectoryCount() const
+{
+    return usesInotify() ? m_watchByPath.size() : m_fallbackPaths.size();
+}
+
+void NotesWatcher::startWatching(const QStringList &directories)
+{
+#ifdef Q_OS_LINUX
+    if (!m_fallback && m_inotifyFd < 0) {
+        m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotifyFd >= 0) {
+            m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+            connect(m_notifier, &QSocketNotifier::activated, this, &NotesWatcher::readInotifyEvents);
+        } else {
+            qWarning() << "inotify unavailable, watching notes through QFileSystemWatcher:"
+                       << qt_error_string(errno);
+        }
+    }
+#endif
+    for (const QString &directory : directories) {
+        watchDirectory(directory);
+    }
+}
+
+void NotesWatcher::stopWatching()
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        delete m_notifier;
+        m_notifier = nullptr;
+        // Closing the descriptor drops every watch on it
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+#endif
+    m_pathByWatch.clear();
+    m_watchByPath.clear();
+
+    delete m_fallback;
+    m_fallback = nullptr;
+    m_fallbackPaths.clear();
+}
+
+void NotesWatcher::watchTree(const QString &directory)
+{
+    // The folder itself right away, so nothing created in it is missed; the
+    // folders below it once a worker has walked them
+    watchDirectory(directory);
+    watchInBackground([directory]() {
+        return listDirectories(directory);
+    });
+}
+
+void NotesWatcher::watchInBackground(const std::function<QStringList()> &walk)
+{
+    auto *watcher = new QFutureWatcher<QStringList>(this);
+    m_subtreeWalks.insert(watcher);
+    connect(watcher, &QFutureWatcher<QStringList>::finished, this, [this, watcher]() {
+        m_subtreeWalks.remove(watcher);
+        watcher->deleteLater();
+        // Already watched ones are skipped, vanished ones fail quietly
+        const QStringList directories = watcher->result();
+        for (const QString &directory : directories) {
+            watchDirectory(directory);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(walk));
+}
+
+void NotesWatcher::watchDirectory(const QString &directory)
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        if (m_watchByPath.contains(directory)) {
+            return;
+        }
+        const int watch = inotify_add_watch(m_inotifyFd, QFile::encodeName(directory).constData(),
+                                            IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                            | IN_CLOSE_WRITE | IN_ONLYDIR | IN_DONT_FOLLOW
+                                            | IN_EXCL_UNLINK);
+        if (watch >= 0) {
+            m_pathByWatch.insert(watch, directory);
+            m_watchByPath.insert(directory, watch);
+            return;
+        }
+        if (errno != ENOSPC && errno != ENOMEM) {
+            // Gone again already, or not readable
+            return;
+        }
+        qWarning() << "Out of inotify watches, watching notes through QFileSystemWatcher";
+        switchToFallback();
+    }
+#endif
+
+    if (!m_fallback) {
+        m_fallback = new FileWatcherGuard(this);
+        connect(m_fallback, &FileWatcherGuard::directoryChanged,
+                this, &NotesWatcher::onFallbackDirectoryChanged);
+    }
+    if (!m_fallbackPaths.contains(directory) && m_fallback->addPath(directory)) {
+        m_fallbackPaths.insert(directory);
+    }
+}
+
+void NotesWatcher::unwatchTree(const QString &directory)
+{
+#ifdef Q_OS_LINUX
+    for (auto it = m_watchByPath.begin(); it != m_watchByPath.end();) {
+        if (QuteNote::isPathUnder(it.key(), directory)) {
+            inotify_rm_watch(m_inotifyFd, it.value());
+            m_pathByWatch.remove(it.value());
+            it = m_watchByPath.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#endif
+    for (auto it = m_fallbackPaths.begin(); it != m_fallbackPaths.end();) {
+        if (QuteNote::isPathUnder(*it, directory)) {
+            m_fallback->removePath(*it);
+            it = m_fallbackPaths.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void NotesWatcher::rebaseTree(const QString &oldPath, const QString &newPath)
+{
+    // An inotify watch follows its directory; only the path has to change
+    QHash<QString, int> moved;
+    for (auto it = m_watchByPath.begin(); it != m_watchByPath.end();) {
+        if (QuteNote::isPathUnder(it.key(), oldPath)) {
+            moved.insert(newPath + it.key().mid(oldPath.size()), it.value());
+            it = m_watchByPath.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = moved.constBegin(); it != moved.constEnd(); ++it) {
+        m_watchByPath.insert(it.key(), it.value());
+        m_pathByWatch.insert(it.value(), it.key());
+    }
+}
+
+void NotesWatcher::switchToFallback()
+{
+    const QStringList watched = m_watchByPath.keys();
+#ifdef Q_OS_LINUX
+    delete m_notifier;
+    m_notifier = nullptr;
+    ::close(m_inotifyFd);
+    m_inotifyFd = -1;
+#endif
+    m_pathByWatch.clear();
+    m_watchByPath.clear();
+
+    for (const QString &directory : watched) {
+        watchDirectory(directory);
+    }
+}
+
+void NotesWatcher::readInotifyEvents()
+{
+#ifdef Q_OS_LINUX
+    struct MovedFrom {
+        QString directory;
+        QString name;
+        bool isDir = false;
+    };
+    QHash<quint32, MovedFrom> movedFrom;
+
+    alignas(struct inotify_event) char buffer[16384];
+    for (;;) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (const char *cursor = buffer; cursor < buffer + length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(cursor);
+            cursor += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; every directory has to be looked at again
+                const QStringList directories = m_watchByPath.keys();
+                for (const QString &directory : directories) {
+                    noteRescan(directory);
+                }
+                continue;
+            }
+
+            const QString directory = m_pathByWatch.value(event->wd);
+            if (directory.isEmpty()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                // The directory is gone; its parent reports it
+                m_pathByWatch.remove(event->wd);
+                m_watchByPath.remove(directory);
+                continue;
+            }
+
+            const QString name = event->len ? QFile::decodeName(event->name) : QString();
+            if (name.isEmpty() || isIgnored(name)) {
+                continue;
+            }
+            const QString path = directory + QLatin1Char('/') + name;
+            const bool isDir = event->mask & IN_ISDIR;
+
+            if (event->mask & IN_MOVED_FROM) {
+                movedFrom.insert(event->cookie, MovedFrom{directory, name, isDir});
+            } else if (event->mask & IN_MOVED_TO) {
+                auto from = movedFrom.find(event->cookie);
+                if (from == movedFrom.end()) {
+                    // Moved in from outside the notes
+                    noteAdded(directory, name);
+                    if (isDir) {
+                        watchTree(path);
+                    }
+                    continue;
+                }
+                if (from->directory == directory) {
+                    noteRenamed(directory, from->name, name);
+                } else {
+                    noteRemoved(from->directory, from->name);
+                    noteAdded(directory, name);
+                }
+                if (isDir) {
+                    rebaseTree(from->directory + QLatin1Char('/') + from->name, path);
+                }
+                movedFrom.erase(from);
+            } else if (event->mask & IN_CREATE) {
+                noteAdded(directory, name);
+                if (isDir) {
+                    watchTree(path);
+                }
+            } else if (event->mask & IN_DELETE) {
+                noteRemoved(directory, name);
+                if (isDir) {
+                    unwatchTree(path);
+                }
+            } else if (event->mask & IN_CLOSE_WRITE) {
+                noteModified(directory, name);
+            }
+        }
+    }
+
+    // Moves whose other half never came went out of the notes
+    for (const MovedFrom &from : std::as_const(movedFrom)) {
+        noteRemoved(from.directory, from.name);
+        if (from.isDir) {
+            unwatchTree(from.directory + QLatin1Char('/') + from.name);
+        }
+    }
+#endif
+}
+
+void NotesWatcher::onFallbackDirectoryChanged(const QString &directory)
+{
+    const QString path = QDir::cleanPath(directory);
+    if (!QFileInfo(path).isDir()) {
+        unwatchTree(path);
+        if (path != m_rootPath) {
+            noteRescan(QFileInfo(path).absolutePath());
+        }
+        return;
+    }
+
+    noteRescan(path);
+    // New folders need watches of their own. Finding them, and the folders
+    // in them, is left to a worker.
+    const QSet<QString> watched = m_fallbackPaths;
+    watchInBackground([path, watched]() {
+        QStringList directories;
+        const QStringList names = QDir(path).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QString &name : names) {
+            const QString subdirectory = path + QLatin1Char('/') + name;
+            if (!isIgnored(name) && !watched.contains(subdirectory)) {
+                directories << listDirectories(subdirectory);
+            }
+        }
+        return directories;
+    });
+}
+
+void NotesWatcher::noteAdded(const QString &directory, const QString &name)
+{
+    PendingChange &change = pendingFor(directory);
+    if (change.removed.remove(name)) {
+        // Replaced, as by an atomic save
+        change.modified.insert(name);
+    } else {
+        change.added.insert(name);
+    }
+}
+
+void NotesWatcher::noteRemoved(const QString &directory, const QString &name)
+{
+    PendingChange &change = pendingFor(directory);
+    change.modified.remove(name);
+    if (change.added.remove(name)) {
+        // Came and went within the burst
+        return;
+    }
+    auto renamed = change.renamedFrom.find(name);
+    if (renamed != change.renamedFrom.end()) {
+        change.removed.insert(renamed.value());
+        change.renamedFrom.erase(renamed);
+        return;
+    }
+    change.removed.insert(name);
+}
+
+void NotesWatcher::noteModified(const QString &directory, const QString &name)
+{
+    PendingChange &change = pendingFor(directory);
+    if (!change.added.contains(name)) {
+        change.modified.insert(name);
+    }
+}
+
+void NotesWatcher::noteRenamed(const QString &directory, const QString &oldName, const QString &newName)
+{
+    PendingChange &change = pendingFor(directory);
+    if (change.added.remove(oldName)) {
+        change.added.insert(newName);
+        return;
+    }
+    if (change.modified.remove(oldName)) {
+        change.modified.insert(newName);
+    }
+    // Renamed twice within the burst: report it once, from the first name
+    const QString original = change.renamedFrom.take(oldName);
+    change.renamedFrom.insert(newName, original.isEmpty() ? oldName : original);
+}
+
+void NotesWatcher::noteRescan(const QString &directory)
+{
+    pendingFor(directory).rescan = true;
+}
+
+NotesWatcher::PendingChange &NotesWatcher::pendingFor(const QString &directory)
+{
+    if (!m_coalesceTimer.isActive()) {
+        m_coalesceTimer.start();
+    }
+    return m_pending[directory];
+}
+
+void NotesWatcher::flush()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    QList<DirectoryChange> changes;
+    changes.reserve(m_pending.size());
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        const PendingChange &pending = it.value();
+        DirectoryChange change;
+        change.directory = it.key();
+        change.added = pending.added.values();
+        change.removed = pending.removed.values();
+        change.modified = pending.modified.values();
+        for (auto renamed = pending.renamedFrom.constBegin(); renamed != pending.renamedFrom.constEnd(); ++renamed) {
+            if (renamed.value() != renamed.key()) {
+                change.renamed.append(qMakePair(renamed.value(), renamed.key()));
+            }
+        }
+        change.rescan = pending.rescan;
+        if (change.rescan || !change.added.isEmpty() || !change.removed.isEmpty()
+                || !change.modified.isEmpty() || !change.renamed.isEmpty()) {
+            changes << change;
+        }
+    }
+    m_pending.clear();
+
+    // Parents before children, so rows for new folders exist before their
+    // contents are looked at
+    std::sort(changes.begin(), changes.end(), [](const DirectoryChange &a, const DirectoryChange &b) {
+        return a.directory < b.directory;
+    });
+    if (!changes.isEmpty()) {
+        emit changesReady(changes);
+    }
+}
+
+QStringList NotesWatcher::listDirectories(const QString &root)
+{
+    QStringList directories;
+    directories << root;
+    // Hidden folders (.git and the like) are left alone
+    QDirIterator it(root, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        directories << QDir::cleanPath(it.next());
+    }
+    return directories;
+}
+
+bool NotesWatcher::isIgnored(const QString &name)
+{
+    return name.startsWith(QLatin1Char('.'));
+}
@@ -0,0 +1,108 @@
+#ifndef NOTESWATCHER_H
+#define NOTESWATCHER_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <functional>
+
+class FileWatcherGuard;
+class QSocketNotifier;
+
+// Watches everything under a notes root for changes made outside the
+// application (sync tools, editors, the shell).
+//
+// On Linux every directory gets an inotify watch on a single descriptor,
+// which reports names as well as the directory they changed in. Elsewhere,
+// or when inotify is unavailable or out of watches, the directories are
+// watched through a FileWatcherGuard instead, which can only say that a
+// directory changed. Changes are collected for COALESCE_INTERVAL after the
+// first one of a burst, folded per directory (a file created and deleted
+// again in the same burst is not reported at all), and delivered together
+// through changesReady(). Hidden entries are ignored.
+class NotesWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct DirectoryChange {
+        QString directory;
+        QStringList added;     // Names
+        QStringList removed;
+        QStringList modified;
+        QList<QPair<QString, QString>> renamed; // Old and new name
+        bool rescan = false;   // What changed is unknown; list it again
+    };
+
+    explicit NotesWatcher(QObject *parent = nullptr);
+    ~NotesWatcher() override;
+
+    // Starts over on a new root; an empty path stops watching
+    void setRootPath(const QString &path);
+    QString rootPath() const { return m_rootPath; }
+
+    bool usesInotify() const { return m_inotifyFd >= 0; }
+    int watchedDirectoryCount() const;
+
+Q_SIGNALS:
+    void changesReady(const QList<NotesWatcher::DirectoryChange> &changes);
+
+private:
+    struct PendingChange {
+        QSet<QString> added;
+        QSet<QString> removed;
+        QSet<QString> modified;
+        QHash<QString, QString> renamedFrom; // New name -> old name
+        bool rescan = false;
+    };
+
+    void startWatching(const QStringList &directories);
+    void stopWatching();
+    void watchTree(const QString &directory);
+    void watchInBackground(const std::function<QStringList()> &walk);
+    void watchDirectory(const QString &directory);
+    void unwatchTree(const QString &directory);
+    void rebaseTree(const QString &oldPath, const QString &newPath);
+    void switchToFallback();
+
+    void readInotifyEvents();
+    void onFallbackDirectoryChanged(const QString &directory);
+
+    void noteAdded(const QString &directory, const QString &name);
+    void noteRemoved(const QString &directory, const QString &name);
+    void noteModified(const QString &directory, const QString &name);
+    void noteRenamed(const QString &directory, const QString &oldName, const QString &newName);
+    void noteRescan(const QString &directory);
+    PendingChange &pendingFor(const QString &directory);
+    void flush();
+
+    static QStringList listDirectories(const QString &root);
+    static bool isIgnored(const QString &name);
+
+    QString m_rootPath;
+    QFutureWatcher<QStringList> *m_walk = nullptr;
+    QSet<QFutureWatcher<QStringList> *> m_subtreeWalks; // Folders that appeared later
+
+    // inotify backend
+    int m_inotifyFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<int, QString> m_pathByWatch;
+    QHash<QString, int> m_watchByPath;
+
+    // Fallback backend
+    FileWatcherGuard *m_fallback = nullptr;
+    QSet<QString> m_fallbackPaths;
+
+    QHash<QString, PendingChange> m_pending;
+    QTimer m_coalesceTimer;
+
+    static const int COALESCE_INTERVAL = 200; // ms
+};
+
+#endif // NOTESWATCHER_H
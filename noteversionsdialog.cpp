@@ -0,0 +1,125 @@
+#include "noteversionsdialog.h"
+#include "uiutils.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListWidget>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QtConcurrent>
+
+NoteVersionsDialog::NoteVersionsDialog(const QString &notePath, QWidget *parent)
+    : QDialog(parent)
+    , m_notePath(notePath)
+    , m_catalog(BackupEngine::instance()->catalog())
+{
+    setWindowTitle(tr("Previous Versions of %1").arg(QFileInfo(notePath).fileName()));
+    setModal(true);
+
+    auto mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(8, 8, 8, 8);
+    mainLayout->setSpacing(8);
+
+    m_statusLabel = new QLabel(tr("Looking through backups..."), this);
+    m_statusLabel->setWordWrap(true);
+    mainLayout->addWidget(m_statusLabel);
+
+    m_list = new QListWidget(this);
+    mainLayout->addWidget(m_list, 1);
+
+    auto btnLayout = new QHBoxLayout();
+    btnLayout->addStretch();
+    m_restoreBtn = new QPushButton(tr("Restore"), this);
+    m_restoreBtn->setEnabled(false);
+    m_closeBtn = new QPushButton(tr("Close"), this);
+    btnLayout->addWidget(m_restoreBtn);
+    btnLayout->addWidget(m_closeBtn);
+    mainLayout->addLayout(btnLayout);
+
+    UIUtils::makeTouchFriendly(m_list);
+
+    connect(m_list, &QListWidget::itemSelectionChanged, this, &NoteVersionsDialog::onSelectionChanged);
+    connect(m_list, &QListWidget::itemDoubleClicked, this, &NoteVersionsDialog::onRestoreClicked);
+    connect(m_restoreBtn, &QPushButton::clicked, this, &NoteVersionsDialog::onRestoreClicked);
+    connect(m_closeBtn, &QPushButton::clicked, this, &QDialog::reject);
+    connect(&m_watcher, &QFutureWatcher<QList<SnapshotCatalog::Version>>::finished,
+            this, &NoteVersionsDialog::onVersionsLoaded);
+
+    // Snapshots store paths relative to the notes directory
+    const QString relativePath = QDir(BackupEngine::instance()->sourcePath()).relativeFilePath(notePath);
+    const std::shared_ptr<SnapshotCatalog> catalog = m_catalog;
+    m_watcher.setFuture(QtConcurrent::run([catalog, relativePath]() {
+        catalog->refresh();
+        return catalog->versions(relativePath);
+    }));
+
+    resize(420, 360);
+}
+
+NoteVersionsDialog::~NoteVersionsDialog()
+{
+    // The worker only holds its own reference to the catalog
+    m_watcher.waitForFinished();
+}
+
+void NoteVersionsDialog::onVersionsLoaded()
+{
+    m_versions = m_watcher.result();
+    m_list->clear();
+
+    if (m_versions.isEmpty()) {
+        m_statusLabel->setText(tr("No backups of this note were found in %1.")
+                                   .arg(QDir::toNativeSeparators(m_catalog->repositoryPath())));
+        return;
+    }
+    m_statusLabel->setText(tr("%n version(s) found. Restoring one replaces the note as it is now.",
+                              nullptr, m_versions.size()));
+
+    const QFileInfo current(m_notePath);
+    const QLocale locale;
+    for (const SnapshotCatalog::Version &version : m_versions) {
+        QString text = tr("%1  (%2)")
+            .arg(locale.toString(QDateTime::fromMSecsSinceEpoch(version.modified), QLocale::ShortFormat),
+                 locale.formattedDataSize(version.size));
+        if (current.exists() && current.size() == version.size
+            && current.lastModified().toMSecsSinceEpoch() == version.modified) {
+            text += tr(" - current");
+        }
+        auto item = new QListWidgetItem(text, m_list);
+        item->setToolTip(tr("Backed up %1").arg(locale.toString(version.created, QLocale::LongFormat)));
+    }
+}
+
+void NoteVersionsDialog::onSelectionChanged()
+{
+    m_restoreBtn->setEnabled(m_list->currentRow() >= 0 && m_list->currentRow() < m_versions.size());
+}
+
+void NoteVersionsDialog::onRestoreClicked()
+{
+    const int row = m_list->currentRow();
+    if (row < 0 || row >= m_versions.size()) {
+        return;
+    }
+    const SnapshotCatalog::Version &version = m_versions.at(row);
+
+    if (QMessageBox::question(this, tr("Restore Version"),
+            tr("Replace %1 with the version from %2?")
+                .arg(QFileInfo(m_notePath).fileName(),
+                     QLocale().toString(QDateTime::fromMSecsSinceEpoch(version.modified), QLocale::ShortFormat)),
+            QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+        return;
+    }
+
+    emit aboutToRestore(m_notePath);
+    QString error;
+    if (!m_catalog->restore(version, m_notePath, &error)) {
+        QMessageBox::warning(this, tr("Restore Version"), error);
+        return;
+    }
+    emit noteRestored(m_notePath);
+    accept();
+}
@@ -0,0 +1,47 @@
+#ifndef NOTEVERSIONSDIALOG_H
+#define NOTEVERSIONSDIALOG_H
+
+#include "snapshotcatalog.h"
+#include <QDialog>
+#include <QFutureWatcher>
+#include <memory>
+
+class QLabel;
+class QListWidget;
+class QPushButton;
+
+// Lists the backed-up versions of one note and puts a chosen one back in
+// place of the note. The snapshot catalog is brought up to date on a worker
+// thread while the dialog shows.
+class NoteVersionsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit NoteVersionsDialog(const QString &notePath, QWidget *parent = nullptr);
+    ~NoteVersionsDialog() override;
+
+Q_SIGNALS:
+    // Emitted right before the note at notePath is replaced
+    void aboutToRestore(const QString &notePath);
+    // The note at notePath was replaced with a backed-up version
+    void noteRestored(const QString &notePath);
+
+private slots:
+    void onVersionsLoaded();
+    void onRestoreClicked();
+    void onSelectionChanged();
+
+private:
+    QString m_notePath;
+    std::shared_ptr<SnapshotCatalog> m_catalog;
+    QFutureWatcher<QList<SnapshotCatalog::Version>> m_watcher;
+    QList<SnapshotCatalog::Version> m_versions;
+
+    QLabel *m_statusLabel;
+    QListWidget *m_list;
+    QPushButton *m_restoreBtn;
+    QPushButton *m_closeBtn;
+};
+
+#endif // NOTEVERSIONSDIALOG_H
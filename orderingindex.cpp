@@ -0,0 +1,638 @@
+#include "orderingindex.h"
+#include "checksum.h"
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+
+// Static member definitions
+const qint64 OrderingIndex::RANK_GAP;
+const int OrderingIndex::COMPACT_SLACK;
+
+namespace {
+
+constexpr quint32 kIndexMagic = 0x514e4f31; // "QNO1"
+constexpr quint16 kIndexVersion = 1;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_12;
+constexpr const char *kIndexFileName = ".qutenote_order.idx";
+constexpr const char *kLegacyFileName = ".qutenote_order.md";
+
+QByteArray encodeRecord(quint8 type, const QString &key, const QString &name,
+                        qint64 rank, const QString &newKey)
+{
+    QByteArray record;
+    QDataStream recordOut(&record, QIODevice::WriteOnly);
+    recordOut.setVersion(kStreamVersion);
+    recordOut << type << key << name << rank << newKey;
+
+    QByteArray framed;
+    QDataStream out(&framed, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << QuteNote::recordChecksum(record) << record;
+    return framed;
+}
+
+QByteArray encodeHeader()
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kIndexMagic << kIndexVersion;
+    return data;
+}
+
+} // namespace
+
+OrderingIndex::~OrderingIndex()
+{
+    close();
+}
+
+bool OrderingIndex::open(const QString &rootPath)
+{
+    close();
+    if (rootPath.isEmpty()) {
+        return false;
+    }
+    m_rootPath = QDir::cleanPath(QFileInfo(rootPath).absoluteFilePath());
+    const QString indexPath = QDir(m_rootPath).filePath(QString::fromLatin1(kIndexFileName));
+
+    bool rewrite = false;
+    if (QFileInfo::exists(indexPath)) {
+        // A torn tail is dropped; writing back what was read removes it
+        rewrite = !load();
+    } else {
+        // Compacts on its own if there was anything to migrate
+        migrateLegacyFiles();
+        rewrite = !m_log.isOpen();
+    }
+    if (m_recordCount > 2 * entryCount() + COMPACT_SLACK) {
+        rewrite = true;
+    }
+
+    if (rewrite) {
+        return compact();
+    }
+
+    m_log.setFileName(indexPath);
+    if (!m_log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot open ordering index" << indexPath << m_log.errorString();
+        return false;
+    }
+    return true;
+}
+
+void OrderingIndex::close()
+{
+    m_batchDepth = 0;
+    writePending();
+    if (m_log.isOpen()) {
+        m_log.close();
+    }
+    m_directories.clear();
+    m_rootPath.clear();
+    m_recordCount = 0;
+}
+
+QFileInfoList OrderingIndex::order(const QString &directory, const QFileInfoList &entries)
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    if (!ok) {
+        return entries;
+    }
+
+    if (!m_directories.contains(key)) {
+        // Copied or synced in from an older version after the migration
+        const QString legacyPath = QDir(directory).filePath(QString::fromLatin1(kLegacyFileName));
+        if (QFileInfo::exists(legacyPath) && importLegacyFile(key, legacyPath)) {
+            QFile::remove(legacyPath);
+        }
+    }
+
+    QHash<QString, QFileInfo> infoByName;
+    infoByName.reserve(entries.size());
+    for (const QFileInfo &info : entries) {
+        if (!isIndexFile(info.fileName())) {
+            infoByName.insert(info.fileName(), info);
+        }
+    }
+
+    QFileInfoList ordered;
+    ordered.reserve(infoByName.size());
+    QStringList stale;
+    auto dir = m_directories.constFind(key);
+    if (dir != m_directories.constEnd()) {
+        for (auto it = dir->namesByRank.constBegin(); it != dir->namesByRank.constEnd(); ++it) {
+            auto info = infoByName.find(it.value());
+            if (info == infoByName.end()) {
+                stale << it.value();
+            } else {
+                ordered << info.value();
+                infoByName.erase(info);
+            }
+        }
+    }
+
+    for (const QString &name : std::as_const(stale)) {
+        record(RemoveName, key, name);
+    }
+
+    QStringList leftovers = infoByName.keys();
+    std::sort(leftovers.begin(), leftovers.end(), [](const QString &a, const QString &b) {
+        return a.localeAwareCompare(b) < 0;
+    });
+    for (const QString &name : std::as_const(leftovers)) {
+        placeName(key, name, QString());
+        ordered << infoByName.value(name);
+    }
+    return ordered;
+}
+
+QStringList OrderingIndex::names(const QString &directory) const
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    auto dir = ok ? m_directories.constFind(key) : m_directories.constEnd();
+    return dir != m_directories.constEnd() ? QStringList(dir->namesByRank.values()) : QStringList();
+}
+
+bool OrderingIndex::contains(const QString &directory, const QString &name) const
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    return ok && hasName(key, name);
+}
+
+void OrderingIndex::insert(const QString &directory, const QString &name, const QString &beforeName)
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    if (ok && !name.isEmpty()) {
+        placeName(key, name, beforeName);
+    }
+}
+
+void OrderingIndex::remove(const QString &directory, const QString &name)
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    if (!ok || name.isEmpty()) {
+        return;
+    }
+    if (hasName(key, name) || m_directories.contains(childKey(key, name))) {
+        record(RemoveName, key, name);
+    }
+}
+
+void OrderingIndex::rename(const QString &directory, const QString &oldName, const QString &newName)
+{
+    bool ok = false;
+    const QString key = keyFor(directory, &ok);
+    if (!ok || oldName == newName || newName.isEmpty()) {
+        return;
+    }
+    if (!hasName(key, oldName)) {
+        // Not ordered yet; the next listing places it
+        return;
+    }
+    record(RenameName, key, oldName, 0, newName);
+}
+
+void OrderingIndex::move(const QString &oldDirectory, const QString &name,
+                         const QString &newDirectory, const QString &beforeName)
+{
+    bool oldOk = false;
+    bool newOk = false;
+    const QString oldKey = keyFor(oldDirectory, &oldOk);
+    const QString newKey = keyFor(newDirectory, &newOk);
+    if (!oldOk || !newOk || name.isEmpty()) {
+        return;
+    }
+    if (oldKey == newKey) {
+        placeName(newKey, name, beforeName);
+        return;
+    }
+
+    // The order inside a moved folder goes along with it
+    const QString oldChild = childKey(oldKey, name);
+    const QString newChild = childKey(newKey, name);
+    if (!subtreeKeys(oldChild).isEmpty()) {
+        record(RenameDirectory, oldChild, QString(), 0, newChild);
+    }
+    if (hasName(oldKey, name)) {
+        record(RemoveName, oldKey, name);
+    }
+    placeName(newKey, name, beforeName);
+}
+
+bool OrderingIndex::isIndexFile(const QString &fileName)
+{
+    return fileName == QLatin1String(kIndexFileName) || fileName == QLatin1String(kLegacyFileName);
+}
+
+QString OrderingIndex::keyFor(const QString &directory, bool *ok) const
+{
+    *ok = false;
+    if (m_rootPath.isEmpty()) {
+        return QString();
+    }
+    const QString path = QDir::cleanPath(QFileInfo(directory.isEmpty() ? m_rootPath : directory).absoluteFilePath());
+    if (path == m_rootPath) {
+        *ok = true;
+        return QString();
+    }
+    const QString relative = QDir(m_rootPath).relativeFilePath(path);
+    if (relative.startsWith(QLatin1String("..")) || QDir::isAbsolutePath(relative)) {
+        return QString();
+    }
+    *ok = true;
+    return relative;
+}
+
+bool OrderingIndex::hasName(const QString &key, const QString &name) const
+{
+    auto dir = m_directories.constFind(key);
+    return dir != m_directories.constEnd() && dir->rankByName.contains(name);
+}
+
+QString OrderingIndex::childKey(const QString &key, const QString &name)
+{
+    return key.isEmpty() ? name : key + QLatin1Char('/') + name;
+}
+
+QStringList OrderingIndex::subtreeKeys(const QString &key) const
+{
+    QStringList keys;
+    if (m_directories.contains(key)) {
+        keys << key;
+    }
+    // Names such as "a b" sort between "a" and "a/", so the range starts at
+    // the separator rather than at key itself
+    const QString prefix = key.isEmpty() ? QString() : key + QLatin1Char('/');
+    for (auto it = m_directories.lowerBound(prefix);
+         it != m_directories.constEnd() && it.key().startsWith(prefix); ++it) {
+        if (it.key() != key) {
+            keys << it.key();
+        }
+    }
+    return keys;
+}
+
+void OrderingIndex::applySetRank(const QString &key, const QString &name, qint64 rank)
+{
+    Directory &dir = m_directories[key];
+    auto existing = dir.rankByName.find(name);
+    if (existing != dir.rankByName.end()) {
+        dir.namesByRank.remove(existing.value());
+    }
+    dir.rankByName.insert(name, rank);
+    dir.namesByRank.insert(rank, name);
+}
+
+void OrderingIndex::applyRemoveName(const QString &key, const QString &name)
+{
+    auto dir = m_directories.find(key);
+    if (dir != m_directories.end()) {
+        auto existing = dir->rankByName.find(name);
+        if (existing != dir->rankByName.end()) {
+            dir->namesByRank.remove(existing.value());
+            dir->rankByName.erase(existing);
+        }
+        if (dir->rankByName.isEmpty()) {
+            m_directories.erase(dir);
+        }
+    }
+
+    // A note has no subtree, and costs one lookup here
+    const QStringList subtree = subtreeKeys(childKey(key, name));
+    for (const QString &subKey : subtree) {
+        m_directories.remove(subKey);
+    }
+}
+
+void OrderingIndex::applyRenameName(const QString &key, const QString &oldName, const QString &newName)
+{
+    auto dir = m_directories.find(key);
+    if (dir == m_directories.end()) {
+        return;
+    }
+    auto existing = dir->rankByName.find(oldName);
+    if (existing == dir->rankByName.end()) {
+        return;
+    }
+    const qint64 rank = existing.value();
+    dir->rankByName.erase(existing);
+
+    // A name already taking newName gives up its place
+    auto clash = dir->rankByName.find(newName);
+    if (clash != dir->rankByName.end()) {
+        dir->namesByRank.remove(clash.value());
+        dir->rankByName.erase(clash);
+    }
+
+    dir->rankByName.insert(newName, rank);
+    dir->namesByRank.insert(rank, newName);
+    applyRenameDirectory(childKey(key, oldName), childKey(key, newName));
+}
+
+void OrderingIndex::applyRenameDirectory(const QString &oldKey, const QString &newKey)
+{
+    QHash<QString, Directory> moved;
+    const QStringList oldKeys = subtreeKeys(oldKey);
+    for (const QString &key : oldKeys) {
+        moved.insert(newKey + key.mid(oldKey.size()), m_directories.take(key));
+    }
+    // Leftovers of whatever was there before
+    const QStringList replaced = subtreeKeys(newKey);
+    for (const QString &key : replaced) {
+        m_directories.remove(key);
+    }
+    for (auto it = moved.constBegin(); it != moved.constEnd(); ++it) {
+        m_directories.insert(it.key(), it.value());
+    }
+}
+
+void OrderingIndex::applyRecord(RecordType type, const QString &key, const QString &name,
+                                qint64 rank, const QString &newKey)
+{
+    switch (type) {
+    case SetRank:
+        applySetRank(key, name, rank);
+        break;
+    case RemoveName:
+        applyRemoveName(key, name);
+        break;
+    case RenameName:
+        applyRenameName(key, name, newKey);
+        break;
+    case RenameDirectory:
+        applyRenameDirectory(key, newKey);
+        break;
+    }
+}
+
+void OrderingIndex::record(RecordType type, const QString &key, const QString &name,
+                           qint64 rank, const QString &newKey)
+{
+    applyRecord(type, key, name, rank, newKey);
+
+    // Nothing is logged while migrating; compact() writes it all at once
+    if (!m_log.isOpen()) {
+        return;
+    }
+    m_pending += encodeRecord(type, key, name, rank, newKey);
+    ++m_pendingRecords;
+    if (m_batchDepth == 0) {
+        writePending();
+    }
+}
+
+void OrderingIndex::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void OrderingIndex::commitBatch()
+{
+    if (m_batchDepth > 0 && --m_batchDepth == 0) {
+        writePending();
+    }
+}
+
+void OrderingIndex::writePending()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    const QByteArray pending = m_pending;
+    const int records = m_pendingRecords;
+    m_pending.clear();
+    m_pendingRecords = 0;
+
+    if (m_log.write(pending) != pending.size() || !m_log.flush()) {
+        qWarning() << "Failed to append to ordering index" << m_log.fileName() << m_log.errorString();
+        return;
+    }
+
+    // Counting entries walks every folder, so it is only done now and then
+    const int before = m_recordCount;
+    m_recordCount += records;
+    if (m_recordCount / 256 != before / 256 && m_recordCount > 2 * entryCount() + COMPACT_SLACK) {
+        compact();
+    }
+}
+
+void OrderingIndex::placeName(const QString &key, const QString &name, const QString &beforeName)
+{
+    static const Directory noDirectory;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        auto found = m_directories.constFind(key);
+        const Directory &dir = found != m_directories.constEnd() ? found.value() : noDirectory;
+        const auto end = dir.namesByRank.constEnd();
+
+        auto next = end;
+        if (!beforeName.isEmpty() && beforeName != name && dir.rankByName.contains(beforeName)) {
+            next = dir.namesByRank.constFind(dir.rankByName.value(beforeName));
+        }
+
+        if (next != dir.namesByRank.constBegin() && std::prev(next).value() == name) {
+            // Already there
+            return;
+        }
+
+        // The closest rank in front of the new place, not counting name itself
+        auto previous = next;
+        bool hasPrevious = false;
+        while (previous != dir.namesByRank.constBegin()) {
+            --previous;
+            if (previous.value() != name) {
+                hasPrevious = true;
+                break;
+            }
+        }
+
+        qint64 rank = 0;
+        if (next == end) {
+            rank = hasPrevious ? previous.key() + RANK_GAP : 0;
+        } else {
+            const qint64 lower = hasPrevious ? previous.key() : next.key() - 2 * RANK_GAP;
+            rank = lower + (next.key() - lower) / 2;
+            if (rank == lower || rank == next.key()) {
+                renumber(key);
+                continue;
+            }
+        }
+        record(SetRank, key, name, rank);
+        return;
+    }
+    qWarning() << "Could not find a place for" << name << "in the ordering of" << key;
+}
+
+void OrderingIndex::renumber(const QString &key)
+{
+    // New ranks start past the current ones, so replaying the log never sees
+    // two names on the same rank
+    const Directory dir = m_directories.value(key);
+    if (dir.namesByRank.isEmpty()) {
+        return;
+    }
+    qint64 rank = dir.namesByRank.lastKey();
+    for (auto it = dir.namesByRank.constBegin(); it != dir.namesByRank.constEnd(); ++it) {
+        rank += RANK_GAP;
+        record(SetRank, key, it.value(), rank);
+    }
+}
+
+bool OrderingIndex::load()
+{
+    QFile file(QDir(m_rootPath).filePath(QString::fromLatin1(kIndexFileName)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot read ordering index" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion) {
+        qWarning() << "Ignoring unreadable ordering index" << file.fileName();
+        return false;
+    }
+
+    // Records are only ever appended, so everything before a torn or corrupt
+    // one is intact
+    while (!in.atEnd()) {
+        quint32 checksum = 0;
+        QByteArray framed;
+        in >> checksum >> framed;
+        if (in.status() != QDataStream::Ok || QuteNote::recordChecksum(framed) != checksum) {
+            qWarning() << "Dropping damaged tail of ordering index" << file.fileName();
+            return false;
+        }
+
+        QDataStream recordIn(framed);
+        recordIn.setVersion(kStreamVersion);
+        quint8 type = 0;
+        QString key;
+        QString name;
+        qint64 rank = 0;
+        QString newKey;
+        recordIn >> type >> key >> name >> rank >> newKey;
+        if (recordIn.status() != QDataStream::Ok || type < SetRank || type > RenameDirectory) {
+            qWarning() << "Dropping damaged tail of ordering index" << file.fileName();
+            return false;
+        }
+        applyRecord(static_cast<RecordType>(type), key, name, rank, newKey);
+        ++m_recordCount;
+    }
+    return true;
+}
+
+void OrderingIndex::migrateLegacyFiles()
+{
+    QStringList imported;
+    QDirIterator it(m_rootPath, QStringList() << QString::fromLatin1(kLegacyFileName),
+                    QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString legacyPath = it.next();
+        bool ok = false;
+        const QString key = keyFor(QFileInfo(legacyPath).absolutePath(), &ok);
+        if (ok && importLegacyFile(key, legacyPath)) {
+            imported << legacyPath;
+        }
+    }
+
+    // The old files go only once the index holding their order is on disk
+    if (!imported.isEmpty() && compact()) {
+        for (const QString &legacyPath : std::as_const(imported)) {
+            if (!QFile::remove(legacyPath)) {
+                qWarning() << "Could not remove migrated ordering file" << legacyPath;
+            }
+        }
+    }
+}
+
+bool OrderingIndex::importLegacyFile(const QString &key, const QString &legacyPath)
+{
+    QFile file(legacyPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "Failed to read ordering metadata" << legacyPath << file.errorString();
+        return false;
+    }
+
+    QStringList names;
+    QSet<QString> seen;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (line.startsWith(QStringLiteral("- ")) || line.startsWith(QStringLiteral("* "))) {
+            const QString name = line.mid(2).trimmed();
+            if (!name.isEmpty() && !seen.contains(name)) {
+                seen.insert(name);
+                names << name;
+            }
+        }
+    }
+
+    // Appended after anything already known about the folder
+    for (const QString &name : std::as_const(names)) {
+        placeName(key, name, QString());
+    }
+    return true;
+}
+
+bool OrderingIndex::compact()
+{
+    const QString indexPath = QDir(m_rootPath).filePath(QString::fromLatin1(kIndexFileName));
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write ordering index" << indexPath << file.errorString();
+        return false;
+    }
+
+    int records = 0;
+    file.write(encodeHeader());
+    for (auto dir = m_directories.constBegin(); dir != m_directories.constEnd(); ++dir) {
+        const QMap<qint64, QString> &namesByRank = dir->namesByRank;
+        for (auto it = namesByRank.constBegin(); it != namesByRank.constEnd(); ++it) {
+            file.write(encodeRecord(SetRank, dir.key(), it.value(), it.key(), QString()));
+            ++records;
+        }
+    }
+    if (!file.commit()) {
+        qWarning() << "Failed to commit ordering index" << indexPath << file.errorString();
+        return false;
+    }
+
+    // The log now continues the rewritten file, which already has anything
+    // that was waiting to be appended
+    m_pending.clear();
+    m_pendingRecords = 0;
+    if (m_log.isOpen()) {
+        m_log.close();
+    }
+    m_recordCount = records;
+    m_log.setFileName(indexPath);
+    if (!m_log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Cannot open ordering index" << indexPath << m_log.errorString();
+        return false;
+    }
+    return true;
+}
+
+int OrderingIndex::entryCount() const
+{
+    int count = 0;
+    for (const Directory &dir : m_directories) {
+        count += dir.rankByName.size();
+    }
+    return count;
+}
@@ -0,0 +1,111 @@
+#ifndef ORDERINGINDEX_H
+#define ORDERINGINDEX_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// The user's ordering of every folder under a notes root, kept in a single
+// file (.qutenote_order.idx) at the root.
+//
+// Each entry has a sparse integer rank, so placing a name before another or
+// at the end only picks a rank between its neighbours (O(log n)); a folder
+// is renumbered when two neighbours run out of room. The file is an
+// append-only log of small changes, read once when the root is opened and
+// rewritten compactly when the log has grown well past what it describes.
+// Roots that still have per-folder .qutenote_order.md files are migrated on
+// first open, and a stray legacy file found later is folded in when its
+// folder is first ordered.
+class OrderingIndex
+{
+public:
+    OrderingIndex() = default;
+    ~OrderingIndex();
+
+    bool open(const QString &rootPath);
+    void close();
+    bool isOpen() const { return m_log.isOpen(); }
+    QString rootPath() const { return m_rootPath; }
+
+    // Sorts a listing of directory by the recorded order. Names not seen
+    // before go last in locale order and are recorded; names no longer in
+    // the listing are forgotten.
+    QFileInfoList order(const QString &directory, const QFileInfoList &entries);
+    QStringList names(const QString &directory) const;
+    bool contains(const QString &directory, const QString &name) const;
+
+    // Places name in front of beforeName, or last if beforeName is empty or
+    // not in the folder. Also how an existing name is moved.
+    void insert(const QString &directory, const QString &name, const QString &beforeName = QString());
+    // Forgets name, and the order inside it if it is a folder
+    void remove(const QString &directory, const QString &name);
+    // Keeps the place (and the order inside a renamed folder)
+    void rename(const QString &directory, const QString &oldName, const QString &newName);
+    // Moves name into another folder, in front of beforeName
+    void move(const QString &oldDirectory, const QString &name,
+              const QString &newDirectory, const QString &beforeName = QString());
+
+    // Changes made until the matching commitBatch() are written together
+    void beginBatch();
+    void commitBatch();
+
+    static bool isIndexFile(const QString &fileName);
+
+private:
+    enum RecordType : quint8 {
+        SetRank = 1,
+        RemoveName = 2,      // Along with the order inside it
+        RenameName = 3,      // Keeps the rank; newKey holds the new name
+        RenameDirectory = 4  // Every folder under key moves to newKey
+    };
+
+    struct Directory {
+        QMap<qint64, QString> namesByRank;
+        QHash<QString, qint64> rankByName;
+    };
+
+    QString keyFor(const QString &directory, bool *ok) const;
+    bool hasName(const QString &key, const QString &name) const;
+    static QString childKey(const QString &key, const QString &name);
+    // key and the folders inside it, found without visiting any other folder
+    QStringList subtreeKeys(const QString &key) const;
+
+    // Applied to memory only; used both for changes and for replaying the log
+    void applySetRank(const QString &key, const QString &name, qint64 rank);
+    void applyRemoveName(const QString &key, const QString &name);
+    void applyRenameName(const QString &key, const QString &oldName, const QString &newName);
+    void applyRenameDirectory(const QString &oldKey, const QString &newKey);
+    void applyRecord(RecordType type, const QString &key, const QString &name,
+                     qint64 rank, const QString &newKey);
+
+    // Applied and logged
+    void record(RecordType type, const QString &key, const QString &name = QString(),
+                qint64 rank = 0, const QString &newKey = QString());
+    void placeName(const QString &key, const QString &name, const QString &beforeName);
+    void renumber(const QString &key);
+
+    bool load();
+    void migrateLegacyFiles();
+    bool importLegacyFile(const QString &key, const QString &legacyPath);
+    void writePending();
+    bool compact();
+    int entryCount() const;
+
+    QString m_rootPath;
+    QFile m_log;
+    // By path relative to the root. Ordered, so a folder's subfolders are
+    // the keys that follow "key/".
+    QMap<QString, Directory> m_directories;
+    int m_recordCount = 0;
+    QByteArray m_pending;
+    int m_pendingRecords = 0;
+    int m_batchDepth = 0;
+
+    static const qint64 RANK_GAP = 1 << 16;
+    static const int COMPACT_SLACK = 1024;
+};
+
+#endif // ORDERINGINDEX_H
@@ -0,0 +1,20 @@
+#ifndef PATHS_H
+#define PATHS_H
+
+#include <QString>
+
+namespace QuteNote {
+
+// True if path is ancestor itself or lies somewhere below it. Both are
+// expected to be clean ('/'-separated, no trailing slash), so "a/bc" is not
+// under "a/b".
+inline bool isPathUnder(const QString &path, const QString &ancestor)
+{
+    return path == ancestor
+        || (path.size() > ancestor.size() && path.startsWith(ancestor)
+            && path.at(ancestor.size()) == QLatin1Char('/'));
+}
+
+} // namespace QuteNote
+
+#endif // PATHS_H
@@ -1,15 +1,155 @@
 #include "physicsengine.h"
+#include "framescheduler.h"
+#include "springsystem.h"
+#include "smartpointers.h"
+#include <QHash>
+#include <QPointer>
+#include <utility>
+
+// Every running PhysicsEngine: FixedStep springs in one SpringSystem and
+// the list of Analytic ones, stepped together as a single FrameScheduler
+// client.
+class PhysicsEngineBatch : public QObject, public QuteNote::Singleton<PhysicsEngineBatch>
+{
+    friend class QuteNote::Singleton<PhysicsEngineBatch>;
+
+public:
+    SpringSystem::Handle add(PhysicsEngine *engine, const PhysicsState &state)
+    {
+        const SpringSystem::Handle handle = m_springs.add(state);
+        m_engines.insert(handle, engine);
+        updateScheduling();
+        return handle;
+    }
+
+    PhysicsState remove(SpringSystem::Handle handle)
+    {
+        m_engines.remove(handle);
+        const PhysicsState state = m_springs.remove(handle);
+        updateScheduling();
+        return state;
+    }
+
+    void addAnalytic(PhysicsEngine *engine)
+    {
+        if (!m_analytic.contains(engine)) {
+            m_analytic.append(engine);
+            updateScheduling();
+        }
+    }
+
+    void removeAnalytic(PhysicsEngine *engine)
+    {
+        if (m_analytic.removeOne(engine)) {
+            updateScheduling();
+        }
+    }
+
+    void addVelocity(SpringSystem::Handle handle, qreal velocity)
+    {
+        m_springs.addVelocity(handle, velocity);
+    }
+
+private:
+    PhysicsEngineBatch() = default;
+    ~PhysicsEngineBatch() override = default;
+
+    bool isRunning() const
+    {
+        return m_springs.size() > 0 || !m_analytic.isEmpty();
+    }
+
+    void updateScheduling()
+    {
+        FrameScheduler *scheduler = FrameScheduler::instance();
+        if (!isRunning()) {
+            scheduler->unschedule(this);
+        } else if (!scheduler->isScheduled(this)) {
+            scheduler->schedule(this, [this](qreal deltaTime) {
+                return step(deltaTime);
+            });
+        }
+    }
+
+    bool step(qreal deltaTime)
+    {
+        m_springs.step(deltaTime, &m_moved, &m_settled);
+
+        // Analytic springs just evaluate their solution at the new time and
+        // stop at the frame their settle time falls in
+        QVector<QPointer<PhysicsEngine>> analyticMoved;
+        QVector<QPointer<PhysicsEngine>> analyticSettled;
+        const QVector<PhysicsEngine *> analytic = m_analytic;
+        for (PhysicsEngine *engine : analytic) {
+            bool moved = false;
+            if (engine->advanceAnalytic(deltaTime, &moved)) {
+                engine->m_analyticRunning = false;
+                m_analytic.removeOne(engine);
+                analyticSettled.append(engine);
+            } else if (moved) {
+                analyticMoved.append(engine);
+            }
+        }
+
+        // Engines may stop, start or delete others from their signals, so
+        // settled springs leave the batch before any engine is told, and
+        // moved ones are checked against their engine again
+        QVector<QPair<QPointer<PhysicsEngine>, PhysicsState>> settled;
+        for (SpringSystem::Handle handle : std::as_const(m_settled)) {
+            PhysicsEngine *engine = m_engines.take(handle);
+            engine->m_springHandle = -1;
+            settled.append({engine, m_springs.remove(handle)});
+        }
+        QVector<QPair<SpringSystem::Handle, PhysicsEngine *>> moved;
+        for (SpringSystem::Handle handle : std::as_const(m_moved)) {
+            moved.append({handle, m_engines.value(handle)});
+        }
+
+        for (const auto &entry : std::as_const(settled)) {
+            if (entry.first) {
+                entry.first->springSettled(entry.second);
+            }
+        }
+        for (const auto &entry : std::as_const(moved)) {
+            // A stopped or deleted engine has left m_engines
+            if (m_engines.value(entry.first) == entry.second) {
+                entry.second->springMoved(m_springs.state(entry.first));
+            }
+        }
+
+        for (const QPointer<PhysicsEngine> &engine : std::as_const(analyticSettled)) {
+            // Report the landing on the target; unless that restarted the
+            // spring, it is done
+            if (engine) {
+                engine->springMoved(engine->m_state);
+            }
+            if (engine && !engine->isActive()) {
+                engine->springSettled(engine->m_state);
+            }
+        }
+        for (const QPointer<PhysicsEngine> &engine : std::as_const(analyticMoved)) {
+            if (engine && engine->m_analyticRunning) {
+                engine->springMoved(engine->m_state);
+            }
+        }
+        return isRunning();
+    }
+
+    SpringSystem m_springs;
+    QHash<SpringSystem::Handle, PhysicsEngine *> m_engines;
+    QVector<SpringSystem::Handle> m_moved;
+    QVector<SpringSystem::Handle> m_settled;
+    QVector<PhysicsEngine *> m_analytic;
+};
 
 PhysicsEngine::PhysicsEngine(QObject *parent)
     : QObject(parent)
-    , m_minimumTimestep(DEFAULT_MIN_TIMESTEP)
-    , m_maximumTimestep(DEFAULT_MAX_TIMESTEP)
-    , m_accumulatedTime(0)
-    , m_lastFrameTime(0)
+    , m_integration(FixedStep)
+    , m_springHandle(-1)
+    , m_elapsed(0)
+    , m_notifiedPosition(0)
+    , m_analyticRunning(false)
 {
-    // Set up update timer with default 60 Hz rate
-    m_updateTimer.setInterval(16);
-    connect(&m_updateTimer, &QTimer::timeout, this, &PhysicsEngine::updatePhysics);
 }
 
 PhysicsEngine::~PhysicsEngine()
@@ -17,77 +157,117 @@ PhysicsEngine::~PhysicsEngine()
     stop();
 }
 
-void PhysicsEngine::setUpdateInterval(int msecs)
+void PhysicsEngine::setIntegration(Integration integration)
+{
+    m_integration = integration;
+}
+
+void PhysicsEngine::start()
 {
-    m_updateTimer.setInterval(msecs);
+    if (isActive()) {
+        return;
+    }
+    if (m_integration == Analytic && AnalyticSpring::isSolvable(m_state)) {
+        m_analyticRunning = true;
+        m_notifiedPosition = m_state.position;
+        releaseAnalytic();
+        PhysicsEngineBatch::instance()->addAnalytic(this);
+    } else {
+        m_springHandle = PhysicsEngineBatch::instance()->add(this, m_state);
+    }
 }
 
-void PhysicsEngine::setMinimumTimestep(qreal msecs)
+void PhysicsEngine::stop()
 {
-    m_minimumTimestep = qBound(1.0/1000.0, msecs, m_maximumTimestep);
+    if (m_springHandle >= 0) {
+        m_state = PhysicsEngineBatch::instance()->remove(m_springHandle);
+        m_springHandle = -1;
+    }
+    if (m_analyticRunning) {
+        m_analyticRunning = false;
+        updateAnalyticState();
+        PhysicsEngineBatch::instance()->removeAnalytic(this);
+    }
 }
 
-void PhysicsEngine::setMaximumTimestep(qreal msecs)
+void PhysicsEngine::reset()
 {
-    m_maximumTimestep = qBound(m_minimumTimestep, msecs, 1.0/10.0);
+    stop();
+    m_state.reset();
 }
 
-void PhysicsEngine::start()
+void PhysicsEngine::addVelocity(qreal velocity)
 {
-    if (!m_updateTimer.isActive()) {
-        m_elapsedTimer.start();
-        m_lastFrameTime = 0;
-        m_accumulatedTime = 0;
-        m_updateTimer.start();
+    if (m_analyticRunning) {
+        // A new solution from where the spring is now
+        updateAnalyticState();
+        m_state.velocity += velocity;
+        releaseAnalytic();
+        return;
+    }
+    m_state.velocity += velocity;
+    if (m_springHandle >= 0) {
+        PhysicsEngineBatch::instance()->addVelocity(m_springHandle, velocity);
     }
 }
 
-void PhysicsEngine::stop()
+qreal PhysicsEngine::remainingTime() const
 {
-    m_updateTimer.stop();
+    return m_analyticRunning ? qMax<qreal>(0.0, m_solution.settleTime() - m_elapsed) : -1.0;
 }
 
-void PhysicsEngine::reset()
+void PhysicsEngine::releaseAnalytic()
 {
-    stop();
-    m_state.reset();
-    m_accumulatedTime = 0;
-    m_lastFrameTime = 0;
+    m_solution = AnalyticSpring(m_state, SpringSystem::POSITION_THRESHOLD, SpringSystem::VELOCITY_THRESHOLD);
+    m_elapsed = 0;
 }
 
-void PhysicsEngine::updatePhysics()
+void PhysicsEngine::updateAnalyticState()
 {
-    // Calculate elapsed time since last frame in seconds
-    qreal currentTime = m_elapsedTimer.elapsed() / 1000.0;
-    qreal deltaTime = m_lastFrameTime > 0 ? currentTime - m_lastFrameTime : 0;
-    m_lastFrameTime = currentTime;
-    
-    // Clamp deltaTime to prevent spiral of death
-    deltaTime = qBound(m_minimumTimestep, deltaTime, m_maximumTimestep);
-    
-    // Add to accumulated time
-    m_accumulatedTime += deltaTime;
-    
-    // Fixed timestep update with interpolation for smooth rendering
-    while (m_accumulatedTime >= m_minimumTimestep) {
-        m_state.applySpringForce(m_minimumTimestep);
-        m_accumulatedTime -= m_minimumTimestep;
-        
-        // Check if simulation has settled
-        if (isSimulationComplete()) {
-            stop();
-            emit simulationComplete();
-            return;
+    m_state.position = m_solution.position(m_elapsed);
+    m_state.velocity = m_solution.velocity(m_elapsed);
+    m_state.acceleration = -m_state.springConstant * (m_state.position - m_state.targetPosition)
+                           - m_state.damping * m_state.velocity;
+}
+
+bool PhysicsEngine::advanceAnalytic(qreal deltaTime, bool *moved)
+{
+    m_elapsed += deltaTime;
+    if (m_elapsed >= m_solution.settleTime()) {
+        // Within the thresholds from here on: land exactly
+        m_state.position = m_state.targetPosition;
+        m_state.velocity = 0;
+        m_state.acceleration = 0;
+        return true;
+    }
+
+    updateAnalyticState();
+    if (m_state.minLimit != m_state.maxLimit) {
+        const qreal clamped = qBound(m_state.minLimit, m_state.position, m_state.maxLimit);
+        if (clamped != m_state.position) {
+            // Stopped at the limit, as the fixed-step path does; the rest
+            // of the motion is a new solution from there
+            m_state.position = clamped;
+            m_state.velocity = 0;
+            releaseAnalytic();
         }
     }
-    
-    // Notify about state update
+
+    *moved = qAbs(m_state.position - m_notifiedPosition) > SpringSystem::NOTIFY_THRESHOLD;
+    if (*moved) {
+        m_notifiedPosition = m_state.position;
+    }
+    return false;
+}
+
+void PhysicsEngine::springMoved(const PhysicsState &state)
+{
+    m_state = state;
     emit stateUpdated(m_state);
 }
 
-bool PhysicsEngine::isSimulationComplete() const
+void PhysicsEngine::springSettled(const PhysicsState &state)
 {
-    // Check if the system has settled (very low velocity and close to target)
-    return qAbs(m_state.velocity) < VELOCITY_THRESHOLD &&
-           qAbs(m_state.position - m_state.targetPosition) < POSITION_THRESHOLD;
-}
\ No newline at end of file
+    m_state = state;
+    emit simulationComplete();
+}
@@ -2,10 +2,9 @@
 #define PHYSICSENGINE_H
 
 #include <QObject>
-#include <QElapsedTimer>
-#include <QTimer>
 #include <QPointF>
 #include <QtMath>
+#include "analyticspring.h"
 
 class PhysicsState {
 public:
@@ -53,24 +52,42 @@ public:
     }
 };
 
+// One spring, animated as part of the shared batch of running springs.
+//
+// FixedStep springs live in the batch's SpringSystem, which integrates them
+// all together in substeps. Analytic springs are evaluated in closed form
+// from the time since they were released (see AnalyticSpring) and know
+// their settle time up front, so they stop at exactly that frame instead of
+// testing for rest after every substep. FrameScheduler steps the batch once
+// per display frame; stateUpdated() is only emitted for frames that moved
+// this spring visibly. state() is the last reported state. Changes made to
+// it take effect at the next start(); use addVelocity() on a running spring.
 class PhysicsEngine : public QObject {
     Q_OBJECT
+    friend class PhysicsEngineBatch;
     
 public:
+    enum Integration {
+        FixedStep,  // Semi-implicit Euler substeps
+        Analytic    // Closed-form solution; needs springConstant > 0
+    };
+
     explicit PhysicsEngine(QObject *parent = nullptr);
     ~PhysicsEngine();
     
-    // Physics configuration
-    void setUpdateInterval(int msecs);
-    void setMinimumTimestep(qreal msecs);
-    void setMaximumTimestep(qreal msecs);
+    // Physics configuration; a change applies from the next start()
+    Integration integration() const { return m_integration; }
+    void setIntegration(Integration integration);
     
     // Physics state
-    // Use the correct QTimer member to report activity
-    bool isActive() const { return m_updateTimer.isActive(); }
+    bool isActive() const { return m_springHandle >= 0 || m_analyticRunning; }
     void start();
     void stop();
     void reset();
+    void addVelocity(qreal velocity);
+    
+    // Seconds until a running analytic spring comes to rest, -1 if unknown
+    qreal remainingTime() const;
     
     // State access
     PhysicsState& state() { return m_state; }
@@ -80,25 +97,26 @@ signals:
     void stateUpdated(const PhysicsState &state);
     void simulationComplete();
     
-private slots:
-    void updatePhysics();
-    
 private:
-    bool isSimulationComplete() const;
+    // Called by the batch after a frame
+    void springMoved(const PhysicsState &state);
+    void springSettled(const PhysicsState &state);
     
-    QTimer m_updateTimer;
-    QElapsedTimer m_elapsedTimer;
-    PhysicsState m_state;
+    // Advances a running analytic spring into m_state; true once it has
+    // reached its settle time, with the spring placed on its target
+    bool advanceAnalytic(qreal deltaTime, bool *moved);
+    void releaseAnalytic();
+    void updateAnalyticState();
     
-    qreal m_minimumTimestep;
-    qreal m_maximumTimestep;
-    qreal m_accumulatedTime;
-    qreal m_lastFrameTime;
+    PhysicsState m_state;
+    Integration m_integration;
+    int m_springHandle; // In the batch's SpringSystem, -1 while stopped
     
-    static constexpr qreal DEFAULT_MIN_TIMESTEP = 1.0/240.0;  // 240 Hz max
-    static constexpr qreal DEFAULT_MAX_TIMESTEP = 1.0/30.0;   // 30 Hz min
-    static constexpr qreal VELOCITY_THRESHOLD = 0.01;
-    static constexpr qreal POSITION_THRESHOLD = 0.01;
+    // Analytic springs: the solution since the last release, and how far along it is
+    AnalyticSpring m_solution;
+    qreal m_elapsed;
+    qreal m_notifiedPosition;
+    bool m_analyticRunning;
 };
 
-#endif // PHYSICSENGINE_H
\ No newline at end of file
+#endif // PHYSICSENGINE_H
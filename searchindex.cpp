@@ -0,0 +1,896 @@
+#include "searchindex.h"
+#include "documentsaver.h"
+#include "markdownreader.h"
+#include "noteformat.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+// Static member definitions
+const int SearchIndex::DEFAULT_RESULT_LIMIT;
+const int SearchIndex::MIN_TERM_LENGTH;
+const int SearchIndex::MAX_TERM_LENGTH;
+const int SearchIndex::BATCH_SIZE;
+const int SearchIndex::RESCAN_DELAY;
+const int SearchIndex::SAVE_DELAY;
+const int SearchIndex::MAX_PREFIX_EXPANSION;
+
+namespace {
+
+constexpr quint32 kIndexMagic = 0x51534931; // "QSI1"
+constexpr quint16 kIndexVersion = 1;
+constexpr QDataStream::Version kStreamVersion = QDataStream::Qt_5_12;
+
+void writeVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray &in, int &pos, quint32 *value)
+{
+    quint32 result = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7) {
+        const quint8 byte = static_cast<quint8>(in.at(pos++));
+        result |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isDescendantOf(const QString &path, const QString &directory)
+{
+    return path.size() > directory.size() + 1
+        && path.startsWith(directory)
+        && path.at(directory.size()) == QLatin1Char('/');
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(QObject *parent)
+    : QObject(parent)
+    , m_cancelFlag(std::make_shared<std::atomic_bool>(false))
+    , m_saver(new DocumentSaver(this))
+{
+    m_rescanTimer.setSingleShot(true);
+    m_rescanTimer.setInterval(RESCAN_DELAY);
+    connect(&m_rescanTimer, &QTimer::timeout, this, [this]() {
+        const QSet<QString> directories = m_dirtyDirectories;
+        m_dirtyDirectories.clear();
+        for (const QString &directory : directories) {
+            if (QFileInfo(directory).isDir()) {
+                rescanDirectory(directory, false);
+            } else {
+                removePath(directory);
+            }
+        }
+    });
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SearchIndex::saveSnapshot);
+}
+
+SearchIndex::~SearchIndex()
+{
+    m_cancelFlag->store(true);
+    if (m_saveTimer.isActive()) {
+        // m_saver waits for the write when it is destroyed
+        saveSnapshot();
+    }
+}
+
+void SearchIndex::setRootDirectory(const QString &path)
+{
+    const QString root = path.isEmpty() ? QString() : QFileInfo(path).absoluteFilePath();
+    if (root == m_rootDirectory) {
+        return;
+    }
+
+    if (m_saveTimer.isActive()) {
+        saveSnapshot();
+    }
+
+    // Drop everything belonging to the old root; workers still running for it
+    // finish on their own and their results are never looked at.
+    m_cancelFlag->store(true);
+    m_cancelFlag = std::make_shared<std::atomic_bool>(false);
+    for (QFutureWatcher<ScanResult> *scan : std::as_const(m_scans)) {
+        scan->disconnect(this);
+        scan->deleteLater();
+    }
+    m_scans.clear();
+    if (m_batchWatcher) {
+        m_batchWatcher->disconnect(this);
+        m_batchWatcher->deleteLater();
+        m_batchWatcher = nullptr;
+    }
+    m_queue.clear();
+    m_queued.clear();
+    m_dirtyDirectories.clear();
+    m_rescanTimer.stop();
+    m_knownDirectories.clear();
+
+    m_files.clear();
+    m_freeIds.clear();
+    m_fileIds.clear();
+    m_postings.clear();
+
+    m_rootDirectory = root;
+    emit indexChanged();
+
+    if (!m_rootDirectory.isEmpty()) {
+        startScan(m_rootDirectory, true, true);
+    }
+    updateIndexingState();
+}
+
+QList<SearchIndex::Hit> SearchIndex::search(const QString &query, int limit) const
+{
+    const bool prefixLast = !query.isEmpty() && !query.at(query.size() - 1).isSpace();
+
+    // Terms too short to be indexed are dropped, except the one still being
+    // typed, which can match as a prefix
+    QVector<QPair<QString, int>> tokens = tokenize(query, 1);
+    const int last = tokens.size() - 1;
+    for (int i = last; i >= 0; --i) {
+        const bool typing = prefixLast && i == last;
+        if (tokens.at(i).first.size() < MIN_TERM_LENGTH && !typing) {
+            tokens.remove(i);
+        }
+    }
+    if (tokens.isEmpty() || m_fileIds.isEmpty()) {
+        return {};
+    }
+    const double documents = m_fileIds.size();
+
+    struct Match {
+        int frequency = 0;
+        Posting first;
+    };
+    struct Candidate {
+        double score = 0.0;
+        Posting first;
+        int matchedTerms = 0;
+    };
+    QHash<quint32, Candidate> candidates;
+
+    for (int i = 0; i < tokens.size(); ++i) {
+        const QString &term = tokens.at(i).first;
+        const bool prefix = prefixLast && i == tokens.size() - 1;
+
+        QHash<quint32, Match> matches;
+        auto collect = [&matches](const QVector<Posting> &postings) {
+            for (const Posting &posting : postings) {
+                Match &match = matches[posting.file];
+                if (match.frequency == 0 || posting.block < match.first.block
+                        || (posting.block == match.first.block && posting.offset < match.first.offset)) {
+                    match.first = posting;
+                }
+                ++match.frequency;
+            }
+        };
+
+        if (prefix) {
+            int expanded = 0;
+            for (auto it = m_postings.lowerBound(term);
+                 it != m_postings.constEnd() && it.key().startsWith(term) && expanded < MAX_PREFIX_EXPANSION;
+                 ++it, ++expanded) {
+                collect(it.value());
+            }
+        } else {
+            auto it = m_postings.constFind(term);
+            if (it != m_postings.constEnd()) {
+                collect(it.value());
+            }
+        }
+        if (matches.isEmpty()) {
+            return {};
+        }
+
+        // tf-idf with dampened term frequency
+        const double idf = std::log(1.0 + documents / matches.size());
+        for (auto it = matches.constBegin(); it != matches.constEnd(); ++it) {
+            const double weight = (1.0 + std::log(double(it.value().frequency))) * idf;
+            if (i == 0) {
+                Candidate candidate;
+                candidate.score = weight;
+                candidate.first = it.value().first;
+                candidate.matchedTerms = 1;
+                candidates.insert(it.key(), candidate);
+                continue;
+            }
+            auto candidate = candidates.find(it.key());
+            if (candidate == candidates.end()) {
+                continue;
+            }
+            candidate->score += weight;
+            ++candidate->matchedTerms;
+            const Posting &first = it.value().first;
+            if (first.block < candidate->first.block
+                    || (first.block == candidate->first.block && first.offset < candidate->first.offset)) {
+                candidate->first = first;
+            }
+        }
+
+        // Every term has to match
+        for (auto it = candidates.begin(); it != candidates.end();) {
+            it = it->matchedTerms == i + 1 ? std::next(it) : candidates.erase(it);
+        }
+        if (candidates.isEmpty()) {
+            return {};
+        }
+    }
+
+    QList<Hit> hits;
+    hits.reserve(candidates.size());
+    for (auto it = candidates.constBegin(); it != candidates.constEnd(); ++it) {
+        const FileEntry &entry = m_files.at(it.key());
+        Hit hit;
+        hit.path = entry.path;
+        hit.score = it.value().score;
+        hit.block = it.value().first.block;
+        hit.offset = it.value().first.offset;
+
+        // Notes whose name matches rank above ones that merely mention it
+        const QString name = QFileInfo(entry.path).completeBaseName().toCaseFolded();
+        for (const auto &token : tokens) {
+            if (name.contains(token.first)) {
+                hit.score += 1.0;
+            }
+        }
+        hits.append(hit);
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+        return a.score != b.score ? a.score > b.score : a.path < b.path;
+    });
+    if (limit > 0 && hits.size() > limit) {
+        hits.erase(hits.begin() + limit, hits.end());
+    }
+    return hits;
+}
+
+bool SearchIndex::isIndexing() const
+{
+    return !m_scans.isEmpty() || m_batchWatcher || !m_queue.isEmpty();
+}
+
+QVector<QPair<QString, int>> SearchIndex::tokenize(const QString &text, int minLength)
+{
+    QVector<QPair<QString, int>> tokens;
+    const int length = text.size();
+    int start = -1;
+    for (int i = 0; i <= length; ++i) {
+        const bool wordChar = i < length && text.at(i).isLetterOrNumber();
+        if (wordChar) {
+            if (start < 0) {
+                start = i;
+            }
+            continue;
+        }
+        if (start >= 0) {
+            const int size = i - start;
+            if (size >= minLength && size <= MAX_TERM_LENGTH) {
+                tokens.append(qMakePair(text.mid(start, size).toCaseFolded(), start));
+            }
+            start = -1;
+        }
+    }
+    return tokens;
+}
+
+void SearchIndex::updateFile(const QString &path)
+{
+    const QFileInfo info(path);
+    const QString absolute = info.absoluteFilePath();
+    if (!isUnderRoot(absolute) || !QuteNote::hasNoteExtension(absolute)) {
+        return;
+    }
+    if (!info.exists()) {
+        removePath(absolute);
+        return;
+    }
+
+    FileStamp stamp;
+    stamp.path = absolute;
+    enqueue(stamp);
+    startNextBatch();
+    updateIndexingState();
+}
+
+void SearchIndex::removePath(const QString &path)
+{
+    const QString absolute = QFileInfo(path).absoluteFilePath();
+    if (!isUnderRoot(absolute)) {
+        return;
+    }
+
+    bool changed = false;
+    auto id = m_fileIds.constFind(absolute);
+    if (id != m_fileIds.constEnd()) {
+        removeEntry(id.value());
+        changed = true;
+    } else {
+        // A directory: everything below it goes
+        QVector<quint32> doomed;
+        for (auto it = m_fileIds.constBegin(); it != m_fileIds.constEnd(); ++it) {
+            if (isDescendantOf(it.key(), absolute)) {
+                doomed.append(it.value());
+            }
+        }
+        for (quint32 doomedId : std::as_const(doomed)) {
+            removeEntry(doomedId);
+        }
+        changed = !doomed.isEmpty();
+
+        QStringList forgotten;
+        for (const QString &directory : std::as_const(m_knownDirectories)) {
+            if (directory == absolute || isDescendantOf(directory, absolute)) {
+                forgotten.append(directory);
+            }
+        }
+        for (const QString &directory : std::as_const(forgotten)) {
+            m_knownDirectories.remove(directory);
+        }
+    }
+
+    if (changed) {
+        scheduleSave();
+        emit indexChanged();
+    }
+}
+
+void SearchIndex::renamePath(const QString &oldPath, const QString &newPath)
+{
+    const QString from = QFileInfo(oldPath).absoluteFilePath();
+    const QString to = QFileInfo(newPath).absoluteFilePath();
+    if (!isUnderRoot(from) && !isUnderRoot(to)) {
+        return;
+    }
+
+    // Re-key existing entries instead of re-reading them; the follow-up scan
+    // sees unchanged stamps and leaves them alone
+    QVector<QPair<quint32, QString>> moved;
+    for (auto it = m_fileIds.constBegin(); it != m_fileIds.constEnd(); ++it) {
+        if (it.key() == from) {
+            moved.append(qMakePair(it.value(), to));
+        } else if (isDescendantOf(it.key(), from)) {
+            moved.append(qMakePair(it.value(), to + it.key().mid(from.size())));
+        }
+    }
+    for (const auto &move : std::as_const(moved)) {
+        FileEntry &entry = m_files[move.first];
+        m_fileIds.remove(entry.path);
+        if (!isUnderRoot(move.second) || !QuteNote::hasNoteExtension(move.second)) {
+            m_fileIds.insert(entry.path, move.first);
+            removeEntry(move.first);
+            continue;
+        }
+        entry.path = move.second;
+        m_fileIds.insert(entry.path, move.first);
+    }
+
+    if (QFileInfo(to).isDir()) {
+        removePath(from); // Only forgets its directories by now
+        if (isUnderRoot(to)) {
+            rescanDirectory(to, true);
+        }
+    } else if (moved.isEmpty()) {
+        updateFile(to);
+    }
+
+    if (!moved.isEmpty()) {
+        scheduleSave();
+        emit indexChanged();
+    }
+}
+
+void SearchIndex::applyExternalChanges(const QList<NotesWatcher::DirectoryChange> &changes)
+{
+    // Atomic saves (QSaveFile) replace the note by renaming, which is a
+    // change of its directory, so directories are all that is looked at
+    for (const NotesWatcher::DirectoryChange &change : changes) {
+        m_dirtyDirectories.insert(QFileInfo(change.directory).absoluteFilePath());
+    }
+    if (!changes.isEmpty()) {
+        m_rescanTimer.start();
+    }
+}
+
+void SearchIndex::rescanDirectory(const QString &path, bool recursive)
+{
+    const QString absolute = QFileInfo(path).absoluteFilePath();
+    if (!isUnderRoot(absolute)) {
+        return;
+    }
+    startScan(absolute, recursive, false);
+    updateIndexingState();
+}
+
+SearchIndex::ScanResult SearchIndex::scanInWorker(const QString &directory, bool recursive,
+                                                  const QString &snapshotPath, const QString &root,
+                                                  const CancelFlag &cancelled)
+{
+    ScanResult result;
+    result.directory = directory;
+    result.recursive = recursive;
+
+    if (!snapshotPath.isEmpty()
+            && !loadSnapshot(snapshotPath, root, &result.loadedFiles, &result.loadedPostings)) {
+        result.loadedFiles.clear();
+        result.loadedPostings.clear();
+    }
+
+    result.directories.append(directory);
+    QDirIterator it(directory, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        if (cancelled->load()) {
+            break;
+        }
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            result.directories.append(info.absoluteFilePath());
+        } else if (QuteNote::hasNoteExtension(info.fileName())) {
+            FileStamp stamp;
+            stamp.path = info.absoluteFilePath();
+            stamp.modified = info.lastModified().toMSecsSinceEpoch();
+            stamp.size = info.size();
+            result.files.append(stamp);
+        }
+    }
+    return result;
+}
+
+QVector<SearchIndex::IndexedFile> SearchIndex::indexInWorker(const QVector<FileStamp> &files,
+                                                             const CancelFlag &cancelled)
+{
+    QVector<IndexedFile> results;
+    results.reserve(files.size());
+
+    for (const FileStamp &requested : files) {
+        if (cancelled->load()) {
+            break;
+        }
+
+        IndexedFile indexed;
+        const QFileInfo info(requested.path);
+        indexed.stamp.path = requested.path;
+        indexed.stamp.modified = info.lastModified().toMSecsSinceEpoch();
+        indexed.stamp.size = info.size();
+
+        QFile file(requested.path);
+        if (!info.isFile() || !file.open(QIODevice::ReadOnly)) {
+            results.append(indexed);
+            continue;
+        }
+
+        // Parse exactly as the editor will, so block numbers line up
+        QTextDocument document;
+        if (QuteNote::noteFormatForPath(requested.path) == QuteNote::NoteFormat::Markdown) {
+            MarkdownReader(&document).read(&file);
+        } else {
+            document.setHtml(QString::fromUtf8(file.readAll()));
+        }
+
+        for (QTextBlock block = document.begin(); block.isValid(); block = block.next()) {
+            const auto tokens = tokenize(block.text());
+            for (const auto &token : tokens) {
+                indexed.occurrences[token.first].append(
+                    qMakePair(quint32(block.blockNumber()), quint32(token.second)));
+            }
+        }
+        indexed.ok = true;
+        results.append(indexed);
+    }
+    return results;
+}
+
+QString SearchIndex::snapshotPathFor(const QString &root)
+{
+    const QString name = QString::fromLatin1(
+        QCryptographicHash::hash(root.toUtf8(), QCryptographicHash::Sha1).toHex());
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+        + "/search/" + name + ".qsi";
+}
+
+QByteArray SearchIndex::encodeSnapshot(const QString &root, const QVector<FileEntry> &files,
+                                       const QMap<QString, QVector<Posting>> &postings)
+{
+    // Live files are renumbered densely; postings refer to them by that number
+    QVector<qint32> dense(files.size(), -1);
+    quint32 liveCount = 0;
+    for (int i = 0; i < files.size(); ++i) {
+        if (files.at(i).live) {
+            dense[i] = liveCount++;
+        }
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+    out << kIndexMagic << kIndexVersion << root << liveCount;
+
+    const QDir rootDir(root);
+    for (const FileEntry &entry : files) {
+        if (entry.live) {
+            out << rootDir.relativeFilePath(entry.path) << entry.modified << entry.size;
+        }
+    }
+
+    out << quint32(postings.size());
+    for (auto it = postings.constBegin(); it != postings.constEnd(); ++it) {
+        QVector<Posting> sorted;
+        sorted.reserve(it.value().size());
+        for (const Posting &posting : it.value()) {
+            if (posting.file < quint32(dense.size()) && dense.at(posting.file) >= 0) {
+                Posting renumbered = posting;
+                renumbered.file = dense.at(posting.file);
+                sorted.append(renumbered);
+            }
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const Posting &a, const Posting &b) {
+            if (a.file != b.file) return a.file < b.file;
+            if (a.block != b.block) return a.block < b.block;
+            return a.offset < b.offset;
+        });
+
+        // File numbers as deltas, blocks as deltas within a file; both are
+        // small, so most postings take three bytes
+        QByteArray encoded;
+        quint32 previousFile = 0;
+        quint32 previousBlock = 0;
+        for (const Posting &posting : std::as_const(sorted)) {
+            const quint32 fileDelta = posting.file - previousFile;
+            if (fileDelta != 0) {
+                previousBlock = 0;
+            }
+            writeVarint(encoded, fileDelta);
+            writeVarint(encoded, posting.block - previousBlock);
+            writeVarint(encoded, posting.offset);
+            previousFile = posting.file;
+            previousBlock = posting.block;
+        }
+        out << it.key() << quint32(sorted.size()) << encoded;
+    }
+    return data;
+}
+
+bool SearchIndex::loadSnapshot(const QString &snapshotPath, const QString &root,
+                               QVector<FileEntry> *files, QMap<QString, QVector<Posting>> *postings)
+{
+    QFile file(snapshotPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(kStreamVersion);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString recordedRoot;
+    quint32 fileCount = 0;
+    in >> magic >> version >> recordedRoot >> fileCount;
+    if (in.status() != QDataStream::Ok || magic != kIndexMagic || version != kIndexVersion
+            || recordedRoot != root) {
+        return false;
+    }
+
+    const QDir rootDir(root);
+    files->reserve(fileCount);
+    for (quint32 i = 0; i < fileCount && in.status() == QDataStream::Ok; ++i) {
+        FileEntry entry;
+        QString relative;
+        in >> relative >> entry.modified >> entry.size;
+        entry.path = QDir::cleanPath(rootDir.absoluteFilePath(relative));
+        entry.live = true;
+        files->append(entry);
+    }
+
+    quint32 termCount = 0;
+    in >> termCount;
+    for (quint32 i = 0; i < termCount && in.status() == QDataStream::Ok; ++i) {
+        QString term;
+        quint32 count = 0;
+        QByteArray encoded;
+        in >> term >> count >> encoded;
+
+        QVector<Posting> list;
+        list.reserve(count);
+        int pos = 0;
+        quint32 fileId = 0;
+        quint32 block = 0;
+        for (quint32 n = 0; n < count; ++n) {
+            quint32 fileDelta = 0;
+            quint32 blockDelta = 0;
+            quint32 offset = 0;
+            if (!readVarint(encoded, pos, &fileDelta) || !readVarint(encoded, pos, &blockDelta)
+                    || !readVarint(encoded, pos, &offset)) {
+                return false;
+            }
+            if (fileDelta != 0) {
+                block = 0;
+            }
+            fileId += fileDelta;
+            block += blockDelta;
+            if (fileId >= quint32(files->size())) {
+                return false;
+            }
+            list.append(Posting{ fileId, block, offset });
+
+            QStringList &terms = (*files)[fileId].terms;
+            if (terms.isEmpty() || terms.last() != term) {
+                terms.append(term);
+            }
+        }
+        postings->insert(term, list);
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void SearchIndex::startScan(const QString &directory, bool recursive, bool loadSnapshotFirst)
+{
+    auto *watcher = new QFutureWatcher<ScanResult>(this);
+    m_scans.append(watcher);
+    connect(watcher, &QFutureWatcher<ScanResult>::finished, this, [this, watcher]() {
+        onScanFinished(watcher);
+    });
+
+    const QString snapshotPath = loadSnapshotFirst ? snapshotPathFor(m_rootDirectory) : QString();
+    const QString root = m_rootDirectory;
+    CancelFlag cancelled = m_cancelFlag;
+    watcher->setFuture(QtConcurrent::run([directory, recursive, snapshotPath, root, cancelled]() {
+        return scanInWorker(directory, recursive, snapshotPath, root, cancelled);
+    }));
+}
+
+void SearchIndex::onScanFinished(QFutureWatcher<ScanResult> *watcher)
+{
+    m_scans.removeOne(watcher);
+    watcher->deleteLater();
+    const ScanResult result = watcher->result();
+
+    bool changed = false;
+    if (!result.loadedFiles.isEmpty() && m_files.isEmpty()) {
+        m_files = result.loadedFiles;
+        m_postings = result.loadedPostings;
+        for (int i = 0; i < m_files.size(); ++i) {
+            m_fileIds.insert(m_files.at(i).path, quint32(i));
+        }
+        changed = true;
+    }
+
+    // Notes that disappeared while we were not looking
+    QHash<QString, FileStamp> onDisk;
+    for (const FileStamp &stamp : result.files) {
+        onDisk.insert(stamp.path, stamp);
+    }
+    QVector<quint32> vanished;
+    for (auto it = m_fileIds.constBegin(); it != m_fileIds.constEnd(); ++it) {
+        const bool covered = result.recursive
+            ? isDescendantOf(it.key(), result.directory)
+            : QFileInfo(it.key()).absolutePath() == result.directory;
+        if (covered && !onDisk.contains(it.key())) {
+            vanished.append(it.value());
+        }
+    }
+    for (quint32 id : std::as_const(vanished)) {
+        removeEntry(id);
+        changed = true;
+    }
+
+    // New or modified notes
+    for (const FileStamp &stamp : result.files) {
+        auto id = m_fileIds.constFind(stamp.path);
+        if (id != m_fileIds.constEnd()) {
+            const FileEntry &entry = m_files.at(id.value());
+            if (entry.modified == stamp.modified && entry.size == stamp.size) {
+                continue;
+            }
+        }
+        enqueue(stamp);
+    }
+
+    // Directories: remember new ones, descend into new subdirectories found
+    // by a shallow rescan, forget ones that are gone
+    for (const QString &directory : result.directories) {
+        if (m_knownDirectories.contains(directory)) {
+            continue;
+        }
+        m_knownDirectories.insert(directory);
+        if (!result.recursive && directory != result.directory) {
+            startScan(directory, true, false);
+        }
+    }
+    if (!result.recursive) {
+        const QSet<QString> present(result.directories.cbegin(), result.directories.cend());
+        QStringList gone;
+        for (const QString &directory : std::as_const(m_knownDirectories)) {
+            if (QFileInfo(directory).absolutePath() == result.directory && directory != result.directory
+                    && !present.contains(directory)) {
+                gone.append(directory);
+            }
+        }
+        for (const QString &directory : std::as_const(gone)) {
+            removePath(directory);
+        }
+    }
+
+    if (changed) {
+        scheduleSave();
+        emit indexChanged();
+    }
+    startNextBatch();
+    updateIndexingState();
+}
+
+void SearchIndex::enqueue(const FileStamp &stamp)
+{
+    if (m_queued.contains(stamp.path)) {
+        return;
+    }
+    m_queued.insert(stamp.path);
+    m_queue.append(stamp);
+}
+
+void SearchIndex::startNextBatch()
+{
+    if (m_batchWatcher || m_queue.isEmpty()) {
+        return;
+    }
+
+    const int count = qMin(BATCH_SIZE, m_queue.size());
+    const QVector<FileStamp> batch = m_queue.mid(0, count);
+    m_queue.remove(0, count);
+    for (const FileStamp &stamp : batch) {
+        m_queued.remove(stamp.path);
+    }
+
+    m_batchWatcher = new QFutureWatcher<QVector<IndexedFile>>(this);
+    connect(m_batchWatcher, &QFutureWatcher<QVector<IndexedFile>>::finished,
+            this, &SearchIndex::onBatchFinished);
+    CancelFlag cancelled = m_cancelFlag;
+    m_batchWatcher->setFuture(QtConcurrent::run([batch, cancelled]() {
+        return indexInWorker(batch, cancelled);
+    }));
+}
+
+void SearchIndex::onBatchFinished()
+{
+    QFutureWatcher<QVector<IndexedFile>> *watcher = m_batchWatcher;
+    m_batchWatcher = nullptr;
+    watcher->deleteLater();
+
+    const QVector<IndexedFile> results = watcher->result();
+    for (const IndexedFile &file : results) {
+        merge(file);
+    }
+    if (!results.isEmpty()) {
+        scheduleSave();
+        emit indexChanged();
+    }
+
+    startNextBatch();
+    updateIndexingState();
+}
+
+void SearchIndex::merge(const IndexedFile &file)
+{
+    auto existing = m_fileIds.constFind(file.stamp.path);
+    if (existing != m_fileIds.constEnd()) {
+        removeEntry(existing.value());
+    }
+    if (!file.ok || !isUnderRoot(file.stamp.path)) {
+        return;
+    }
+
+    quint32 id;
+    if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+    } else {
+        id = quint32(m_files.size());
+        m_files.append(FileEntry());
+    }
+
+    FileEntry &entry = m_files[id];
+    entry.path = file.stamp.path;
+    entry.modified = file.stamp.modified;
+    entry.size = file.stamp.size;
+    entry.live = true;
+    entry.terms.clear();
+    entry.terms.reserve(file.occurrences.size());
+
+    for (auto it = file.occurrences.constBegin(); it != file.occurrences.constEnd(); ++it) {
+        entry.terms.append(it.key());
+        QVector<Posting> &postings = m_postings[it.key()];
+        postings.reserve(postings.size() + it.value().size());
+        for (const auto &occurrence : it.value()) {
+            postings.append(Posting{ id, occurrence.first, occurrence.second });
+        }
+    }
+    m_fileIds.insert(entry.path, id);
+}
+
+void SearchIndex::removeEntry(quint32 id)
+{
+    FileEntry &entry = m_files[id];
+    for (const QString &term : std::as_const(entry.terms)) {
+        auto it = m_postings.find(term);
+        if (it == m_postings.end()) {
+            continue;
+        }
+        QVector<Posting> &postings = it.value();
+        postings.erase(std::remove_if(postings.begin(), postings.end(),
+                                      [id](const Posting &posting) { return posting.file == id; }),
+                       postings.end());
+        if (postings.isEmpty()) {
+            m_postings.erase(it);
+        }
+    }
+    m_fileIds.remove(entry.path);
+    entry = FileEntry();
+    m_freeIds.append(id);
+}
+
+void SearchIndex::scheduleSave()
+{
+    if (!m_rootDirectory.isEmpty()) {
+        m_saveTimer.start();
+    }
+}
+
+void SearchIndex::saveSnapshot()
+{
+    m_saveTimer.stop();
+    if (m_rootDirectory.isEmpty()) {
+        return;
+    }
+
+    // The containers are implicitly shared, so these copies are cheap; the
+    // encoding happens on DocumentSaver's worker
+    const QString root = m_rootDirectory;
+    const QVector<FileEntry> files = m_files;
+    const QMap<QString, QVector<Posting>> postings = m_postings;
+    m_saver->save(snapshotPathFor(root), [root, files, postings]() {
+        return encodeSnapshot(root, files, postings);
+    });
+}
+
+void SearchIndex::updateIndexingState()
+{
+    const bool indexing = isIndexing();
+    if (indexing == m_indexing) {
+        return;
+    }
+    m_indexing = indexing;
+    if (indexing) {
+        emit indexingStarted();
+    } else {
+        emit indexingFinished(documentCount());
+    }
+}
+
+bool SearchIndex::isUnderRoot(const QString &path) const
+{
+    return !m_rootDirectory.isEmpty() && (path == m_rootDirectory || isDescendantOf(path, m_rootDirectory));
+}
@@ -0,0 +1,169 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include "noteswatcher.h"
+#include <QTimer>
+#include <QFutureWatcher>
+#include <atomic>
+#include <memory>
+
+class DocumentSaver;
+
+// Incremental full-text index over the notes under a root directory.
+//
+// Every note is tokenized into case-folded terms; each term maps to a posting
+// list of (file, block, offset) so a hit can be located inside the note. The
+// index lives in memory for queries and is persisted in a compact,
+// delta/varint-encoded form under AppDataLocation/search, so only notes that
+// changed since the last run have to be re-read at startup.
+//
+// Reading and tokenizing happen on worker threads in small batches; merging
+// the results and answering queries happen on the owning thread. Changes on
+// disk are handed in from the NotesWatcher of the notes root, and callers
+// can push known changes (saves, renames, deletes) directly.
+class SearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Hit {
+        QString path;
+        double score = 0.0;
+        int block = 0;  // First matching block in the note
+        int offset = 0; // Position of the match inside that block
+    };
+
+    explicit SearchIndex(QObject *parent = nullptr);
+    ~SearchIndex();
+
+    // Loads the persisted index for path (if any) and reconciles it with disk
+    void setRootDirectory(const QString &path);
+    QString rootDirectory() const { return m_rootDirectory; }
+
+    // All terms must match; the last one also matches as a prefix so results
+    // update while the user is still typing. Best matches first.
+    QList<Hit> search(const QString &query, int limit = DEFAULT_RESULT_LIMIT) const;
+
+    bool isIndexing() const;
+    int documentCount() const { return m_fileIds.size(); }
+
+    // Case-folded terms of text, in order of appearance, with their offsets
+    static QVector<QPair<QString, int>> tokenize(const QString &text, int minLength = MIN_TERM_LENGTH);
+
+    static const int DEFAULT_RESULT_LIMIT = 200;
+    static const int MIN_TERM_LENGTH = 2;
+    static const int MAX_TERM_LENGTH = 64;
+
+public slots:
+    // (Re)index a single note, or drop it if it no longer exists
+    void updateFile(const QString &path);
+    void removePath(const QString &path);
+    void renamePath(const QString &oldPath, const QString &newPath);
+    // Re-reads the directory listing and indexes whatever changed
+    void rescanDirectory(const QString &path, bool recursive = false);
+    // Directories that changed on disk; each is re-read once things settle
+    void applyExternalChanges(const QList<NotesWatcher::DirectoryChange> &changes);
+
+Q_SIGNALS:
+    void indexingStarted();
+    void indexingFinished(int documentCount);
+    // Emitted after each merged batch; open searches may want to re-run
+    void indexChanged();
+
+private:
+    using CancelFlag = std::shared_ptr<std::atomic_bool>;
+
+    struct Posting {
+        quint32 file = 0;
+        quint32 block = 0;
+        quint32 offset = 0;
+    };
+
+    struct FileEntry {
+        QString path; // Absolute
+        qint64 modified = 0;
+        qint64 size = 0;
+        QStringList terms; // Unique terms, for removal
+        bool live = false;
+    };
+
+    struct FileStamp {
+        QString path;
+        qint64 modified = 0;
+        qint64 size = 0;
+    };
+
+    struct ScanResult {
+        QString directory;
+        bool recursive = false;
+        QVector<FileStamp> files;
+        QStringList directories;
+        // Only set by the initial scan
+        QVector<FileEntry> loadedFiles;
+        QMap<QString, QVector<Posting>> loadedPostings;
+    };
+
+    struct IndexedFile {
+        FileStamp stamp;
+        bool ok = false;
+        QHash<QString, QVector<QPair<quint32, quint32>>> occurrences; // term -> (block, offset)
+    };
+
+    // Worker side
+    static ScanResult scanInWorker(const QString &directory, bool recursive,
+                                   const QString &snapshotPath, const QString &root,
+                                   const CancelFlag &cancelled);
+    static QVector<IndexedFile> indexInWorker(const QVector<FileStamp> &files, const CancelFlag &cancelled);
+    static bool loadSnapshot(const QString &snapshotPath, const QString &root,
+                             QVector<FileEntry> *files, QMap<QString, QVector<Posting>> *postings);
+    static QByteArray encodeSnapshot(const QString &root, const QVector<FileEntry> &files,
+                                     const QMap<QString, QVector<Posting>> &postings);
+    static QString snapshotPathFor(const QString &root);
+
+    // Owner side
+    void startScan(const QString &directory, bool recursive, bool loadSnapshotFirst);
+    void onScanFinished(QFutureWatcher<ScanResult> *watcher);
+    void enqueue(const FileStamp &stamp);
+    void startNextBatch();
+    void onBatchFinished();
+    void merge(const IndexedFile &file);
+    void removeEntry(quint32 id);
+    void scheduleSave();
+    void saveSnapshot();
+    void updateIndexingState();
+    bool isUnderRoot(const QString &path) const;
+
+    QString m_rootDirectory;
+    CancelFlag m_cancelFlag;
+
+    QVector<FileEntry> m_files;
+    QVector<quint32> m_freeIds;
+    QHash<QString, quint32> m_fileIds;
+    QMap<QString, QVector<Posting>> m_postings; // Ordered for prefix lookups
+
+    QList<QFutureWatcher<ScanResult>*> m_scans;
+    QVector<FileStamp> m_queue;
+    QSet<QString> m_queued;
+    QFutureWatcher<QVector<IndexedFile>> *m_batchWatcher = nullptr;
+    bool m_indexing = false;
+
+    QSet<QString> m_knownDirectories; // Scanned, so new ones can be told apart
+    QTimer m_rescanTimer;
+    QSet<QString> m_dirtyDirectories;
+    QTimer m_saveTimer;
+    DocumentSaver *m_saver = nullptr;
+
+    static const int BATCH_SIZE = 32;
+    static const int RESCAN_DELAY = 300;
+    static const int SAVE_DELAY = 5000;
+    static const int MAX_PREFIX_EXPANSION = 64;
+};
+
+#endif // SEARCHINDEX_H
@@ -165,12 +165,18 @@ void SettingsView::setupGeneralTab()
     m_languageCombo->addItem("Chinese", "zh");
 
     m_autoSaveCheck = QuteNote::makeOwned<QCheckBox>("Enable Auto-save", m_generalTab.get());
+    m_autoSaveDelayLabel = QuteNote::makeOwned<QLabel>("Auto-save after idle:", m_generalTab.get());
+    m_autoSaveDelaySpin = QuteNote::makeOwned<QSpinBox>(m_generalTab.get());
+    m_autoSaveDelaySpin->setRange(1, 60);
+    m_autoSaveDelaySpin->setSuffix(" s");
+    m_autoSaveDelaySpin->setMinimumHeight(touchTarget);
     m_showSidebarCheck = QuteNote::makeOwned<QCheckBox>("Show Sidebar by Default", m_generalTab.get());
 
     auto formLayout = QuteNote::makeOwned<QFormLayout>(m_generalTab.get());
     formLayout->addRow(m_notesDirLabel.get(), notesDirWidget);
     formLayout->addRow(m_languageLabel.get(), m_languageCombo.get());
     formLayout->addRow(m_autoSaveCheck.get());
+    formLayout->addRow(m_autoSaveDelayLabel.get(), m_autoSaveDelaySpin.get());
     formLayout->addRow(m_showSidebarCheck.get());
     formLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Minimum, QSizePolicy::Expanding));
     m_generalTab->setLayout(formLayout.get());
@@ -180,6 +186,10 @@ void SettingsView::setupGeneralTab()
     // Don't emit settingsChanged for checkboxes - they save immediately without closing settings
     connect(m_autoSaveCheck.get(), &QCheckBox::toggled, this, [this](bool checked) {
         m_settings->setValue("autoSave", checked);
+        m_autoSaveDelaySpin->setEnabled(checked);
+    });
+    connect(m_autoSaveDelaySpin.get(), QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int seconds) {
+        m_settings->setValue("autoSaveDelay", seconds * 1000);
     });
     connect(m_showSidebarCheck.get(), &QCheckBox::toggled, this, [this](bool checked) {
         m_settings->setValue("showSidebarByDefault", checked);
@@ -310,7 +320,9 @@ void SettingsView::loadSettings()
     m_notesDirEdit->setText(notesDir);
     
     // Load auto-save and sidebar settings
-    m_autoSaveCheck->setChecked(m_settings->value("autoSave", true).toBool());
+    m_autoSaveCheck->setChecked(m_settings->value("autoSave", false).toBool());
+    m_autoSaveDelaySpin->setValue(m_settings->value("autoSaveDelay", 2000).toInt() / 1000);
+    m_autoSaveDelaySpin->setEnabled(m_autoSaveCheck->isChecked());
     m_showSidebarCheck->setChecked(m_settings->value("showSidebarByDefault", true).toBool());
 }
 
@@ -78,6 +78,8 @@ protected:
     QuteNote::OwnedPtr<QLabel> m_languageLabel;
     QuteNote::OwnedPtr<QComboBox> m_languageCombo;
     QuteNote::OwnedPtr<QCheckBox> m_autoSaveCheck;
+    QuteNote::OwnedPtr<QLabel> m_autoSaveDelayLabel;
+    QuteNote::OwnedPtr<QSpinBox> m_autoSaveDelaySpin;
     QuteNote::OwnedPtr<QCheckBox> m_showSidebarCheck;
 
     // Appearance settings
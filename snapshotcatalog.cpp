@@ -0,0 +1,184 @@
+#include "snapshotcatalog.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+SnapshotCatalog::SnapshotCatalog(const QString &repository)
+    : m_repository(repository)
+{
+}
+
+void SnapshotCatalog::refresh()
+{
+    const QStringList ids = BackupEngine::snapshotIds(m_repository);
+
+    QStringList missing;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const QString &id : ids) {
+            if (!m_snapshots.contains(id)) {
+                missing.append(id);
+            }
+        }
+    }
+
+    // Manifests are read without holding the lock; lookups can carry on
+    for (const QString &id : missing) {
+        BackupEngine::Snapshot snapshot;
+        QString error;
+        if (!BackupEngine::readSnapshot(BackupEngine::snapshotFilePath(m_repository, id), &snapshot, &error)) {
+            qWarning() << "SnapshotCatalog:" << error;
+            continue;
+        }
+        QMutexLocker locker(&m_mutex);
+        if (!m_snapshots.contains(id)) {
+            index(snapshot);
+        }
+    }
+}
+
+void SnapshotCatalog::addSnapshot(const BackupEngine::Snapshot &snapshot)
+{
+    if (snapshot.isNull()) {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!m_snapshots.contains(snapshot.id)) {
+        index(snapshot);
+    }
+}
+
+QStringList SnapshotCatalog::snapshotIds() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_snapshots.keys();
+}
+
+bool SnapshotCatalog::lookup(const QString &snapshotId, const QString &path, BackupEngine::Entry *entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    const auto snapshot = m_snapshots.constFind(snapshotId);
+    if (snapshot == m_snapshots.constEnd()) {
+        return false;
+    }
+    const int id = findRecord(*snapshot, path);
+    if (id < 0) {
+        return false;
+    }
+    const Record &record = m_records.at(id);
+    entry->path = path;
+    entry->size = record.size;
+    entry->modified = record.modified;
+    entry->hash = record.hash;
+    return true;
+}
+
+QList<SnapshotCatalog::Version> SnapshotCatalog::versions(const QString &path) const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<Version> result;
+    QByteArray lastHash;
+    // Oldest first, so each version is credited to the snapshot it first appeared in
+    for (auto it = m_snapshots.constBegin(); it != m_snapshots.constEnd(); ++it) {
+        const int id = findRecord(it.value(), path);
+        if (id < 0) {
+            lastHash.clear();
+            continue;
+        }
+        const Record &record = m_records.at(id);
+        if (record.hash.isEmpty() || record.hash == lastHash) {
+            continue;
+        }
+        lastHash = record.hash;
+
+        Version version;
+        version.snapshotId = it.key();
+        version.created = it.value().created;
+        version.size = record.size;
+        version.modified = record.modified;
+        version.hash = record.hash;
+        result.prepend(version);
+    }
+    return result;
+}
+
+bool SnapshotCatalog::restore(const Version &version, const QString &targetFile, QString *error) const
+{
+    auto fail = [&](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QByteArray content;
+    if (!BackupEngine::readBlob(m_repository, version.hash, &content)) {
+        return fail(QString("The backup copy from %1 is missing or damaged").arg(version.snapshotId));
+    }
+
+    QDir().mkpath(QFileInfo(targetFile).absolutePath());
+    QSaveFile file(targetFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit()) {
+        return fail(QString("Could not write %1: %2").arg(targetFile, file.errorString()));
+    }
+    return true;
+}
+
+void SnapshotCatalog::index(const BackupEngine::Snapshot &snapshot)
+{
+    SnapshotIndex &indexed = m_snapshots[snapshot.id];
+    indexed.created = snapshot.created;
+    indexed.records.reserve(snapshot.entries.size());
+    for (const BackupEngine::Entry &entry : snapshot.entries) {
+        indexed.records.append(internRecord(entry));
+    }
+}
+
+int SnapshotCatalog::internRecord(const BackupEngine::Entry &entry)
+{
+    int pathId = m_pathIds.value(entry.path, -1);
+    if (pathId < 0) {
+        pathId = m_paths.size();
+        m_paths.append(entry.path);
+        m_pathIds.insert(entry.path, pathId);
+    }
+
+    QByteArray key = entry.hash;
+    char numbers[20];
+    qToLittleEndian(qint64(entry.size), numbers);
+    qToLittleEndian(qint64(entry.modified), numbers + 8);
+    qToLittleEndian(qint32(pathId), numbers + 16);
+    key.append(numbers, sizeof(numbers));
+
+    const auto known = m_recordIds.constFind(key);
+    if (known != m_recordIds.constEnd()) {
+        return *known;
+    }
+
+    Record record;
+    record.path = pathId;
+    record.size = entry.size;
+    record.modified = entry.modified;
+    record.hash = entry.hash;
+    const int id = m_records.size();
+    m_records.append(record);
+    m_recordIds.insert(key, id);
+    return id;
+}
+
+int SnapshotCatalog::findRecord(const SnapshotIndex &snapshot, const QString &path) const
+{
+    // Manifests are sorted with QString's operator<, which is what we search with
+    const auto it = std::lower_bound(snapshot.records.cbegin(), snapshot.records.cend(), path,
+        [this](int id, const QString &value) {
+            return m_paths.at(m_records.at(id).path) < value;
+        });
+    if (it == snapshot.records.cend() || m_paths.at(m_records.at(*it).path) != path) {
+        return -1;
+    }
+    return *it;
+}
@@ -0,0 +1,207 @@
+#include "springsystem.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// One substep over a run of springs. The arrays never overlap, and saying
+// so (with no branch or conditional load in the body) is what lets the
+// compiler turn this into SIMD code.
+void integrateBlock(int count, qreal *__restrict position, qreal *__restrict velocity,
+                    const qreal *__restrict target, const qreal *__restrict stiffness,
+                    const qreal *__restrict damping, const qreal *__restrict lower,
+                    const qreal *__restrict upper)
+{
+    const qreal dt = SpringSystem::TIMESTEP;
+    for (int i = 0; i < count; ++i) {
+        // Same integration as PhysicsState::applySpringForce(), unit mass
+        const qreal acceleration = -stiffness[i] * (position[i] - target[i]) - damping[i] * velocity[i];
+        const qreal v = velocity[i] + acceleration * dt;
+        const qreal p = position[i] + v * dt;
+        const qreal min = lower[i];
+        const qreal max = upper[i];
+        const qreal clamped = p < min ? min : (p > max ? max : p);
+        // Hitting a limit stops the spring there
+        velocity[i] = clamped == p ? v : 0.0;
+        position[i] = clamped;
+    }
+}
+
+} // namespace
+
+SpringSystem::SpringSystem()
+    : m_accumulatedTime(0)
+{
+}
+
+SpringSystem::Handle SpringSystem::add(const PhysicsState &state)
+{
+    Handle handle;
+    if (!m_freeHandles.isEmpty()) {
+        handle = m_freeHandles.takeLast();
+    } else {
+        handle = m_indices.size();
+        m_indices.append(-1);
+    }
+    m_indices[handle] = m_position.size();
+
+    // PhysicsState treats equal limits as no limits
+    const bool limited = state.minLimit != state.maxLimit;
+    const qreal infinity = std::numeric_limits<qreal>::infinity();
+
+    m_position.append(state.position);
+    m_velocity.append(state.velocity);
+    m_target.append(state.targetPosition);
+    m_stiffness.append(state.springConstant);
+    m_damping.append(state.damping);
+    m_lower.append(limited ? state.minLimit : -infinity);
+    m_upper.append(limited ? state.maxLimit : infinity);
+    m_notified.append(state.position);
+    m_handles.append(handle);
+    return handle;
+}
+
+PhysicsState SpringSystem::remove(Handle handle)
+{
+    const PhysicsState last = state(handle);
+    if (!contains(handle)) {
+        return last;
+    }
+
+    // Move the last spring into the gap so the arrays stay dense
+    const int index = m_indices.at(handle);
+    const int back = m_position.size() - 1;
+    if (index != back) {
+        m_position[index] = m_position.at(back);
+        m_velocity[index] = m_velocity.at(back);
+        m_target[index] = m_target.at(back);
+        m_stiffness[index] = m_stiffness.at(back);
+        m_damping[index] = m_damping.at(back);
+        m_lower[index] = m_lower.at(back);
+        m_upper[index] = m_upper.at(back);
+        m_notified[index] = m_notified.at(back);
+        m_handles[index] = m_handles.at(back);
+        m_indices[m_handles.at(index)] = index;
+    }
+    m_position.removeLast();
+    m_velocity.removeLast();
+    m_target.removeLast();
+    m_stiffness.removeLast();
+    m_damping.removeLast();
+    m_lower.removeLast();
+    m_upper.removeLast();
+    m_notified.removeLast();
+    m_handles.removeLast();
+
+    m_indices[handle] = -1;
+    m_freeHandles.append(handle);
+    if (m_position.isEmpty()) {
+        m_accumulatedTime = 0;
+    }
+    return last;
+}
+
+bool SpringSystem::contains(Handle handle) const
+{
+    return handle >= 0 && handle < m_indices.size() && m_indices.at(handle) >= 0;
+}
+
+PhysicsState SpringSystem::state(Handle handle) const
+{
+    PhysicsState result;
+    if (!contains(handle)) {
+        return result;
+    }
+
+    const int i = m_indices.at(handle);
+    result.position = m_position.at(i);
+    result.velocity = m_velocity.at(i);
+    result.targetPosition = m_target.at(i);
+    result.springConstant = m_stiffness.at(i);
+    result.damping = m_damping.at(i);
+    result.acceleration = -result.springConstant * (result.position - result.targetPosition)
+                          - result.damping * result.velocity;
+    if (std::isfinite(m_lower.at(i))) {
+        result.minLimit = m_lower.at(i);
+        result.maxLimit = m_upper.at(i);
+    }
+    return result;
+}
+
+void SpringSystem::addVelocity(Handle handle, qreal velocity)
+{
+    if (contains(handle)) {
+        m_velocity[m_indices.at(handle)] += velocity;
+    }
+}
+
+void SpringSystem::integrate(int substeps)
+{
+    const int count = m_position.size();
+    // Raw pointers taken once: no detach checks inside the loops
+    qreal *const position = m_position.data();
+    qreal *const velocity = m_velocity.data();
+    const qreal *const target = m_target.constData();
+    const qreal *const stiffness = m_stiffness.constData();
+    const qreal *const damping = m_damping.constData();
+    const qreal *const lower = m_lower.constData();
+    const qreal *const upper = m_upper.constData();
+
+    // Every substep of one block before the next, so the block stays in L1
+    for (int first = 0; first < count; first += BLOCK_SIZE) {
+        const int size = qMin(BLOCK_SIZE, count - first);
+        for (int s = 0; s < substeps; ++s) {
+            integrateBlock(size, position + first, velocity + first, target + first,
+                           stiffness + first, damping + first, lower + first, upper + first);
+        }
+    }
+}
+
+void SpringSystem::step(qreal deltaTime, QVector<Handle> *moved, QVector<Handle> *settled)
+{
+    if (moved) {
+        moved->clear();
+    }
+    if (settled) {
+        settled->clear();
+    }
+    if (m_position.isEmpty()) {
+        return;
+    }
+
+    m_accumulatedTime += qBound(TIMESTEP, deltaTime, MAX_FRAME_TIME);
+    const int substeps = int(m_accumulatedTime / TIMESTEP);
+    m_accumulatedTime -= substeps * TIMESTEP;
+    integrate(substeps);
+
+    // Branch-free compaction: every spring is written to both lists and
+    // the list's length only advances for the ones that belong there
+    const int count = m_position.size();
+    QVector<Handle> discard;
+    QVector<Handle> *movedList = moved ? moved : &discard;
+    QVector<Handle> *settledList = settled ? settled : &discard;
+    movedList->resize(count);
+    settledList->resize(count);
+    Handle *const movedOut = movedList->data();
+    Handle *const settledOut = settledList->data();
+    const qreal *const position = m_position.constData();
+    const qreal *const velocity = m_velocity.constData();
+    const qreal *const target = m_target.constData();
+    qreal *const notified = m_notified.data();
+    const Handle *const handles = m_handles.constData();
+    int movedCount = 0;
+    int settledCount = 0;
+    for (int i = 0; i < count; ++i) {
+        const qreal p = position[i];
+        // & rather than &&: no branches to mispredict on mixed springs
+        const bool atRest = (qAbs(velocity[i]) < VELOCITY_THRESHOLD) & (qAbs(p - target[i]) < POSITION_THRESHOLD);
+        const bool visible = !atRest & (qAbs(p - notified[i]) > NOTIFY_THRESHOLD);
+        notified[i] = visible ? p : notified[i];
+        movedOut[movedCount] = handles[i];
+        movedCount += visible;
+        settledOut[settledCount] = handles[i];
+        settledCount += atRest;
+    }
+    movedList->resize(movedCount);
+    settledList->resize(settledCount);
+}
@@ -0,0 +1,64 @@
+#ifndef SPRINGSYSTEM_H
+#define SPRINGSYSTEM_H
+
+#include "physicsengine.h"
+#include <QVector>
+
+// Every running spring in one batch, stored as a structure of arrays.
+//
+// Positions, velocities, targets, spring constants, damping and limits each
+// live in their own contiguous array, so a frame is a few fixed-size
+// semi-implicit Euler substeps, each one branch-free loop over all springs
+// that the compiler can vectorize. Afterwards only springs that moved more
+// than NOTIFY_THRESHOLD since they were last reported, or that settled, are
+// handed back to the caller. Springs are addressed by handles that stay
+// valid while others are added and removed.
+class SpringSystem
+{
+public:
+    using Handle = int;
+
+    SpringSystem();
+
+    Handle add(const PhysicsState &state);
+    // Returns the spring's final state
+    PhysicsState remove(Handle handle);
+    bool contains(Handle handle) const;
+    int size() const { return m_position.size(); }
+
+    PhysicsState state(Handle handle) const;
+    void addVelocity(Handle handle, qreal velocity);
+
+    // Advances every spring by deltaTime seconds (clamped to one frame's
+    // worth of substeps) and lists the springs that moved visibly and the
+    // ones that came to rest. Settled springs stay in the system.
+    void step(qreal deltaTime, QVector<Handle> *moved, QVector<Handle> *settled);
+
+    static constexpr qreal TIMESTEP = 1.0 / 240.0;          // Fixed substep
+    static constexpr qreal MAX_FRAME_TIME = 1.0 / 30.0;     // At most 8 substeps
+    static constexpr qreal NOTIFY_THRESHOLD = 0.05;         // Position units
+    static constexpr qreal VELOCITY_THRESHOLD = 0.01;
+    static constexpr qreal POSITION_THRESHOLD = 0.01;
+    static const int BLOCK_SIZE = 512;                        // Springs per cache block
+
+private:
+    void integrate(int substeps);
+
+    // One entry per spring, all indexed alike
+    QVector<qreal> m_position;
+    QVector<qreal> m_velocity;
+    QVector<qreal> m_target;
+    QVector<qreal> m_stiffness;
+    QVector<qreal> m_damping;
+    QVector<qreal> m_lower;  // -inf/+inf without limits, so clamping never branches
+    QVector<qreal> m_upper;
+    QVector<qreal> m_notified; // Position last reported as moved
+    QVector<Handle> m_handles;
+
+    // Handle -> index, -1 for free handles
+    QVector<int> m_indices;
+    QVector<Handle> m_freeHandles;
+    qreal m_accumulatedTime;
+};
+
+#endif // SPRINGSYSTEM_H
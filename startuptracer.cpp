@@ -0,0 +1,203 @@
+#include "startuptracer.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    char phase;      // 'X' complete, 'i' instant
+    qint64 start;    // us since process start
+    qint64 duration;
+    int thread;
+};
+
+// How long the process had been running when the clock below started;
+// zero where that cannot be found out
+qint64 processAgeUs()
+{
+#ifdef Q_OS_LINUX
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    QFile uptime(QStringLiteral("/proc/uptime"));
+    if (!stat.open(QIODevice::ReadOnly) || !uptime.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    // The command name may contain spaces; fields are counted after it
+    const QByteArray line = stat.readAll();
+    const int nameEnd = line.lastIndexOf(')');
+    const QList<QByteArray> fields = line.mid(nameEnd + 2).split(' ');
+    const QList<QByteArray> uptimeFields = uptime.readAll().split(' ');
+    // starttime is field 22 overall, the 20th after the name
+    if (nameEnd < 0 || fields.size() < 20 || uptimeFields.isEmpty()) {
+        return 0;
+    }
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    bool ok1 = false;
+    bool ok2 = false;
+    const double startedAt = fields.at(19).toDouble(&ok1) / double(ticksPerSecond > 0 ? ticksPerSecond : 100);
+    const double systemUptime = uptimeFields.first().toDouble(&ok2);
+    if (!ok1 || !ok2 || systemUptime < startedAt) {
+        return 0;
+    }
+    return qint64((systemUptime - startedAt) * 1e6);
+#else
+    return 0;
+#endif
+}
+
+struct TracerState {
+    TracerState()
+    {
+        clock.start();
+        preMainUs = processAgeUs();
+        events.reserve(64);
+    }
+
+    QElapsedTimer clock;
+    qint64 preMainUs = 0;
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    QHash<Qt::HANDLE, int> threads;
+    bool recording = true;
+};
+
+TracerState &state()
+{
+    static TracerState s;
+    return s;
+}
+
+// Touch the state during static initialization so the clock starts before main()
+[[maybe_unused]] const bool s_started = (state(), true);
+
+// Called with the mutex held
+int threadNumber(TracerState &s)
+{
+    const Qt::HANDLE id = QThread::currentThreadId();
+    auto it = s.threads.constFind(id);
+    if (it == s.threads.constEnd()) {
+        it = s.threads.insert(id, s.threads.size() + 1);
+    }
+    return *it;
+}
+
+void record(const char *name, char phase, qint64 start, qint64 duration)
+{
+    TracerState &s = state();
+    QMutexLocker locker(&s.mutex);
+    if (!s.recording) {
+        return;
+    }
+    s.events.append({name, phase, start, duration, threadNumber(s)});
+}
+
+} // namespace
+
+StartupTracer::Scope::Scope(const char *name)
+    : m_name(name)
+    , m_start(StartupTracer::now())
+{
+}
+
+StartupTracer::Scope::~Scope()
+{
+    StartupTracer::complete(m_name, m_start, StartupTracer::now());
+}
+
+void StartupTracer::mark(const char *name)
+{
+    record(name, 'i', now(), 0);
+}
+
+void StartupTracer::complete(const char *name, qint64 startUs, qint64 endUs)
+{
+    record(name, 'X', startUs, qMax<qint64>(0, endUs - startUs));
+}
+
+qint64 StartupTracer::now()
+{
+    TracerState &s = state();
+    return s.preMainUs + s.clock.nsecsElapsed() / 1000;
+}
+
+bool StartupTracer::isRecording()
+{
+    TracerState &s = state();
+    QMutexLocker locker(&s.mutex);
+    return s.recording;
+}
+
+QString StartupTracer::outputPath()
+{
+    return qEnvironmentVariable("QUTENOTE_STARTUP_TRACE");
+}
+
+void StartupTracer::finish()
+{
+    TracerState &s = state();
+    QVector<TraceEvent> events;
+    {
+        QMutexLocker locker(&s.mutex);
+        if (!s.recording) {
+            return;
+        }
+        s.recording = false;
+        events.swap(s.events);
+    }
+
+    const QString path = outputPath();
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QJsonArray traceEvents;
+    auto append = [&traceEvents](const char *name, char phase, qint64 start, qint64 duration, int thread) {
+        QJsonObject event;
+        event.insert("name", QString::fromUtf8(name));
+        event.insert("cat", "startup");
+        event.insert("ph", QString(QChar::fromLatin1(phase)));
+        event.insert("ts", double(start));
+        if (phase == 'X') {
+            event.insert("dur", double(duration));
+        } else {
+            event.insert("s", "g");
+        }
+        event.insert("pid", 1);
+        event.insert("tid", thread);
+        traceEvents.append(event);
+    };
+    if (s.preMainUs > 0) {
+        append("process start", 'i', 0, 0, 1);
+        append("pre-main", 'X', 0, s.preMainUs, 1);
+    }
+    for (const TraceEvent &event : events) {
+        append(event.name, event.phase, event.start, event.duration, event.thread);
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", traceEvents);
+    root.insert("displayTimeUnit", "ms");
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0
+            || !file.commit()) {
+        qWarning() << "StartupTracer: could not write" << path << file.errorString();
+        return;
+    }
+    qInfo() << "Startup trace written to" << path;
+}
@@ -0,0 +1,48 @@
+#ifndef STARTUPTRACER_H
+#define STARTUPTRACER_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Records timestamped phases of application startup and writes them as a
+// Chrome trace (load the file in chrome://tracing or ui.perfetto.dev).
+//
+// The clock starts during static initialization; on Linux and Android the
+// time the process spent being loaded before that is read from /proc and
+// shown as a "pre-main" phase, so timestamps count from process start.
+// Recording is always on and costs a mutex and an append per event; the
+// trace is only written if QUTENOTE_STARTUP_TRACE names an output file.
+// finish() stops recording, so later activity never grows the buffer.
+class StartupTracer
+{
+public:
+    // Records the time from construction to destruction as one phase
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        const char *m_name;
+        qint64 m_start;
+    };
+
+    // A single point in time, such as "first paint"
+    static void mark(const char *name);
+    static void complete(const char *name, qint64 startUs, qint64 endUs);
+
+    // Microseconds since process start
+    static qint64 now();
+    static bool isRecording();
+
+    // Stops recording and writes the trace if one was requested
+    static void finish();
+    static QString outputPath();
+
+private:
+    StartupTracer() = delete;
+};
+
+#endif // STARTUPTRACER_H
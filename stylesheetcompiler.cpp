@@ -0,0 +1,682 @@
+#include "stylesheetcompiler.h"
+#include "thememanager.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+
+// Static member definitions
+const int StyleSheetCompiler::FORMAT_VERSION = 1;
+const int StyleSheetCompiler::MAX_MEMORY_ENTRIES = 128;
+const int StyleSheetCompiler::MAX_DISK_ENTRIES = 256;
+
+namespace {
+
+const char *const kTokenNames[StyleSheetCompiler::TokenCount] = {
+    "TOUCH_TARGET",
+    "SPACING",
+    "SPACING2",
+    "BORDER_RADIUS",
+    "PRIMARY",
+    "SECONDARY",
+    "BACKGROUND",
+    "SURFACE",
+    "BASE",
+    "TEXT",
+    "ACCENT",
+    "HIGHLIGHT",
+    "BORDER",
+    "MENUBG",
+    "PLATE",
+    "CHECKED_BG",
+    "CHECKED_TEXT",
+    "SELECT_BG",
+    "SELECT_TEXT",
+    "OUTLINE_COLOR",
+    "COMBO_BG",
+    "COMBO_TEXT",
+    "SWITCH_STYLE",
+    "EDITOR_TEXT",
+    "EDITOR_BACKGROUND",
+    "EDITOR_FONT",
+    "EDITOR_FONT_SIZE",
+    "EDITOR_SELECTION",
+    "EDITOR_SELECTION_BG",
+    "EDITOR_TOOLBAR_BG",
+    "EDITOR_TOOLBAR_TEXT",
+};
+
+const char kApplicationSheet[] = R"(
+    QMainWindow {
+        background-color: {{BACKGROUND}};
+    }
+    QMessageBox {
+        border-radius: {{BORDER_RADIUS}}px;
+        border: 2px solid {{BORDER}};
+    }
+    QMessageBox QPushButton {
+        background-color: {{PLATE}};
+        color: white;
+    }
+    /* Removed global QWidget font-family and font-size to prevent layout issues */
+    QPushButton {
+        min-height: {{TOUCH_TARGET}}px;
+        padding: {{SPACING}}px {{SPACING2}}px;
+        border-radius: {{BORDER_RADIUS}}px;
+        /* Use the plate color for generic button backgrounds so toolbar/menu
+           plates defined elsewhere (menuBackground) remain authoritative. */
+        background: {{PLATE}};
+        border: 1px solid {{BORDER}};
+    }
+    QPushButton:hover {
+        background: {{SECONDARY}};
+    }
+    /* Make toolbars use the derived plate color so the toolbar buttons
+       region matches the fixed plate areas and scrollbar tracks. */
+    QToolBar { background: {{PLATE}}; }
+    /* Ensure any scrollbars inside toolbars use the same plate color for
+       their tracks/grooves so the area behind the handle doesn't appear
+       lighter than the toolbar plate. */
+    QToolBar QScrollBar:horizontal, QToolBar QScrollBar:vertical { background: {{PLATE}}; }
+    QToolBar QScrollBar::groove:horizontal, QToolBar QScrollBar::groove:vertical { background: {{PLATE}}; }
+    /* Specific targets for toolbar plate areas (fixed left/right and scroll area viewport)
+       use a slightly darker plate color so fixed components read equal or darker than
+       toolbar buttons. These are targeted by objectName set on MainView widgets. */
+    #ToolbarRow, #ToolbarLeftFixed, #ToolbarArea, #ToolbarArea QWidget, #FileBrowserButtonContainer { background: {{PLATE}}; }
+    QToolButton:checked, QPushButton:checked {
+        background: {{CHECKED_BG}};
+        color: {{CHECKED_TEXT}};
+        border: 1px solid {{MENUBG}};
+    }
+    QToolButton:checked:hover, QPushButton:checked:hover {
+        background: {{PLATE}};
+    }
+    /* Set base for text entry widgets */
+    QTextEdit, QLineEdit, QPlainTextEdit {
+        background-color: {{BASE}};
+        border: none;
+        padding: 0px;
+        margin: 0px;
+        selection-background-color: {{SELECT_BG}};
+        selection-color: {{SELECT_TEXT}};
+        font-size: 16px;
+    }
+    #ToolbarRow, #ToolbarLeftFixed, #ToolbarArea > .qt_scrollarea_viewport, #FileBrowserButtonContainer {
+        background: {{PLATE}};
+    }
+
+    QScrollBar:vertical, QScrollBar:horizontal {
+        /* Use the toolbar plate color for scrollbar tracks in toolbar areas so the
+           area behind the handle doesn't appear lighter than the toolbar plate. */
+        background: {{PLATE}};
+        border-radius: 6px;
+        width: 12px;
+        height: 12px;
+        margin: 0px;
+    }
+    QScrollBar::handle:vertical, QScrollBar::handle:horizontal {
+        background: {{ACCENT}};
+        min-height: 24px;
+        min-width: 24px;
+        border-radius: 6px;
+        border: 1px solid {{BORDER}};
+    }
+    QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical,
+    QScrollBar::add-line:horizontal, QScrollBar::sub-line:horizontal {
+        background: none;
+        border: none;
+    }
+    QScrollBar::up-arrow, QScrollBar::down-arrow,
+    QScrollBar::left-arrow, QScrollBar::right-arrow {
+        background: none;
+        border: none;
+    }
+    QScrollBar::add-page:vertical, QScrollBar::sub-page:vertical,
+    QScrollBar::add-page:horizontal, QScrollBar::sub-page:horizontal {
+        background: none;
+    }
+
+    QSlider::groove:horizontal {
+        border: 1px solid {{BORDER}};
+        height: 8px;
+        background: {{SURFACE}};
+        border-radius: 4px;
+    }
+    QSlider::handle:horizontal {
+        background: {{BACKGROUND}};
+        border: 1px solid {{BORDER}};
+        width: 22px;
+        height: 22px;
+        margin: -7px 0;
+        border-radius: 11px;
+    }
+    QSlider::groove:vertical {
+        border: 1px solid {{BORDER}};
+        width: 8px;
+        background: {{SURFACE}};
+        border-radius: 4px;
+    }
+    QSlider::handle:vertical {
+        background: {{BACKGROUND}};
+        border: 1px solid {{BORDER}};
+        width: 22px;
+        height: 22px;
+        margin: 0 -7px;
+        border-radius: 11px;
+    }
+    {{SWITCH_STYLE}}
+
+    /* FileBrowser buttons and toolbar buttons: bolder outline, no shadow, full surround.
+       Also include toolbar fixed-area buttons so toggle/settings in MainView
+       pick up the same plate/background without needing per-widget styles. */
+    #FileBrowserButtonContainer QPushButton, QToolBar QToolButton, TitleBarWidget QToolButton,
+    #ToolbarLeftFixed QToolButton, #ToolbarRow QToolButton {
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        border: 2px solid {{OUTLINE_COLOR}};
+        border-top-left-radius: {{BORDER_RADIUS}}px;
+        border-top-right-radius: {{BORDER_RADIUS}}px;
+        border-bottom-left-radius: {{BORDER_RADIUS}}px;
+        border-bottom-right-radius: {{BORDER_RADIUS}}px;
+        padding: {{SPACING}}px {{SPACING}}px;
+        min-height: 34px;
+    }
+
+    /* Apply same outer outline to the TitleBarWidget itself so the titlebar
+       region matches the button outlines visually. Only the border is set
+       so we don't alter the titlebar's background color. */
+    TitleBarWidget {
+        border: 2px solid {{OUTLINE_COLOR}};
+        border-radius: {{BORDER_RADIUS}}px;
+    }
+
+    /* Font selector and size combo in TextEditor: curved corners, no drop shadow.
+       The right edge of the combo border is hidden so the drop area can present
+       a stronger edge without a double seam. */
+    QComboBox#fontComboBox, QComboBox#fontSizeComboBox {
+        border-radius: {{BORDER_RADIUS}}px;
+        border: 2px solid {{OUTLINE_COLOR}};
+        border-right: none;
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        padding: {{SPACING}}px;
+    }
+    QComboBox#fontComboBox::drop-down, QComboBox#fontSizeComboBox::drop-down {
+        border-left: 2px solid {{OUTLINE_COLOR}};
+        background: {{COMBO_BG}};
+        subcontrol-origin: padding;
+        subcontrol-position: top right;
+        width: 30px;
+        border-top-right-radius: {{BORDER_RADIUS}}px;
+        border-bottom-right-radius: {{BORDER_RADIUS}}px;
+    }
+    QComboBox#fontComboBox::down-arrow, QComboBox#fontSizeComboBox::down-arrow {
+        image: url(:/resources/icons/custom/chevron-down.svg);
+        width: 10px;
+        height: 6px;
+        border: none;
+    }
+
+    /* Toolbar dividers should be subtle and driven by the theme border color */
+    QToolBar::separator {
+        background: {{OUTLINE_COLOR}};
+        width: 2px;
+        margin: 0 8px;
+        min-height: 24px;
+        border-radius: 1px;
+    }
+
+    /* Status bar should match the top bar plate and use white text */
+    QStatusBar {
+        background: {{PLATE}};
+        color: #ffffff;
+    }
+    QStatusBar QLabel, QStatusBar * { color: #ffffff; }
+    QWidget[touch-friendly=true]:pressed { background-color: rgba(128,128,128,0.12); }
+
+    /* Global QComboBox dropdown styling so all combobox popups get themed */
+    QComboBox QAbstractItemView {
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        selection-background-color: {{ACCENT}};
+        selection-color: {{SURFACE}};
+        border: 1px solid {{OUTLINE_COLOR}};
+    }
+)";
+
+const char kEditorSheet[] = R"(
+    QTextEdit {
+        color: {{EDITOR_TEXT}};
+        background-color: {{EDITOR_BACKGROUND}};
+        font-family: {{EDITOR_FONT}};
+        font-size: {{EDITOR_FONT_SIZE}}pt;
+        selection-color: {{EDITOR_SELECTION}};
+        selection-background-color: {{EDITOR_SELECTION_BG}};
+    }
+    TextEditor {
+        background-color: {{EDITOR_BACKGROUND}};
+        border: 2px solid {{HIGHLIGHT}};
+        border-radius: {{BORDER_RADIUS}}px;
+        padding: {{SPACING}}px;
+    }
+    QToolBar {
+        spacing: 2px;
+        padding: 0px;
+        background: {{EDITOR_TOOLBAR_BG}};
+        color: {{EDITOR_TOOLBAR_TEXT}};
+    }
+    QToolBar QToolButton {
+        min-width: 48px;
+        min-height: 44px;
+        padding: 4px;
+        margin: 1px;
+        border: 2px solid {{HIGHLIGHT}};
+        border-top-left-radius: {{BORDER_RADIUS}}px;
+        border-top-right-radius: {{BORDER_RADIUS}}px;
+        border-bottom-left-radius: {{BORDER_RADIUS}}px;
+        border-bottom-right-radius: {{BORDER_RADIUS}}px;
+    }
+    QToolBar QWidget {
+        margin: 0px;
+    }
+)";
+
+const char kFileBrowserSheet[] = R"(
+    QTreeView {
+        background-color: {{BASE}};
+        border: 2px solid {{HIGHLIGHT}};
+        border-top-left-radius: 8px;
+        border-top-right-radius: 8px;
+        border-bottom-left-radius: 8px;
+        border-bottom-right-radius: 8px;
+    }
+    QTreeView::item:selected {
+        background-color: {{ACCENT}};
+        color: {{SURFACE}};
+    }
+)";
+
+const char kSplitterSheet[] = R"(
+    QSplitter::handle {
+        background: {{SECONDARY}};
+        border: 1px solid {{BORDER}};
+    }
+    QSplitter::handle:hover {
+        background: {{PRIMARY}};
+    }
+)";
+
+const char kComboBoxSheet[] = R"(
+    QComboBox {
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        border: 2px solid {{OUTLINE_COLOR}};
+        border-radius: {{BORDER_RADIUS}}px;
+        padding: {{SPACING}}px;
+    }
+    QComboBox::drop-down {
+        subcontrol-origin: padding;
+        subcontrol-position: top right;
+        width: 30px;
+        border-left: 2px solid {{OUTLINE_COLOR}};
+    }
+    QComboBox::down-arrow {
+        image: url(:/resources/icons/custom/chevron-down.svg);
+        width: 10px;
+        height: 6px;
+    }
+    /* Ensure the popup list uses the same background and text colors so items are readable */
+    QComboBox QAbstractItemView {
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        selection-background-color: {{ACCENT}};
+        selection-color: {{SURFACE}};
+        border: 1px solid {{OUTLINE_COLOR}};
+    }
+)";
+
+const char kSpinBoxSheet[] = R"(
+    QSpinBox, QDoubleSpinBox {
+        background: {{COMBO_BG}};
+        color: {{COMBO_TEXT}};
+        border: 2px solid {{OUTLINE_COLOR}};
+        border-radius: {{BORDER_RADIUS}}px;
+        padding: {{SPACING}}px;
+    }
+    QSpinBox::up-button, QSpinBox::down-button {
+        subcontrol-origin: border;
+        width: 30px;
+    }
+)";
+
+const char kTabWidgetSheet[] = R"(
+    QTabWidget::pane { /* The tab widget frame */
+        border-top: 1px solid {{BORDER}};
+        background: {{BACKGROUND}};
+    }
+    QTabWidget::tab-bar {
+        left: 0px; /* Align tab bar to the left */
+    }
+    QTabBar::tab {
+        background: {{SURFACE}};
+        color: {{TEXT}};
+        min-height: {{TOUCH_TARGET}}px;
+        padding: 5px 10px;
+        border: 1px solid {{BORDER}};
+        border-bottom-color: {{BORDER}}; /* Same as pane border */
+        border-top-left-radius: {{BORDER_RADIUS}}px;
+        border-top-right-radius: {{BORDER_RADIUS}}px;
+        margin-right: 1px;
+    }
+    QTabBar::tab:selected {
+        background: {{BACKGROUND}};
+        color: {{PLATE}}; /* Use the plate color for selected tab text */
+        border-bottom-color: {{BACKGROUND}}; /* Make border disappear for selected tab */
+    }
+    QTabBar::tab:hover {
+        background: {{SECONDARY}};
+    }
+)";
+
+const char *const kSources[StyleSheetCompiler::SheetCount] = {
+    kApplicationSheet,
+    kEditorSheet,
+    kFileBrowserSheet,
+    kSplitterSheet,
+    kComboBoxSheet,
+    kSpinBoxSheet,
+    kTabWidgetSheet,
+};
+
+} // namespace
+
+StyleSheetCompiler::StyleSheetCompiler(const QString &cacheDirectory)
+    : m_cacheDirectory(cacheDirectory)
+{
+}
+
+StyleSheetCompiler::Tokens StyleSheetCompiler::themeTokens(const Theme &theme)
+{
+    const ThemeColors &colors = theme.colors;
+    const QColor checkedBg = colors.clicked.isValid() ? colors.clicked : colors.accent.darker(115);
+    const QString plate = colors.menuBackground.isValid()
+        ? colors.menuBackground.darker(110).name()
+        : colors.background.darker(130).name();
+
+    Tokens tokens;
+    tokens[TouchTarget] = QString::number(theme.metrics.touchTarget);
+    tokens[Spacing] = QString::number(theme.metrics.spacing);
+    tokens[Spacing2] = QString::number(theme.metrics.spacing * 2);
+    tokens[BorderRadius] = QString::number(theme.metrics.borderRadius);
+    tokens[Primary] = colors.primary.name();
+    tokens[Secondary] = colors.secondary.name();
+    tokens[Background] = colors.background.name();
+    tokens[Surface] = colors.surface.name();
+    tokens[Base] = colors.base.name();
+    tokens[Text] = colors.text.name();
+    tokens[Accent] = colors.accent.name();
+    tokens[Highlight] = colors.highlight.name();
+    tokens[Border] = colors.border.name();
+    tokens[MenuBackground] = colors.menuBackground.name();
+    tokens[Plate] = plate;
+    tokens[CheckedBackground] = checkedBg.name();
+    tokens[CheckedText] = colors.surface.name();
+    // Same pairing as the editor selection in ThemeManager::editorTheme()
+    tokens[SelectionBackground] = colors.accent.name();
+    tokens[SelectionText] = colors.surface.name();
+    tokens[Outline] = colors.menuBackground.isValid()
+        ? colors.menuBackground.darker(140).name()
+        : colors.border.darker(140).name();
+    tokens[ComboBackground] = colors.menuBackground.isValid()
+        ? colors.menuBackground.name()
+        : colors.surface.name();
+    tokens[ComboText] = colors.toolbarTextIcon.isValid()
+        ? colors.toolbarTextIcon.name()
+        : colors.text.name();
+    tokens[SwitchStyle] = theme.switchStyle;
+    return tokens;
+}
+
+void StyleSheetCompiler::setEditorTokens(Tokens *tokens, const Theme &theme, const EditorTheme &editor)
+{
+    // Toolbar background for the editor: prefer explicit editorMenuBackground,
+    // falling back to a darker variant of the general menuBackground
+    const QColor toolbarBg = theme.colors.editorMenuBackground.isValid()
+        ? theme.colors.editorMenuBackground
+        : theme.colors.menuBackground.darker(120);
+    const QColor toolbarText = theme.colors.toolbarTextIcon.isValid()
+        ? theme.colors.toolbarTextIcon
+        : ((toolbarBg.lightness() < 128) ? QColor("#ffffff") : theme.colors.text);
+
+    (*tokens)[EditorText] = editor.textColor.name();
+    (*tokens)[EditorBackground] = editor.backgroundColor.name();
+    (*tokens)[EditorFont] = editor.editorFont.family();
+    (*tokens)[EditorFontSize] = QString::number(editor.fontSize);
+    (*tokens)[EditorSelection] = editor.selectionColor.name();
+    (*tokens)[EditorSelectionBackground] = editor.selectionBackground.name();
+    (*tokens)[EditorToolbarBackground] = toolbarBg.name();
+    (*tokens)[EditorToolbarText] = toolbarText.name();
+}
+
+QString StyleSheetCompiler::styleSheet(Sheet sheet, const Tokens &tokens)
+{
+    const Template &compiledSheet = compiled(sheet);
+    const QByteArray key = cacheKey(sheet, compiledSheet, tokens);
+
+    const auto cached = m_sheets.constFind(key);
+    if (cached != m_sheets.constEnd()) {
+        return *cached;
+    }
+
+    QString result;
+    if (!readFromDisk(key, &result)) {
+        result = expand(compiledSheet, tokens);
+        writeToDisk(key, result);
+    }
+
+    // Theme and zoom combinations are few; dropping them all now and then
+    // is simpler than tracking use
+    if (m_sheets.size() >= MAX_MEMORY_ENTRIES) {
+        m_sheets.clear();
+    }
+    m_sheets.insert(key, result);
+    return result;
+}
+
+QString StyleSheetCompiler::expand(Sheet sheet, const Tokens &tokens)
+{
+    return expand(compiled(sheet), tokens);
+}
+
+QString StyleSheetCompiler::source(Sheet sheet)
+{
+    return QString::fromUtf8(kSources[sheet]);
+}
+
+QString StyleSheetCompiler::tokenName(Token token)
+{
+    return QString::fromLatin1(kTokenNames[token]);
+}
+
+QString StyleSheetCompiler::cacheDirectory() const
+{
+    return m_cacheDirectory;
+}
+
+void StyleSheetCompiler::setCacheDirectory(const QString &path)
+{
+    m_cacheDirectory = path;
+}
+
+void StyleSheetCompiler::clearMemoryCache()
+{
+    m_sheets.clear();
+}
+
+const StyleSheetCompiler::Template &StyleSheetCompiler::compiled(Sheet sheet)
+{
+    static const std::array<Template, SheetCount> templates = []() {
+        std::array<Template, SheetCount> result;
+        for (int i = 0; i < SheetCount; ++i) {
+            result[i] = compile(source(Sheet(i)));
+        }
+        return result;
+    }();
+    return templates[sheet];
+}
+
+StyleSheetCompiler::Template StyleSheetCompiler::compile(const QString &source)
+{
+    Template result;
+    result.text = minify(source);
+    result.digest = QCryptographicHash::hash(result.text.toUtf8(), QCryptographicHash::Sha1);
+
+    const QString &text = result.text;
+    int literalStart = 0;
+    int pos = 0;
+    while ((pos = text.indexOf(QLatin1String("{{"), pos)) >= 0) {
+        const int end = text.indexOf(QLatin1String("}}"), pos + 2);
+        if (end < 0) {
+            break;
+        }
+        const QStringView name = QStringView(text).mid(pos + 2, end - pos - 2);
+        int token = -1;
+        for (int i = 0; i < TokenCount; ++i) {
+            if (name == QLatin1String(kTokenNames[i])) {
+                token = i;
+                break;
+            }
+        }
+        if (token < 0) {
+            // Left in the text as written
+            qWarning() << "StyleSheetCompiler: unknown token" << name.toString();
+            pos = end + 2;
+            continue;
+        }
+
+        result.segments.append({literalStart, pos - literalStart, token});
+        result.literalLength += pos - literalStart;
+        if (!result.tokens.contains(token)) {
+            result.tokens.append(token);
+        }
+        pos = end + 2;
+        literalStart = pos;
+    }
+    result.segments.append({literalStart, int(text.size()) - literalStart, -1});
+    result.literalLength += int(text.size()) - literalStart;
+    return result;
+}
+
+QString StyleSheetCompiler::minify(const QString &source)
+{
+    // Drops comments and collapses whitespace; the templates hold no quoted
+    // strings, so nothing else needs to be preserved
+    QString result;
+    result.reserve(source.size());
+    bool pendingSpace = false;
+    for (int i = 0; i < source.size(); ++i) {
+        const QChar c = source.at(i);
+        if (c == QLatin1Char('/') && i + 1 < source.size() && source.at(i + 1) == QLatin1Char('*')) {
+            const int end = source.indexOf(QLatin1String("*/"), i + 2);
+            i = end < 0 ? source.size() : end + 1;
+            pendingSpace = true;
+            continue;
+        }
+        if (c.isSpace()) {
+            pendingSpace = true;
+            continue;
+        }
+        if (pendingSpace && !result.isEmpty()) {
+            result.append(QLatin1Char(' '));
+        }
+        pendingSpace = false;
+        result.append(c);
+    }
+    return result;
+}
+
+QString StyleSheetCompiler::expand(const Template &compiled, const Tokens &tokens)
+{
+    int length = compiled.literalLength;
+    for (const Segment &segment : compiled.segments) {
+        if (segment.token >= 0) {
+            length += tokens[segment.token].size();
+        }
+    }
+
+    QString result;
+    result.reserve(length);
+    for (const Segment &segment : compiled.segments) {
+        result.append(compiled.text.constData() + segment.offset, segment.length);
+        if (segment.token >= 0) {
+            result.append(tokens[segment.token]);
+        }
+    }
+    return result;
+}
+
+QByteArray StyleSheetCompiler::cacheKey(Sheet sheet, const Template &compiled, const Tokens &tokens)
+{
+    // Only the tokens the sheet uses, so e.g. a zoom change leaves the
+    // splitter sheet where it was
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const int header[2] = {FORMAT_VERSION, int(sheet)};
+    hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(header), sizeof(header)));
+    hash.addData(compiled.digest);
+    for (int token : compiled.tokens) {
+        const QString &value = tokens[token];
+        const int size = value.size();
+        hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(&size), sizeof(size)));
+        hash.addData(QByteArray::fromRawData(reinterpret_cast<const char *>(value.constData()),
+                                             size * int(sizeof(QChar))));
+    }
+    return hash.result().toHex();
+}
+
+QString StyleSheetCompiler::diskPath(const QByteArray &key) const
+{
+    return QString("%1/%2.qss").arg(m_cacheDirectory, QString::fromLatin1(key));
+}
+
+bool StyleSheetCompiler::readFromDisk(const QByteArray &key, QString *sheet) const
+{
+    if (m_cacheDirectory.isEmpty()) {
+        return false;
+    }
+    QFile file(diskPath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray content = file.readAll();
+    if (content.isEmpty()) {
+        return false;
+    }
+    *sheet = QString::fromUtf8(content);
+    return true;
+}
+
+void StyleSheetCompiler::writeToDisk(const QByteArray &key, const QString &sheet) const
+{
+    if (m_cacheDirectory.isEmpty()) {
+        return;
+    }
+    QDir dir(m_cacheDirectory);
+    if (!dir.mkpath(".")) {
+        qWarning() << "StyleSheetCompiler: could not create" << m_cacheDirectory;
+        return;
+    }
+
+    QSaveFile file(diskPath(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(sheet.toUtf8()) < 0 || !file.commit()) {
+        qWarning() << "StyleSheetCompiler: could not write" << file.fileName() << file.errorString();
+        return;
+    }
+
+    // Themes edited over time leave sheets nobody asks for again
+    const QFileInfoList entries = dir.entryInfoList(QStringList() << "*.qss", QDir::Files, QDir::Time);
+    for (int i = MAX_DISK_ENTRIES; i < entries.size(); ++i) {
+        QFile::remove(entries.at(i).absoluteFilePath());
+    }
+}
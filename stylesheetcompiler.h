@@ -0,0 +1,128 @@
+#ifndef STYLESHEETCOMPILER_H
+#define STYLESHEETCOMPILER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <array>
+
+struct Theme;
+struct EditorTheme;
+
+// Turns the theme stylesheet templates into the sheets ThemeManager applies.
+//
+// Each template is parsed once per process: comments and redundant
+// whitespace are dropped and every {{TOKEN}} becomes a slot, so expanding it
+// is one pass that appends literals and token values. Expanded sheets are
+// cached by a hash of the template and of the token values it uses (theme
+// colors and the zoom-dependent metrics), in memory and as .qss files in the
+// cache directory, so switching back to a theme or zoom level seen before -
+// in this run or an earlier one - costs a lookup.
+class StyleSheetCompiler
+{
+public:
+    enum Sheet {
+        Application,
+        Editor,
+        FileBrowser,
+        Splitter,
+        ComboBox,
+        SpinBox,
+        TabWidget,
+        SheetCount
+    };
+
+    enum Token {
+        TouchTarget,
+        Spacing,
+        Spacing2,
+        BorderRadius,
+        Primary,
+        Secondary,
+        Background,
+        Surface,
+        Base,
+        Text,
+        Accent,
+        Highlight,
+        Border,
+        MenuBackground,
+        Plate,
+        CheckedBackground,
+        CheckedText,
+        SelectionBackground,
+        SelectionText,
+        Outline,
+        ComboBackground,
+        ComboText,
+        SwitchStyle,
+        EditorText,
+        EditorBackground,
+        EditorFont,
+        EditorFontSize,
+        EditorSelection,
+        EditorSelectionBackground,
+        EditorToolbarBackground,
+        EditorToolbarText,
+        TokenCount
+    };
+
+    using Tokens = std::array<QString, TokenCount>;
+
+    // An empty cache directory keeps the cache in memory only
+    explicit StyleSheetCompiler(const QString &cacheDirectory = QString());
+
+    // Token values derived from a theme; the Editor* tokens stay empty
+    static Tokens themeTokens(const Theme &theme);
+    static void setEditorTokens(Tokens *tokens, const Theme &theme, const EditorTheme &editor);
+
+    // The expanded sheet, from memory, then disk, then expanded and stored
+    QString styleSheet(Sheet sheet, const Tokens &tokens);
+
+    // Expands without touching either cache
+    static QString expand(Sheet sheet, const Tokens &tokens);
+
+    // The template as written and the placeholder name of a token, for
+    // comparing against plain string substitution
+    static QString source(Sheet sheet);
+    static QString tokenName(Token token);
+
+    QString cacheDirectory() const;
+    void setCacheDirectory(const QString &path);
+    void clearMemoryCache();
+
+    static const int FORMAT_VERSION;
+    static const int MAX_MEMORY_ENTRIES;
+    static const int MAX_DISK_ENTRIES;
+
+private:
+    struct Segment {
+        int offset;   // literal text in Template::text
+        int length;
+        int token;    // token appended after the literal, or -1
+    };
+
+    struct Template {
+        QString text;
+        QVector<Segment> segments;
+        QVector<int> tokens;     // distinct tokens used, in order of first use
+        QByteArray digest;       // of the minified text
+        int literalLength = 0;
+    };
+
+    static const Template &compiled(Sheet sheet);
+    static Template compile(const QString &source);
+    static QString minify(const QString &source);
+    static QString expand(const Template &compiled, const Tokens &tokens);
+    static QByteArray cacheKey(Sheet sheet, const Template &compiled, const Tokens &tokens);
+
+    QString diskPath(const QByteArray &key) const;
+    bool readFromDisk(const QByteArray &key, QString *sheet) const;
+    void writeToDisk(const QByteArray &key, const QString &sheet) const;
+
+    QString m_cacheDirectory;
+    QHash<QByteArray, QString> m_sheets;
+};
+
+#endif // STYLESHEETCOMPILER_H
@@ -19,6 +19,7 @@
 #include <QUrl>
 #include <QStandardPaths>
 #include <QFile>
+#include <QFileInfo>
 #include <QThread>
 #include <QCoreApplication>
 #include <QDebug>
@@ -39,6 +40,16 @@
 #include "colorpicker.h"
 #include "thememanager.h"
 #include "uiutils.h"
+#include "documentsaver.h"
+#include "editjournal.h"
+#include "markdownreader.h"
+#include "markdownwriter.h"
+#include "noteformat.h"
+
+// Static member definitions
+const int TextEditor::DEFAULT_AUTOSAVE_DELAY;
+const int TextEditor::MIN_AUTOSAVE_DELAY;
+const int TextEditor::MAX_AUTOSAVE_DELAY;
 
 TextEditor::TextEditor(QWidget *parent)
     : QuteNote::ComponentBase(parent)
@@ -68,6 +79,12 @@ void TextEditor::initializeComponent()
     m_touchHandler = QuteNote::makeOwned<TextEditorTouchHandler>(this);
 #endif
     
+    m_saver = new DocumentSaver(this);
+    m_journal = new EditJournal(this);
+
+    m_autosaveTimer.setSingleShot(true);
+    m_autosaveTimer.setInterval(DEFAULT_AUTOSAVE_DELAY);
+
     // Setup actions, UI and connections
     setupActions();
     setupMenus();
@@ -105,6 +122,13 @@ void TextEditor::setupConnections()
             this, &TextEditor::onTextChanged);
     connect(m_editor.get(), &QTextEdit::cursorPositionChanged, 
             this, &TextEditor::onCursorPositionChanged);
+    connect(m_saver, &DocumentSaver::saveFinished,
+            this, &TextEditor::onSaveFinished);
+    connect(m_saver, &DocumentSaver::saveFailed,
+            this, &TextEditor::onSaveFailed);
+    connect(&m_autosaveTimer, &QTimer::timeout,
+            this, &TextEditor::flushAutosave);
+    connectDocumentSignals();
     
     // Connect action signals
     connect(m_boldAction.get(), &QAction::triggered, 
@@ -226,6 +250,22 @@ QScrollBar* TextEditor::verticalScrollBar() const
     return m_editor ? m_editor->verticalScrollBar() : nullptr;
 }
 
+void TextEditor::revealPosition(int blockNumber, int offset, int length)
+{
+    if (!m_editor) return;
+
+    const QTextBlock block = m_editor->document()->findBlockByNumber(blockNumber);
+    if (!block.isValid()) return;
+
+    const int start = block.position() + qBound(0, offset, block.length() - 1);
+    const int end = qMin(start + qMax(0, length), block.position() + block.length() - 1);
+    QTextCursor cursor(m_editor->document());
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    m_editor->setTextCursor(cursor);
+    m_editor->ensureCursorVisible();
+}
+
 bool TextEditor::event(QEvent *event)
 {
     switch (event->type()) {
@@ -1116,6 +1156,7 @@ void TextEditor::setContent(const QString &content)
 {
     if (!m_editor) return;
     m_editor->setHtml(content);
+    markFlushed();
     m_modified = false;
     emit modificationChanged(false);
 }
@@ -1126,8 +1167,79 @@ QString TextEditor::getContent() const
     return m_editor->toHtml();
 }
 
+void TextEditor::showLoadingPlaceholder(const QString &fileName)
+{
+    if (!m_editor) return;
+
+    if (!m_loading) {
+        m_placeholderText = m_editor->placeholderText();
+    }
+    m_loading = true;
+
+    m_autosaveTimer.stop();
+
+    // Clearing an (often large) document is far cheaper than parsing one, and
+    // keeps the user from typing into a note that is about to be replaced.
+    m_editor->clear();
+    m_editor->setReadOnly(true);
+    m_editor->setPlaceholderText(tr("Loading %1...").arg(fileName));
+}
+
+void TextEditor::adoptDocument(QTextDocument *document)
+{
+    if (!m_editor) {
+        delete document;
+        return;
+    }
+
+    const bool showingPlaceholder = m_loading;
+    m_loading = true;
+
+    // Match what QTextEdit would have applied to its own document
+    document->setDefaultFont(m_editor->font());
+    document->setParent(m_editor.get());
+
+    // setDocument() only frees the document QTextEdit created itself; one
+    // adopted earlier is a child of the editor and has to go explicitly
+    QTextDocument *previous = m_editor->document();
+    const bool previousAdopted = previous && previous != document && previous->parent() == m_editor.get();
+    m_editor->setDocument(document);
+    if (previousAdopted) {
+        previous->deleteLater();
+    }
+    connectDocumentSignals();
+
+    if (showingPlaceholder) {
+        m_editor->setReadOnly(false);
+        m_editor->setPlaceholderText(m_placeholderText);
+    }
+    m_loading = false;
+
+    markFlushed();
+    m_modified = false;
+    emit modificationChanged(false);
+}
+
+void TextEditor::clearLoadingPlaceholder()
+{
+    if (!m_editor || !m_loading) return;
+
+    m_editor->setReadOnly(false);
+    m_editor->setPlaceholderText(m_placeholderText);
+    m_loading = false;
+}
+
 void TextEditor::setFilePath(const QString &filePath)
 {
+    // Journal edits against the file they will eventually be saved to
+    const QString journalTarget = filePath.isEmpty() ? QString() : QFileInfo(filePath).absoluteFilePath();
+    if (m_journal && journalTarget != m_journal->notePath()) {
+        if (journalTarget.isEmpty()) {
+            m_journal->close();
+        } else {
+            m_journal->open(journalTarget);
+        }
+    }
     m_filePath = filePath;
     emit filePathChanged(filePath);
 }
@@ -1160,6 +1272,11 @@ void TextEditor::setModified(bool modified)
 
 void TextEditor::onTextChanged()
 {
+    // Placeholder and document swaps during async loads are not user edits
+    if (m_loading) {
+        return;
+    }
+
 #ifdef Q_OS_ANDROID
     // Set the changing text flag
     m_changingText = true;
@@ -1170,6 +1287,11 @@ void TextEditor::onTextChanged()
         emit modificationChanged(true);
     }
     emit contentChanged();
+
+    // Restart the idle debounce; the flush happens once typing pauses
+    if (m_autosaveEnabled && !m_filePath.isEmpty()) {
+        m_autosaveTimer.start();
+    }
     
 #ifdef Q_OS_ANDROID
     // Reset the changing text flag after a short delay
@@ -1714,8 +1836,11 @@ void TextEditor::refreshToolbar()
 void TextEditor::newDocument()
 {
     if (!m_editor) return;
+    m_autosaveTimer.stop();
+    m_journal->close();
     m_editor->clear();
     m_filePath.clear();
+    markFlushed();
     m_modified = false;
     emit modificationChanged(false);
 }
@@ -1724,11 +1849,16 @@ void TextEditor::openDocument()
 {
     if (!m_editor) return;
     QString fileName = QFileDialog::getOpenFileName(this,
-        "Open Document", m_filePath, "HTML files (*.html);;Text files (*.txt);;All files (*.*)");
+        "Open Document", m_filePath,
+        "HTML files (*.html);;Text files (*.txt);;Markdown files (*.md *.markdown);;All files (*.*)");
     if (!fileName.isEmpty()) {
         QFile file(fileName);
         if (file.open(QIODevice::ReadOnly)) {
-            m_editor->setHtml(file.readAll());
+            if (QuteNote::noteFormatForPath(fileName) == QuteNote::NoteFormat::Markdown) {
+                MarkdownReader(m_editor->document()).read(&file);
+            } else {
+                m_editor->setHtml(file.readAll());
+            }
             m_filePath = fileName;
             m_modified = false;
             emit modificationChanged(false);
@@ -1742,14 +1872,19 @@ void TextEditor::saveDocument()
     if (m_filePath.isEmpty()) {
         saveDocumentAs();
     } else {
-        QFile file(m_filePath);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(m_editor->toHtml().toUtf8());
-            file.close();
-            m_modified = false;
-            emit modificationChanged(false);
-            emit fileSaved(m_filePath);
-        }
+        // Snapshot now, serialize and write on a worker. The document stays
+        // modified until the write has been committed (onSaveFinished()), so
+        // a failed write never looks saved.
+        m_autosaveTimer.stop();
+        // The journal sequence tells us which edits this snapshot covers, so
+        // they can be compacted out of the journal once it has been written.
+        // Only Markdown is serialized per block; HTML is the whole toHtml().
+        const DocumentSaver::Serializer snapshot =
+            QuteNote::noteFormatForPath(m_filePath) == QuteNote::NoteFormat::Markdown
+                ? MarkdownWriter::snapshot(m_editor->document())
+                : DocumentSaver::htmlSnapshot(m_editor->document());
+        m_saver->save(m_filePath, snapshot, m_journal->sequence());
+        markFlushed();
     }
 }
 
@@ -1768,23 +1903,250 @@ bool TextEditor::saveDocumentAs()
     
     QString fileName = QFileDialog::getSaveFileName(this, "Save Document As",
                                                    defaultDir,
-                                                   "HTML Files (*.html);;Text Files (*.txt);;All Files (*.*)");
+                                                   "HTML Files (*.html);;Text Files (*.txt);;Markdown Files (*.md);;All Files (*.*)");
 
+    // True once the write is queued; whether it landed is reported through
+    // fileSaved() or saveFailed()
     if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(m_editor->toHtml().toUtf8());
-            file.close();
-            m_filePath = fileName;
-            m_modified = false;
-            emit modificationChanged(false);
-            emit fileSaved(m_filePath);
-            return true;
-        }
+        setFilePath(fileName);
+        saveDocument();
+        return true;
     }
     return false;
 }
 
+void TextEditor::waitForPendingSaves()
+{
+    if (m_saver) {
+        m_saver->waitForAll();
+    }
+}
+
+bool TextEditor::isSaving() const
+{
+    return m_saver && !m_filePath.isEmpty() && m_saver->isSaving(m_filePath);
+}
+
+void TextEditor::abandonPendingSaves()
+{
+    m_autosaveTimer.stop();
+    if (m_saver) {
+        if (!m_filePath.isEmpty()) {
+            m_saver->cancelPending(m_filePath);
+        }
+        m_saver->waitForAll();
+    }
+}
+
+void TextEditor::onSaveFinished(const QString &filePath, qint64 bytesWritten, quint64 journalSequence)
+{
+    if (QFileInfo(filePath).absoluteFilePath() == m_journal->notePath()) {
+        m_journal->compact(journalSequence);
+    }
+
+    m_autosaveStats.bytesWritten += bytesWritten;
+    if (m_flushClock.isValid() && filePath == m_filePath) {
+        const qint64 latency = m_flushClock.elapsed();
+        m_autosaveStats.lastFlushLatencyMs = latency;
+        m_autosaveStats.maxFlushLatencyMs = qMax(m_autosaveStats.maxFlushLatencyMs, latency);
+        m_flushClock.invalidate();
+    }
+
+    // Clean only if this was the newest snapshot and nothing was edited
+    // since it was taken
+    QTextDocument *doc = document();
+    if (filePath == m_filePath && m_modified && !m_saver->isSaving(filePath)
+            && doc && m_flushedRevision >= 0 && doc->revision() == m_flushedRevision) {
+        m_modified = false;
+        emit modificationChanged(false);
+    }
+    emit fileSaved(filePath);
+}
+
+void TextEditor::onSaveFailed(const QString &filePath, const QString &error)
+{
+    qWarning() << "Failed to save" << filePath << ":" << error;
+
+    // The snapshot never reached the disk, so the note still needs saving.
+    // It is normally still marked modified; setModified(false) from a caller
+    // in the meantime is undone.
+    if (filePath == m_filePath) {
+        m_flushedRevision = -1;
+        m_flushClock.invalidate();
+    }
+    if (filePath == m_filePath && !m_modified) {
+        m_modified = true;
+        emit modificationChanged(true);
+    }
+    emit saveFailed(filePath, error);
+}
+
+void TextEditor::setAutosaveEnabled(bool enabled)
+{
+    m_autosaveEnabled = enabled;
+    if (!enabled) {
+        m_autosaveTimer.stop();
+    } else if (m_modified && !m_filePath.isEmpty()) {
+        m_autosaveTimer.start();
+    }
+}
+
+void TextEditor::setAutosaveDelay(int msecs)
+{
+    m_autosaveTimer.setInterval(qBound(MIN_AUTOSAVE_DELAY, msecs, MAX_AUTOSAVE_DELAY));
+}
+
+QList<int> TextEditor::dirtyBlocks() const
+{
+    QList<int> blocks;
+    QTextDocument *doc = document();
+    if (!doc) return blocks;
+
+    // Qt stamps every block it touches with the document revision of the
+    // edit, so anything newer than the flushed revision changed since then.
+    for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
+        if (m_flushedRevision < 0 || block.revision() > m_flushedRevision) {
+            blocks.append(block.blockNumber());
+        }
+    }
+    return blocks;
+}
+
+bool TextEditor::hasUnflushedChanges() const
+{
+    QTextDocument *doc = document();
+    if (!doc) return false;
+    // Removing blocks leaves no dirty block behind but still bumps the
+    // document revision, so compare against that first.
+    return m_flushedRevision < 0 || doc->revision() != m_flushedRevision;
+}
+
+void TextEditor::flushAutosave()
+{
+    m_autosaveTimer.stop();
+    if (!m_editor || m_filePath.isEmpty() || m_loading) return;
+
+    if (!m_modified || !hasUnflushedChanges()) {
+        ++m_autosaveStats.skippedClean;
+        return;
+    }
+
+    m_autosaveStats.lastDirtyBlocks = dirtyBlocks().size();
+    ++m_autosaveStats.flushes;
+    m_flushClock.start();
+    saveDocument();
+}
+
+void TextEditor::connectDocumentSignals()
+{
+    if (QTextDocument *doc = document()) {
+        connect(doc, &QTextDocument::contentsChange,
+                this, &TextEditor::onDocumentContentsChange, Qt::UniqueConnection);
+    }
+}
+
+void TextEditor::onDocumentContentsChange(int position, int charsRemoved, int charsAdded)
+{
+    if (m_loading || !m_journal || !m_journal->isOpen()) return;
+    QTextDocument *doc = document();
+    if (!doc) return;
+
+    // Record "replace charsRemoved characters at position with what is there
+    // now". That is a few bytes per keystroke instead of a full toHtml().
+    const int last = doc->characterCount() - 1;
+    const int start = qBound(0, position, last);
+    const int end = qBound(start, position + charsAdded, last);
+    QTextCursor cursor(doc);
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+
+    if (start == end || isPlainContinuation(doc, start, end)) {
+        m_journal->append(EditJournal::Operation::ReplaceText, position, charsRemoved,
+                          cursor.selectedText());
+    } else {
+        // Formatted text (bold typed or pasted, a new block, a format-only
+        // change) is kept as an HTML fragment of just the changed range
+        m_journal->append(EditJournal::Operation::ReplaceHtml, position, charsRemoved,
+                          QTextDocumentFragment(cursor).toHtml());
+    }
+}
+
+bool TextEditor::isPlainContinuation(const QTextDocument *doc, int start, int end)
+{
+    // Replaying plain text with QTextCursor::insertText() gives it the
+    // format of the character in front of it. That is only right when there
+    // is such a character in the same block and the whole range has its
+    // format.
+    const QTextBlock block = doc->findBlock(start);
+    if (start <= block.position() || end >= block.position() + block.length()) {
+        return false;
+    }
+    QTextCursor before(const_cast<QTextDocument*>(doc));
+    before.setPosition(start);
+    const QTextCharFormat format = before.charFormat();
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+        const QTextFragment fragment = it.fragment();
+        if (fragment.position() + fragment.length() <= start || fragment.position() >= end) {
+            continue;
+        }
+        if (fragment.charFormat() != format) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int TextEditor::recoverFromJournal()
+{
+    QTextDocument *doc = document();
+    if (!doc || !m_journal) return 0;
+
+    const QList<EditJournal::Operation> operations = m_journal->pendingOperations();
+    if (operations.isEmpty()) return 0;
+
+    // Replayed edits are already in the journal; don't record them twice
+    m_loading = true;
+    QTextCursor cursor(doc);
+    cursor.beginEditBlock();
+    for (const EditJournal::Operation &op : operations) {
+        const int last = doc->characterCount() - 1;
+        const int start = qBound(0, static_cast<int>(op.position), last);
+        const int end = qBound(start, static_cast<int>(op.position + op.removed), last);
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        if (op.type == EditJournal::Operation::ReplaceHtml) {
+            cursor.insertFragment(QTextDocumentFragment::fromHtml(op.payload));
+        } else if (op.payload.isEmpty()) {
+            cursor.removeSelectedText();
+        } else {
+            cursor.insertText(op.payload);
+        }
+    }
+    cursor.endEditBlock();
+    m_loading = false;
+
+    // The recovered text exists only in memory and in the journal
+    m_flushedRevision = -1;
+    setModified(true);
+    if (m_autosaveEnabled && !m_filePath.isEmpty()) {
+        m_autosaveTimer.start();
+    }
+    return operations.size();
+}
+
+void TextEditor::discardJournal()
+{
+    if (m_journal) {
+        m_journal->discard();
+    }
+}
+
+void TextEditor::markFlushed()
+{
+    QTextDocument *doc = document();
+    m_flushedRevision = doc ? doc->revision() : -1;
+}
+
 void TextEditor::cut()
 {
     if (!m_editor) return;
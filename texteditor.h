@@ -3,6 +3,8 @@
 
 #include <QWidget>
 #include <QTextEdit>
+#include <QTimer>
+#include <QElapsedTimer>
 #include "texteditortouchhandler.h"
 #include "uiutils.h"
 #include "componentbase.h"
@@ -26,6 +28,8 @@ class QMenu;
 class QActionGroup;
 class QScrollArea;
 class QScrollBar;
+class DocumentSaver;
+class EditJournal;
 
 class TextEditor : public QuteNote::ComponentBase
 {
@@ -38,6 +42,49 @@ public:
 
     void setContent(const QString &content);
     QString getContent() const;
+    // Async loading: show a cheap placeholder while a note is parsed off the
+    // GUI thread, then swap the finished document in with adoptDocument()
+    void showLoadingPlaceholder(const QString &fileName);
+    void adoptDocument(QTextDocument *document);
+    void clearLoadingPlaceholder();
+    // Blocks until background saves have reached the disk
+    void waitForPendingSaves();
+    bool isSaving() const;
+    // Drops scheduled and queued saves of the current file and waits for the
+    // one being written, so nothing lands after the file is replaced
+    void abandonPendingSaves();
+
+    // Autosave: flushes the note after the user has been idle for the
+    // configured delay. Only documents with edits since the last flush
+    // are written. Markdown notes reuse the text of unchanged blocks
+    // (MarkdownWriter::snapshot()); HTML notes are always serialized whole
+    // with toHtml(), on the save worker, so the dirty blocks only decide
+    // whether an HTML note is written at all.
+    struct AutosaveStats {
+        int flushes = 0;              // Autosave writes started
+        int skippedClean = 0;         // Debounce expiries with nothing to write
+        int lastDirtyBlocks = 0;      // Blocks changed before the last flush (statistic only)
+        qint64 bytesWritten = 0;      // Bytes committed by all background saves
+        qint64 lastFlushLatencyMs = 0; // Snapshot to commit, last autosave
+        qint64 maxFlushLatencyMs = 0;
+    };
+    void setAutosaveEnabled(bool enabled);
+    bool isAutosaveEnabled() const { return m_autosaveEnabled; }
+    void setAutosaveDelay(int msecs);
+    int autosaveDelay() const { return m_autosaveTimer.interval(); }
+    AutosaveStats autosaveStats() const { return m_autosaveStats; }
+    void resetAutosaveStats() { m_autosaveStats = AutosaveStats(); }
+
+    // Crash recovery: replays edits journaled for the current file that
+    // never reached it. Returns the number of operations applied.
+    int recoverFromJournal();
+    // Forget journaled edits for the current file (user chose to discard)
+    void discardJournal();
+
+    // Blocks whose contents changed since the last flush, by block number
+    QList<int> dirtyBlocks() const;
+    bool hasUnflushedChanges() const;
+    bool isLoading() const { return m_loading; }
     void setFilePath(const QString &filePath);
     QString filePath() const;
     bool isModified() const;
@@ -53,6 +100,8 @@ public:
     QWidget* viewport() const;
     QTextDocument* document() const;
     QScrollBar* verticalScrollBar() const;
+    // Selects length characters at offset in the given block and scrolls to them
+    void revealPosition(int blockNumber, int offset, int length = 0);
     
 Q_SIGNALS:
     void contentChanged();
@@ -60,12 +109,15 @@ Q_SIGNALS:
     void filePathChanged(const QString &filePath);
     void modificationChanged(bool modified);
     void fileSaved(const QString &filePath);
+    void saveFailed(const QString &filePath, const QString &error);
 
 public slots:
     void newDocument();
     void openDocument();
+    // Both only queue the write: the document stays modified until
+    // fileSaved() and keeps that state after saveFailed()
     void saveDocument();
-    bool saveDocumentAs();
+    bool saveDocumentAs(); // False if no file name was chosen
 
     // Standard text editing operations
     void cut();
@@ -73,6 +125,9 @@ public slots:
     void paste();
     void undo();
     void redo();
+
+    // Writes the note now if it has unflushed edits (autosave timer target)
+    void flushAutosave();
     
     // Overscroll indicator management
     void updateOverscrollIndicators();
@@ -104,6 +159,9 @@ private slots:
     void onFontChanged(const QFont &font);
     void onFontSizeChanged(const QString &size);
     void onCursorPositionChanged();
+    void onSaveFinished(const QString &filePath, qint64 bytesWritten, quint64 journalSequence);
+    void onDocumentContentsChange(int position, int charsRemoved, int charsAdded);
+    void onSaveFailed(const QString &filePath, const QString &error);
 
 
 private:
@@ -115,6 +173,8 @@ private:
     void setupActions();
     void setupMenus();
     void mergeFormatOnWordOrSelection(const QTextCharFormat &format);
+    // Whether [start, end) can be journaled as plain text, see onDocumentContentsChange()
+    static bool isPlainContinuation(const QTextDocument *doc, int start, int end);
     void fontChanged(const QFont &f);
     void applyFormat(QTextListFormat::Style style);
     void applyOverlayButtonTheme();
@@ -142,6 +202,20 @@ private:
     QString m_defaultSaveDirectory;
     bool m_modified;
     bool m_changingText = false;
+    bool m_loading = false;
+    QString m_placeholderText;
+    DocumentSaver *m_saver = nullptr; // Child object; flushes pending saves on destruction
+    EditJournal *m_journal = nullptr; // Write-ahead log of edits to the open file
+    void connectDocumentSignals();
+
+    // Autosave state. m_flushedRevision is the QTextDocument::revision() at
+    // the last snapshot; blocks with a newer QTextBlock::revision() are dirty.
+    bool m_autosaveEnabled = false;
+    QTimer m_autosaveTimer;
+    QElapsedTimer m_flushClock;
+    int m_flushedRevision = -1;
+    AutosaveStats m_autosaveStats;
+    void markFlushed();
 
     // UI Elements
     QuteNote::OwnedPtr<QWidget> m_editorContainer;
@@ -179,6 +253,10 @@ private:
     
     // Touch handling
     QuteNote::OwnedPtr<TextEditorTouchHandler> m_touchHandler;
+
+    static const int DEFAULT_AUTOSAVE_DELAY = 2000; // ms of idle before a flush
+    static const int MIN_AUTOSAVE_DELAY = 250;
+    static const int MAX_AUTOSAVE_DELAY = 60000;
 };
 
 #endif // TEXTEDITOR_H
\ No newline at end of file
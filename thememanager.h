@@ -8,6 +8,9 @@
 #include <QString>
 
 #include "smartpointers.h"
+#include "stylesheetcompiler.h"
+#include "themestyle.h"
+#include <QPointer>
 #include <QMap>
 #include <QStringList>
 #include "texteditor.h"
@@ -90,6 +93,17 @@ class ThemeManager : public QObject, public QuteNote::Singleton<ThemeManager>
     friend class QuteNote::Singleton<ThemeManager>;
 
 public:
+    // How themes reach the widgets: expanded stylesheets, or the application
+    // palette plus ThemeStyle, which switches without re-polishing anything
+    enum Backend {
+        StyleSheetBackend,
+        PaletteBackend
+    };
+
+    Backend backend() const;
+    // Read once at startup; a change applies on the next launch
+    static Backend configuredBackend();
+    static void setConfiguredBackend(Backend backend);
     
     void applyTheme(const QString &themeName);
     void saveTheme(const Theme &theme);
@@ -132,9 +146,17 @@ private:
     void createPurpleTheme();
     void applyThemeToApplication(const Theme &theme);
     QString themeFilePath(const QString &themeName) const;
+    const StyleSheetCompiler::Tokens &styleTokens();
+    void applyStyleSheet(QWidget *widget, StyleSheetCompiler::Sheet sheet);
+    bool usesPalette() const;
 
     Theme m_currentTheme;
     QMap<QString, Theme> m_themes;
+    StyleSheetCompiler m_styleSheets;
+    StyleSheetCompiler::Tokens m_styleTokens;
+    bool m_styleTokensDirty = true;
+    Backend m_backend;
+    QPointer<ThemeStyle> m_style; // owned by the application once installed
 };
 
 #endif // THEMEMANAGER_H
@@ -20,6 +20,7 @@ ThemeSettingsPage::ThemeSettingsPage(QWidget *parent)
     , m_menuFontCombo(nullptr)
     , m_defaultFontSize(nullptr)
     , m_zoomSlider(nullptr)
+    , m_fastSwitchCheck(nullptr)
     , m_isUpdating(false)
 {
     setupUI();
@@ -152,6 +153,16 @@ void ThemeSettingsPage::setupZoomSection()
     layout->addRow("Menu font:", m_menuFontCombo);
     connect(m_menuFontCombo, &QFontComboBox::currentFontChanged, this, &ThemeSettingsPage::onFontChanged);
 
+    // Palette backend; the style is installed at startup, so it needs a restart
+    m_fastSwitchCheck = new QCheckBox("Fast theme switching (after restart)", group);
+    m_fastSwitchCheck->setToolTip("Draw themes with the palette instead of stylesheets");
+    m_fastSwitchCheck->setChecked(ThemeManager::configuredBackend() == ThemeManager::PaletteBackend);
+    layout->addRow(m_fastSwitchCheck);
+    connect(m_fastSwitchCheck, &QCheckBox::toggled, this, [](bool checked) {
+        ThemeManager::setConfiguredBackend(checked ? ThemeManager::PaletteBackend
+                                                   : ThemeManager::StyleSheetBackend);
+    });
+
     if (auto mainLayout = qobject_cast<QVBoxLayout*>(this->layout())) mainLayout->addWidget(group);
 }
 
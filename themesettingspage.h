@@ -9,6 +9,7 @@
 #include <QFontComboBox>
 #include <QSpinBox>
 #include <QSlider>
+#include <QCheckBox>
 #include <QShowEvent>
 #include "thememanager.h"
 #include "colorpicker.h"
@@ -52,6 +53,7 @@ private:
     
     // Zoom slider replaces spacing, border radius, icon size, and touch target
     QSlider *m_zoomSlider;
+    QCheckBox *m_fastSwitchCheck;
 
     Theme m_currentTheme;
     bool m_isUpdating;
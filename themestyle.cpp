@@ -0,0 +1,310 @@
+#include "themestyle.h"
+#include "thememanager.h"
+#include <QCheckBox>
+#include <QPainter>
+#include <QStyleFactory>
+#include <QStyleOption>
+#include <QTabBar>
+#include <QToolBar>
+
+// Static member definitions
+const int ThemeStyle::SCROLLBAR_EXTENT;
+const int ThemeStyle::SCROLLBAR_MIN_HANDLE;
+const int ThemeStyle::SLIDER_HANDLE;
+const int ThemeStyle::SWITCH_WIDTH;
+const int ThemeStyle::SWITCH_HEIGHT;
+
+ThemeStyle::ThemeStyle()
+    : QProxyStyle(QStyleFactory::create("Fusion"))
+{
+}
+
+void ThemeStyle::setTheme(const Theme &theme)
+{
+    // The same derived colors as the stylesheet tokens in StyleSheetCompiler
+    const ThemeColors &colors = theme.colors;
+    m_plate = colors.menuBackground.isValid() ? colors.menuBackground.darker(110) : colors.background.darker(130);
+    m_checked = colors.clicked.isValid() ? colors.clicked : colors.accent.darker(115);
+    m_hover = colors.secondary;
+    m_border = colors.border;
+    m_outline = colors.menuBackground.isValid() ? colors.menuBackground.darker(140) : colors.border.darker(140);
+    m_accent = colors.accent;
+    m_surface = colors.surface;
+    m_background = colors.background;
+    m_radius = theme.metrics.borderRadius;
+    m_spacing = theme.metrics.spacing;
+    m_touchTarget = theme.metrics.touchTarget > 0 ? theme.metrics.touchTarget : 48;
+
+    const QColor buttonBg = colors.menuBackground.isValid() ? colors.menuBackground : colors.surface;
+    const QColor buttonText = colors.toolbarTextIcon.isValid() ? colors.toolbarTextIcon : colors.text;
+
+    QPalette palette;
+    palette.setColor(QPalette::Window, colors.background);
+    palette.setColor(QPalette::WindowText, colors.text);
+    palette.setColor(QPalette::Base, colors.base);
+    palette.setColor(QPalette::AlternateBase, colors.surface);
+    palette.setColor(QPalette::Text, colors.text);
+    palette.setColor(QPalette::Button, buttonBg);
+    palette.setColor(QPalette::ButtonText, buttonText);
+    palette.setColor(QPalette::BrightText, Qt::white);
+    palette.setColor(QPalette::Highlight, colors.accent);
+    palette.setColor(QPalette::HighlightedText, colors.surface);
+    palette.setColor(QPalette::ToolTipBase, colors.surface);
+    palette.setColor(QPalette::ToolTipText, colors.text);
+    palette.setColor(QPalette::Link, colors.accent);
+    palette.setColor(QPalette::LinkVisited, colors.accent.darker(120));
+    palette.setColor(QPalette::Light, buttonBg.lighter(125));
+    palette.setColor(QPalette::Midlight, buttonBg.lighter(110));
+    palette.setColor(QPalette::Mid, m_outline.lighter(120));
+    palette.setColor(QPalette::Dark, m_outline);
+    palette.setColor(QPalette::Shadow, m_outline.darker(150));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    palette.setColor(QPalette::PlaceholderText, colors.textSecondary);
+#endif
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, colors.textSecondary);
+    palette.setColor(QPalette::Disabled, QPalette::Text, colors.textSecondary);
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, colors.textSecondary);
+    m_palette = palette;
+}
+
+QPalette ThemeStyle::themePalette() const
+{
+    return m_palette;
+}
+
+int ThemeStyle::pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const
+{
+    switch (metric) {
+    case PM_ScrollBarExtent:
+        return SCROLLBAR_EXTENT;
+    case PM_ScrollBarSliderMin:
+        return SCROLLBAR_MIN_HANDLE;
+    case PM_SliderThickness:
+    case PM_SliderLength:
+    case PM_SliderControlThickness:
+        return SLIDER_HANDLE;
+    case PM_ButtonMargin:
+        return m_spacing * 2;
+    case PM_IndicatorWidth:
+        if (qobject_cast<const QCheckBox *>(widget)) {
+            return SWITCH_WIDTH;
+        }
+        break;
+    case PM_IndicatorHeight:
+        if (qobject_cast<const QCheckBox *>(widget)) {
+            return SWITCH_HEIGHT;
+        }
+        break;
+    default:
+        break;
+    }
+    return QProxyStyle::pixelMetric(metric, option, widget);
+}
+
+QSize ThemeStyle::sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                                   const QWidget *widget) const
+{
+    QSize result = QProxyStyle::sizeFromContents(type, option, size, widget);
+    switch (type) {
+    case CT_PushButton:
+        result.setHeight(qMax(result.height(), m_touchTarget));
+        break;
+    case CT_TabBarTab:
+        if (const auto *tab = qstyleoption_cast<const QStyleOptionTab *>(option)) {
+            if (tab->shape == QTabBar::RoundedNorth || tab->shape == QTabBar::RoundedSouth) {
+                result.setHeight(qMax(result.height(), m_touchTarget));
+            }
+        }
+        break;
+    case CT_ToolButton:
+        if (widget && qobject_cast<const QToolBar *>(widget->parentWidget())) {
+            result.setHeight(qMax(result.height(), 34));
+        }
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+QRect ThemeStyle::subControlRect(ComplexControl control, const QStyleOptionComplex *option,
+                                 SubControl subControl, const QWidget *widget) const
+{
+    const auto *bar = qstyleoption_cast<const QStyleOptionSlider *>(option);
+    if (control != CC_ScrollBar || !bar) {
+        return QProxyStyle::subControlRect(control, option, subControl, widget);
+    }
+
+    // Slim scroll bars without arrow buttons: the groove is the whole bar
+    const QRect rect = bar->rect;
+    const bool horizontal = bar->orientation == Qt::Horizontal;
+    const int length = horizontal ? rect.width() : rect.height();
+    const int range = bar->maximum - bar->minimum;
+    int handle = length;
+    if (range > 0) {
+        handle = int(qint64(length) * bar->pageStep / (qint64(range) + bar->pageStep));
+        handle = qMin(length, qMax(handle, SCROLLBAR_MIN_HANDLE));
+    }
+    const int position = QStyle::sliderPositionFromValue(bar->minimum, bar->maximum, bar->sliderPosition,
+                                                         length - handle, bar->upsideDown);
+
+    int start = 0;
+    int size = 0;
+    switch (subControl) {
+    case SC_ScrollBarGroove:
+        return rect;
+    case SC_ScrollBarSlider:
+        start = position;
+        size = handle;
+        break;
+    case SC_ScrollBarSubPage:
+        size = position;
+        break;
+    case SC_ScrollBarAddPage:
+        start = position + handle;
+        size = length - start;
+        break;
+    default:
+        // Arrow buttons and first/last have no area
+        return QRect();
+    }
+    const QRect result = horizontal
+        ? QRect(rect.x() + start, rect.y(), size, rect.height())
+        : QRect(rect.x(), rect.y() + start, rect.width(), size);
+    return visualRect(bar->direction, rect, result);
+}
+
+void ThemeStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                               const QWidget *widget) const
+{
+    switch (element) {
+    case PE_PanelButtonCommand:
+        drawButtonPanel(option, painter, false);
+        return;
+    case PE_PanelButtonTool:
+        drawButtonPanel(option, painter, true);
+        return;
+    case PE_IndicatorCheckBox:
+        if (qobject_cast<const QCheckBox *>(widget)) {
+            drawSwitch(option, painter);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void ThemeStyle::drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                             const QWidget *widget) const
+{
+    const auto *tab = qstyleoption_cast<const QStyleOptionTab *>(option);
+    if (tab && tab->shape == QTabBar::RoundedNorth) {
+        const bool selected = tab->state & State_Selected;
+        if (element == CE_TabBarTabShape) {
+            QColor fill = m_surface;
+            if (selected) {
+                fill = m_background;
+            } else if (tab->state & State_MouseOver) {
+                fill = m_hover;
+            }
+            // Round the top corners only; the bottom runs into the pane
+            const QRectF rect = QRectF(tab->rect).adjusted(0.5, 0.5, -1.5, 0);
+            const qreal radius = qMin<qreal>(m_radius, rect.height() / 2);
+            painter->save();
+            painter->setRenderHint(QPainter::Antialiasing);
+            painter->setClipRect(tab->rect);
+            painter->setPen(QPen(m_border, 1));
+            painter->setBrush(fill);
+            painter->drawRoundedRect(rect.adjusted(0, 0, 0, radius), radius, radius);
+            painter->restore();
+            return;
+        }
+        if (element == CE_TabBarTabLabel && selected) {
+            QStyleOptionTab label(*tab);
+            label.palette.setColor(QPalette::WindowText, m_plate);
+            QProxyStyle::drawControl(element, &label, painter, widget);
+            return;
+        }
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+void ThemeStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex *option,
+                                    QPainter *painter, const QWidget *widget) const
+{
+    const auto *bar = qstyleoption_cast<const QStyleOptionSlider *>(option);
+    if (control != CC_ScrollBar || !bar) {
+        QProxyStyle::drawComplexControl(control, option, painter, widget);
+        return;
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->fillRect(bar->rect, m_plate);
+
+    const QRect slider = subControlRect(CC_ScrollBar, bar, SC_ScrollBarSlider, widget);
+    if (slider.isValid()) {
+        QColor fill = m_accent;
+        if ((bar->state & State_Sunken) && (bar->activeSubControls & SC_ScrollBarSlider)) {
+            fill = fill.darker(110);
+        }
+        const QRectF rect = QRectF(slider).adjusted(0.5, 0.5, -0.5, -0.5);
+        const qreal radius = qMin(rect.width(), rect.height()) / 2;
+        painter->setPen(QPen(m_border, 1));
+        painter->setBrush(fill);
+        painter->drawRoundedRect(rect, radius, radius);
+    }
+    painter->restore();
+}
+
+void ThemeStyle::drawButtonPanel(const QStyleOption *option, QPainter *painter, bool toolButton) const
+{
+    const bool enabled = option->state & State_Enabled;
+    const bool checked = option->state & State_On;
+    const bool hovered = enabled && (option->state & State_MouseOver);
+
+    // Tool buttons carry the toolbar look, push buttons the plate
+    QColor fill = toolButton ? m_palette.color(QPalette::Button) : m_plate;
+    QPen pen = toolButton ? QPen(m_outline, 2) : QPen(m_border, 1);
+    if (checked) {
+        fill = hovered ? m_plate : m_checked;
+        pen = QPen(m_palette.color(QPalette::Button), 1);
+    } else if (hovered && !toolButton) {
+        fill = m_hover;
+    }
+    if (option->state & State_Sunken) {
+        fill = fill.darker(110);
+    }
+
+    const qreal inset = pen.widthF() / 2;
+    const QRectF rect = QRectF(option->rect).adjusted(inset, inset, -inset, -inset);
+    const qreal radius = qMin<qreal>(m_radius, rect.height() / 2);
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(pen);
+    painter->setBrush(fill);
+    painter->drawRoundedRect(rect, radius, radius);
+    painter->restore();
+}
+
+void ThemeStyle::drawSwitch(const QStyleOption *option, QPainter *painter) const
+{
+    const bool checked = option->state & State_On;
+    const QRectF rect = QRectF(option->rect).adjusted(1, 1, -1, -1);
+    const qreal radius = rect.height() / 2;
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(QPen(checked ? m_border : m_hover, 2));
+    painter->setBrush(checked ? m_accent : m_surface);
+    painter->drawRoundedRect(rect, radius, radius);
+
+    const qreal knob = rect.height() - 6;
+    const qreal x = checked ? rect.right() - 3 - knob : rect.left() + 3;
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(checked ? m_surface : m_hover);
+    painter->drawEllipse(QRectF(x, rect.top() + 3, knob, knob));
+    painter->restore();
+}
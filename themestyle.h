@@ -0,0 +1,65 @@
+#ifndef THEMESTYLE_H
+#define THEMESTYLE_H
+
+#include <QColor>
+#include <QPalette>
+#include <QProxyStyle>
+
+struct Theme;
+
+// Draws the theme through the style instead of through stylesheets.
+//
+// Used by ThemeManager's palette backend: colors go into the application
+// QPalette and the few looks a palette cannot express (rounded button
+// plates, the switch-style check box, slim scroll bars, touch-sized
+// controls) are painted here on top of Fusion. Switching themes then only
+// swaps colors and metrics and repaints; no widget is re-polished, which is
+// what makes a stylesheet switch slow.
+class ThemeStyle : public QProxyStyle
+{
+    Q_OBJECT
+
+public:
+    ThemeStyle();
+
+    void setTheme(const Theme &theme);
+    QPalette themePalette() const;
+
+    int pixelMetric(PixelMetric metric, const QStyleOption *option = nullptr,
+                    const QWidget *widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                           const QWidget *widget) const override;
+    QRect subControlRect(ComplexControl control, const QStyleOptionComplex *option,
+                         SubControl subControl, const QWidget *widget) const override;
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                       const QWidget *widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                     const QWidget *widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex *option,
+                            QPainter *painter, const QWidget *widget = nullptr) const override;
+
+    static const int SCROLLBAR_EXTENT = 12;
+    static const int SCROLLBAR_MIN_HANDLE = 24;
+    static const int SLIDER_HANDLE = 22;
+    static const int SWITCH_WIDTH = 40;
+    static const int SWITCH_HEIGHT = 24;
+
+private:
+    void drawButtonPanel(const QStyleOption *option, QPainter *painter, bool toolButton) const;
+    void drawSwitch(const QStyleOption *option, QPainter *painter) const;
+
+    QPalette m_palette;
+    QColor m_plate;
+    QColor m_checked;
+    QColor m_hover;
+    QColor m_border;
+    QColor m_outline;
+    QColor m_accent;
+    QColor m_surface;
+    QColor m_background;
+    int m_radius = 12;
+    int m_spacing = 8;
+    int m_touchTarget = 48;
+};
+
+#endif // THEMESTYLE_H
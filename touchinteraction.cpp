@@ -1,7 +1,7 @@
 #include "touchinteraction.h"
 #include <QWidget>
 #include <QtMath>
-#include <QDateTime>
+#include "framescheduler.h"
 
 TouchInteraction::TouchInteraction(QObject *parent)
     : QObject(parent)
@@ -15,26 +15,16 @@ TouchInteraction::TouchInteraction(QObject *parent)
     , m_scrollMin(0.0)
     , m_scrollMax(0.0)
     , m_isAnimating(false)
-    , m_physicsTimer(new QTimer(this))
 {
     m_bounceCurve.setType(QEasingCurve::OutElastic);
     m_bounceCurve.setAmplitude(0.5);
     m_bounceCurve.setPeriod(0.75);
     
     m_physicsEngine = new PhysicsEngine(this);
+    // Overscroll springs are plain springs: evaluate them in closed form
+    m_physicsEngine->setIntegration(PhysicsEngine::Analytic);
     m_isPhysicsActive = false;
     
-    // Connect physics timer to update method
-    connect(m_physicsTimer.data(), &QTimer::timeout, this, [this]() {
-        qreal currentTime = QDateTime::currentMSecsSinceEpoch() / 1000.0;
-        qreal deltaTime = m_jellyState.lastTime > 0 ? currentTime - m_jellyState.lastTime : 0;
-        m_jellyState.lastTime = currentTime;
-        updateJellyPhysics(deltaTime);
-    });
-    
-    // Configure physics engine
-    m_physicsEngine->setUpdateInterval(16); // Default to 60Hz updates
-    
     // Connect physics engine signals
     connect(m_physicsEngine, &PhysicsEngine::stateUpdated, this, [this](const PhysicsState &state) {
         setOverscrollAmount(state.position);
@@ -113,7 +103,7 @@ bool TouchInteraction::handleTouchEvent(QTouchEvent *event)
                     m_physicsEngine->start();
                     m_isPhysicsActive = true;
                 } else {
-                    m_physicsEngine->state().velocity += delta.y() * 60;
+                    m_physicsEngine->addVelocity(delta.y() * 60);
                 }
             }
             
@@ -167,7 +157,6 @@ void TouchInteraction::initializeJellyAnimation()
     m_jellyState.velocity = 0;
     m_jellyState.targetPosition = 0;
     m_jellyState.active = false;
-    m_jellyState.lastTime = QDateTime::currentMSecsSinceEpoch() / 1000.0;
 }
 
 void TouchInteraction::startJellyOverscrollAnimation(qreal currentPos, qreal targetPos)
@@ -180,17 +169,17 @@ void TouchInteraction::startJellyOverscrollAnimation(qreal currentPos, qreal tar
     m_jellyState.targetPosition = targetPos;
     m_jellyState.velocity = 0;
     m_jellyState.active = true;
-    m_jellyState.lastTime = QDateTime::currentMSecsSinceEpoch() / 1000.0;
     
-    if (!m_physicsTimer->isActive()) {
-        m_physicsTimer->start();
-    }
+    // Stepped once per display frame until updateJellyPhysics() settles it
+    FrameScheduler::instance()->schedule(this, [this](qreal deltaTime) {
+        updateJellyPhysics(deltaTime);
+        return m_jellyState.active;
+    });
 }
 
 void TouchInteraction::updateJellyPhysics(qreal deltaTime)
 {
     if (!m_jellyState.active) {
-        m_physicsTimer->stop();
         return;
     }
     
@@ -209,7 +198,6 @@ void TouchInteraction::updateJellyPhysics(qreal deltaTime)
         m_jellyState.active = false;
         m_jellyState.position = m_jellyState.targetPosition;
         m_jellyState.velocity = 0;
-        m_physicsTimer->stop();
     }
     
     // Emit the new position
@@ -222,8 +210,7 @@ void TouchInteraction::resetAnimations()
         m_bounceAnimation->stop();
     if (m_jellyAnimation)
         m_jellyAnimation->stop();
-    if (m_physicsTimer->isActive())
-        m_physicsTimer->stop();
+    FrameScheduler::instance()->unschedule(this);
     
     m_jellyState.active = false;
     m_isAnimating = false;
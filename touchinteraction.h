@@ -97,10 +97,9 @@ private:
     int m_overscrollDuration;
     QEasingCurve m_bounceCurve;
 
-    // Physics engine
+    // Physics engine; the jelly spring below is stepped by FrameScheduler too
     PhysicsEngine *m_physicsEngine;
     bool m_isPhysicsActive;
-    QPointer<QTimer> m_physicsTimer;
 
     // Animations
     QPointer<QPropertyAnimation> m_bounceAnimation;
@@ -113,7 +112,6 @@ private:
         qreal velocity = 0.0;
         qreal targetPosition = 0.0;
         bool active = false;
-        double lastTime = 0.0;
     } m_jellyState;
 
     // Touch tracking
@@ -0,0 +1,323 @@
+#include "zipreader.h"
+#include <QIODevice>
+#include <QStringList>
+#include <QtEndian>
+#include <QDebug>
+#include <zlib.h>
+#include <limits>
+
+// Static member definitions
+const int ZipReader::CHUNK_SIZE;
+
+namespace {
+
+constexpr quint32 kLocalHeaderSignature = 0x04034b50;
+constexpr quint32 kCentralHeaderSignature = 0x02014b50;
+constexpr quint32 kEndOfCentralDirectorySignature = 0x06054b50;
+constexpr quint32 kZip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr quint32 kZip64LocatorSignature = 0x07064b50;
+constexpr quint16 kZip64ExtraTag = 0x0001;
+
+constexpr quint16 kFlagEncrypted = 0x0001;
+constexpr quint16 kFlagUtf8 = 0x0800;
+constexpr quint16 kMethodStored = 0;
+constexpr quint16 kMethodDeflated = 8;
+
+constexpr int kLocalHeaderSize = 30;
+constexpr int kCentralHeaderSize = 46;
+constexpr int kEndOfCentralDirectorySize = 22;
+constexpr int kZip64EndOfCentralDirectorySize = 56;
+constexpr int kZip64LocatorSize = 20;
+constexpr int kMaxCommentSize = 0xffff;
+
+constexpr quint32 kMax32 = 0xffffffffu;
+constexpr quint16 kMax16 = 0xffffu;
+
+quint16 get16(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+
+quint32 get32(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+}
+
+quint64 get64(const char *data)
+{
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(data));
+}
+
+} // namespace
+
+ZipReader::ZipReader(const QString &path)
+    : m_file(path)
+{
+}
+
+bool ZipReader::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return fail(QString("Could not open %1: %2").arg(m_file.fileName(), m_file.errorString()));
+    }
+    return readCentralDirectory();
+}
+
+quint64 ZipReader::totalUncompressedSize() const
+{
+    quint64 total = 0;
+    for (const Entry &entry : m_entries) {
+        total += entry.uncompressedSize;
+    }
+    return total;
+}
+
+bool ZipReader::extract(const Entry &entry, QIODevice *out, const Progress &progress)
+{
+    char header[kLocalHeaderSize];
+    if (!readAt(entry.localHeaderOffset, header, kLocalHeaderSize)
+        || get32(header) != kLocalHeaderSignature) {
+        return fail(QString("%1 is damaged").arg(entry.name));
+    }
+    if (get16(header + 6) & kFlagEncrypted) {
+        return fail(QString("%1 is encrypted").arg(entry.name));
+    }
+    const quint64 dataOffset = entry.localHeaderOffset + kLocalHeaderSize
+        + get16(header + 26) + get16(header + 28);
+    if (!m_file.seek(qint64(dataOffset))) {
+        return fail(QString("%1 is damaged").arg(entry.name));
+    }
+
+    QByteArray input(CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray output(CHUNK_SIZE, Qt::Uninitialized);
+    quint64 remaining = entry.compressedSize;
+    quint64 total = 0;
+    quint32 crc = quint32(crc32(0L, Z_NULL, 0));
+
+    auto deliver = [&](const char *data, qint64 size) {
+        if (out->write(data, size) != size) {
+            return fail(QString("Could not write %1: %2").arg(entry.name, out->errorString()));
+        }
+        crc = quint32(crc32(crc, reinterpret_cast<const Bytef *>(data), uInt(size)));
+        total += quint64(size);
+        if (progress && !progress(qint64(total))) {
+            return fail("Cancelled");
+        }
+        return true;
+    };
+
+    if (entry.method == kMethodStored) {
+        while (remaining > 0) {
+            const qint64 read = m_file.read(input.data(), qint64(qMin<quint64>(remaining, CHUNK_SIZE)));
+            if (read <= 0) {
+                return fail(QString("%1 is truncated").arg(entry.name));
+            }
+            remaining -= quint64(read);
+            if (!deliver(input.constData(), read)) {
+                return false;
+            }
+        }
+    } else if (entry.method == kMethodDeflated) {
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            return fail(QString("Could not decompress %1").arg(entry.name));
+        }
+        int status = Z_OK;
+        bool ok = true;
+        while (ok && status != Z_STREAM_END) {
+            // With no input left zlib may still hold output that did not fit
+            // the last buffer, so inflate() runs until it cannot progress
+            if (stream.avail_in == 0 && remaining > 0) {
+                const qint64 read = m_file.read(input.data(), qint64(qMin<quint64>(remaining, CHUNK_SIZE)));
+                if (read <= 0) {
+                    ok = fail(QString("%1 is truncated").arg(entry.name));
+                    break;
+                }
+                remaining -= quint64(read);
+                stream.next_in = reinterpret_cast<Bytef *>(input.data());
+                stream.avail_in = uInt(read);
+            }
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = uInt(output.size());
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_BUF_ERROR && stream.avail_in == 0 && remaining == 0) {
+                // Out of input before the end of the stream
+                ok = fail(QString("%1 is truncated").arg(entry.name));
+                break;
+            }
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                ok = fail(QString("%1 is damaged").arg(entry.name));
+                break;
+            }
+            const int produced = output.size() - int(stream.avail_out);
+            if (produced > 0 && !deliver(output.constData(), produced)) {
+                ok = false;
+            }
+        }
+        inflateEnd(&stream);
+        if (!ok) {
+            return false;
+        }
+    } else {
+        return fail(QString("%1 uses an unsupported compression method (%2)")
+                        .arg(entry.name).arg(entry.method));
+    }
+
+    if (total != entry.uncompressedSize || crc != entry.crc) {
+        return fail(QString("%1 is damaged").arg(entry.name));
+    }
+    return true;
+}
+
+bool ZipReader::isSafeName(const QString &name)
+{
+    if (name.isEmpty() || name.startsWith('/') || name.startsWith('\\') || name.contains(':')) {
+        return false;
+    }
+    const QStringList parts = QString(name).replace('\\', '/').split('/');
+    bool hasName = false;
+    for (const QString &part : parts) {
+        if (part == "..") {
+            return false;
+        }
+        hasName = hasName || (!part.isEmpty() && part != ".");
+    }
+    return hasName;
+}
+
+bool ZipReader::readCentralDirectory()
+{
+    const quint64 fileSize = quint64(m_file.size());
+    if (fileSize < quint64(kEndOfCentralDirectorySize)) {
+        return fail(QString("%1 is not a ZIP archive").arg(m_file.fileName()));
+    }
+
+    // The end record sits at the very end, behind an optional comment
+    const quint64 tailSize = qMin<quint64>(fileSize, kEndOfCentralDirectorySize + kMaxCommentSize);
+    QByteArray tail(int(tailSize), Qt::Uninitialized);
+    if (!readAt(fileSize - tailSize, tail.data(), tail.size())) {
+        return false;
+    }
+    int endPos = -1;
+    for (int i = tail.size() - kEndOfCentralDirectorySize; i >= 0; --i) {
+        if (get32(tail.constData() + i) == kEndOfCentralDirectorySignature) {
+            endPos = i;
+            break;
+        }
+    }
+    if (endPos < 0) {
+        return fail(QString("%1 is not a ZIP archive").arg(m_file.fileName()));
+    }
+
+    const char *end = tail.constData() + endPos;
+    quint64 count = get16(end + 10);
+    quint64 centralSize = get32(end + 12);
+    quint64 centralOffset = get32(end + 16);
+
+    if (count == kMax16 || centralSize == kMax32 || centralOffset == kMax32) {
+        const quint64 endOffset = fileSize - tailSize + quint64(endPos);
+        char locator[kZip64LocatorSize];
+        char zip64End[kZip64EndOfCentralDirectorySize];
+        if (endOffset < quint64(kZip64LocatorSize)
+            || !readAt(endOffset - kZip64LocatorSize, locator, kZip64LocatorSize)
+            || get32(locator) != kZip64LocatorSignature
+            || !readAt(get64(locator + 8), zip64End, kZip64EndOfCentralDirectorySize)
+            || get32(zip64End) != kZip64EndOfCentralDirectorySignature) {
+            return fail(QString("%1 is damaged").arg(m_file.fileName()));
+        }
+        count = get64(zip64End + 32);
+        centralSize = get64(zip64End + 40);
+        centralOffset = get64(zip64End + 48);
+    }
+
+    if (centralOffset + centralSize > fileSize || centralSize > quint64(std::numeric_limits<int>::max())) {
+        return fail(QString("%1 is damaged").arg(m_file.fileName()));
+    }
+    QByteArray central(int(centralSize), Qt::Uninitialized);
+    if (!readAt(centralOffset, central.data(), central.size())) {
+        return false;
+    }
+
+    m_entries.clear();
+    m_entries.reserve(int(qMin<quint64>(count, centralSize / kCentralHeaderSize)));
+    int pos = 0;
+    for (quint64 i = 0; i < count; ++i) {
+        if (pos + kCentralHeaderSize > central.size()
+            || get32(central.constData() + pos) != kCentralHeaderSignature) {
+            return fail(QString("%1 is damaged").arg(m_file.fileName()));
+        }
+        const char *header = central.constData() + pos;
+        const quint16 flags = get16(header + 8);
+        const int nameLength = get16(header + 28);
+        const int extraLength = get16(header + 30);
+        const int commentLength = get16(header + 32);
+        if (pos + kCentralHeaderSize + nameLength + extraLength + commentLength > central.size()) {
+            return fail(QString("%1 is damaged").arg(m_file.fileName()));
+        }
+
+        Entry entry;
+        entry.method = get16(header + 10);
+        entry.modified = fromDosDateTime(get16(header + 12), get16(header + 14));
+        entry.crc = get32(header + 16);
+        entry.compressedSize = get32(header + 20);
+        entry.uncompressedSize = get32(header + 24);
+        entry.localHeaderOffset = get32(header + 42);
+
+        const char *name = header + kCentralHeaderSize;
+        entry.name = (flags & kFlagUtf8) ? QString::fromUtf8(name, nameLength)
+                                         : QString::fromLocal8Bit(name, nameLength);
+        entry.name.replace('\\', '/');
+
+        // ZIP64 values appear in this order, and only for the fields that overflowed
+        const char *extra = name + nameLength;
+        const char *extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd) {
+            const quint16 tag = get16(extra);
+            const quint16 size = get16(extra + 2);
+            const char *field = extra + 4;
+            const char *fieldEnd = qMin(field + size, extraEnd);
+            if (tag == kZip64ExtraTag) {
+                if (entry.uncompressedSize == kMax32 && field + 8 <= fieldEnd) {
+                    entry.uncompressedSize = get64(field);
+                    field += 8;
+                }
+                if (entry.compressedSize == kMax32 && field + 8 <= fieldEnd) {
+                    entry.compressedSize = get64(field);
+                    field += 8;
+                }
+                if (entry.localHeaderOffset == kMax32 && field + 8 <= fieldEnd) {
+                    entry.localHeaderOffset = get64(field);
+                }
+            }
+            extra += 4 + size;
+        }
+
+        m_entries.append(entry);
+        pos += kCentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+bool ZipReader::readAt(quint64 offset, char *data, qint64 size)
+{
+    if (!m_file.seek(qint64(offset)) || m_file.read(data, size) != size) {
+        return fail(QString("Could not read %1").arg(m_file.fileName()));
+    }
+    return true;
+}
+
+bool ZipReader::fail(const QString &message)
+{
+    if (m_error.isEmpty()) {
+        m_error = message;
+        qWarning() << "ZipReader:" << message;
+    }
+    return false;
+}
+
+QDateTime ZipReader::fromDosDateTime(quint16 time, quint16 date)
+{
+    const QDate d(1980 + (date >> 9), (date >> 5) & 0x0f, date & 0x1f);
+    const QTime t(time >> 11, (time >> 5) & 0x3f, (time & 0x1f) * 2);
+    return QDateTime(d, t);
+}
@@ -0,0 +1,62 @@
+#ifndef ZIPREADER_H
+#define ZIPREADER_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class QIODevice;
+
+// Reads ZIP archives (stored and deflated entries, ZIP64) one entry at a
+// time. open() only reads the central directory; extract() inflates an
+// entry in fixed-size chunks straight into a device and checks its CRC, so
+// memory use does not depend on the size of the archive or its entries.
+class ZipReader
+{
+public:
+    struct Entry {
+        QString name; // '/' separated; directories end with '/'
+        quint16 method = 0;
+        quint32 crc = 0;
+        quint64 compressedSize = 0;
+        quint64 uncompressedSize = 0;
+        quint64 localHeaderOffset = 0;
+        QDateTime modified;
+
+        bool isDirectory() const { return name.endsWith('/'); }
+    };
+
+    // Called with the number of bytes extracted from the current entry so
+    // far; returning false stops the extraction
+    using Progress = std::function<bool(qint64 bytesDone)>;
+
+    explicit ZipReader(const QString &path);
+
+    bool open();
+    QVector<Entry> entries() const { return m_entries; }
+    quint64 totalUncompressedSize() const;
+
+    bool extract(const Entry &entry, QIODevice *out, const Progress &progress = Progress());
+
+    // A relative path without "..", suitable for extracting below a folder
+    static bool isSafeName(const QString &name);
+
+    QString errorString() const { return m_error; }
+
+private:
+    bool readCentralDirectory();
+    bool readAt(quint64 offset, char *data, qint64 size);
+    bool fail(const QString &message);
+
+    static QDateTime fromDosDateTime(quint16 time, quint16 date);
+
+    QFile m_file;
+    QVector<Entry> m_entries;
+    QString m_error;
+
+    static const int CHUNK_SIZE = 256 * 1024;
+};
+
+#endif // ZIPREADER_H
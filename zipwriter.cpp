@@ -0,0 +1,470 @@
+#include "zipwriter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QList>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QDebug>
+#include <zlib.h>
+
+// Static member definitions
+const int ZipWriter::COMPRESSION_LEVEL;
+const int ZipWriter::CHUNK_SIZE;
+const qint64 ZipWriter::STREAM_THRESHOLD;
+const qint64 ZipWriter::MAX_IN_FLIGHT_BYTES;
+
+namespace {
+
+constexpr quint32 kLocalHeaderSignature = 0x04034b50;
+constexpr quint32 kCentralHeaderSignature = 0x02014b50;
+constexpr quint32 kEndOfCentralDirectorySignature = 0x06054b50;
+constexpr quint32 kZip64EndOfCentralDirectorySignature = 0x06064b50;
+constexpr quint32 kZip64LocatorSignature = 0x07064b50;
+constexpr quint16 kZip64ExtraTag = 0x0001;
+
+constexpr quint16 kVersionDefault = 20;
+constexpr quint16 kVersionZip64 = 45;
+constexpr quint16 kFlagUtf8 = 0x0800;
+constexpr quint16 kMethodStored = 0;
+constexpr quint16 kMethodDeflated = 8;
+constexpr quint32 kDosDirectoryAttribute = 0x10;
+
+constexpr quint32 kMax32 = 0xffffffffu;
+constexpr quint16 kMax16 = 0xffffu;
+// Deflate can grow incompressible data slightly; leave room for that
+constexpr quint64 kZip64LocalThreshold = 0xffff0000u;
+
+void put16(QByteArray &out, quint16 value)
+{
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 2);
+}
+
+void put32(QByteArray &out, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+void put64(QByteArray &out, quint64 value)
+{
+    char bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 8);
+}
+
+quint32 clamp32(quint64 value)
+{
+    return value >= kMax32 ? kMax32 : quint32(value);
+}
+
+} // namespace
+
+ZipWriter::ZipWriter(const QString &path)
+    : m_file(path)
+{
+}
+
+ZipWriter::~ZipWriter()
+{
+    // An archive that was not closed is discarded by QSaveFile
+}
+
+bool ZipWriter::open()
+{
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        return fail(QString("Could not create %1: %2").arg(m_file.fileName(), m_file.errorString()));
+    }
+    return true;
+}
+
+bool ZipWriter::addDirectory(const QString &name, const QDateTime &modified)
+{
+    CentralRecord record;
+    record.name = (name.endsWith('/') ? name : name + '/').toUtf8();
+    record.directory = true;
+    dosDateTime(modified, &record.dosTime, &record.dosDate);
+    if (!writeLocalHeader(&record, false)) {
+        return false;
+    }
+    m_records.append(record);
+    return true;
+}
+
+bool ZipWriter::addFiles(const QVector<Source> &files, const Progress &progress)
+{
+    struct Pending {
+        QFuture<CompressedFile> future;
+        qint64 size = 0;
+    };
+
+    QList<Pending> pending;
+    qint64 inFlightBytes = 0;
+    qint64 bytesDone = 0;
+    const int maxInFlight = qMax(2, QThreadPool::globalInstance()->maxThreadCount() * 2);
+
+    auto abandon = [&pending]() {
+        for (Pending &task : pending) {
+            task.future.waitForFinished();
+        }
+        pending.clear();
+    };
+
+    // Writes the oldest compressed file once it is ready, keeping the
+    // archive in the order the files were given
+    auto writeNext = [&]() {
+        Pending task = pending.takeFirst();
+        const CompressedFile file = task.future.result();
+        inFlightBytes -= task.size;
+        if (!file.error.isEmpty()) {
+            return fail(file.error);
+        }
+        if (!writeCompressed(file)) {
+            return false;
+        }
+        bytesDone += qint64(file.uncompressedSize);
+        if (progress && !progress(bytesDone)) {
+            return fail("Cancelled");
+        }
+        return true;
+    };
+
+    for (const Source &source : files) {
+        if (m_failed) {
+            break;
+        }
+
+        const qint64 size = QFileInfo(source.filePath).size();
+        if (size > STREAM_THRESHOLD) {
+            while (!pending.isEmpty() && writeNext()) {
+            }
+            if (m_failed || !streamFile(source, progress, &bytesDone)) {
+                break;
+            }
+            continue;
+        }
+
+        while (!pending.isEmpty()
+               && (pending.size() >= maxInFlight || inFlightBytes + size > MAX_IN_FLIGHT_BYTES)) {
+            if (!writeNext()) {
+                break;
+            }
+        }
+        if (m_failed) {
+            break;
+        }
+
+        pending.append({QtConcurrent::run([source]() { return compressFile(source); }), size});
+        inFlightBytes += size;
+    }
+
+    while (!m_failed && !pending.isEmpty()) {
+        writeNext();
+    }
+    abandon();
+    return !m_failed;
+}
+
+bool ZipWriter::close()
+{
+    if (m_failed) {
+        return false;
+    }
+
+    const quint64 centralOffset = m_offset;
+    for (const CentralRecord &record : m_records) {
+        QByteArray extra;
+        if (record.uncompressedSize >= kMax32) {
+            put64(extra, record.uncompressedSize);
+        }
+        if (record.compressedSize >= kMax32) {
+            put64(extra, record.compressedSize);
+        }
+        if (record.offset >= kMax32) {
+            put64(extra, record.offset);
+        }
+        if (!extra.isEmpty()) {
+            QByteArray field;
+            put16(field, kZip64ExtraTag);
+            put16(field, quint16(extra.size()));
+            extra.prepend(field);
+        }
+
+        QByteArray header;
+        put32(header, kCentralHeaderSignature);
+        put16(header, kVersionZip64);
+        put16(header, extra.isEmpty() ? kVersionDefault : kVersionZip64);
+        put16(header, kFlagUtf8);
+        put16(header, record.method);
+        put16(header, record.dosTime);
+        put16(header, record.dosDate);
+        put32(header, record.crc);
+        put32(header, clamp32(record.compressedSize));
+        put32(header, clamp32(record.uncompressedSize));
+        put16(header, quint16(record.name.size()));
+        put16(header, quint16(extra.size()));
+        put16(header, 0); // Comment
+        put16(header, 0); // Disk
+        put16(header, 0); // Internal attributes
+        put32(header, record.directory ? kDosDirectoryAttribute : 0);
+        put32(header, clamp32(record.offset));
+        header.append(record.name);
+        header.append(extra);
+        if (!write(header)) {
+            return false;
+        }
+    }
+    const quint64 centralSize = m_offset - centralOffset;
+    const quint64 count = quint64(m_records.size());
+
+    QByteArray trailer;
+    if (count >= kMax16 || centralOffset >= kMax32 || centralSize >= kMax32) {
+        const quint64 zip64EndOffset = m_offset;
+        put32(trailer, kZip64EndOfCentralDirectorySignature);
+        put64(trailer, 44); // Size of the rest of this record
+        put16(trailer, kVersionZip64);
+        put16(trailer, kVersionZip64);
+        put32(trailer, 0);
+        put32(trailer, 0);
+        put64(trailer, count);
+        put64(trailer, count);
+        put64(trailer, centralSize);
+        put64(trailer, centralOffset);
+
+        put32(trailer, kZip64LocatorSignature);
+        put32(trailer, 0);
+        put64(trailer, zip64EndOffset);
+        put32(trailer, 1);
+    }
+    put32(trailer, kEndOfCentralDirectorySignature);
+    put16(trailer, 0);
+    put16(trailer, 0);
+    put16(trailer, count >= kMax16 ? kMax16 : quint16(count));
+    put16(trailer, count >= kMax16 ? kMax16 : quint16(count));
+    put32(trailer, clamp32(centralSize));
+    put32(trailer, clamp32(centralOffset));
+    put16(trailer, 0); // Comment
+    if (!write(trailer)) {
+        return false;
+    }
+
+    if (!m_file.commit()) {
+        return fail(QString("Could not write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+    }
+    return true;
+}
+
+ZipWriter::CompressedFile ZipWriter::compressFile(const Source &source)
+{
+    CompressedFile result;
+    result.name = source.name;
+
+    QFile file(source.filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = QString("Could not read %1: %2").arg(source.filePath, file.errorString());
+        return result;
+    }
+    result.modified = QFileInfo(file).lastModified();
+    const QByteArray content = file.readAll();
+    result.uncompressedSize = quint64(content.size());
+    result.crc = quint32(crc32(0L, reinterpret_cast<const Bytef *>(content.constData()), uInt(content.size())));
+
+    z_stream stream = {};
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        result.error = QString("Could not compress %1").arg(source.filePath);
+        return result;
+    }
+    QByteArray deflated(int(deflateBound(&stream, uLong(content.size()))), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(content.constData()));
+    stream.avail_in = uInt(content.size());
+    stream.next_out = reinterpret_cast<Bytef *>(deflated.data());
+    stream.avail_out = uInt(deflated.size());
+    const int status = deflate(&stream, Z_FINISH);
+    deflated.truncate(int(stream.total_out));
+    deflateEnd(&stream);
+
+    // Incompressible files (images, already compressed data) are stored
+    if (status == Z_STREAM_END && deflated.size() < content.size()) {
+        result.method = kMethodDeflated;
+        result.data = deflated;
+    } else {
+        result.method = kMethodStored;
+        result.data = content;
+    }
+    return result;
+}
+
+bool ZipWriter::writeCompressed(const CompressedFile &file)
+{
+    CentralRecord record;
+    record.name = file.name.toUtf8();
+    record.method = file.method;
+    record.crc = file.crc;
+    record.compressedSize = quint64(file.data.size());
+    record.uncompressedSize = file.uncompressedSize;
+    dosDateTime(file.modified, &record.dosTime, &record.dosDate);
+
+    if (!writeLocalHeader(&record, false) || !write(file.data)) {
+        return false;
+    }
+    m_records.append(record);
+    return true;
+}
+
+bool ZipWriter::streamFile(const Source &source, const Progress &progress, qint64 *bytesDone)
+{
+    QFile file(source.filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(QString("Could not read %1: %2").arg(source.filePath, file.errorString()));
+    }
+
+    CentralRecord record;
+    record.name = source.name.toUtf8();
+    record.method = kMethodDeflated;
+    dosDateTime(QFileInfo(file).lastModified(), &record.dosTime, &record.dosDate);
+    const bool zip64 = quint64(file.size()) >= kZip64LocalThreshold;
+    // CRC and sizes are filled in once the data has been written
+    if (!writeLocalHeader(&record, zip64)) {
+        return false;
+    }
+    const quint64 dataOffset = m_offset;
+
+    z_stream stream = {};
+    if (deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return fail(QString("Could not compress %1").arg(source.filePath));
+    }
+
+    QByteArray input(CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray output(CHUNK_SIZE, Qt::Uninitialized);
+    quint32 crc = quint32(crc32(0L, Z_NULL, 0));
+    quint64 total = 0;
+    bool ok = true;
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH) {
+        const qint64 read = file.read(input.data(), CHUNK_SIZE);
+        if (read < 0) {
+            ok = fail(QString("Could not read %1: %2").arg(source.filePath, file.errorString()));
+            break;
+        }
+        flush = file.atEnd() || read == 0 ? Z_FINISH : Z_NO_FLUSH;
+        crc = quint32(crc32(crc, reinterpret_cast<const Bytef *>(input.constData()), uInt(read)));
+        total += quint64(read);
+
+        stream.next_in = reinterpret_cast<Bytef *>(input.data());
+        stream.avail_in = uInt(read);
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(output.data());
+            stream.avail_out = uInt(output.size());
+            if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+                ok = fail(QString("Could not compress %1").arg(source.filePath));
+                break;
+            }
+            const int produced = output.size() - int(stream.avail_out);
+            if (produced > 0 && !write(QByteArray::fromRawData(output.constData(), produced))) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0);
+
+        *bytesDone += read;
+        if (ok && progress && !progress(*bytesDone)) {
+            ok = fail("Cancelled");
+        }
+    }
+    deflateEnd(&stream);
+    if (!ok) {
+        return false;
+    }
+
+    record.crc = crc;
+    record.uncompressedSize = total;
+    record.compressedSize = m_offset - dataOffset;
+    if (!zip64 && (record.uncompressedSize >= kMax32 || record.compressedSize >= kMax32)) {
+        return fail(QString("%1 grew while it was being exported").arg(source.filePath));
+    }
+
+    // Patch the local header now that CRC and sizes are known
+    QByteArray patch;
+    put32(patch, record.crc);
+    put32(patch, zip64 ? kMax32 : quint32(record.compressedSize));
+    put32(patch, zip64 ? kMax32 : quint32(record.uncompressedSize));
+    bool patched = m_file.seek(qint64(record.offset) + 14) && m_file.write(patch) == patch.size();
+    if (patched && zip64) {
+        QByteArray sizes;
+        put64(sizes, record.uncompressedSize);
+        put64(sizes, record.compressedSize);
+        patched = m_file.seek(qint64(record.offset) + 30 + record.name.size() + 4)
+            && m_file.write(sizes) == sizes.size();
+    }
+    if (!patched || !m_file.seek(qint64(m_offset))) {
+        return fail(QString("Could not write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+    }
+
+    m_records.append(record);
+    return true;
+}
+
+bool ZipWriter::writeLocalHeader(CentralRecord *record, bool zip64)
+{
+    record->offset = m_offset;
+
+    QByteArray header;
+    put32(header, kLocalHeaderSignature);
+    put16(header, zip64 ? kVersionZip64 : kVersionDefault);
+    put16(header, kFlagUtf8);
+    put16(header, record->method);
+    put16(header, record->dosTime);
+    put16(header, record->dosDate);
+    put32(header, record->crc);
+    put32(header, zip64 ? kMax32 : quint32(record->compressedSize));
+    put32(header, zip64 ? kMax32 : quint32(record->uncompressedSize));
+    put16(header, quint16(record->name.size()));
+    put16(header, zip64 ? 20 : 0);
+    header.append(record->name);
+    if (zip64) {
+        put16(header, kZip64ExtraTag);
+        put16(header, 16);
+        put64(header, record->uncompressedSize);
+        put64(header, record->compressedSize);
+    }
+    return write(header);
+}
+
+bool ZipWriter::write(const QByteArray &data)
+{
+    if (m_failed) {
+        return false;
+    }
+    if (m_file.write(data) != data.size()) {
+        return fail(QString("Could not write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+    }
+    m_offset += quint64(data.size());
+    return true;
+}
+
+bool ZipWriter::fail(const QString &message)
+{
+    if (!m_failed) {
+        m_failed = true;
+        m_error = message;
+        qWarning() << "ZipWriter:" << message;
+    }
+    return false;
+}
+
+void ZipWriter::dosDateTime(const QDateTime &modified, quint16 *time, quint16 *date)
+{
+    // DOS timestamps start in 1980 and have two-second resolution
+    QDateTime local = modified.isValid() ? modified.toLocalTime() : QDateTime::currentDateTime();
+    if (local.date().year() < 1980) {
+        local = QDateTime(QDate(1980, 1, 1), QTime(0, 0));
+    }
+    const QDate d = local.date();
+    const QTime t = local.time();
+    *time = quint16((t.hour() << 11) | (t.minute() << 5) | (t.second() / 2));
+    *date = quint16(((d.year() - 1980) << 9) | (d.month() << 5) | d.day());
+}
@@ -0,0 +1,87 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include <QDateTime>
+#include <QSaveFile>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// Writes a ZIP archive (deflate, with ZIP64 where sizes or offsets need it)
+// without holding more than a bounded amount of it in memory.
+//
+// addFiles() runs a read -> compress -> write pipeline: small files are read
+// and deflated on the global thread pool, several at a time, and written to
+// the archive in order as they complete; at most MAX_IN_FLIGHT_BYTES of
+// input is being worked on at once. Files too big for that are streamed
+// through a single deflate stream in chunks instead. The archive is written
+// through a QSaveFile, so a failed or cancelled export leaves nothing behind.
+class ZipWriter
+{
+public:
+    struct Source {
+        QString name;     // Path inside the archive, '/' separated
+        QString filePath; // File on disk
+    };
+
+    // Called with the number of input bytes processed so far; returning
+    // false cancels the export
+    using Progress = std::function<bool(qint64 bytesDone)>;
+
+    explicit ZipWriter(const QString &path);
+    ~ZipWriter();
+
+    bool open();
+    bool addDirectory(const QString &name, const QDateTime &modified);
+    bool addFiles(const QVector<Source> &files, const Progress &progress = Progress());
+    // Writes the central directory and moves the archive into place
+    bool close();
+
+    QString errorString() const { return m_error; }
+
+private:
+    struct CentralRecord {
+        QByteArray name; // UTF-8
+        quint16 method = 0;
+        quint16 dosTime = 0;
+        quint16 dosDate = 0;
+        quint32 crc = 0;
+        quint64 compressedSize = 0;
+        quint64 uncompressedSize = 0;
+        quint64 offset = 0;
+        bool directory = false;
+    };
+
+    struct CompressedFile {
+        QString name;
+        QDateTime modified;
+        quint16 method = 0;
+        quint32 crc = 0;
+        quint64 uncompressedSize = 0;
+        QByteArray data; // Deflated (or stored) bytes
+        QString error;
+    };
+
+    static CompressedFile compressFile(const Source &source);
+    bool writeCompressed(const CompressedFile &file);
+    bool streamFile(const Source &source, const Progress &progress, qint64 *bytesDone);
+    bool writeLocalHeader(CentralRecord *record, bool zip64);
+    bool write(const QByteArray &data);
+    bool fail(const QString &message);
+
+    static void dosDateTime(const QDateTime &modified, quint16 *time, quint16 *date);
+
+    QSaveFile m_file;
+    QVector<CentralRecord> m_records;
+    quint64 m_offset = 0;
+    bool m_failed = false;
+    QString m_error;
+
+    static const int COMPRESSION_LEVEL = 6;
+    static const int CHUNK_SIZE = 256 * 1024;
+    // Files above this are streamed rather than compressed in one piece
+    static const qint64 STREAM_THRESHOLD = 8 * 1024 * 1024;
+    static const qint64 MAX_IN_FLIGHT_BYTES = 64 * 1024 * 1024;
+};
+
+#endif // ZIPWRITER_H